@@ -2,6 +2,7 @@
 #include "GLFW/glfw3.h"
 #include "glad/glad.h"
 #include "glbasimac/glbi_engine.hpp"
+#include "glbasimac/glbi_app_loop.hpp"
 #include <iostream>
 
 using namespace glbasimac;
@@ -45,33 +46,20 @@ int main() {
 	// Initialize Rendering Engine
 	myEngine.initGL();
 
-	/* Loop until the user closes the window */
-	while (!glfwWindowShouldClose(window))
-	{
-		/* Get time (in second) at loop beginning */
-		double startTime = glfwGetTime();
-
+	/* Static scene : images are drawn only after events, at most every FRAMERATE_IN_SECONDS */
+	GLBI_App_Loop loop;
+	loop.onDemand = true;
+	loop.targetFrameTime = FRAMERATE_IN_SECONDS;
+	loop.render = [&](double /*alpha*/) {
 		/* Render here */
 		glClearColor(0.2f,0.f,0.f,0.f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
         // render here
+	};
 
-		/* Swap front and back buffers */
-		glfwSwapBuffers(window);
-
-		/* Poll for and process events */
-		glfwPollEvents();
-
-		/* Elapsed time computation from loop begining */
-		double elapsedTime = glfwGetTime() - startTime;
-		/* If to few time is spend vs our wanted FPS, we wait */
-		while(elapsedTime < FRAMERATE_IN_SECONDS)
-		{
-			glfwWaitEventsTimeout(FRAMERATE_IN_SECONDS-elapsedTime);
-			elapsedTime = glfwGetTime() - startTime;
-		}
-	}
+	/* Loop until the user closes the window */
+	loop.run(window);
 
     glfwTerminate();
     return 0;
@@ -2,6 +2,8 @@
 #include "GLFW/glfw3.h"
 #include "glad/glad.h"
 #include "glbasimac/glbi_engine.hpp"
+#include "glbasimac/glbi_app_loop.hpp"
+#include <algorithm>
 #include <iostream>
 
 using namespace glbasimac;
@@ -16,6 +18,9 @@ GLBI_Engine myEngine;
 /* Background color */
 static float bgColor[3] = {0.2f, 0.0f, 0.0f};
 
+/* Color change per second while a key is held */
+static const float COLOR_SPEED = 3.0f;
+
 /* Key states */
 static bool increaseRed = false;
 static bool increaseGreen = false;
@@ -139,44 +144,31 @@ int main() {
     // Initialize Rendering Engine
     myEngine.initGL();
 
-    /* Loop until the user closes the window */
-    while (!glfwWindowShouldClose(window))
-    {
-        /* Get time (in second) at loop beginning */
-        double startTime = glfwGetTime();
-
-        /* Update background color based on key states */
-        if (shiftPressed) {
-            if (increaseRed && bgColor[0] > 0.0f) bgColor[0] -= 0.1f;
-            if (increaseGreen && bgColor[1] > 0.0f) bgColor[1] -= 0.1f;
-            if (increaseBlue && bgColor[2] > 0.0f) bgColor[2] -= 0.1f;
-        } else {
-            if (increaseRed && bgColor[0] < 1.0f) bgColor[0] += 0.1f;
-            if (increaseGreen && bgColor[1] < 1.0f) bgColor[1] += 0.1f;
-            if (increaseBlue && bgColor[2] < 1.0f) bgColor[2] += 0.1f;
-        }
-
+    /* Background color changes while keys are held (fixed simulation steps). Images are drawn
+     * only after events or while a color changes, at most every FRAMERATE_IN_SECONDS */
+    GLBI_App_Loop loop;
+    loop.onDemand = true;
+    loop.targetFrameTime = FRAMERATE_IN_SECONDS;
+    loop.update = [](double dt) {
+        float step = COLOR_SPEED * dt;
+        if (shiftPressed) step = -step;
+        if (increaseRed) bgColor[0] = std::max(0.0f, std::min(bgColor[0] + step, 1.0f));
+        if (increaseGreen) bgColor[1] = std::max(0.0f, std::min(bgColor[1] + step, 1.0f));
+        if (increaseBlue) bgColor[2] = std::max(0.0f, std::min(bgColor[2] + step, 1.0f));
+    };
+    loop.render = [&](double /*alpha*/) {
         /* Render here */
         glClearColor(bgColor[0], bgColor[1], bgColor[2], 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
         // render here
 
-        /* Swap front and back buffers */
-        glfwSwapBuffers(window);
+        /* Keep drawing while a color changes, else wait for events */
+        if (increaseRed || increaseGreen || increaseBlue) loop.requestRedraw();
+    };
 
-        /* Poll for and process events */
-        glfwPollEvents();
-
-        /* Elapsed time computation from loop begining */
-        double elapsedTime = glfwGetTime() - startTime;
-        /* If to few time is spend vs our wanted FPS, we wait */
-        while(elapsedTime < FRAMERATE_IN_SECONDS)
-        {
-            glfwWaitEventsTimeout(FRAMERATE_IN_SECONDS-elapsedTime);
-            elapsedTime = glfwGetTime() - startTime;
-        }
-    }
+    /* Loop until the user closes the window */
+    loop.run(window);
 
     glfwTerminate();
     return 0;
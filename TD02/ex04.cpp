@@ -2,6 +2,7 @@
 #include "GLFW/glfw3.h"
 #include "glad/glad.h"
 #include "glbasimac/glbi_engine.hpp"
+#include "glbasimac/glbi_app_loop.hpp"
 #include "glbasimac/glbi_set_of_points.hpp"
 #include "glbasimac/glbi_convex_2D_shape.hpp"
 #include <iostream>
@@ -118,9 +119,9 @@ void initScene() {
     cercle.initShape(pointsCercle);
     
     // Changer le mode de rendu pour permettre le remplissage
-    carre.changeNature(GL_POLYGON);  // GL_LINE_LOOP pour contour, GL_POLYGON pour remplissage
-    triangle.changeNature(GL_POLYGON);
-    cercle.changeNature(GL_POLYGON);
+    carre.changeNature(GL_TRIANGLE_FAN);  // GL_LINE_LOOP pour contour, GL_TRIANGLE_FAN pour remplissage
+    triangle.changeNature(GL_TRIANGLE_FAN);
+    cercle.changeNature(GL_TRIANGLE_FAN);
     
     // Initialisation des points (code existant)
     // Créer un vector de float contenant les coordonnées des points
@@ -211,34 +212,21 @@ int main() {
     glfwSetMouseButtonCallback(window, onMouseButton);
     glfwSetKeyCallback(window, onKeyboard);
 	
-	/* Loop until the user closes the window */
-	while (!glfwWindowShouldClose(window))
-	{
-		/* Get time (in second) at loop beginning */
-		double startTime = glfwGetTime();
-
+	/* Static scene : images are drawn only after events, at most every FRAMERATE_IN_SECONDS */
+	GLBI_App_Loop loop;
+	loop.onDemand = true;
+	loop.targetFrameTime = FRAMERATE_IN_SECONDS;
+	loop.render = [&](double /*alpha*/) {
 		/* Render here */
 		glClearColor(0.2f,0.f,0.f,0.f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
         // Rendu de la scène
         renderScene();
+	};
 
-		/* Swap front and back buffers */
-		glfwSwapBuffers(window);
-
-		/* Poll for and process events */
-		glfwPollEvents();
-
-		/* Elapsed time computation from loop begining */
-		double elapsedTime = glfwGetTime() - startTime;
-		/* If to few time is spend vs our wanted FPS, we wait */
-		while(elapsedTime < FRAMERATE_IN_SECONDS)
-		{
-			glfwWaitEventsTimeout(FRAMERATE_IN_SECONDS-elapsedTime);
-			elapsedTime = glfwGetTime() - startTime;
-		}
-	}
+	/* Loop until the user closes the window */
+	loop.run(window);
 
     glfwTerminate();
     return 0;
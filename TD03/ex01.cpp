@@ -3,7 +3,11 @@
 #include "glad/glad.h"
 #include "glbasimac/glbi_engine.hpp"
 #include "glbasimac/glbi_set_of_points.hpp"
-#include "glbasimac/glbi_convex_2D_shape.hpp"
+#include "glbasimac/glbi_batch_2D.hpp"
+#include "glbasimac/glbi_transform_node.hpp"
+#include "glbasimac/glbi_profiler.hpp"
+#include "glbasimac/glbi_app_loop.hpp"
+#include <cstring>
 
 using namespace glbasimac;
 
@@ -11,191 +15,174 @@ using namespace glbasimac;
 static const double FRAMERATE_IN_SECONDS = 1. / 30.;
 static float aspectRatio = 1.0f;
 
-/* Animation parameters */
-static float angle1 = 0.0f;  // Angle for the first arm rotation
-static float angle2 = 0.0f;  // Angle for the second arm rotation
-static float angle3 = 0.0f;  // Angle for the third arm (beater) rotation
+/* Animation parameters, advanced by fixed simulation steps (see updateAnimation) */
+static float angle1 = 0.0f;  // Angle for the first arm rotation (degrees)
+static float phase2 = 0.0f;  // Phase of the second arm oscillation
+static float phase3 = 0.0f;  // Phase of the third arm (beater) oscillation
 static float animationSpeed = 1.0f;  // Speed of the animation
+/* Values of the previous step : drawn frames interpolate between the two last steps */
+static float prevAngle1 = 0.0f;
+static float prevPhase2 = 0.0f;
+static float prevPhase3 = 0.0f;
 
 /* OpenGL Engine */
 GLBI_Engine myEngine;
-GLBI_Convex_2D_Shape carre;
-GLBI_Convex_2D_Shape cercle;
+/* Frame profiler : summary in the window title, P prints the zones, T records a trace */
+GLBI_Profiler profiler;
+/* Every part of the pile is written in one batch : a handful of draws whatever the number of parts */
+GLBI_Batch_2D batch(myEngine);
+
+/* Shapes of the parts : unit square centered on the origin, unit circle (outline) */
+enum PartShape { SQUARE, CIRCLE };
+static const float CIRCLE_LINE_WIDTH = 0.5f;
+
+/* Transform hierarchy of the pile : matrices are only recomputed for nodes that move */
+GLBI_Transform_Node pileNode;                       // Origin of the pile
+GLBI_Transform_Node baseNode(&pileNode);            // Base rectangle
+GLBI_Transform_Node arm1Node(&pileNode);            // First arm (rotation angle1)
+GLBI_Transform_Node arm1CircleNode(&arm1Node);      // Large circle
+GLBI_Transform_Node arm1BarNode(&arm1Node);         // Trapezoid
+GLBI_Transform_Node arm1EndNode(&arm1Node);         // End of the first arm
+GLBI_Transform_Node arm1EndCircleNode(&arm1EndNode); // Small circle
+GLBI_Transform_Node arm2Node(&arm1EndNode);         // Second arm (rotation angle2)
+GLBI_Transform_Node arm2BarNode(&arm2Node);         // Rectangular part
+GLBI_Transform_Node arm2PivotNode(&arm2Node);       // Pivot on the first arm
+GLBI_Transform_Node arm2EndNode(&arm2Node);         // End of the second arm
+GLBI_Transform_Node arm2EndPivotNode(&arm2EndNode); // Pivot on the third arm
+GLBI_Transform_Node arm3Node(&arm2EndNode);         // Third arm (rotation angle3)
+GLBI_Transform_Node arm3BarNode(&arm3Node);         // Rod
+GLBI_Transform_Node arm3PivotNode(&arm3Node);       // Pivot on the second arm
+GLBI_Transform_Node arm3EndNode(&arm3Node);         // End of the third arm
+GLBI_Transform_Node ballNode(&arm3EndNode);         // The beater
 
 // Déclarations anticipées des fonctions pour résoudre les dépendances cycliques
 void drawFirstArm();
 void drawSecondArm();
 void drawThirdArm();
-void drawRoundedSquare();
 
 /**
- * Draws the main arm with two circles and a trapezoid
+ * Set the fixed transforms of the pile (only rotations of the arms are animated)
  */
-void drawFirstArm() {
-    // Save current matrix
-    glPushMatrix();
-    
-    // Apply rotation around the origin (large circle center)
-    glRotatef(angle1, 0.0f, 0.0f, 1.0f);
-    
-    // Draw the large circle (radius = 20)
-    glColor3f(0.8f, 0.8f, 0.8f); // Light gray
-    glPushMatrix();
-    glScalef(20.0f, 20.0f, 1.0f);
-    cercle.drawShape();
-    glPopMatrix();
-    
-    // Draw the trapezoid (connecting the two circles)
-    glColor3f(0.7f, 0.7f, 0.7f); // Slightly darker gray
-    glBegin(GL_QUADS);
-        glVertex2f(-10.0f, -5.0f);   // Bottom left
-        glVertex2f(50.0f, -5.0f);    // Bottom right
-        glVertex2f(50.0f, 5.0f);     // Top right
-        glVertex2f(-10.0f, 5.0f);    // Top left
-    glEnd();
-    
-    // Move to the right to draw the small circle
-    glTranslatef(50.0f, 0.0f, 0.0f);
-    
-    // Draw the small circle (radius = 10)
-    glColor3f(0.85f, 0.85f, 0.85f); // Slightly lighter gray
-    glPushMatrix();
-    glScalef(10.0f, 10.0f, 1.0f);
-    cercle.drawShape();
-    glPopMatrix();
-    
-    // Draw the second arm from this pivot point
-    drawSecondArm();
-    
-    // Restore matrix
-    glPopMatrix();
+void initPile() {
+    // Move the origin to lower part of the screen
+    pileNode.setTranslation(0.0f, -30.0f, 0.0f);
+    // Base : rectangle from (-30,-10) to (30,0)
+    baseNode.setTranslation(0.0f, -5.0f, 0.0f);
+    baseNode.setScale(60.0f, 10.0f, 1.0f);
+
+    // First arm : large circle (radius 20), trapezoid from (-10,-5) to (50,5), small circle (radius 10)
+    arm1CircleNode.setScale(20.0f, 20.0f, 1.0f);
+    arm1BarNode.setTranslation(20.0f, 0.0f, 0.0f);
+    arm1BarNode.setScale(60.0f, 10.0f, 1.0f);
+    arm1EndNode.setTranslation(50.0f, 0.0f, 0.0f);
+    arm1EndCircleNode.setScale(10.0f, 10.0f, 1.0f);
+
+    // Second arm : rectangle from (0,-3) to (40,3) and two pivots
+    arm2BarNode.setTranslation(20.0f, 0.0f, 0.0f);
+    arm2BarNode.setScale(40.0f, 6.0f, 1.0f);
+    arm2PivotNode.setScale(5.0f, 5.0f, 1.0f);
+    arm2EndNode.setTranslation(40.0f, 0.0f, 0.0f);
+    arm2EndPivotNode.setScale(5.0f, 5.0f, 1.0f);
+
+    // Third arm : rod from (0,-2) to (35,2), pivot and ball
+    arm3BarNode.setTranslation(17.5f, 0.0f, 0.0f);
+    arm3BarNode.setScale(35.0f, 4.0f, 1.0f);
+    arm3PivotNode.setScale(4.0f, 4.0f, 1.0f);
+    arm3EndNode.setTranslation(35.0f, 0.0f, 0.0f);
+    ballNode.setScale(8.0f, 8.0f, 1.0f);
 }
 
 /**
- * Draws a square with rounded corners
+ * Draws a shape with the transform of a node
  */
-void drawRoundedSquare() {
-    // Using a simple square for now
-    glPushMatrix();
-    glScalef(5.0f, 5.0f, 1.0f);
-    carre.drawShape();
-    glPopMatrix();
+void drawPart(GLBI_Transform_Node& node, PartShape shape, float r, float g, float b) {
+    batch.setColor(r, g, b);
+    batch.transform.loadTransformation(node.getWorldMatrix());
+    if (shape == SQUARE) {
+        batch.rectangle(-0.5f, -0.5f, 0.5f, 0.5f);
+    } else {
+        batch.circleOutline(0.0f, 0.0f, 1.0f, CIRCLE_LINE_WIDTH);
+    }
+}
+
+/**
+ * Draws the main arm with two circles and a trapezoid
+ */
+void drawFirstArm() {
+    drawPart(arm1CircleNode, CIRCLE, 0.8f, 0.8f, 0.8f);     // Light gray
+    drawPart(arm1BarNode, SQUARE, 0.7f, 0.7f, 0.7f);         // Slightly darker gray
+    drawPart(arm1EndCircleNode, CIRCLE, 0.85f, 0.85f, 0.85f); // Slightly lighter gray
+
+    // Draw the second arm from this pivot point
+    drawSecondArm();
 }
 
 /**
  * Draws the second arm
  */
 void drawSecondArm() {
-    glPushMatrix();
-    
-    // Apply rotation for the second arm
-    glRotatef(angle2, 0.0f, 0.0f, 1.0f);
-    
-    // Draw the rectangular part of the arm
-    glColor3f(0.6f, 0.6f, 0.6f);
-    glBegin(GL_QUADS);
-        glVertex2f(0.0f, -3.0f);   // Bottom left
-        glVertex2f(40.0f, -3.0f);  // Bottom right
-        glVertex2f(40.0f, 3.0f);   // Top right
-        glVertex2f(0.0f, 3.0f);    // Top left
-    glEnd();
-    
-    // Draw the pivot on the left side (connection to first arm)
-    glColor3f(0.7f, 0.7f, 0.7f);
-    glPushMatrix();
-    glScalef(5.0f, 5.0f, 1.0f);
-    cercle.drawShape();
-    glPopMatrix();
-    
-    // Draw the pivot at the end of the arm (connection to third arm)
-    glTranslatef(40.0f, 0.0f, 0.0f);
-    glColor3f(0.75f, 0.75f, 0.75f);
-    glPushMatrix();
-    glScalef(5.0f, 5.0f, 1.0f);
-    cercle.drawShape();
-    glPopMatrix();
-    
+    drawPart(arm2BarNode, SQUARE, 0.6f, 0.6f, 0.6f);
+    drawPart(arm2PivotNode, CIRCLE, 0.7f, 0.7f, 0.7f);
+    drawPart(arm2EndPivotNode, CIRCLE, 0.75f, 0.75f, 0.75f);
+
     // Draw the third arm from this pivot point
     drawThirdArm();
-    
-    glPopMatrix();
 }
 
 /**
  * Draws the beater/striker component
  */
 void drawThirdArm() {
-    glPushMatrix();
-    
-    // Apply rotation for the third arm (beater)
-    glRotatef(angle3, 0.0f, 0.0f, 1.0f);
-    
-    // Draw the rod
-    glColor3f(0.5f, 0.5f, 0.5f);
-    glBegin(GL_QUADS);
-        glVertex2f(0.0f, -2.0f);   // Bottom left
-        glVertex2f(35.0f, -2.0f);  // Bottom right
-        glVertex2f(35.0f, 2.0f);   // Top right
-        glVertex2f(0.0f, 2.0f);    // Top left
-    glEnd();
-    
-    // Draw the pivot on the left side (connection to second arm)
-    glColor3f(0.65f, 0.65f, 0.65f);
-    glPushMatrix();
-    glScalef(4.0f, 4.0f, 1.0f);
-    cercle.drawShape();
-    glPopMatrix();
-    
-    // Draw the ball at the end (the beater)
-    glTranslatef(35.0f, 0.0f, 0.0f);
-    glColor3f(0.9f, 0.3f, 0.3f); // Red for the beater
-    glPushMatrix();
-    glScalef(8.0f, 8.0f, 1.0f);
-    cercle.drawShape();
-    glPopMatrix();
-    
-    glPopMatrix();
+    drawPart(arm3BarNode, SQUARE, 0.5f, 0.5f, 0.5f);
+    drawPart(arm3PivotNode, CIRCLE, 0.65f, 0.65f, 0.65f);
+    drawPart(ballNode, CIRCLE, 0.9f, 0.3f, 0.3f); // Red for the beater
 }
 
 /**
  * Draws the complete mechanical pile
  */
 void drawCompletePile() {
-    glPushMatrix();
-    
-    // Move the origin to lower part of the screen
-    glTranslatef(0.0f, -30.0f, 0.0f);
-    
-    // Draw the base of the pile
-    glColor3f(0.4f, 0.4f, 0.4f);
-    glBegin(GL_QUADS);
-        glVertex2f(-30.0f, -10.0f);
-        glVertex2f(30.0f, -10.0f);
-        glVertex2f(30.0f, 0.0f);
-        glVertex2f(-30.0f, 0.0f);
-    glEnd();
-    
+    drawPart(baseNode, SQUARE, 0.4f, 0.4f, 0.4f);
+
     // Draw the main arm assembly
     drawFirstArm();
-    
-    glPopMatrix();
 }
 
 /**
- * Updates the animation angles
+ * Updates the animation for a simulation step of dt seconds : the speed does not depend on the frame rate
  */
-void updateAnimation() {
-    // Update the angles for each arm
-    angle1 += 0.5f * animationSpeed;
-    angle2 = 30.0f * sin(glfwGetTime() * 1.5f * animationSpeed);
-    angle3 = 45.0f * sin(glfwGetTime() * 2.0f * animationSpeed);
+void updateAnimation(double dt) {
+    prevAngle1 = angle1;
+    prevPhase2 = phase2;
+    prevPhase3 = phase3;
+
+    // First arm turns at 15 degrees per second, the others oscillate
+    angle1 += 15.0f * animationSpeed * dt;
+    phase2 += 1.5f * animationSpeed * dt;
+    phase3 += 2.0f * animationSpeed * dt;
     
     // Make sure the angles stay within a reasonable range
     if (angle1 > 360.0f) {
         angle1 -= 360.0f;
+        prevAngle1 -= 360.0f;
     }
 }
 
+/**
+ * Sets the arm rotations between the two last steps (alpha in [0,1[)
+ */
+void setPose(float alpha) {
+    float a1 = prevAngle1 + alpha * (angle1 - prevAngle1);
+    float a2 = 30.0f * sin(prevPhase2 + alpha * (phase2 - prevPhase2));
+    float a3 = 45.0f * sin(prevPhase3 + alpha * (phase3 - prevPhase3));
+
+    // Only the arm nodes (and their children) will be recomputed
+    const Vector3D zAxis(0.0f, 0.0f, 1.0f);
+    arm1Node.setRotation(a1 * M_PI / 180.0f, zAxis);
+    arm2Node.setRotation(a2 * M_PI / 180.0f, zAxis);
+    arm3Node.setRotation(a3 * M_PI / 180.0f, zAxis);
+}
+
 /* Error handling function */
 void onError(int error, const char* description) {
     std::cout << "GLFW Error (" << error << ") : " << description << std::endl;
@@ -224,9 +211,25 @@ void onKeyPressed(GLFWwindow* window, int key, int /*scancode*/, int action, int
     if (key == GLFW_KEY_DOWN && action == GLFW_PRESS) {
         animationSpeed *= 0.8f; // Decrease speed
     }
+
+    // Profiling
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        std::cout << profiler.report();
+    }
+    if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+        if (!profiler.tracing) {
+            profiler.startTrace();
+            std::cout << "Recording a trace (T again to stop)" << std::endl;
+        } else {
+            profiler.stopTrace();
+            if (profiler.writeTrace("TD03_ex01_trace.json")) {
+                std::cout << profiler.trace.size() << " frames written in TD03_ex01_trace.json" << std::endl;
+            }
+        }
+    }
 }
 
-int main() {
+int main(int argc, char** argv) {
     // Initialize the library
     if (!glfwInit()) {
         return -1;
@@ -256,71 +259,62 @@ int main() {
 
     // Initialize Rendering Engine
     myEngine.initGL();
+    profiler.init();
     
-    // Initialize the square and circle shapes
-    // Create a square (unit size)
-    std::vector<float> squareVertices = {
-        -0.5f, -0.5f,
-        0.5f, -0.5f,
-        0.5f, 0.5f,
-        -0.5f, 0.5f
-    };
-    carre.initShape(squareVertices);
-    
-    // Create a circle (unit radius)
-    std::vector<float> circleVertices;
-    const int numSegments = 32;
-    for (int i = 0; i < numSegments; ++i) {
-        float angle = 2.0f * M_PI * i / numSegments;
-        circleVertices.push_back(cos(angle));
-        circleVertices.push_back(sin(angle));
-    }
-    cercle.initShape(circleVertices);
+    initPile();
     
     // Print instructions
     std::cout << "===== Pile Mécanique - TD03 Ex01 =====" << std::endl;
     std::cout << "Utilisez les flèches HAUT/BAS pour changer la vitesse d'animation" << std::endl;
+    std::cout << "Appuyez sur P pour afficher le profil d'une image, T pour enregistrer une trace" << std::endl;
     std::cout << "Appuyez sur ECHAP pour quitter" << std::endl;
-    
-    /* Loop until the user closes the window */
-    while (!glfwWindowShouldClose(window)) {
-        /* Get time (in second) at loop beginning */
-        double startTime = glfwGetTime();
+    std::cout << "(--benchmark : images sans limite de fréquence, statistiques à la fin)" << std::endl;
 
+    /* Fixed simulation steps, images at most every FRAMERATE_IN_SECONDS (the profiler frames are handled by the loop) */
+    GLBI_App_Loop loop;
+    loop.targetFrameTime = FRAMERATE_IN_SECONDS;
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+        loop.benchmark = true;
+        loop.benchmarkFrames = 2000;
+    }
+    double titleTime = 0.0;
+    loop.update = [](double dt) {
+        GLBI_PROFILE_ZONE(profiler, "animation");
+        updateAnimation(dt);
+    };
+    loop.render = [&](double alpha) {
         /* Render here */
         glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
         
         // Set up the view with proper aspect ratio
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
         if (aspectRatio > 1.0f) {
-            glOrtho(-100.0 * aspectRatio, 100.0 * aspectRatio, -100.0, 100.0, -1.0, 1.0);
+            myEngine.set2DProjection(-100.0f * aspectRatio, 100.0f * aspectRatio, -100.0f, 100.0f);
         } else {
-            glOrtho(-100.0, 100.0, -100.0 / aspectRatio, 100.0 / aspectRatio, -1.0, 1.0);
+            myEngine.set2DProjection(-100.0f, 100.0f, -100.0f / aspectRatio, 100.0f / aspectRatio);
         }
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
         
-        // Update animation and draw the complete pile
-        updateAnimation();
-        drawCompletePile();
-
-        /* Swap front and back buffers */
-        glfwSwapBuffers(window);
-
-        /* Poll for and process events */
-        glfwPollEvents();
-
-        /* Elapsed time computation from loop beginning */
-        double elapsedTime = glfwGetTime() - startTime;
-        /* If too little time is spent vs our wanted FPS, we wait */
-        while(elapsedTime < FRAMERATE_IN_SECONDS) {
-            glfwWaitEventsTimeout(FRAMERATE_IN_SECONDS-elapsedTime);
-            elapsedTime = glfwGetTime() - startTime;
+        // Draw the complete pile between the two last animation steps
+        {
+            GLBI_PROFILE_ZONE(profiler, "pile");
+            setPose(alpha);
+            drawCompletePile();
+            batch.flush();
         }
-    }
 
+        /* Frame times in the title, twice a second */
+        if (loop.now() - titleTime > 0.5) {
+            glfwSetWindowTitle(window, ("Pile Mécanique - TD03 Ex01 - " + profiler.summary()).c_str());
+            titleTime = loop.now();
+        }
+    };
+
+    /* Loop until the user closes the window */
+    loop.run(window);
+    std::cout << loop.frameStats().toString() << std::endl;
+
+    batch.release();
+    profiler.release();
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
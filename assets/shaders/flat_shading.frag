@@ -1,17 +1,29 @@
 #version 410 core
 
+// Variants (see GLBI_Shader_Variant in glbi_engine.hpp) : with GLBI_VARIANT defined, texturing
+// depends on TEXTURED at compile time instead of the use_texture uniform
 in vec3 color;
 in vec2 uvs;
 
 layout(location = 0) out vec4 final_col;
 
+#ifndef GLBI_VARIANT
 uniform int use_texture; // 0 if not. 1 else
+#endif
 uniform sampler2D tex0;
 
 void main()
 {
+#ifdef GLBI_VARIANT
+#ifdef TEXTURED
+	final_col = texture(tex0,uvs);
+#else
+	final_col = vec4(color,1.0);
+#endif
+#else
 	final_col = vec4(color,1.0);
 	if (use_texture == 1) {
 		final_col = texture(tex0,uvs);
 	}
+#endif
 }
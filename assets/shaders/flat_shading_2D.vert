@@ -3,6 +3,8 @@
 layout(location=0) in vec2 vx_pos; // Indice 0
 layout(location=2) in vec2 vx_uvs; // Indice 2
 layout(location=3) in vec3 vx_col; // Indice 3
+layout(location=4) in mat4 vx_inst_mat; // Indices 4 to 7 : instance transform (identity if not instanced)
+layout(location=8) in vec4 vx_inst_col; // Indice 8 : instance color (null alpha if not instanced)
 
 uniform mat4 projectionMat;
 uniform mat4 modelviewMat;
@@ -12,9 +14,9 @@ out vec2 uvs;
 
 void main()
 {
-	gl_Position = projectionMat*modelviewMat*vec4(vx_pos.xy,0.0,1.0);
+	gl_Position = projectionMat*modelviewMat*vx_inst_mat*vec4(vx_pos.xy,0.0,1.0);
 
-	color = vx_col;
+	color = mix(vx_col,vx_inst_col.rgb,vx_inst_col.a);
 	uvs = vx_uvs;
 
 }
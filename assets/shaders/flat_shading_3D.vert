@@ -3,8 +3,19 @@
 layout(location=0) in vec3 vx_pos; // Indice 0
 layout(location=2) in vec2 vx_uvs; // Indice 3
 layout(location=3) in vec3 vx_col; // Indice 3
+layout(location=4) in mat4 vx_inst_mat; // Indices 4 to 7 : instance transform (identity if not instanced)
+layout(location=8) in vec4 vx_inst_col; // Indice 8 : instance color (null alpha if not instanced)
 
-uniform mat4 projectionMat;
+// Per-frame data shared by all 3D programs (see GLBI_Frame_Block in glbi_engine.hpp).
+// GLBI_MAX_LIGHTS is defined by the engine (GLBI_Engine::shaderDefines)
+layout(std140) uniform GLBI_Frame {
+	mat4 projectionMat;
+	mat4 viewMatrix;
+	vec4 attenuationFactor;              // xyz used
+	int numOfLight;
+	vec4 lightPos[GLBI_MAX_LIGHTS];
+	vec4 lightIntensity[GLBI_MAX_LIGHTS]; // rgb used
+};
 uniform mat4 modelviewMat;
 
 uniform int use_texture; // 0 if not. 1 else
@@ -14,7 +25,7 @@ out vec2 uvs;
 
 void main()
 {
-	gl_Position = projectionMat*modelviewMat*vec4(vx_pos,1.0);
-	color = vx_col;
+	gl_Position = projectionMat*modelviewMat*vx_inst_mat*vec4(vx_pos,1.0);
+	color = mix(vx_col,vx_inst_col.rgb,vx_inst_col.a);
 	uvs = vx_uvs;
 }
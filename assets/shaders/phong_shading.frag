@@ -3,22 +3,35 @@
 #define M_PI 3.1415926535897932384626433832795
 const int Nmax = 255;
 
+// GLBI_Engine compiles this shader in variants (see GLBI_Shader_Variant in glbi_engine.hpp), with
+// GLBI_VARIANT, TEXTURED, SPECULAR, NUM_POINT_LIGHTS and NUM_DIR_LIGHTS defined before this line :
+// texturing, specular and the light loop are then fixed at compile time.
+// Without GLBI_VARIANT, the generic program tests use_texture, shininess and the lights per fragment.
+
 in vec3 color; // Couleur flat du point de l'objet (si existe)
 in vec2 uvs;   // Coordonnees de texture du point de l'object (dans le repere camera)
 in vec3 nml;   // Normale du point de l'object (dans le repere camera)
 in vec3 pos;   // Position dans le repere camera
 
 uniform sampler2D tex0;
+#ifndef GLBI_VARIANT
 uniform int use_texture; // 0 if not. 1 else
+#endif
 
 uniform vec3 c_spec;
 uniform float shininess;
 
-uniform vec3 attenuationFactor;
-uniform int numOfLight;
-uniform vec4 lightPos[6];
-uniform vec3 lightIntensity[6];
-uniform mat4 viewMatrix;
+// Per-frame data shared by all 3D programs (see GLBI_Frame_Block in glbi_engine.hpp).
+// GLBI_MAX_LIGHTS is defined by the engine (GLBI_Engine::shaderDefines)
+// Point lights come first in the arrays, then directional lights
+layout(std140) uniform GLBI_Frame {
+	mat4 projectionMat;
+	mat4 viewMatrix;
+	vec4 attenuationFactor;              // xyz used
+	int numOfLight;
+	vec4 lightPos[GLBI_MAX_LIGHTS];
+	vec4 lightIntensity[GLBI_MAX_LIGHTS]; // rgb used
+};
 
 layout(location = 0) out vec4 final_col;
 
@@ -32,56 +45,80 @@ float saturate(float val) {
 	return val;
 }
 
-vec4 lambert(int idLight) {
-	// Normal normalization
-	vec3 nml_cam = normalize(nml);
-
-	// Computing vector PL and setting lambert term
-	vec3 dir_illu;
-	if (lightPos[idLight].w > 0.0) {
-		vec3 ptlight = vec3(viewMatrix*vec4(lightPos[idLight].xyz,1.0f));
-		dir_illu = ptlight - pos;
-	}
-	else {
-		dir_illu = vec3(viewMatrix*lightPos[idLight]);
-	}
-	float dist = length(dir_illu);
-	vec3 dir_illu_nml = normalize(dir_illu);
-	float cos_illu = saturate(dot(dir_illu_nml,nml_cam));
-
-	vec3 L = lightIntensity[idLight];
-	float attenuation;
-	if (lightPos[idLight].w > 0.0) {
-		attenuation = 1.0f/(attenuationFactor.x+attenuationFactor.y*dist+attenuationFactor.z*dist*dist);
-	}
-	else {
-		attenuation = attenuationFactor.x;
+vec3 diffuseColor() {
+#ifdef GLBI_VARIANT
+#ifdef TEXTURED
+	return objTexture().rgb;
+#else
+	return color;
+#endif
+#else
+	if (use_texture == 1) {
+		return objTexture().rgb;
 	}
+	return color;
+#endif
+}
 
-	// Shininess
+float specularIntensity(vec3 dir_illu_nml,vec3 nml_cam) {
 	vec3 view_dir = normalize(-pos);
 	vec3 halfVector = normalize(view_dir + dir_illu_nml);
-	float spec_intensity = 0.0;
+	return pow(saturate(dot(nml_cam,halfVector)),shininess);
+}
+
+// Light reflected toward the camera for a light coming from dir_illu (in camera frame)
+vec3 lambert(vec3 dir_illu,vec3 L,vec3 nml_cam,vec3 c_dif) {
+	vec3 dir_illu_nml = normalize(dir_illu);
+	float cos_illu = saturate(dot(dir_illu_nml,nml_cam));
+	vec3 col = c_dif*cos_illu;
+#ifdef GLBI_VARIANT
+#ifdef SPECULAR
+	col += specularIntensity(dir_illu_nml,nml_cam)*c_spec;
+#endif
+#else
 	if (shininess>0.0) {
-		spec_intensity = pow(saturate(dot(nml_cam,halfVector)),shininess);
+		col += specularIntensity(dir_illu_nml,nml_cam)*c_spec;
 	}
-	//spec_intensity = saturate(dot(nml,halfVector));
+#endif
+	return col*L;
+}
 
-	// Final color computation
-	vec4 c_dif;
-	if (use_texture == 1) {
-		c_dif  = texture(tex0,uvs);
-	}
-	else {
-		c_dif = vec4(color,1.0f);
-	}
-	return vec4(c_dif.rgb*(L*attenuation)*cos_illu + spec_intensity*(L*attenuation)*c_spec,1.0);
+vec3 pointLight(int idLight,vec3 nml_cam,vec3 c_dif) {
+	vec3 ptlight = vec3(viewMatrix*vec4(lightPos[idLight].xyz,1.0f));
+	vec3 dir_illu = ptlight - pos;
+	float dist = length(dir_illu);
+	float attenuation = 1.0f/(attenuationFactor.x+attenuationFactor.y*dist+attenuationFactor.z*dist*dist);
+	return lambert(dir_illu,lightIntensity[idLight].rgb*attenuation,nml_cam,c_dif);
+}
+
+vec3 directionalLight(int idLight,vec3 nml_cam,vec3 c_dif) {
+	vec3 dir_illu = vec3(viewMatrix*lightPos[idLight]);
+	return lambert(dir_illu,lightIntensity[idLight].rgb*attenuationFactor.x,nml_cam,c_dif);
 }
 
 void main()
 {
-	final_col = vec4(0.0,0.0,0.0,1.0);
+	// Normal normalization
+	vec3 nml_cam = normalize(nml);
+	vec3 c_dif = diffuseColor();
+	vec3 col = vec3(0.0);
+#ifdef GLBI_VARIANT
+	// Constant bounds : loops are unrolled, the kind of each light is known
+	for(int i=0;i<NUM_POINT_LIGHTS;i++) {
+		col += pointLight(i,nml_cam,c_dif);
+	}
+	for(int i=NUM_POINT_LIGHTS;i<NUM_POINT_LIGHTS+NUM_DIR_LIGHTS;i++) {
+		col += directionalLight(i,nml_cam,c_dif);
+	}
+#else
 	for(int i=0;i<numOfLight;i++) {
-		final_col += lambert(i);
+		if (lightPos[i].w > 0.0) {
+			col += pointLight(i,nml_cam,c_dif);
+		}
+		else {
+			col += directionalLight(i,nml_cam,c_dif);
+		}
 	}
+#endif
+	final_col = vec4(col,1.0);
 }
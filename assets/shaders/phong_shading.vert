@@ -4,8 +4,19 @@ layout(location=0) in vec3 vx_pos; // Coordonnee du sommet
 layout(location=1) in vec3 vx_nml; // Normale du sommet
 layout(location=2) in vec2 vx_uvs; // Coordonnee de texture du sommet
 layout(location=3) in vec3 vx_col; // Couleur du sommet (ou couleur de l'objet)
+layout(location=4) in mat4 vx_inst_mat; // Transformation de l'instance (indices 4 a 7, identite sans instanciation)
+layout(location=8) in vec4 vx_inst_col; // Couleur de l'instance (alpha nul sans instanciation)
 
-uniform mat4 projectionMat;
+// Per-frame data shared by all 3D programs (see GLBI_Frame_Block in glbi_engine.hpp).
+// GLBI_MAX_LIGHTS is defined by the engine (GLBI_Engine::shaderDefines)
+layout(std140) uniform GLBI_Frame {
+	mat4 projectionMat;
+	mat4 viewMatrix;
+	vec4 attenuationFactor;              // xyz used
+	int numOfLight;
+	vec4 lightPos[GLBI_MAX_LIGHTS];
+	vec4 lightIntensity[GLBI_MAX_LIGHTS]; // rgb used
+};
 uniform mat4 modelviewMat;
 uniform mat4 normalMat;
 
@@ -16,10 +27,11 @@ out vec3 pos;
 
 void main()
 {
-	gl_Position = projectionMat*modelviewMat*vec4(vx_pos,1.0);
+	vec4 pos_inst = vx_inst_mat*vec4(vx_pos,1.0);
+	gl_Position = projectionMat*modelviewMat*pos_inst;
 	uvs = vx_uvs;
-	color = vx_col;
-	nml = vec3(normalMat*vec4(vx_nml,0.0));	
-	vec4 pos_t = modelviewMat*vec4(vx_pos,1.0);
+	color = mix(vx_col,vx_inst_col.rgb,vx_inst_col.a);
+	nml = vec3(normalMat*(vx_inst_mat*vec4(vx_nml,0.0))); // instances : rotation and uniform scale only	
+	vec4 pos_t = modelviewMat*pos_inst;
 	pos = pos_t.xyz/pos_t.w;
 }
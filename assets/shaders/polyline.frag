@@ -0,0 +1,32 @@
+#version 410 core
+
+// Coverage of a thick line segment (see polyline.vert) from its distance to the fragment :
+// one pixel wide transition on the border
+in vec2 segCoord;
+flat in float segLength;
+flat in vec2 endStyles;
+in vec4 color;
+
+layout(location = 0) out vec4 final_col;
+
+uniform float lineWidth;
+
+// Signed distance to the border beyond an end (along > 0 : distance past the end point)
+float endDistance(float along,float across,float style,float half_width) {
+	if (style < 0.5) return across-half_width;                // Mitered : the next segment starts at the bisector
+	if (style < 1.5) return max(across-half_width,along);     // Butt
+	if (style < 2.5) return max(across,along)-half_width;     // Square
+	return length(vec2(along,across))-half_width;             // Round
+}
+
+void main()
+{
+	float half_width = 0.5*lineWidth;
+	float across = abs(segCoord.y);
+	float dist = across-half_width;
+	if (segCoord.x < 0.0) dist = endDistance(-segCoord.x,across,endStyles.x,half_width);
+	else if (segCoord.x > segLength) dist = endDistance(segCoord.x-segLength,across,endStyles.y,half_width);
+	float alpha = clamp(0.5-dist,0.0,1.0);
+	if (alpha <= 0.0) discard;
+	final_col = vec4(color.rgb,color.a*alpha);
+}
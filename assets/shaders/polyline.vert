@@ -0,0 +1,88 @@
+#version 410 core
+
+// Segments of a thick line (see GLBI_Polyline in glbi_polyline.hpp) : one instance per segment,
+// 4 vertices expanded on screen around the segment [vx_a,vx_b] to lineWidth pixels plus one pixel
+// of antialiasing. vx_prev and vx_next (the neighbour points) give the miter joins.
+layout(location=0) in vec2 vx_prev;
+layout(location=1) in vec2 vx_a;
+layout(location=2) in vec2 vx_b;
+layout(location=3) in vec2 vx_next;
+layout(location=4) in vec4 vx_col_a;
+layout(location=5) in vec4 vx_col_b;
+
+uniform mat4 projectionMat;
+uniform mat4 modelviewMat;
+uniform vec2 viewportSize;
+uniform float lineWidth;
+uniform int joinStyle;  // 0 miter, 1 round
+uniform int capStyle;   // 0 butt, 1 square, 2 round
+uniform float miterLimit;
+uniform int capEnds;    // Bit 0 : the first segment starts the line, bit 1 : the last one ends it
+uniform int lastSegment;
+
+// In pixels : along the segment from vx_a, and across it
+out vec2 segCoord;
+flat out float segLength;
+// Shape of each end : 0 mitered (cut along the bisector), 1 butt, 2 square, 3 round
+flat out vec2 endStyles;
+out vec4 color;
+
+vec2 toScreen(vec2 p,out float depth) {
+	vec4 clip = projectionMat*modelviewMat*vec4(p,0.0,1.0);
+	depth = clip.z/clip.w;
+	return (0.5*clip.xy/clip.w+0.5)*viewportSize;
+}
+
+// Style of the end at point s of the segment of direction d, neighbour segment of direction d_other
+// (pointing the same way). miter : unit vector along the bisector, scaled to reach the half width r
+float endStyle(bool is_cap,vec2 d,vec2 d_other,float len,float r,out vec2 miter) {
+	miter = vec2(0.0);
+	if (is_cap) return float(capStyle+1);
+	float len_other = length(d_other);
+	if ((joinStyle == 1) || (len == 0.0) || (len_other == 0.0)) return 3.0;
+	vec2 t = d+d_other/len_other;
+	if (length(t) < 1e-4) return 3.0;
+	t = normalize(t);
+	vec2 m = vec2(-t.y,t.x);
+	float c = dot(m,vec2(-d.y,d.x));
+	// Too long, or reaching the other end of a short segment
+	if ((c < 1.0/miterLimit) || (abs(dot(m,d))*r/c > 0.5*len)) return 3.0;
+	miter = m*r/c;
+	return 0.0;
+}
+
+void main()
+{
+	float depth_prev,depth_a,depth_b,depth_next;
+	vec2 s_prev = toScreen(vx_prev,depth_prev);
+	vec2 s_a = toScreen(vx_a,depth_a);
+	vec2 s_b = toScreen(vx_b,depth_b);
+	vec2 s_next = toScreen(vx_next,depth_next);
+	float len = length(s_b-s_a);
+	vec2 d = (len > 0.0) ? (s_b-s_a)/len : vec2(1.0,0.0);
+	vec2 n = vec2(-d.y,d.x);
+	float r = 0.5*lineWidth+1.0;
+
+	vec2 miter_a,miter_b;
+	endStyles.x = endStyle(((capEnds & 1) != 0) && (gl_InstanceID == 0),d,s_a-s_prev,len,r,miter_a);
+	endStyles.y = endStyle(((capEnds & 2) != 0) && (gl_InstanceID == lastSegment),d,s_next-s_b,len,r,miter_b);
+
+	// Corners 0 and 1 at vx_a, 2 and 3 at vx_b, on both sides
+	bool at_b = gl_VertexID >= 2;
+	float side = ((gl_VertexID & 1) == 0) ? -1.0 : 1.0;
+	float style = at_b ? endStyles.y : endStyles.x;
+	vec2 pos = at_b ? s_b : s_a;
+	if (style == 0.0) {
+		pos += side*(at_b ? miter_b : miter_a);
+	}
+	else {
+		// Butt ends only need the antialiasing pixel
+		float extent = (style == 1.0) ? 1.0 : r;
+		pos += side*r*n+(at_b ? extent : -extent)*d;
+	}
+
+	segCoord = vec2(dot(pos-s_a,d),dot(pos-s_a,n));
+	segLength = len;
+	color = at_b ? vx_col_b : vx_col_a;
+	gl_Position = vec4(2.0*pos/viewportSize-1.0,at_b ? depth_b : depth_a,1.0);
+}
@@ -0,0 +1,34 @@
+// Application loop (see glbasimac/glbi_app_loop.hpp) : the loop is driven by frame() with a render
+// cost simulated by a sleep, at several frame rates. With the fixed timestep, the simulated time
+// follows the real time whatever the frame rate (until maxSteps drops time), and the animation
+// moves at the same speed. Frame time statistics (p50, p99, jitter) are printed for each rate.
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON :
+//   bench_app_loop [seconds_per_rate]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include "glbasimac/glbi_app_loop.hpp"
+
+using namespace glbasimac;
+
+int main(int argc,char** argv) {
+	double duration = (argc > 1) ? atof(argv[1]) : 1.0;
+	const double render_costs[] = {1.0/240.0,1.0/60.0,1.0/24.0,1.0/8.0};
+
+	printf("%-10s %10s %10s %10s %8s %8s  %s\n","render ms","real s","sim s","position","updates","frames","frame times");
+	for(double cost : render_costs) {
+		GLBI_App_Loop loop;
+		// Unit speed : position should end close to the real time
+		double position = 0.0;
+		loop.update = [&](double dt) {position += dt;};
+		loop.render = [&](double /*alpha*/) {std::this_thread::sleep_for(std::chrono::duration<double>(cost));};
+		double start = loop.now();
+		while (loop.now()-start < duration) loop.frame();
+		double real = loop.now()-start;
+		printf("%-10.2f %10.3f %10.3f %10.3f %8lu %8lu  %s\n",1000.0*cost,real,loop.simTime,position,loop.nbUpdates,loop.nbFrames,
+		       loop.frameStats().toString().c_str());
+	}
+	return 0;
+}
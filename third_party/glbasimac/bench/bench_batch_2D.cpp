@@ -0,0 +1,112 @@
+// Batched 2D primitives (see glbasimac/glbi_batch_2D.hpp) : a scene of squares and circles drawn
+// one shape per draw call (GLBI_Convex_2D_Shape, a modelview and a color upload each) against the
+// same scene written in a GLBI_Batch_2D and flushed once. Both images are compared pixel by pixel.
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON. Run from bin/ (shaders are read from ../assets/shaders) :
+//   bench_batch_2D [nb_shapes] [nb_frames]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "glbasimac/glbi_batch_2D.hpp"
+#include "glbasimac/glbi_convex_2D_shape.hpp"
+#include "glbasimac/glbi_headless.hpp"
+
+using namespace glbasimac;
+
+static const int WIDTH = 800;
+static const int HEIGHT = 600;
+static const unsigned int NB_SEGMENTS = 32;
+
+/// Placement of shape \param i at frame \param frame (in [-100,100]^2)
+static void place(MatrixStack& stack,int i,int frame) {
+	stack.loadIdentity();
+	stack.addTranslation(Vector3D(-95.0f+float((i*37)%190),-95.0f+float((i*53)%190),0.0f));
+	stack.addRotation(0.01f*(i+frame),Vector3D(0.0f,0.0f,1.0f));
+	stack.addHomothety(Vector3D(0.4f+0.1f*(i%5),0.3f+0.1f*(i%3),1.0f));
+}
+
+static void color(int i,float rgb[3]) {
+	rgb[0] = 0.2f+0.1f*(i%8);
+	rgb[1] = 0.5f;
+	rgb[2] = 0.9f-0.1f*(i%8);
+}
+
+int main(int argc,char** argv) {
+	int nb_shapes = (argc > 1) ? atoi(argv[1]) : 5000;
+	int nb_frames = (argc > 2) ? atoi(argv[2]) : 50;
+
+	GLBI_Headless headless;
+	if (!headless.init(WIDTH,HEIGHT)) return 1;
+	printf("%d shapes, %d frames, GL %s / %s\n",nb_shapes,nb_frames,glGetString(GL_VERSION),glGetString(GL_RENDERER));
+	GLBI_Engine engine;
+	engine.initGL();
+	engine.set2DProjection(-100.0f,100.0f,-100.0f,100.0f);
+
+	GLBI_Convex_2D_Shape square,circle;
+	square.initShape({-0.5f,-0.5f,0.5f,-0.5f,0.5f,0.5f,-0.5f,0.5f});
+	square.changeNature(GL_TRIANGLE_FAN);
+	std::vector<float> circle_pts;
+	for(unsigned int s=0;s<NB_SEGMENTS;s++) {
+		float angle = 2.0f*float(M_PI)*s/NB_SEGMENTS;
+		circle_pts.push_back(std::cos(angle));
+		circle_pts.push_back(std::sin(angle));
+	}
+	circle.initShape(circle_pts);
+	circle.changeNature(GL_POLYGON);
+	GLBI_Batch_2D batch(engine);
+
+	std::vector<unsigned char> images[2];
+	for(int mode=0;mode<2;mode++) {
+		STP3D::glCounters().reset();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(int f=0;f<nb_frames;f++) {
+			headless.beginFrame();
+			glClearColor(0.1f,0.1f,0.1f,1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			float rgb[3];
+			for(int i=0;i<nb_shapes;i++) {
+				color(i,rgb);
+				if (mode == 0) {
+					place(engine.mvMatrixStack,i,f);
+					engine.setFlatColor(rgb[0],rgb[1],rgb[2]);
+					engine.updateMvMatrix();
+					if (i%2) circle.drawShape();
+					else square.drawShape();
+				}
+				else {
+					place(batch.transform,i,f);
+					batch.setColor(rgb[0],rgb[1],rgb[2]);
+					if (i%2) batch.circle(0.0f,0.0f,1.0f,NB_SEGMENTS);
+					else batch.rectangle(-0.5f,-0.5f,0.5f,0.5f);
+				}
+			}
+			if (mode == 1) batch.flush();
+			if (f == nb_frames-1) {
+				images[mode].resize(4*WIDTH*HEIGHT);
+				GLTools::takeSnapshot(WIDTH,HEIGHT,images[mode].data(),4);
+			}
+			headless.endFrame();
+		}
+		glFinish();
+		double t = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-start).count()/nb_frames;
+		const STP3D::GLCounters& counters = STP3D::glCounters();
+		printf("%-22s %8.3f ms/frame %8llu draws/frame %8llu uniform uploads/frame\n",(mode == 0) ? "one draw per shape" : "batch 2D",
+		       t,counters.draw_calls/nb_frames,counters.uniform_uploads/nb_frames);
+	}
+	printf("batch : %lu vertices, %lu triangles in %lu draws\n",batch.stats.vertices,batch.stats.triangles,batch.stats.drawCalls);
+
+	// 8 bits colors of the batch may round differently
+	size_t nb_diff = 0;
+	for(size_t p=0;p<images[0].size();p+=4) {
+		for(int c=0;c<3;c++) {
+			if (std::abs(int(images[0][p+c])-int(images[1][p+c])) > 2) {
+				nb_diff++;
+				break;
+			}
+		}
+	}
+	printf("%zu pixels differ (of %d)\n",nb_diff,WIDTH*HEIGHT);
+	batch.release();
+	headless.release();
+	return 0;
+}
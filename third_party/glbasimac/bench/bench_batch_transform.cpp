@@ -0,0 +1,97 @@
+// Micro-benchmark of the batch transforms (see tools/batch_transform.hpp) against a loop
+// of Matrix4D::operator*(const Vector4D&).
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON (add -DGLBASIMAC_ENABLE_AVX2=ON for AVX2).
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <random>
+#include "tools/batch_transform.hpp"
+
+using namespace STP3D;
+
+static const size_t NB_POINTS = 4000000;
+static const int NB_LOOPS = 10;
+
+/// Run \param job NB_LOOPS times. Return millions of points per second
+template<typename Job>
+static double bench(Job job) {
+	auto start = std::chrono::steady_clock::now();
+	for(int l=0;l<NB_LOOPS;l++) job();
+	double s = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+	return double(NB_LOOPS)*NB_POINTS/s*1e-6;
+}
+
+/// Maximum absolute difference between two arrays
+static float maxError(const std::vector<float>& a,const std::vector<float>& b) {
+	float err = 0.0f;
+	for(size_t i=0;i<a.size();i++) err = std::max(err,std::fabs(a[i]-b[i]));
+	return err;
+}
+
+static void report(const char* name,double ref,double res,float err) {
+	printf("%-28s %8.1f Mpts/s   speedup x%5.2f   max error %g\n",name,res,res/ref,err);
+}
+
+int main() {
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> dist(-10.0f,10.0f);
+	std::vector<float> aos(3*NB_POINTS);
+	for(size_t i=0;i<aos.size();i++) aos[i] = dist(gen);
+	std::vector<float> soa_x(NB_POINTS),soa_y(NB_POINTS),soa_z(NB_POINTS);
+	for(size_t i=0;i<NB_POINTS;i++) {
+		soa_x[i] = aos[3*i]; soa_y[i] = aos[3*i+1]; soa_z[i] = aos[3*i+2];
+	}
+
+	Matrix4D m = Matrix4D::perspective(60.0f,1.5f,0.1f,100.0f);
+	m *= Matrix4D::translation(0.0f,0.0f,-30.0f);
+	m *= Matrix4D::rotation(0.7f,Vector3D(0.3f,1.0f,0.2f));
+
+	std::vector<float> ref(3*NB_POINTS),res(3*NB_POINTS);
+	std::vector<float> out_x(NB_POINTS),out_y(NB_POINTS),out_z(NB_POINTS);
+	unsigned int nb_cores = std::thread::hardware_concurrency();
+
+	printf("Batch transforms, %d x %zu points, SIMD path : %s, %u cores\n",NB_LOOPS,NB_POINTS,STP3D_SIMD_NAME,nb_cores);
+
+	// Reference : one Vector4D temporary per point
+	double t_ref = bench([&]() {
+		for(size_t i=0;i<NB_POINTS;i++) {
+			Vector4D v = m*Vector4D(aos[3*i],aos[3*i+1],aos[3*i+2],1.0f);
+			ref[3*i] = v.x; ref[3*i+1] = v.y; ref[3*i+2] = v.z;
+		}
+	});
+	printf("%-28s %8.1f Mpts/s\n","Matrix4D * Vector4D loop",t_ref);
+
+	double t = bench([&]() {transformPoints(m,aos.data(),res.data(),NB_POINTS,1);});
+	report("transformPoints AoS 1 thread",t_ref,t,maxError(ref,res));
+	t = bench([&]() {transformPoints(m,aos.data(),res.data(),NB_POINTS);});
+	report("transformPoints AoS threads",t_ref,t,maxError(ref,res));
+
+	t = bench([&]() {
+		batchTransform(m,STP3D_BATCH_POINTS,soa_x.data(),soa_y.data(),soa_z.data(),
+		               out_x.data(),out_y.data(),out_z.data(),NB_POINTS,1);
+	});
+	for(size_t i=0;i<NB_POINTS;i++) {
+		res[3*i] = out_x[i]; res[3*i+1] = out_y[i]; res[3*i+2] = out_z[i];
+	}
+	report("transformPoints SoA 1 thread",t_ref,t,maxError(ref,res));
+	t = bench([&]() {
+		batchTransform(m,STP3D_BATCH_POINTS,soa_x.data(),soa_y.data(),soa_z.data(),
+		               out_x.data(),out_y.data(),out_z.data(),NB_POINTS);
+	});
+	report("transformPoints SoA threads",t_ref,t,maxError(ref,res));
+
+	// Perspective divide
+	double t_proj = bench([&]() {
+		for(size_t i=0;i<NB_POINTS;i++) {
+			Vector4D v = m*Vector4D(aos[3*i],aos[3*i+1],aos[3*i+2],1.0f);
+			ref[3*i] = v.x/v.w; ref[3*i+1] = v.y/v.w; ref[3*i+2] = v.z/v.w;
+		}
+	});
+	printf("%-28s %8.1f Mpts/s\n","Vector4D loop with divide",t_proj);
+	t = bench([&]() {projectPoints(m,aos.data(),res.data(),NB_POINTS,1);});
+	report("projectPoints AoS 1 thread",t_proj,t,maxError(ref,res));
+	t = bench([&]() {projectPoints(m,aos.data(),res.data(),NB_POINTS);});
+	report("projectPoints AoS threads",t_proj,t,maxError(ref,res));
+	return 0;
+}
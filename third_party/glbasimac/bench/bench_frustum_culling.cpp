@@ -0,0 +1,111 @@
+// Frustum culling (see tools/frustum.hpp) : box tests one at a time against the batch test
+// (4 boxes per SSE register, 8 with AVX2), then a walkthrough of a field of spheres around the
+// camera drawn through GLBI_DrawList with and without culling.
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON. Run from bin/ (shaders are read from ../assets/shaders) :
+//   bench_frustum_culling [nb_frames] [grid_size] [nb_boxes]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "glbasimac/glbi_draw_list.hpp"
+#include "glbasimac/glbi_headless.hpp"
+#include "tools/basic_mesh.hpp"
+#include "tools/frustum.hpp"
+
+using namespace glbasimac;
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedMs(Clock::time_point start) {
+	return std::chrono::duration<double,std::milli>(Clock::now()-start).count();
+}
+
+/// Box tests on the CPU only
+static void benchTests(size_t nb_boxes) {
+	Matrix4D proj = Matrix4D::perspective(60.0f,16.0f/9.0f,0.1f,200.0f);
+	Matrix4D view = Matrix4D::lookAt(Vector3D(0.0f,2.0f,0.0f),Vector3D(1.0f,2.0f,-1.0f),Vector3D(0.0f,1.0f,0.0f));
+	Frustum frustum(proj*view);
+	FrustumCuller culler;
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> pos(-100.0f,100.0f),size(0.1f,2.0f);
+	for(size_t i=0;i<nb_boxes;i++) {
+		culler.addBox(Vector3D(pos(rng),0.1f*pos(rng),pos(rng)),Vector3D(size(rng),size(rng),size(rng)));
+	}
+	std::vector<unsigned char> visible(nb_boxes);
+	int nb_runs = 20;
+	size_t nb_scalar = 0,nb_batch = 0;
+	Clock::time_point start = Clock::now();
+	for(int r=0;r<nb_runs;r++) nb_scalar = frustum_detail::cullScalar(frustum,culler,0,nb_boxes,visible.data());
+	double t_scalar = elapsedMs(start)/nb_runs;
+	start = Clock::now();
+	for(int r=0;r<nb_runs;r++) nb_batch = culler.cull(frustum,visible);
+	double t_batch = elapsedMs(start)/nb_runs;
+	printf("%zu boxes, %zu visible (%zu with scalar tests)\n",nb_boxes,nb_batch,nb_scalar);
+	printf("%-24s %8.3f ms  %7.1f Mboxes/s\n","one box at a time",t_scalar,nb_boxes/t_scalar/1000.0);
+	printf("%-24s %8.3f ms  %7.1f Mboxes/s   speedup x%.2f (%s)\n","batch",t_batch,nb_boxes/t_batch/1000.0,t_scalar/t_batch,STP3D_SIMD_NAME);
+}
+
+/// Render nb_frames of the field turning around the camera. Return the frames per second
+static double renderFrames(GLBI_Engine& engine,GLBI_Headless& headless,GLBI_DrawList& list,IndexedMesh* sphere,
+                           int grid,int nb_frames,unsigned long& nb_culled) {
+	glFinish();
+	Clock::time_point start = Clock::now();
+	nb_culled = 0;
+	for(int f=0;f<nb_frames;f++) {
+		headless.beginFrame();
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		float angle = 0.05f*f;
+		Matrix4D view = Matrix4D::lookAt(Vector3D(0.0f,2.0f,0.0f),Vector3D(std::cos(angle),2.0f,std::sin(angle)),Vector3D(0.0f,1.0f,0.0f));
+		engine.mvMatrixStack.loadIdentity();
+		engine.setViewMatrix(view);
+		for(int j=0;j<grid;j++) {
+			for(int i=0;i<grid;i++) {
+				engine.mvMatrixStack.pushMatrix();
+				engine.mvMatrixStack.addTranslation(Vector3D(3.0f*(i-grid/2),0.0f,3.0f*(j-grid/2)));
+				list.addDraw(*sphere,GLBI_Material(Vector3D(0.2f+0.6f*i/grid,0.5f,0.2f+0.6f*j/grid)));
+				engine.mvMatrixStack.popMatrix();
+			}
+		}
+		list.submit();
+		nb_culled += list.afterSort.culled;
+		headless.endFrame();
+	}
+	glFinish();
+	return nb_frames/std::chrono::duration<double>(Clock::now()-start).count();
+}
+
+int main(int argc,char** argv) {
+	int nb_frames = (argc > 1) ? atoi(argv[1]) : 10;
+	int grid = (argc > 2) ? atoi(argv[2]) : 64;
+	size_t nb_boxes = (argc > 3) ? atoi(argv[3]) : 1000000;
+
+	benchTests(nb_boxes);
+
+	GLBI_Headless headless;
+	if (!headless.init(1280,720)) return 1;
+	printf("%d spheres, %d frames, GL %s / %s\n",grid*grid,nb_frames,glGetString(GL_VERSION),glGetString(GL_RENDERER));
+	glEnable(GL_DEPTH_TEST);
+	GLBI_Engine engine;
+	engine.mode2D = false;
+	engine.initGL();
+	engine.switchToPhongShading();
+	engine.set3DProjection(60.0f,16.0f/9.0f,0.1f,500.0f);
+	IndexedMesh* sphere = basicSphere(1.0f,32,32);
+	sphere->createVAO();
+	GLBI_DrawList list(engine);
+
+	double fps[2];
+	unsigned long nb_culled[2];
+	for(int culling=0;culling<2;culling++) {
+		list.frustumCulling = (culling == 1);
+		renderFrames(engine,headless,list,sphere,grid,1,nb_culled[culling]);
+		fps[culling] = renderFrames(engine,headless,list,sphere,grid,nb_frames,nb_culled[culling]);
+	}
+	printf("%-24s %8.1f frames/s\n","no culling",fps[0]);
+	printf("%-24s %8.1f frames/s   %5.1f%% of the spheres culled   speedup x%.2f\n","frustum culling",fps[1],
+	       100.0*nb_culled[1]/(double(nb_frames)*grid*grid),fps[1]/fps[0]);
+	delete sphere;
+	headless.release();
+	return 0;
+}
@@ -0,0 +1,106 @@
+// Headless rendering throughput (see glbasimac/glbi_headless.hpp) : frames rendered in an offscreen
+// target and written to image files, with a synchronous readback (glReadPixels then write on the
+// rendering thread) against the asynchronous one (pixel buffers, fences and writer thread).
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON (and -DGLBASIMAC_HEADLESS=ON on machines without display).
+// Run from bin/ (shaders are loaded from ../assets/shaders) :
+//   bench_headless [nb_frames] [output_dir] [png|ppm]
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "glbasimac/glbi_engine.hpp"
+#include "glbasimac/glbi_headless.hpp"
+#include "tools/basic_mesh.hpp"
+
+using namespace glbasimac;
+
+static const int WIDTH = 640;
+static const int HEIGHT = 480;
+
+static GLBI_Engine engine;
+static IndexedMesh* sphere = nullptr;
+
+/// A grid of spheres turning with the frame number
+static void drawFrame(int frame) {
+	glClearColor(0.1f,0.1f,0.1f,1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	engine.mvMatrixStack.loadIdentity();
+	engine.setViewMatrix(Matrix4D::lookAt(Vector3D(0.0f,0.0f,25.0f),Vector3D(0.0f),Vector3D(0.0f,1.0f,0.0f)));
+	engine.mvMatrixStack.addRotation(0.02f*frame,Vector3D(0.0f,1.0f,0.0f));
+	for(int i=0;i<100;i++) {
+		engine.mvMatrixStack.pushMatrix();
+		engine.mvMatrixStack.addTranslation(Vector3D(2.0f*(i%10)-9.0f,2.0f*(i/10)-9.0f,0.0f));
+		engine.setFlatColor(0.1f*(i%10),0.1f*(i/10),0.8f);
+		engine.updateMvMatrix();
+		sphere->draw();
+		engine.mvMatrixStack.popMatrix();
+	}
+}
+
+static std::string frameName(const std::string& dir,const char* mode,int frame,GLBI_Image_Format format) {
+	char name[64];
+	snprintf(name,64,"/bench_%s_%04d.%s",mode,frame,(format == GLBI_IMAGE_PNG) ? "png" : "ppm");
+	return dir+name;
+}
+
+int main(int argc,char** argv) {
+	int nb_frames = (argc > 1) ? atoi(argv[1]) : 60;
+	std::string dir = (argc > 2) ? argv[2] : ".";
+	GLBI_Image_Format format = ((argc > 3) && !strcmp(argv[3],"ppm")) ? GLBI_IMAGE_PPM : GLBI_IMAGE_PNG;
+
+	GLBI_Headless headless(2);
+	headless.format = format;
+	if (!headless.init(WIDTH,HEIGHT)) return 1;
+	printf("Headless rendering, %d frames of %dx%d, GL %s / %s\n",nb_frames,WIDTH,HEIGHT,
+	       glGetString(GL_VERSION),glGetString(GL_RENDERER));
+
+	engine.mode2D = false;
+	engine.initGL();
+	engine.switchToPhongShading();
+	engine.set3DProjection(60.0f,float(WIDTH)/HEIGHT,0.1f,100.0f);
+	engine.setLightPosition(Vector4D(0.0f,10.0f,30.0f,1.0f),0);
+	engine.setLightIntensity(Vector3D(1500.0f),0);
+	glEnable(GL_DEPTH_TEST);
+	sphere = basicSphere(0.8f,32,32);
+	sphere->createVAO();
+
+	// Rendering only
+	auto start = std::chrono::steady_clock::now();
+	for(int f=0;f<nb_frames;f++) {
+		headless.beginFrame();
+		drawFrame(f);
+		headless.endFrame();
+	}
+	glFinish();
+	double t_render = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+	printf("%-24s %8.1f frames/s\n","render only",nb_frames/t_render);
+
+	// Synchronous readback and write
+	std::vector<unsigned char> pixels(4*WIDTH*HEIGHT);
+	start = std::chrono::steady_clock::now();
+	for(int f=0;f<nb_frames;f++) {
+		headless.beginFrame();
+		drawFrame(f);
+		GLTools::takeSnapshot(WIDTH,HEIGHT,pixels.data(),4);
+		glbiWriteImage(frameName(dir,"sync",f,format),format,WIDTH,HEIGHT,4,pixels.data());
+	}
+	double t_sync = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+	printf("%-24s %8.1f frames/s\n","sync readback + write",nb_frames/t_sync);
+
+	// Asynchronous readback, files written by the writer threads
+	start = std::chrono::steady_clock::now();
+	for(int f=0;f<nb_frames;f++) {
+		headless.beginFrame();
+		drawFrame(f);
+		headless.endFrame(frameName(dir,"async",f,format));
+	}
+	headless.finish();
+	double t_async = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+	printf("%-24s %8.1f frames/s   speedup x%.2f   (%lu readback stalls, %lu files written)\n","async readback + write",
+	       nb_frames/t_async,t_sync/t_async,headless.readback.nbStalls,headless.writer.nbWritten);
+
+	delete sphere;
+	headless.release();
+	return 0;
+}
@@ -0,0 +1,95 @@
+// Level of detail selection (see glbasimac/glbi_lod.hpp) : a field of spheres seen from above its
+// ground, drawn at full detail then with the level chosen from the projected size of each sphere.
+// Reports frames per second and triangles per frame, and the triangles the selection would keep for
+// other screen heights (the cost follows the screen area covered, not the number of objects).
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON. Run from bin/ (shaders are read from ../assets/shaders) :
+//   bench_lod [nb_frames] [grid_size] [pixel_error]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "glbasimac/glbi_engine.hpp"
+#include "glbasimac/glbi_headless.hpp"
+#include "glbasimac/glbi_lod.hpp"
+
+using namespace glbasimac;
+
+static const int width = 1280;
+static const int height = 720;
+
+/// Modelview of sphere (i,j) of the grid
+static Matrix4D sphereMatrix(const Matrix4D& view,int i,int j,int grid) {
+	return view*Matrix4D::translation(3.0f*(i-grid/2),0.0f,-3.0f*j);
+}
+
+/// Render nb_frames, with the finest level if \param use_lod is false. Return the frames per second
+static double renderFrames(GLBI_Engine& engine,GLBI_Headless& headless,GLBI_LOD_Mesh& lod,GLBI_LOD_Selector& selector,
+                           int grid,int nb_frames,bool use_lod) {
+	glFinish();
+	auto start = std::chrono::steady_clock::now();
+	for(int f=0;f<nb_frames;f++) {
+		Matrix4D view = Matrix4D::lookAt(Vector3D(0.1f*f,4.0f,6.0f),Vector3D(0.1f*f,0.0f,-20.0f),Vector3D(0.0f,1.0f,0.0f));
+		headless.beginFrame();
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		selector.update(engine);
+		for(int j=0;j<grid;j++) {
+			for(int i=0;i<grid;i++) {
+				engine.mvMatrixStack.loadTransformation(sphereMatrix(view,i,j,grid));
+				engine.updateMvMatrix();
+				if (use_lod) lod.draw(selector,engine);
+				else {
+					lod.levels[0].mesh->draw();
+					selector.nbTriangles += lod.levels[0].mesh->nb_primitive;
+				}
+			}
+		}
+		headless.endFrame();
+	}
+	glFinish();
+	return nb_frames/std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+}
+
+int main(int argc,char** argv) {
+	int nb_frames = (argc > 1) ? atoi(argv[1]) : 5;
+	int grid = (argc > 2) ? atoi(argv[2]) : 64;
+	float pixel_error = (argc > 3) ? float(atof(argv[3])) : 1.0f;
+
+	GLBI_Headless headless;
+	if (!headless.init(width,height)) return 1;
+	printf("%d spheres, %d frames of %dx%d, GL %s / %s\n",grid*grid,nb_frames,width,height,glGetString(GL_VERSION),glGetString(GL_RENDERER));
+	glEnable(GL_DEPTH_TEST);
+	GLBI_Engine engine;
+	engine.mode2D = false;
+	engine.initGL();
+	engine.switchToPhongShading();
+	engine.set3DProjection(60.0f,float(width)/height,0.1f,500.0f);
+
+	GLBI_LOD_Mesh lod;
+	lod.buildSphere(1.0f,64,5);
+	lod.createVAOs();
+	for(unsigned int l=0;l<lod.nbLevels();l++) {
+		printf("  level %u : %5u triangles, error %.4f\n",l,lod.levels[l].mesh->nb_primitive,lod.levels[l].error);
+	}
+
+	GLBI_LOD_Selector selector(pixel_error);
+	renderFrames(engine,headless,lod,selector,grid,1,false);
+	double fps_full = renderFrames(engine,headless,lod,selector,grid,nb_frames,false);
+	unsigned long tri_full = selector.nbTriangles;
+	double fps_lod = renderFrames(engine,headless,lod,selector,grid,nb_frames,true);
+	unsigned long tri_lod = selector.nbTriangles;
+	printf("%-22s %8.1f frames/s %10lu triangles\n","full detail",fps_full,tri_full);
+	printf("%-22s %8.1f frames/s %10lu triangles   speedup x%.2f\n","LOD selection",fps_lod,tri_lod,fps_lod/fps_full);
+
+	// Selection only, for other screen heights
+	Matrix4D view = Matrix4D::lookAt(Vector3D(0.0f,4.0f,6.0f),Vector3D(0.0f,0.0f,-20.0f),Vector3D(0.0f,1.0f,0.0f));
+	for(int h=360;h<=2880;h*=2) {
+		selector.update(engine,h);
+		unsigned long nb = 0;
+		for(int j=0;j<grid;j++) {
+			for(int i=0;i<grid;i++) nb += lod.levels[selector.select(lod,sphereMatrix(view,i,j,grid))].mesh->nb_primitive;
+		}
+		printf("  screen height %4d : %10lu triangles\n",h,nb);
+	}
+	headless.release();
+	return 0;
+}
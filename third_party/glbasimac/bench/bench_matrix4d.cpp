@@ -0,0 +1,95 @@
+// Micro-benchmark of the Matrix4D kernels : scalar versions against the SIMD versions
+// selected at compile time (see tools/matrix4d_simd.hpp).
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON (add -DGLBASIMAC_ENABLE_AVX2=ON for AVX2).
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <random>
+#include "tools/matrix4d.hpp"
+
+using namespace STP3D;
+
+static const int NB_MATRICES = 1024;
+static const int NB_LOOPS = 2000;
+
+/// Random affine matrices (rotation, scale, translation) : always invertible
+static std::vector<Matrix4D> randomMatrices(int nb) {
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> dist(-1.0f,1.0f);
+	std::vector<Matrix4D> res;
+	for(int i=0;i<nb;i++) {
+		Matrix4D m = Matrix4D::translation(10.0f*dist(gen),10.0f*dist(gen),10.0f*dist(gen));
+		m *= Matrix4D::rotation(3.0f*dist(gen),Vector3D(dist(gen),dist(gen),1.0f));
+		m *= Matrix4D::homothety(1.5f+dist(gen),1.5f+dist(gen),1.5f+dist(gen));
+		res.push_back(m);
+	}
+	return res;
+}
+
+/// Run \param kernel on every pair of matrices NB_LOOPS times. Return millions of operations per second
+template<typename Kernel>
+static double bench(const std::vector<Matrix4D>& a,const std::vector<Matrix4D>& b,std::vector<Matrix4D>& r,Kernel kernel) {
+	auto start = std::chrono::steady_clock::now();
+	for(int l=0;l<NB_LOOPS;l++) {
+		for(int i=0;i<NB_MATRICES;i++) kernel(a[i].mat,b[i].mat,r[i].mat);
+	}
+	double s = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+	return double(NB_LOOPS)*NB_MATRICES/s*1e-6;
+}
+
+/// Maximum absolute difference between two sets of matrices
+static float maxError(const std::vector<Matrix4D>& a,const std::vector<Matrix4D>& b) {
+	float err = 0.0f;
+	for(size_t i=0;i<a.size();i++) {
+		for(int k=0;k<16;k++) err = std::max(err,std::fabs(a[i].mat[k]-b[i].mat[k]));
+	}
+	return err;
+}
+
+static void report(const char* name,double scalar,double simd,float err) {
+	printf("%-14s scalar %8.1f Mop/s   %-6s %8.1f Mop/s   speedup x%.2f   max error %g\n",
+	       name,scalar,STP3D_SIMD_NAME,simd,simd/scalar,err);
+}
+
+int main() {
+	std::vector<Matrix4D> a = randomMatrices(NB_MATRICES);
+	std::vector<Matrix4D> b = randomMatrices(NB_MATRICES);
+	std::vector<Matrix4D> r_scalar(NB_MATRICES),r_simd(NB_MATRICES);
+	double t_scalar,t_simd;
+
+	printf("Matrix4D kernels, %d x %d operations, SIMD path : %s\n",NB_LOOPS,NB_MATRICES,STP3D_SIMD_NAME);
+
+	t_scalar = bench(a,b,r_scalar,[](const float* x,const float* y,float* r) {mat4_scalar::mul(x,y,r);});
+	t_simd   = bench(a,b,r_simd,[](const float* x,const float* y,float* r) {mat4Mul(x,y,r);});
+	report("mat x mat",t_scalar,t_simd,maxError(r_scalar,r_simd));
+
+	t_scalar = bench(a,b,r_scalar,[](const float* x,const float* y,float* r) {mat4_scalar::mulAffine(x,y,r);});
+	t_simd   = bench(a,b,r_simd,[](const float* x,const float* y,float* r) {mat4MulAffine(x,y,r);});
+	report("affine x affine",t_scalar,t_simd,maxError(r_scalar,r_simd));
+
+	t_scalar = bench(a,b,r_scalar,[](const float* x,const float* y,float* r) {mat4_scalar::mulVec4(x,y,r);});
+	t_simd   = bench(a,b,r_simd,[](const float* x,const float* y,float* r) {mat4MulVec4(x,y,r);});
+	report("mat x vec4",t_scalar,t_simd,maxError(r_scalar,r_simd));
+
+	t_scalar = bench(a,b,r_scalar,[](const float* x,const float*,float* r) {mat4_scalar::invert(x,r);});
+	t_simd   = bench(a,b,r_simd,[](const float* x,const float*,float* r) {mat4Invert(x,r);});
+	report("inverse",t_scalar,t_simd,maxError(r_scalar,r_simd));
+
+	t_scalar = bench(a,b,r_scalar,[](const float* x,const float*,float* r) {mat4_scalar::normalMatrix(x,r);});
+	t_simd   = bench(a,b,r_simd,[](const float* x,const float*,float* r) {mat4NormalMatrix(x,r);});
+	report("normal matrix",t_scalar,t_simd,maxError(r_scalar,r_simd));
+
+	// Reference : normal matrix computed the former way (full inverse then transpose)
+	float err = 0.0f;
+	for(int i=0;i<NB_MATRICES;i++) {
+		Matrix4D ref = a[i];
+		ref.invert();
+		ref.transpose();
+		Matrix4D nml = a[i];
+		nml.normalFromModelview();
+		for(int c=0;c<3;c++) for(int l=0;l<3;l++) err = std::max(err,std::fabs(ref.mat[4*c+l]-nml.mat[4*c+l]));
+	}
+	printf("normal matrix against inverse transpose : max error %g\n",err);
+	return 0;
+}
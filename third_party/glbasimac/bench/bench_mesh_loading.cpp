@@ -0,0 +1,95 @@
+// Mesh loading (see tools/obj_loader.hpp, tools/mesh_file.hpp and tools/mesh_manager.hpp) : a large OBJ
+// file (a sphere written by this program) parsed by one thread then by every core, converted to the
+// native format by MeshManager, then loaded from this cache with a CPU copy and straight to the GPU.
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON. Run from bin/ (files are written in the current directory) :
+//   bench_mesh_loading [nb_div] [nb_runs]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include "glbasimac/glbi_headless.hpp"
+#include "tools/basic_mesh.hpp"
+#include "tools/mesh_manager.hpp"
+
+using namespace glbasimac;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* obj_file = "bench_mesh_loading.obj";
+static const char* cache_dir = "bench_mesh_cache";
+
+/// Write a sphere as an OBJ file with positions, uvs, normals and triangles
+static bool writeOBJ(unsigned int nb_div) {
+	IndexedMesh* sphere = basicSphere(1.0f,nb_div,nb_div);
+	FILE* file = fopen(obj_file,"w");
+	if (!file) return false;
+	const float* coord = sphere->buffers[0];
+	const float* nml = sphere->buffers[1];
+	const float* uv = sphere->buffers[2];
+	for(unsigned int v=0;v<sphere->nb_elts;v++) fprintf(file,"v %f %f %f\n",coord[3*v],coord[3*v+1],coord[3*v+2]);
+	for(unsigned int v=0;v<sphere->nb_elts;v++) fprintf(file,"vt %f %f\n",uv[2*v],uv[2*v+1]);
+	for(unsigned int v=0;v<sphere->nb_elts;v++) fprintf(file,"vn %f %f %f\n",nml[3*v],nml[3*v+1],nml[3*v+2]);
+	for(unsigned int t=0;t<sphere->nb_primitive;t++) {
+		const unsigned int* tri = sphere->index_buffer+3*t;
+		fprintf(file,"f %u/%u/%u %u/%u/%u %u/%u/%u\n",tri[0]+1,tri[0]+1,tri[0]+1,tri[1]+1,tri[1]+1,tri[1]+1,tri[2]+1,tri[2]+1,tri[2]+1);
+	}
+	fclose(file);
+	delete sphere;
+	return true;
+}
+
+/// Load the OBJ file through a manager, return the time in ms (the mesh is deleted)
+static double loadWithManager(bool gpu_only,unsigned int nb_threads,unsigned long& nb_hits) {
+	MeshManager manager(cache_dir);
+	Clock::time_point start = Clock::now();
+	IndexedMesh* mesh = manager.loadIdxMesh(obj_file,gpu_only,nb_threads);
+	if (gpu_only) glFinish();
+	double t = std::chrono::duration<double,std::milli>(Clock::now()-start).count();
+	if (!mesh) {
+		std::cerr<<"Unable to load "<<obj_file<<" : "<<STP3D::getError()<<std::endl;
+		exit(1);
+	}
+	nb_hits = manager.nb_cache_hits;
+	manager.indexed_meshes.clear();
+	delete mesh;
+	return t;
+}
+
+int main(int argc,char** argv) {
+	unsigned int nb_div = (argc > 1) ? atoi(argv[1]) : 600;
+	int nb_runs = (argc > 2) ? atoi(argv[2]) : 3;
+
+	GLBI_Headless_Context context;
+	if (!context.create(64,64)) return 1;
+	if (!writeOBJ(nb_div)) return 1;
+	unsigned int nb_cores = std::max(1u,std::thread::hardware_concurrency());
+	IndexedMesh* probe = loadOBJ(obj_file,1);
+	printf("OBJ sphere : %u triangles, %u vertices, %u cores, GL %s\n",probe->nb_primitive,probe->nb_elts,nb_cores,glGetString(GL_VERSION));
+	delete probe;
+
+	double t_single = 0.0,t_multi = 0.0,t_cpu = 0.0,t_gpu = 0.0;
+	unsigned long nb_hits = 0;
+	for(int r=0;r<nb_runs;r++) {
+		Clock::time_point start = Clock::now();
+		delete loadOBJ(obj_file,1);
+		t_single += std::chrono::duration<double,std::milli>(Clock::now()-start).count();
+		start = Clock::now();
+		delete loadOBJ(obj_file,0);
+		t_multi += std::chrono::duration<double,std::milli>(Clock::now()-start).count();
+	}
+	std::string cached = MeshManager(cache_dir).cachedFileName(obj_file);
+	remove(cached.c_str());
+	double t_convert = loadWithManager(false,0,nb_hits);
+	for(int r=0;r<nb_runs;r++) {
+		t_cpu += loadWithManager(false,0,nb_hits);
+		t_gpu += loadWithManager(true,0,nb_hits);
+	}
+	if (nb_hits == 0) printf("Warning : the native cache was not used\n");
+	printf("%-34s %8.1f ms\n","OBJ parse (1 thread)",t_single/nb_runs);
+	printf("%-34s %8.1f ms\n","OBJ parse (every core)",t_multi/nb_runs);
+	printf("%-34s %8.1f ms\n","MeshManager first load (convert)",t_convert);
+	printf("%-34s %8.1f ms   speedup x%.1f\n","native cache (CPU copy)",t_cpu/nb_runs,t_single/t_cpu);
+	printf("%-34s %8.1f ms   speedup x%.1f\n","native cache (straight to GPU)",t_gpu/nb_runs,t_single/t_gpu);
+	return 0;
+}
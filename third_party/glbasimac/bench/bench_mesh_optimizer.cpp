@@ -0,0 +1,76 @@
+// Indexed mesh optimization (see tools/mesh_optimizer.hpp) : spheres and cylinders as generated by
+// tools/basic_mesh.hpp against the same meshes after optimizeMesh. Reports the simulated vertex cache
+// efficiency (ACMR, ATVR), the GPU memory of the indices, and when GL_ARB_pipeline_statistics_query
+// is available the number of vertex shader invocations really measured for one draw.
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON. Run from bin/ (shaders are read from ../assets/shaders) :
+//   bench_mesh_optimizer [nb_div]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "glbasimac/glbi_engine.hpp"
+#include "glbasimac/glbi_headless.hpp"
+#include "glbasimac/glbi_gl_extensions.hpp"
+#include "tools/basic_mesh.hpp"
+#include "tools/mesh_optimizer.hpp"
+
+using namespace glbasimac;
+
+// GL_ARB_pipeline_statistics_query, missing from the GL 4.0 loader
+#define GLBI_GL_VERTEX_SHADER_INVOCATIONS 0x82F0
+
+/// Vertex shader invocations of one draw of \param mesh (0 if they can not be queried)
+static unsigned long vertexInvocations(IndexedMesh* mesh,bool has_query) {
+	if (!has_query) return 0;
+	unsigned int query;
+	glGenQueries(1,&query);
+	glBeginQuery(GLBI_GL_VERTEX_SHADER_INVOCATIONS,query);
+	mesh->draw();
+	glEndQuery(GLBI_GL_VERTEX_SHADER_INVOCATIONS);
+	GLuint64 count = 0;
+	glGetQueryObjectui64v(query,GL_QUERY_RESULT,&count);
+	glDeleteQueries(1,&query);
+	return (unsigned long)count;
+}
+
+static void benchMesh(const char* name,IndexedMesh* raw,IndexedMesh* optimized,bool has_query) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	MeshOptimizationReport report = optimizeMesh(*optimized);
+	double t_opt = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-start).count();
+	raw->createVAO();
+	optimized->createVAO();
+	size_t idx_raw = size_t(raw->nb_primitive)*3*sizeof(unsigned int);
+	size_t idx_opt = size_t(optimized->nb_primitive)*3*optimized->getIndexByteSize();
+	printf("%-10s %7u triangles %6u vertices   optimized in %6.1f ms\n",name,report.nbTriangles,optimized->nb_elts,t_opt);
+	printf("           ACMR %.3f -> %.3f   ATVR %.3f -> %.3f   indices %zu -> %zu bytes\n",report.before.acmr,report.after.acmr,
+	       report.before.atvr,report.after.atvr,idx_raw,idx_opt);
+	if (has_query) {
+		unsigned long before = vertexInvocations(raw,true),after = vertexInvocations(optimized,true);
+		printf("           vertex shader invocations %lu -> %lu (x%.2f)\n",before,after,double(before)/std::max(1ul,after));
+	}
+	delete raw;
+	delete optimized;
+}
+
+int main(int argc,char** argv) {
+	unsigned int nb_div = (argc > 1) ? atoi(argv[1]) : 180;
+
+	GLBI_Headless headless;
+	if (!headless.init(256,256)) return 1;
+	printf("GL %s / %s\n",glGetString(GL_VERSION),glGetString(GL_RENDERER));
+	GLBI_Engine engine;
+	engine.mode2D = false;
+	engine.initGL();
+	engine.switchToPhongShading();
+	engine.set3DProjection(60.0f,1.0f,0.1f,100.0f);
+	engine.updateMvMatrix();
+	bool has_query = glbiHasVersion(4,6) || glbiHasExtension("GL_ARB_pipeline_statistics_query");
+	if (!has_query) printf("No pipeline statistics query : vertex shader invocations not measured\n");
+
+	headless.beginFrame();
+	benchMesh("sphere",basicSphere(1.0f,nb_div,nb_div),basicSphere(1.0f,nb_div,nb_div),has_query);
+	benchMesh("cylinder",basicCylinder(2.0f,1.0f,nb_div,nb_div),basicCylinder(2.0f,1.0f,nb_div,nb_div),has_query);
+	headless.endFrame();
+	headless.release();
+	return 0;
+}
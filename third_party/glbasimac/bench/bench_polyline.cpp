@@ -0,0 +1,134 @@
+// Thick antialiased polylines (see glbasimac/glbi_polyline.hpp) : a noisy time series streamed in
+// chunks (only the new points are uploaded), then drawn whole with and without min/max decimation
+// (both images are compared pixel by pixel), zoomed in (only the visible points are drawn), and
+// scrolled one point at a time (decimation columns updated from the new points only).
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON. Run from bin/ (shaders are read from ../assets/shaders) :
+//   bench_polyline [nb_points] [nb_frames]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "glbasimac/glbi_headless.hpp"
+#include "glbasimac/glbi_polyline.hpp"
+
+using namespace glbasimac;
+
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const unsigned int NB_CHUNKS = 100;
+
+typedef std::chrono::steady_clock Clock;
+
+/// Draw \param curve \param nb_frames times, return the milliseconds per frame (snapshot of the last one in \param image)
+static double drawFrames(GLBI_Headless& headless,GLBI_Polyline& curve,int nb_frames,std::vector<unsigned char>* image = nullptr) {
+	Clock::time_point start = Clock::now();
+	for(int f=0;f<nb_frames;f++) {
+		headless.beginFrame();
+		glClearColor(0.1f,0.1f,0.1f,1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		curve.draw();
+		if (image && (f == nb_frames-1)) {
+			image->resize(4*WIDTH*HEIGHT);
+			GLTools::takeSnapshot(WIDTH,HEIGHT,image->data(),4);
+		}
+		headless.endFrame();
+	}
+	glFinish();
+	return std::chrono::duration<double,std::milli>(Clock::now()-start).count()/nb_frames;
+}
+
+static void printDraw(const char* name,double t,const GLBI_Polyline& curve) {
+	printf("%-28s %9.3f ms/frame %10lu visible points %8lu segments%s\n",name,t,curve.stats.visiblePoints,
+	       curve.stats.drawnSegments,curve.stats.decimated ? " (decimated)" : "");
+}
+
+int main(int argc,char** argv) {
+	unsigned int nb_points = (argc > 1) ? atoi(argv[1]) : 2000000;
+	int nb_frames = (argc > 2) ? atoi(argv[2]) : 20;
+
+	GLBI_Headless headless;
+	if (!headless.init(WIDTH,HEIGHT)) return 1;
+	printf("%u points, %d frames, GL %s / %s\n",nb_points,nb_frames,glGetString(GL_VERSION),glGetString(GL_RENDERER));
+	GLBI_Engine engine;
+	engine.initGL();
+	engine.set2DProjection(0.0f,float(nb_points),-2.0f,2.0f);
+
+	// Random walk around a slow sine
+	std::mt19937 gen(1);
+	std::normal_distribution<float> noise(0.0f,0.02f);
+	std::vector<float> coords(2*nb_points);
+	float walk = 0.0f;
+	for(unsigned int i=0;i<nb_points;i++) {
+		walk = 0.999f*walk+noise(gen);
+		coords[2*i] = float(i);
+		coords[2*i+1] = std::sin(6.0f*float(M_PI)*i/nb_points)+walk;
+	}
+
+	GLBI_Polyline curve(engine);
+	curve.width = 2.0f;
+	curve.join = GLBI_JOIN_ROUND;
+	curve.setColor(0.3f,0.8f,1.0f);
+
+	// Streaming : each frame adds a chunk
+	unsigned int chunk = nb_points/NB_CHUNKS;
+	unsigned long max_bytes = 0;
+	Clock::time_point start = Clock::now();
+	for(unsigned int c=0;c<NB_CHUNKS;c++) {
+		curve.addPoints(chunk,&coords[2*c*chunk]);
+		headless.beginFrame();
+		glClear(GL_COLOR_BUFFER_BIT);
+		curve.draw();
+		headless.endFrame();
+		max_bytes = std::max(max_bytes,curve.stats.uploadedBytes);
+	}
+	glFinish();
+	double t_stream = std::chrono::duration<double,std::milli>(Clock::now()-start).count()/NB_CHUNKS;
+	printf("%-28s %9.3f ms/frame %10u points per chunk, at most %lu bytes uploaded per frame (%zu bytes per point)\n",
+	       "streaming",t_stream,chunk,max_bytes,sizeof(GLBI_Polyline_Point));
+
+	// Whole series : decimated against every segment
+	std::vector<unsigned char> images[2];
+	curve.decimation = false;
+	double t_full = drawFrames(headless,curve,std::max(nb_frames/4,1),&images[0]);
+	printDraw("whole, every segment",t_full,curve);
+	curve.decimation = true;
+	double t_decimated = drawFrames(headless,curve,nb_frames,&images[1]);
+	printDraw("whole, decimated",t_decimated,curve);
+	size_t nb_diff = 0;
+	for(size_t p=0;p<images[0].size();p+=4) {
+		for(int c=0;c<3;c++) {
+			if (std::abs(int(images[0][p+c])-int(images[1][p+c])) > 16) {
+				nb_diff++;
+				break;
+			}
+		}
+	}
+	// Borders of the antialiased segments, overlapping by thousands per column, are more opaque in the full strip
+	printf("%zu pixels differ (of %d)\n",nb_diff,WIDTH*HEIGHT);
+
+	// Zoom on 0.25% of the series : no decimation needed, only the visible points are drawn
+	engine.set2DProjection(0.5f*nb_points,0.5025f*nb_points,-2.0f,2.0f);
+	printDraw("zoomed in",drawFrames(headless,curve,nb_frames),curve);
+
+	// Fixed view, one new point per frame : columns updated from the new point only
+	engine.set2DProjection(0.0f,float(nb_points)+nb_frames,-2.0f,2.0f);
+	curve.draw();
+	start = Clock::now();
+	for(int f=0;f<nb_frames;f++) {
+		curve.addPoint(float(nb_points+f),walk);
+		headless.beginFrame();
+		glClear(GL_COLOR_BUFFER_BIT);
+		curve.draw();
+		headless.endFrame();
+	}
+	glFinish();
+	printDraw("append one point",std::chrono::duration<double,std::milli>(Clock::now()-start).count()/nb_frames,curve);
+	printf("%lu bytes uploaded by the last frame\n",curve.stats.uploadedBytes);
+
+	curve.release();
+	headless.release();
+	return 0;
+}
@@ -0,0 +1,101 @@
+// Frame profiler (see glbasimac/glbi_profiler.hpp) : cost of a zone (CPU clock and two GPU timestamp
+// queries), then a few frames of a sphere grid profiled by zones, with the engine stages, written as
+// a Chrome trace (bench_profiler.json, open it in chrome://tracing or ui.perfetto.dev).
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON. Run from bin/ (shaders are read from ../assets/shaders) :
+//   bench_profiler [nb_frames] [grid_size] [nb_zones]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "glbasimac/glbi_draw_list.hpp"
+#include "glbasimac/glbi_headless.hpp"
+#include "glbasimac/glbi_profiler.hpp"
+#include "tools/basic_mesh.hpp"
+
+using namespace glbasimac;
+
+typedef std::chrono::steady_clock Clock;
+
+/// Read the frames still in flight (empty frames)
+static void flush(GLBI_Profiler& profiler) {
+	for(int f=0;f<GLBI_PROFILER_LATENCY;f++) {
+		profiler.beginFrame();
+		profiler.endFrame();
+	}
+}
+
+/// Time (us) of one empty zone, measured over \param nb_zones zones in one frame
+static double zoneCost(GLBI_Profiler& profiler,int nb_zones) {
+	profiler.beginFrame();
+	Clock::time_point start = Clock::now();
+	for(int z=0;z<nb_zones;z++) {
+		GLBI_PROFILE_ZONE(profiler,"empty");
+	}
+	double t = std::chrono::duration<double,std::micro>(Clock::now()-start).count();
+	profiler.endFrame();
+	flush(profiler);
+	return t/nb_zones;
+}
+
+int main(int argc,char** argv) {
+	int nb_frames = (argc > 1) ? atoi(argv[1]) : 20;
+	int grid = (argc > 2) ? atoi(argv[2]) : 16;
+	int nb_zones = (argc > 3) ? atoi(argv[3]) : 10000;
+
+	GLBI_Headless headless;
+	if (!headless.init(1280,720)) return 1;
+	printf("%d spheres, %d frames, GL %s / %s\n",grid*grid,nb_frames,glGetString(GL_VERSION),glGetString(GL_RENDERER));
+	glEnable(GL_DEPTH_TEST);
+	GLBI_Engine engine;
+	engine.mode2D = false;
+	engine.initGL();
+	engine.switchToPhongShading();
+	engine.set3DProjection(60.0f,16.0f/9.0f,0.1f,500.0f);
+	IndexedMesh* sphere = basicSphere(1.0f,32,32);
+	sphere->createVAO();
+	GLBI_DrawList list(engine);
+
+	GLBI_Profiler profiler;
+	bool gpu = profiler.init();
+	printf("%-24s %8.3f us (%s)\n","zone cost",zoneCost(profiler,nb_zones),gpu ? "CPU clock and GPU timestamps" : "CPU clock only");
+
+	profiler.startTrace();
+	for(int f=0;f<nb_frames;f++) {
+		profiler.beginFrame();
+		headless.beginFrame();
+		{
+			GLBI_PROFILE_ZONE(profiler,"clear");
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+		{
+			GLBI_PROFILE_ZONE(profiler,"scene");
+			float angle = 0.05f*f;
+			engine.mvMatrixStack.loadIdentity();
+			engine.setViewMatrix(Matrix4D::lookAt(Vector3D(20.0f*std::cos(angle),10.0f,20.0f*std::sin(angle)),Vector3D(0.0f,0.0f,0.0f),Vector3D(0.0f,1.0f,0.0f)));
+			{
+				GLBI_PROFILE_ZONE(profiler,"record");
+				for(int j=0;j<grid;j++) {
+					for(int i=0;i<grid;i++) {
+						engine.mvMatrixStack.pushMatrix();
+						engine.mvMatrixStack.addTranslation(Vector3D(3.0f*(i-grid/2),0.0f,3.0f*(j-grid/2)));
+						list.addDraw(*sphere,GLBI_Material(Vector3D(0.2f+0.6f*i/grid,0.5f,0.2f+0.6f*j/grid)));
+						engine.mvMatrixStack.popMatrix();
+					}
+				}
+			}
+			list.submit();
+		}
+		headless.endFrame();
+		profiler.endFrame();
+	}
+	printf("%s",profiler.report().c_str());
+	printf("%lu frames read late (stalls)\n",profiler.nbStalls);
+	flush(profiler);
+	profiler.stopTrace();
+	profiler.trace.resize(nb_frames);
+	if (profiler.writeTrace("bench_profiler.json")) printf("Trace of %zu frames written in bench_profiler.json\n",profiler.trace.size());
+	delete sphere;
+	profiler.release();
+	headless.release();
+	return 0;
+}
@@ -0,0 +1,87 @@
+// Shader startup cost (see glbasimac/glbi_program_cache.hpp) : the engine programs (with the engine
+// #define lines) built one after the other, then requested together (overlapped compilation) with
+// GLBI_Program_Cache without disk cache, then loaded from the binary cache written by the previous step.
+// Driver caches hide part of the compilation : Mesa keeps compiled shaders in ~/.cache/mesa_shader_cache
+// (and exposes no program binary format when this cache is disabled).
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON. Run from bin/ (shaders are read from ../assets/shaders) :
+//   bench_shader_cache [nb_runs] [cache_dir]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <filesystem>
+#include "glbasimac/glbi_engine.hpp"
+#include "glbasimac/glbi_headless.hpp"
+#include "glbasimac/glbi_program_cache.hpp"
+
+using namespace glbasimac;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* files[4] = {
+	"../assets/shaders/flat_shading_3D.vert","../assets/shaders/flat_shading.frag",
+	"../assets/shaders/phong_shading.vert","../assets/shaders/phong_shading.frag"
+};
+
+static double elapsedMs(Clock::time_point start) {
+	return std::chrono::duration<double,std::milli>(Clock::now()-start).count();
+}
+
+/// Build both programs, return the time in ms (programs are deleted).
+/// \param overlapped : both requested before the first finish, else each finished before the next request
+static double buildWithCache(GLBI_Program_Cache& cache,bool overlapped = true) {
+	std::string defines = GLBI_Engine::shaderDefines();
+	Clock::time_point start = Clock::now();
+	unsigned int programs[2];
+	if (overlapped) {
+		int flat = cache.request(files[0],files[1],defines);
+		int phong = cache.request(files[2],files[3],defines);
+		programs[0] = cache.finish(flat);
+		programs[1] = cache.finish(phong);
+	}
+	else {
+		programs[0] = cache.finish(cache.request(files[0],files[1],defines));
+		programs[1] = cache.finish(cache.request(files[2],files[3],defines));
+	}
+	glFinish();
+	double t = elapsedMs(start);
+	if (!programs[0] || !programs[1]) {
+		std::cerr<<"Unable to build the programs"<<std::endl;
+		exit(1);
+	}
+	glDeleteProgram(programs[0]);
+	glDeleteProgram(programs[1]);
+	return t;
+}
+
+int main(int argc,char** argv) {
+	int nb_runs = (argc > 1) ? atoi(argv[1]) : 5;
+	std::string dir = (argc > 2) ? argv[2] : "bench_shader_cache";
+
+	GLBI_Headless_Context context;
+	if (!context.create(64,64)) return 1;
+	printf("Flat and phong programs, %d runs, GL %s / %s\n",nb_runs,glGetString(GL_VERSION),glGetString(GL_RENDERER));
+	std::error_code error;
+	std::filesystem::remove_all(dir,error);
+
+	double t_serial = 0.0,t_overlap = 0.0,t_warm = 0.0;
+	for(int r=0;r<nb_runs;r++) {
+		GLBI_Program_Cache serial("");
+		t_serial += buildWithCache(serial,false);
+		GLBI_Program_Cache no_disk("");
+		t_overlap += buildWithCache(no_disk);
+	}
+	GLBI_Program_Cache cold(dir);
+	double t_cold = buildWithCache(cold);
+	for(int r=0;r<nb_runs;r++) {
+		GLBI_Program_Cache warm(dir);
+		t_warm += buildWithCache(warm);
+		if (warm.nbHits != 2) printf("Warning : %lu programs compiled (binary cache not used)\n",warm.nbCompiled);
+	}
+	printf("%-34s %8.2f ms\n","one after the other (serial)",t_serial/nb_runs);
+	printf("%-34s %8.2f ms\n","request/finish (overlapped)",t_overlap/nb_runs);
+	printf("%-34s %8.2f ms\n","cold cache (compile + store)",t_cold);
+	printf("%-34s %8.2f ms   speedup x%.1f\n","warm cache (program binaries)",t_warm/nb_runs,t_serial/t_warm);
+	return 0;
+}
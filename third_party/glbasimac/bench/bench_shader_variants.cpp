@@ -0,0 +1,89 @@
+// Fragment shading cost of the shader variants (see GLBI_Shader_Variant in glbasimac/glbi_engine.hpp) :
+// screen-filling textured spheres lit by point and directional lights, drawn with the generic phong
+// program (texturing, specular and light loop tested per fragment) then with the specialized variant.
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON. Run from bin/ (shaders are read from ../assets/shaders) :
+//   bench_shader_variants [nb_frames] [nb_lights] [size]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "glbasimac/glbi_engine.hpp"
+#include "glbasimac/glbi_headless.hpp"
+#include "glbasimac/glbi_texture.hpp"
+#include "tools/basic_mesh.hpp"
+
+using namespace glbasimac;
+
+/// Render nb_frames with \param engine, return the frames per second
+static double renderFrames(GLBI_Engine& engine,GLBI_Headless& headless,IndexedMesh* sphere,int nb_frames) {
+	Matrix4D view = Matrix4D::lookAt(Vector3D(0.0f,0.0f,12.0f),Vector3D(0.0f),Vector3D(0.0f,1.0f,0.0f));
+	engine.setViewMatrix(view);
+	glFinish();
+	auto start = std::chrono::steady_clock::now();
+	for(int f=0;f<nb_frames;f++) {
+		headless.beginFrame();
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// Overlapping spheres drawn back to front : every one is shaded
+		for(int i=0;i<4;i++) {
+			engine.mvMatrixStack.loadIdentity();
+			engine.mvMatrixStack.addTransformation(view);
+			engine.mvMatrixStack.addTranslation(Vector3D(0.0f,0.0f,float(i)));
+			engine.mvMatrixStack.addRotation(0.02f*f+i,Vector3D(0.0f,1.0f,0.0f));
+			engine.mvMatrixStack.addHomothety(6.0f);
+			engine.updateMvMatrix();
+			sphere->draw();
+		}
+		headless.endFrame();
+	}
+	glFinish();
+	return nb_frames/std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+}
+
+int main(int argc,char** argv) {
+	int nb_frames = (argc > 1) ? atoi(argv[1]) : 30;
+	int nb_lights = (argc > 2) ? atoi(argv[2]) : 4;
+	int size = (argc > 3) ? atoi(argv[3]) : 1024;
+
+	GLBI_Headless headless;
+	if (!headless.init(size,size)) return 1;
+	printf("%d frames of %dx%d, %d lights, GL %s / %s\n",nb_frames,size,size,nb_lights,glGetString(GL_VERSION),glGetString(GL_RENDERER));
+	glEnable(GL_DEPTH_TEST);
+	IndexedMesh* sphere = basicSphere(1.0f,64,64);
+	sphere->createVAO();
+	GLBI_Texture texture;
+	texture.createTexture();
+	texture.attachTexture();
+	std::vector<unsigned char> pixels(3*256*256);
+	for(size_t i=0;i<pixels.size();i++) pixels[i] = (unsigned char)((i*7)^(i/768));
+	texture.loadImage(256,256,3,pixels.data());
+
+	double fps[2];
+	for(int variants=0;variants<2;variants++) {
+		GLBI_Engine engine;
+		engine.mode2D = false;
+		engine.shaderVariants = (variants == 1);
+		engine.programCache.directory = "";
+		engine.initGL();
+		engine.switchToPhongShading();
+		engine.set3DProjection(60.0f,1.0f,0.1f,100.0f);
+		// Half point lights, half directional lights
+		engine.setLightPosition(Vector4D(0.0f,10.0f,20.0f,1.0f),0);
+		engine.setLightIntensity(Vector3D(400.0f),0);
+		for(int l=1;l<nb_lights;l++) {
+			engine.addALight(Vector4D(float(l),float(l%3),5.0f,(l%2) ? 0.0f : 1.0f),Vector3D(0.1f*l,0.3f,(l%2) ? 0.4f : 80.0f));
+		}
+		engine.setShininess(32.0f);
+		engine.setSpecularColor(Vector3D(0.5f));
+		engine.activateTexturing(true);
+		renderFrames(engine,headless,sphere,2);
+		fps[variants] = renderFrames(engine,headless,sphere,nb_frames);
+		printf("%-26s %8.1f frames/s\n",variants ? "variant (compile-time)" : "generic (run-time tests)",fps[variants]);
+		glDeleteProgram(engine.idShader[0]);
+		glDeleteProgram(engine.idShader[1]);
+	}
+	printf("Speedup x%.2f\n",fps[1]/fps[0]);
+	delete sphere;
+	headless.release();
+	return 0;
+}
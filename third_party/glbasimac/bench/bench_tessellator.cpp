@@ -0,0 +1,147 @@
+// Polygon tessellation (see glbasimac/glbi_tessellator.hpp) : ear clipping against the monotone sweep on
+// concave star polygons of growing size, then a map like polygon with holes, and the cache. The area
+// of the triangles is checked against the area of the polygon. The sweep time per n log2 n stays flat.
+// Degenerate and self-touching rings must be triangulated exactly or rejected (never crash).
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON :
+//   bench_tessellator [max_points] [nb_holes_per_side]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "glbasimac/glbi_tessellator.hpp"
+
+using namespace glbasimac;
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedMs(Clock::time_point start) {
+	return std::chrono::duration<double,std::milli>(Clock::now()-start).count();
+}
+
+/// Star of \param nb points (every other point inside), radii randomized : concave, simple
+static std::vector<float> star(unsigned int nb,double cx,double cy,double r_in,double r_out,unsigned int seed) {
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<double> jitter(0.8,1.0);
+	std::vector<float> coords;
+	for(unsigned int i=0;i<nb;i++) {
+		double angle = 2.0*M_PI*i/nb;
+		double r = ((i%2) ? r_in : r_out)*jitter(gen);
+		coords.push_back(float(cx+r*std::cos(angle)));
+		coords.push_back(float(cy+r*std::sin(angle)));
+	}
+	return coords;
+}
+
+static double ringArea(const std::vector<float>& coords) {
+	double area = 0.0;
+	size_t nb = coords.size()/2;
+	for(size_t i=0;i<nb;i++) {
+		size_t j = (i+1)%nb;
+		area += double(coords[2*i])*coords[2*j+1]-double(coords[2*j])*coords[2*i+1];
+	}
+	return 0.5*std::fabs(area);
+}
+
+/// Relative difference between the area of \param triangles and the area of the polygon
+static double areaError(const std::vector<float>& outline,const std::vector<std::vector<float> >& holes,const std::vector<unsigned int>& triangles) {
+	std::vector<float> pts(outline);
+	double expected = ringArea(outline);
+	for(size_t h=0;h<holes.size();h++) {
+		pts.insert(pts.end(),holes[h].begin(),holes[h].end());
+		expected -= ringArea(holes[h]);
+	}
+	double area = 0.0;
+	for(size_t t=0;t<triangles.size();t+=3) {
+		const float* a = &pts[2*triangles[t]];
+		const float* b = &pts[2*triangles[t+1]];
+		const float* c = &pts[2*triangles[t+2]];
+		area += 0.5*((double(b[0])-a[0])*(double(c[1])-a[1])-(double(b[1])-a[1])*(double(c[0])-a[0]));
+	}
+	return std::fabs(area-expected)/expected;
+}
+
+int main(int argc,char** argv) {
+	unsigned int max_points = (argc > 1) ? atoi(argv[1]) : 200000;
+	int holes_side = (argc > 2) ? atoi(argv[2]) : 30;
+	std::vector<std::vector<float> > no_hole;
+
+	printf("%10s %12s %12s %16s %12s\n","points","ear ms","sweep ms","sweep ns/nlogn","area error");
+	for(unsigned int nb=1000;nb<=max_points;nb*=(nb < 10000) ? 10 : 2) {
+		std::vector<float> outline = star(nb,0.0,0.0,40.0,100.0,nb);
+		std::vector<unsigned int> triangles;
+		double t_ear = -1.0;
+		// Ear clipping is quadratic : only up to 10000 points
+		if (nb <= 10000) {
+			Clock::time_point start = Clock::now();
+			GLBI_Tessellator::earClipping(outline,triangles);
+			t_ear = elapsedMs(start);
+			triangles.clear();
+		}
+		Clock::time_point start = Clock::now();
+		bool ok = GLBI_Tessellator::sweep(outline,no_hole,triangles);
+		double t_sweep = elapsedMs(start);
+		char ear[16] = "-";
+		if (t_ear >= 0.0) snprintf(ear,sizeof(ear),"%.2f",t_ear);
+		printf("%10u %12s %12.2f %16.2f %12.2e%s\n",nb,ear,t_sweep,1e6*t_sweep/(nb*std::log2(double(nb))),
+		       areaError(outline,no_hole,triangles),ok ? "" : " (failed)");
+	}
+
+	// Map like overlay : a large outline with a grid of small concave holes
+	std::vector<float> outline = star(50000,0.0,0.0,90.0,100.0,1);
+	std::vector<std::vector<float> > holes;
+	for(int j=0;j<holes_side;j++) {
+		for(int i=0;i<holes_side;i++) {
+			double cx = -50.0+100.0*i/std::max(holes_side-1,1),cy = -50.0+100.0*j/std::max(holes_side-1,1);
+			holes.push_back(star(32,cx,cy,0.5,1.2,j*holes_side+i));
+		}
+	}
+	GLBI_Tessellator tessellator;
+	tessellator.createVAOs = false;
+	Clock::time_point start = Clock::now();
+	IndexedMesh* mesh = tessellator.tessellate(outline,holes);
+	double t_first = elapsedMs(start);
+	start = Clock::now();
+	IndexedMesh* cached = tessellator.tessellate(outline,holes);
+	double t_cached = elapsedMs(start);
+	std::vector<unsigned int> triangles;
+	GLBI_Tessellator::triangulate(outline,holes,triangles);
+	printf("map : %zu points, %zu holes, %zu triangles, area error %.2e\n",outline.size()/2+holes.size()*32,holes.size(),
+	       triangles.size()/3,areaError(outline,holes,triangles));
+	printf("%-24s %10.2f ms\n","tessellate",t_first);
+	printf("%-24s %10.3f ms (%s mesh, hash of the points)\n","tessellate again",t_cached,(mesh && (cached == mesh)) ? "same" : "another");
+
+	// Degenerate rings : overlapping collinear edges, no area, a spike, a ring touching itself at a vertex
+	const char* names[5] = {"overlapping edges","flat","spike","touching itself","overlapping edges, large"};
+	std::vector<float> rings[5] = {
+		{0,0,10,0,10,10,0,10,0,0,5,0,5,5},
+		{0,0,5,0,10,0},
+		{0,0,10,0,10,10,5,10,5,15,5,10,0,10},
+		{0,0,5,5,10,0,10,10,5,5,0,10},
+		{0,0,10,0,10,10}
+	};
+	// Above GLBI_EAR_CLIPPING_MAX_POINTS : tessellate goes through the sweep
+	for(int i=1;i<100;i++) {
+		rings[4].push_back(10.0f-0.1f*i);
+		rings[4].push_back(10.0f);
+	}
+	rings[4].insert(rings[4].end(),{0,10,0,0,5,0,5,5});
+	for(int r=0;r<5;r++) {
+		std::vector<unsigned int> tris;
+		bool ok = GLBI_Tessellator::sweep(rings[r],no_hole,tris);
+		double expected = ringArea(rings[r]);
+		if (!ok) printf("%-24s rejected\n",names[r]);
+		else if (expected > 0.0) printf("%-24s %zu triangles, area error %.2e\n",names[r],tris.size()/3,areaError(rings[r],no_hole,tris));
+		else printf("%-24s %zu triangles\n",names[r],tris.size()/3);
+	}
+	// The sweep fails, triangulate falls back to ear clipping
+	std::vector<unsigned int> tris;
+	unsigned long failures = tessellator.stats.failures;
+	bool ok = GLBI_Tessellator::triangulate(rings[4],no_hole,tris);
+	IndexedMesh* degenerate = tessellator.tessellate(rings[4]);
+	printf("%-24s %s, area error %.2e, %s (%lu failure)\n","triangulate large",ok ? "done" : "failed",
+	       areaError(rings[4],no_hole,tris),degenerate ? "mesh" : "no mesh",tessellator.stats.failures-failures);
+	return 0;
+}
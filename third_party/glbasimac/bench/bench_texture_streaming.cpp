@@ -0,0 +1,94 @@
+// Texture loading stalls (see glbasimac/glbi_texture_loader.hpp) : a set of PNG files loaded
+// synchronously (decode and upload on the rendering thread, the frame loop is frozen meanwhile)
+// against GLBI_Texture_Loader (decode on worker threads, upload streamed with a per-frame budget
+// while frames keep being drawn).
+// Build with -DGLBASIMAC_BUILD_BENCHMARKS=ON, runs without display (headless context) :
+//   bench_texture_streaming [nb_textures] [size] [budget_in_KB] [work_dir]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "glbasimac/glbi_headless.hpp"
+#include "glbasimac/glbi_texture_loader.hpp"
+
+using namespace glbasimac;
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedMs(Clock::time_point start) {
+	return std::chrono::duration<double,std::milli>(Clock::now()-start).count();
+}
+
+/// Some frame work : clear the render target and wait for the GPU, as a swap would
+static void drawFrame(int frame) {
+	glClearColor(0.01f*(frame%100),0.2f,0.3f,1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glFinish();
+}
+
+int main(int argc,char** argv) {
+	int nb_textures = (argc > 1) ? atoi(argv[1]) : 64;
+	int size = (argc > 2) ? atoi(argv[2]) : 1024;
+	size_t budget = (argc > 3) ? size_t(atoi(argv[3]))*1024 : GLBI_TEXTURE_UPLOAD_BUDGET;
+	std::string dir = (argc > 4) ? argv[4] : ".";
+
+	GLBI_Headless headless;
+	if (!headless.init(640,480)) return 1;
+	printf("%d textures of %dx%d, GL %s / %s\n",nb_textures,size,size,glGetString(GL_VERSION),glGetString(GL_RENDERER));
+
+	// Input files : smooth gradients with some noise, so that PNG decoding is not trivial
+	std::vector<std::string> files;
+	std::vector<unsigned char> pixels(3*size_t(size)*size);
+	for(int t=0;t<nb_textures;t++) {
+		char name[64];
+		snprintf(name,64,"/bench_texture_%03d.png",t);
+		files.push_back(dir+name);
+		if (FILE* f = fopen(files.back().c_str(),"rb")) {
+			fclose(f);
+			continue;
+		}
+		for(size_t i=0;i<pixels.size();i++) pixels[i] = (unsigned char)((i/3)%size+t*7+rand()%16);
+		if (!glbiWriteImage(files.back(),GLBI_IMAGE_PNG,size,size,3,pixels.data())) return 1;
+	}
+
+	std::vector<GLBI_Texture> textures(nb_textures);
+	headless.beginFrame();
+
+	// Synchronous : decode and upload on the rendering thread
+	Clock::time_point start = Clock::now();
+	for(int t=0;t<nb_textures;t++) {
+		int w,h,c;
+		if (!glbiReadImage(files[t],w,h,c,pixels)) return 1;
+		if (!textures[t].id_in_GL) textures[t].createTexture();
+		textures[t].attachTexture();
+		textures[t].loadImage(w,h,c,pixels.data());
+	}
+	glFinish();
+	double t_sync = elapsedMs(start);
+	printf("%-22s total %8.1f ms   longest frame %8.1f ms\n","synchronous",t_sync,t_sync);
+
+	// Streaming : frames go on while textures are decoded and uploaded
+	GLBI_Texture_Loader loader(0,budget);
+	start = Clock::now();
+	for(int t=0;t<nb_textures;t++) loader.load(files[t],textures[t]);
+	std::vector<double> frame_times;
+	while (loader.pending()) {
+		Clock::time_point frame_start = Clock::now();
+		loader.update();
+		drawFrame(int(frame_times.size()));
+		frame_times.push_back(elapsedMs(frame_start));
+	}
+	double t_async = elapsedMs(start);
+	std::sort(frame_times.begin(),frame_times.end());
+	printf("%-22s total %8.1f ms   longest frame %8.1f ms   median %6.2f ms   %lu frames   %.1f MB uploaded\n","streaming",t_async,
+	       frame_times.back(),frame_times[frame_times.size()/2],(unsigned long)frame_times.size(),loader.nbBytesUploaded/1048576.0);
+	printf("Frame loop frozen %.0fx less long\n",t_sync/frame_times.back());
+
+	loader.release();
+	textures.clear();
+	headless.release();
+	return 0;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct GLFWwindow;
+
+namespace glbasimac {
+
+/// Number of frame times kept for the statistics
+#define GLBI_FRAME_TIMES 1024
+
+/// Statistics of the last frame times (time between two frame starts), in ms
+struct GLBI_Frame_Stats {
+	GLBI_Frame_Stats():nbFrames(0),mean(0.0),p50(0.0),p99(0.0),max(0.0),jitter(0.0) {}
+
+	/// "fps, p50, p99, max, jitter" on one line
+	std::string toString() const;
+
+	/// Frames measured (at most GLBI_FRAME_TIMES)
+	unsigned long nbFrames;
+	double mean;
+	double p50;
+	double p99;
+	double max;
+	/// Mean difference between two consecutive frame times
+	double jitter;
+};
+
+/**
+ * Application loop with a fixed timestep simulation and interpolated rendering : update(dt) is called
+ * with dt = fixedStep as many times as needed to follow the real time, then render(alpha) once, with
+ * alpha in [0,1[ the part of a step elapsed since the last update (to interpolate the state drawn).
+ * Animation speed does not depend on the frame rate.
+ * Pacing (run) : frames are paced by vsync (swapInterval). With a targetFrameTime, the swap interval
+ * is a multiple of the refresh period when the refresh rate is known, and the loop sleeps until the
+ * next frame is due otherwise : it only wakes up for events. Iconified windows are not drawn.
+ * With onDemand (scenes without simulation), a frame is drawn only after events or requestRedraw.
+ * With benchmark, frames are neither synchronized nor capped.
+ * Typical use :
+ *   GLBI_App_Loop loop;
+ *   loop.update = [&](double dt) {angle += speed*dt;};
+ *   loop.render = [&](double alpha) {draw(previous_angle+alpha*(angle-previous_angle));};
+ *   loop.run(window); std::cout<<loop.frameStats().toString()<<std::endl;
+ */
+struct GLBI_App_Loop {
+	GLBI_App_Loop();
+
+	/// Simulation step (dt in s). May be empty
+	std::function<void(double)> update;
+	/// Drawing of a frame (alpha in [0,1[). May be empty
+	std::function<void(double)> render;
+
+	/// Loop (events, frames, swaps) until the window should close. The frames of the active profiler
+	/// (GLBI_Profiler::active) are started and ended around each frame
+	void run(GLFWwindow* window);
+	/// Updates due since the previous frame, then render. For loops driven by the application (headless)
+	void frame();
+	/// Restart the clock : the time elapsed since the last frame is not simulated (after a pause)
+	void resume() {lastTime = -1.0;}
+	/// Draw a frame even without event (onDemand)
+	void requestRedraw() {redraw = true;}
+	/// Statistics of the last GLBI_FRAME_TIMES frame times
+	GLBI_Frame_Stats frameStats() const;
+	void resetStats();
+	/// Seconds since the loop was created
+	double now() const;
+
+	/// Simulation step (s)
+	double fixedStep;
+	/// Maximum number of updates in one frame : a slower simulation drops time instead of lagging further
+	unsigned int maxSteps;
+	/// Minimal time between two frames (s), 0 for the vsync rate
+	double targetFrameTime;
+	/// Vertical synchronizations per frame (0 : no synchronization)
+	int swapInterval;
+	/// Uncapped frames (no vsync, no sleep). Stops after benchmarkFrames frames (0 : when the window closes)
+	bool benchmark;
+	unsigned long benchmarkFrames;
+	bool onDemand;
+
+	/// Simulated time (s)
+	double simTime;
+	unsigned long nbUpdates;
+	unsigned long nbFrames;
+
+private:
+	void recordFrameTime(double dt);
+
+	std::chrono::steady_clock::time_point origin;
+	/// Start of the previous frame (s), -1 after a pause
+	double lastTime;
+	/// Real time not simulated yet (s)
+	double accumulator;
+	bool redraw;
+	/// Ring of the last frame times (s)
+	std::vector<double> frameTimes;
+	size_t nextFrameTime;
+};
+
+}
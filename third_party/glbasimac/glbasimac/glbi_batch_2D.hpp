@@ -0,0 +1,122 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "glbasimac/glbi_engine.hpp"
+#include "tools/matrix_stack.hpp"
+
+using namespace STP3D;
+
+namespace glbasimac {
+
+/// Vertices of one draw of a GLBI_Batch_2D (16 bits indices)
+#define GLBI_BATCH_2D_MAX_VERTICES 65536
+
+/// Vertex of a GLBI_Batch_2D : position already transformed, 8 bits color
+struct GLBI_Batch_2D_Vertex {
+	float x,y;
+	unsigned char rgba[4];
+};
+
+/// Draws and vertices of the last flush
+struct GLBI_Batch_2D_Stats {
+	GLBI_Batch_2D_Stats():drawCalls(0),vertices(0),triangles(0) {}
+	unsigned long drawCalls;
+	unsigned long vertices;
+	unsigned long triangles;
+};
+
+/**
+ * Batched 2D primitives (core profile replacement of glBegin/glVertex, glColor and glRotatef) :
+ * shapes are transformed on the CPU by the top of transform (a MatrixStack, used as the engine
+ * one) and written as indexed triangles with the current color. flush() uploads the vertices of
+ * the frame in one dynamic buffer and draws them with the engine program in use (flat shading,
+ * 2D or 3D), a draw per GLBI_BATCH_2D_MAX_VERTICES vertices : the number of draws does not
+ * depend on the number of shapes.
+ * Line widths are in the units of the engine modelview (after transform) : a line keeps its
+ * width whatever the scaling of the shape. Polygons must be convex (fan triangulation).
+ * Typical use (a GL context must be current) :
+ *   GLBI_Batch_2D batch(engine);
+ *   each frame : batch.transform.loadTransformation(node.getWorldMatrix()); batch.setColor(1,0,0);
+ *                batch.circle(0,0,1); ... batch.flush();
+ */
+struct GLBI_Batch_2D {
+	GLBI_Batch_2D(GLBI_Engine& eng):engine(eng),idVAO(0),capacity(0),idxCapacity(0) {
+		idVBO[0] = idVBO[1] = 0;
+		color[0] = color[1] = color[2] = color[3] = 255;
+	}
+	~GLBI_Batch_2D() {release();}
+
+	/// Delete the GL buffers (a GL context must be current)
+	void release();
+
+	/// Color of the next shapes (components in [0,1])
+	void setColor(float r,float g,float b);
+
+	/// Filled primitives
+	void triangle(float x0,float y0,float x1,float y1,float x2,float y2);
+	/// Quad of corners \param pts (x,y pairs, convex, in order)
+	void quad(const float pts[8]);
+	void rectangle(float xmin,float ymin,float xmax,float ymax);
+	void roundedRectangle(float xmin,float ymin,float xmax,float ymax,float radius,unsigned int nb_corner_segments = 8);
+	void circle(float cx,float cy,float radius,unsigned int nb_segments = 32);
+	/// Convex polygon of \param coords (x,y pairs)
+	void polygon(const std::vector<float>& coords);
+
+	/// Segment of \param width
+	void line(float x0,float y0,float x1,float y1,float width);
+	/// Line strip of \param coords (x,y pairs) with mitered joins, closed (loop) if \param closed
+	void polyline(const std::vector<float>& coords,float width,bool closed = false);
+	void circleOutline(float cx,float cy,float radius,float width,unsigned int nb_segments = 32);
+	void rectangleOutline(float xmin,float ymin,float xmax,float ymax,float width);
+
+	/// Upload and draw the shapes recorded since the last flush, then clear them.
+	/// The modelview matrix of the engine is restored after the draws
+	void flush();
+	/// Remove the shapes recorded since the last flush
+	void clear() {vertices.clear(); indices.clear(); chunks.clear();}
+	/// Number of vertices recorded since the last flush
+	size_t nbVertices() const {return vertices.size();}
+
+	GLBI_Engine& engine;
+	/// Transformation applied to the next shapes
+	MatrixStack transform;
+	/// Statistics of the last flush
+	GLBI_Batch_2D_Stats stats;
+
+private:
+	GLBI_Batch_2D(const GLBI_Batch_2D&);
+	GLBI_Batch_2D& operator=(const GLBI_Batch_2D&);
+
+	/// Indices drawn with the same base vertex
+	struct Chunk {
+		size_t firstIndex;
+		size_t nbIndices;
+		size_t baseVertex;
+	};
+	/// Start room for \param nb_vertices vertices. Return the index of the first one in the current chunk
+	unsigned int reserve(size_t nb_vertices);
+	/// Add a vertex (already transformed) with the current color
+	void addVertex(float x,float y);
+	/// Add a transformed vertex
+	void addPoint(float x,float y);
+	/// Add the triangle fan of the \param nb last vertices
+	void addFan(unsigned int first,unsigned int nb);
+	/// Add the quad of width \param width around the transformed segment (x0,y0)-(x1,y1)
+	void addSegment(float x0,float y0,float x1,float y1,float width);
+	/// Create the VAO and its buffers
+	bool createBuffers();
+
+	unsigned char color[4];
+	std::vector<GLBI_Batch_2D_Vertex> vertices;
+	std::vector<unsigned short> indices;
+	std::vector<Chunk> chunks;
+	unsigned int idVAO;
+	/// Vertex (0) and index (1) buffers
+	unsigned int idVBO[2];
+	/// Sizes allocated in the GL buffers (vertices and indices)
+	size_t capacity;
+	size_t idxCapacity;
+};
+
+}
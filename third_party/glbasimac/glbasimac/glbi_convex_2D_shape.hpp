@@ -4,11 +4,13 @@
 #include <cassert>
 #include "tools/mesh.hpp"
 #include "tools/vector3d.hpp"
+#include "tools/matrix4d.hpp"
 
 using namespace STP3D;
 
 namespace glbasimac {
 
+/// Convex outline drawn as a fan or a loop. Concave shapes and shapes with holes : see GLBI_Tessellator
 struct GLBI_Convex_2D_Shape {
 	GLBI_Convex_2D_Shape(unsigned int dim = 2)
 		:nb_pts(0),dimension(dim),shape(0,GL_LINE_LOOP) {
@@ -21,10 +23,20 @@ struct GLBI_Convex_2D_Shape {
 
 	void initShape(const std::vector<float> in_coord);
 
+	/// Primitive of the shape (GL_LINE_LOOP by default). GL_POLYGON is drawn as GL_TRIANGLE_FAN (core profile)
 	void changeNature(unsigned int new_gl_type);
 
 	void drawShape();
 
+	/// Set the transform and color (optional) of each instance drawn by drawShapeInstanced
+	void setInstances(const std::vector<Matrix4D>& transforms,const std::vector<Vector3D>& colors = std::vector<Vector3D>());
+
+	/// Draw all instances in one draw call. Each instance transform is applied before the current modelview
+	void drawShapeInstanced();
+
+	/// Remove instances : drawShape uses again the current flat color only
+	void clearInstances();
+
 	// Application and GL parameters
 	unsigned int nb_pts;
 	unsigned int dimension;
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "glbasimac/glbi_engine.hpp"
+#include "glbasimac/glbi_texture.hpp"
+#include "glbasimac/glbi_convex_2D_shape.hpp"
+#include "tools/mesh.hpp"
+#include "tools/indexed_mesh.hpp"
+
+using namespace STP3D;
+
+namespace glbasimac {
+
+/// Material of a recorded draw. Specular color and shininess are only used by Phong shading
+struct GLBI_Material {
+	GLBI_Material(const Vector3D& col = Vector3D(1.0),const Vector3D& spec = Vector3D(0.0),float shin = 0.0)
+		:color(col),specular(spec),shininess(shin) {}
+
+	Vector3D color;
+	Vector3D specular;
+	float shininess;
+};
+
+/// One draw recorded in a GLBI_DrawList
+struct GLBI_Draw_Command {
+	StandardMesh* mesh;      ///< Mesh to draw (or NULL)
+	IndexedMesh* idxMesh;    ///< Indexed mesh to draw (or NULL)
+	unsigned int vao;        ///< VAO of the mesh (sort key)
+	int shader;              ///< Engine shader (0 flat, 1 phong)
+	unsigned int texture;    ///< GL texture (0 if no texture)
+	Matrix4D modelview;      ///< Modelview matrix at record time
+	GLBI_Material material;
+};
+
+/// State changes and draw calls issued for one frame
+struct GLBI_Draw_Stats {
+	GLBI_Draw_Stats():commands(0),culled(0),drawCalls(0),programChanges(0),textureChanges(0),vaoBinds(0) {}
+	/// Sum of all driver calls counted
+	unsigned long total() const {return drawCalls+programChanges+textureChanges+vaoBinds;}
+
+	unsigned long commands;
+	/// Commands skipped because their bounds are outside the view frustum
+	unsigned long culled;
+	unsigned long drawCalls;
+	unsigned long programChanges;
+	unsigned long textureChanges;
+	unsigned long vaoBinds;
+};
+
+/**
+ * Retained mode rendering : draws are recorded during the frame (with the current shader and
+ * modelview of the engine) then submitted at once. At submit time, commands are sorted by
+ * program, texture and VAO, consecutive draws of the same mesh and material are merged in a
+ * single instanced draw, and redundant binds are skipped. Commands whose mesh bounds (see
+ * IndexedMesh::bbox) are outside the frustum of the engine are culled first, several boxes at a time.
+ * Meshes drawn through a draw list must not use their own instances (see StandardMesh::setInstances).
+ */
+struct GLBI_DrawList {
+	GLBI_DrawList(GLBI_Engine& eng):engine(eng),sortCommands(true),mergeInstances(true),frustumCulling(true) {}
+
+	/// Record a draw of \param mesh with the current engine shader and modelview matrix
+	void addDraw(StandardMesh& mesh,const GLBI_Material& material,const GLBI_Texture* texture = nullptr);
+	void addDraw(IndexedMesh& mesh,const GLBI_Material& material,const GLBI_Texture* texture = nullptr);
+	void addDraw(GLBI_Convex_2D_Shape& shape,const GLBI_Material& material,const GLBI_Texture* texture = nullptr);
+
+	/// Sort, merge and draw every recorded command, then clear the list.
+	/// Current shader, texturing flag, bound texture and modelview matrix of the engine are restored after submission.
+	void submit();
+	/// Remove every recorded command
+	void clear() {commands.clear();}
+
+	GLBI_Engine& engine;
+	/// Sort commands by program, texture and VAO before drawing
+	bool sortCommands;
+	/// Merge consecutive draws of the same mesh and material in an instanced draw
+	bool mergeInstances;
+	/// Skip commands outside the view frustum of the engine (see GLBI_Engine::viewFrustum)
+	bool frustumCulling;
+	std::vector<GLBI_Draw_Command> commands;
+	/// Calls that immediate drawing of the last submitted frame would have issued (record order)
+	GLBI_Draw_Stats beforeSort;
+	/// Calls really issued by the last submit
+	GLBI_Draw_Stats afterSort;
+
+private:
+	void record(StandardMesh* mesh,IndexedMesh* idx_mesh,unsigned int vao,const GLBI_Material& material,const GLBI_Texture* texture);
+	/// Count the calls of immediate drawing in record order
+	void computeImmediateStats();
+	/// Draw commands [first,last[ (same mesh and material) in one instanced draw
+	void drawMerged(size_t first,size_t last,unsigned int& current_vao);
+	/// Remove the commands outside the view frustum. Return the number removed
+	size_t cullCommands();
+
+	std::vector<float> instanceTransforms;
+	std::vector<float> instanceColors;
+	FrustumCuller culler;
+	std::vector<unsigned char> visibility;
+};
+
+}
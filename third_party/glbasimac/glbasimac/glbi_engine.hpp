@@ -3,23 +3,135 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 #include <iostream>
+#include <map>
+#include <string>
+#include <vector>
 #include "tools/matrix4d.hpp"
 #include "tools/matrix_stack.hpp"
+#include "tools/frustum.hpp"
+#include "glbasimac/glbi_transform_node.hpp"
+#include "glbasimac/glbi_program_cache.hpp"
+#include "glbasimac/glbi_file_watcher.hpp"
 
 using namespace STP3D;
 
 namespace glbasimac {
 
+/// Maximum number of lights (defined in the engine shaders by GLBI_Engine::shaderDefines)
+#define GLBI_MAX_LIGHTS 64
+/// Uniform buffer binding point of the per-frame block
+#define GLBI_FRAME_BLOCK_BINDING 0
+
+/// Uniforms used by the engine shaders. Locations are resolved once per program in initGL
+enum GLBI_Uniform {
+	GLBI_U_PROJECTION = 0,
+	GLBI_U_MODELVIEW,
+	GLBI_U_NORMAL,
+	GLBI_U_USE_TEXTURE,
+	GLBI_U_TEX0,
+	GLBI_U_C_SPEC,
+	GLBI_U_SHININESS,
+	GLBI_NB_UNIFORMS
+};
+
+/// Vertex attributes set as constant values by the engine
+enum GLBI_Attribute {
+	GLBI_A_COLOR = 0,
+	GLBI_A_NORMAL,
+	GLBI_NB_ATTRIBUTES
+};
+
+/// Location table of one shader program and last values sent to each of its uniforms
+struct GLBI_Program {
+	GLBI_Program():id(0) {
+		for(int i=0;i<GLBI_NB_UNIFORMS;i++) uniformLoc[i] = -1;
+		for(int i=0;i<GLBI_NB_ATTRIBUTES;i++) attribLoc[i] = -1;
+	}
+
+	/// Query (once) every uniform and attribute location of program \param id_program
+	void resolveLocations(unsigned int id_program);
+	/// Forget every cached value (next uploads will all be issued)
+	void invalidateValues();
+
+	unsigned int id;
+	int uniformLoc[GLBI_NB_UNIFORMS];
+	int attribLoc[GLBI_NB_ATTRIBUTES];
+	/// Last value sent to GL for each uniform (empty if never sent)
+	std::vector<float> uniformValue[GLBI_NB_UNIFORMS];
+};
+
+/// Per-frame data shared by the 3D programs through a std140 uniform block (GLBI_Frame in shaders)
+struct GLBI_Frame_Block {
+	float projectionMat[16];
+	float viewMatrix[16];
+	float attenuationFactor[4];
+	int numOfLight;
+	int padding[3];
+	float lightPos[GLBI_MAX_LIGHTS][4];
+	float lightIntensity[GLBI_MAX_LIGHTS][4];
+};
+
+/// Counters of uniform uploads, to check the efficiency of the dirty state tracking
+struct GLBI_Upload_Stats {
+	GLBI_Upload_Stats():issued(0),skipped(0) {}
+	/// Number of glUniform* calls really sent to GL
+	unsigned long issued;
+	/// Number of glUniform* calls avoided because the value was already in the program
+	unsigned long skipped;
+};
+
+/// Bounds tested by GLBI_Engine::isVisible since the last reset
+struct GLBI_Cull_Stats {
+	GLBI_Cull_Stats():visible(0),culled(0) {}
+	unsigned long visible;
+	unsigned long culled;
+};
+
+/**
+ * Configuration compiled into a variant of the 3D engine shaders : the sources are specialized with
+ * #define lines (GLBI_VARIANT, TEXTURED, SPECULAR, NUM_POINT_LIGHTS, NUM_DIR_LIGHTS), so that the
+ * texturing and specular tests and the light loop are resolved by the compiler, not per fragment.
+ */
+struct GLBI_Shader_Variant {
+	GLBI_Shader_Variant():textured(false),specular(false),nbPointLights(0),nbDirLights(0) {}
+
+	/// Unique number of the configuration
+	unsigned int key() const {return (textured ? 1 : 0) | (specular ? 2 : 0) | (nbPointLights<<2) | (nbDirLights<<10);}
+	/// Configuration of a key
+	static GLBI_Shader_Variant fromKey(unsigned int key) {
+		GLBI_Shader_Variant variant;
+		variant.textured = (key & 1) != 0;
+		variant.specular = (key & 2) != 0;
+		variant.nbPointLights = (key>>2) & 0xFF;
+		variant.nbDirLights = key>>10;
+		return variant;
+	}
+	/// #define lines to inject in the shader sources
+	std::string defines() const;
+
+	bool textured;
+	bool specular;
+	int nbPointLights;
+	int nbDirLights;
+};
+
 struct GLBI_Engine {
-	GLBI_Engine():mode2D(true),useTexture(0),currentShader(0),attFactors({1.0,0.0,1.0}),numberOfLight(1) {
+	GLBI_Engine():mode2D(true),useTexture(0),currentShader(0),shaderVariants(true),idFrameUBO(0),frameDataDirty(true),
+	              attFactors({1.0,0.0,1.0}),numberOfLight(1),nbPointLights(0),nbDirLights(1),shininess(0.0f),
+	              projectionFov(0.0f),projectionRatio(1.0f) {
+		memset(&frameData,0,sizeof(GLBI_Frame_Block));
+		viewFrustum.extract(Matrix4D());
+		currentVariant[0] = currentVariant[1] = 0;
 		lightPos.push_back({0.0,0.0,0.0,0.0});
 		lightIntensity.push_back({0.0,0.0,0.0});
 	}
 
 	~GLBI_Engine() {}
 
-	/// Set the OpenGL Engine
+	/// Set the OpenGL Engine. Exit the program if its shaders can not be built
 	void initGL();
+	/// #define lines injected in every engine program (constants shared with the engine, GLBI_MAX_LIGHTS)
+	static std::string shaderDefines();
 	/// Set 2D orthographic projection. Resulting virtual screen size is [xmin,ymin][xmax,ymax]
 	void set2DProjection(float xmin,float xmax,float ymin,float ymax);
 	/// Set 3D perspective projection with a \param fov and \param z_near / \param \z_far depth range
@@ -30,6 +142,11 @@ struct GLBI_Engine {
 	void setViewMatrix(const Matrix4D& mat);
 	/// Send current transformation to GL Engine. ids is the id of the shader to set.
 	void updateMvMatrix();
+	/// Load the world matrix of \param node as current transformation and send it to GL Engine.
+	/// The normal matrix cached in the node is used : no inversion for nodes that did not move.
+	void updateMvMatrix(GLBI_Transform_Node& node);
+	/// Upload per-frame data (projection, view, lights) if they changed. Called by updateMvMatrix.
+	void updateFrameData();
 	
 	/// In 3D configuration, activate or desactivate texturing.
 	void activateTexturing(bool use_texture);
@@ -51,20 +168,107 @@ struct GLBI_Engine {
 	void setShininess(float new_shininess);
 	/// Set specular coefficient (for future rendered object)
 	void setSpecularColor(const Vector3D& c_spec);
+	/// Use the variant of the current program matching texturing, shininess and lights (compiled on first use).
+	/// Called when one of them changes.
+	void selectVariant();
+	/** Watch \param directory and rebuild the engine programs when their sources change (see pollShaderReload).
+	  * Call after initGL. Without KHR_parallel_shader_compile, a reload blocks the frame in which the
+	  * program is finished (compilation and link on the render thread) : a warning is printed.
+	  */
+	bool enableShaderReload(const std::string& directory = "../assets/shaders");
+	/** Call once per frame when shader reload is enabled : start compiling the programs whose sources
+	  * changed, and replace the ones compiled since the previous frame. A replaced program gets the
+	  * uniform values of the previous one. Programs that fail to compile or link are kept (errors are printed).
+	  * Compilations are given at least one frame; with KHR_parallel_shader_compile, they are waited for
+	  * without blocking. Without it, the driver may still compile in the background during that frame,
+	  * but the frame finishing the program waits for whatever work is left. Return the number of programs replaced.
+	  */
+	unsigned int pollShaderReload();
+	/// Reset uniform upload counters (typically at the beginning of a frame)
+	void resetUploadStats() {uploadStats = GLBI_Upload_Stats();}
+	/** True if \param box (object space) drawn with the current modelview matrix may be visible with the
+	  * last projection set (see viewFrustum). Skip the draw otherwise. Counted in cullStats.
+	  */
+	bool isVisible(const BoundingBox& box);
+	/// Reset culling counters (typically at the beginning of a frame)
+	void resetCullStats() {cullStats = GLBI_Cull_Stats();}
+
+	/// Uniform upload helpers. Program idShader[ids] must be in use.
+	/// Values identical to the last ones sent to this program are not uploaded again.
+	bool sendUniformMatrix(int ids,GLBI_Uniform u,const float* mat);
+	bool sendUniformVec3(int ids,GLBI_Uniform u,const float* val,int count = 1);
+	bool sendUniformVec4(int ids,GLBI_Uniform u,const float* val,int count = 1);
+	bool sendUniformFloat(int ids,GLBI_Uniform u,float val);
+	bool sendUniformInt(int ids,GLBI_Uniform u,int val);
+	/// Return true (and count a skipped upload) if \param val is already stored for uniform u
+	bool isUniformUpToDate(int ids,GLBI_Uniform u,const float* val,size_t nb_val);
 
 	/// GL parameters
 	unsigned int idShader[3];
+	GLBI_Program program[3];
+	/// Engine programs are compiled together and their binaries cached on disk (set directory before initGL)
+	GLBI_Program_Cache programCache;
+	GLBI_Upload_Stats uploadStats;
 	MatrixStack mvMatrixStack;
 	Matrix4D viewMatrix;
 	bool mode2D;
 	int useTexture; // 0 do not use texture. Else number of texture to use (TODO, 1 for the moment)
 	int currentShader;
+	/// 3D programs are compiled in variants (see GLBI_Shader_Variant). Set to false before initGL
+	/// to use the generic programs, which test the material and the lights for each fragment.
+	bool shaderVariants;
+	/// Compiled variants of flat (0) and phong (1) shading, by key. The variant in use is swapped
+	/// into program[ids] with its uniform cache (the table entry of currentVariant is empty meanwhile).
+	std::map<unsigned int,GLBI_Program> variants[2];
+	unsigned int currentVariant[2];
+	/// Per-frame uniform buffer (3D mode only), uploaded once when dirty
+	unsigned int idFrameUBO;
+	bool frameDataDirty;
+	GLBI_Frame_Block frameData;
 
 	/// Light parameters
 	Vector3D attFactors;
 	std::vector<Vector4D> lightPos;
 	std::vector<Vector3D> lightIntensity;
 	int numberOfLight;
+	/// Lights in the per-frame block, point lights first
+	int nbPointLights;
+	int nbDirLights;
+	/// Material of the phong program, forwarded to the variant in use
+	float shininess;
+	Vector3D specularColor;
+	/// Last 3D projection (vertical field of view in degrees and w/h ratio), used by level of detail selection
+	float projectionFov;
+	float projectionRatio;
+	/// Last projection set (2D or 3D)
+	Matrix4D projectionMatrix;
+	/// Frustum of the last projection set (2D or 3D), in view space : bounds are tested after the modelview
+	/// transformation (equivalent to world space bounds against the planes of projection*view)
+	Frustum viewFrustum;
+	GLBI_Cull_Stats cullStats;
+	/// Shader sources watched for hot reload (see enableShaderReload)
+	GLBI_File_Watcher shaderWatcher;
+
+private:
+	/// Program of shading ids (variant key) being rebuilt after a source change
+	struct Shader_Reload {
+		int ids;
+		unsigned int key;
+		int request;
+		bool started;   ///< Requested during the current poll : not finished before the next one
+	};
+	std::vector<Shader_Reload> reloads;
+	/// Start the rebuild of every program of shading \param ids
+	void requestReload(int ids);
+	/// Replace \param target by program \param id_program, with the same uniform values. The old one is deleted
+	void replaceProgram(GLBI_Program& target,unsigned int id_program);
+
+	/// Build the variant of shading \param ids. Return the program (0 if it can not be built)
+	unsigned int buildVariant(int ids,const GLBI_Shader_Variant& variant);
+	/// Variant matching the current state for shading \param ids
+	GLBI_Shader_Variant variantFor(int ids) const;
+	/// Send the top of the modelview stack and its normal matrix to the program in use
+	void sendMvMatrix();
 };
 
 }
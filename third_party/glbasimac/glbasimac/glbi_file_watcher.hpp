@@ -0,0 +1,51 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+namespace glbasimac {
+
+/**
+ * Watch the files of a directory (not its sub-directories) for modifications, on a background thread :
+ * with inotify on Linux, by polling the modification times every pollInterval ms elsewhere.
+ * Files written in place and files replaced by a rename (as most editors save) are both reported.
+ * Typical use :
+ *   GLBI_File_Watcher watcher; watcher.start("../assets/shaders");
+ *   each frame : if (watcher.changedFiles(names)) ... reload names
+ */
+struct GLBI_File_Watcher {
+	GLBI_File_Watcher():pollInterval(250),running(false) {}
+	~GLBI_File_Watcher() {stop();}
+
+	/// Start watching \param dir. Return false if it can not be watched
+	bool start(const std::string& dir);
+	/// Stop the watching thread
+	void stop();
+	/// Move the names (without directory) of the files modified since the last call to \param files.
+	/// Never blocks. Return false if none
+	bool changedFiles(std::vector<std::string>& files);
+
+	std::string directory;
+	/// Time between two scans of the directory when inotify is not available (ms)
+	unsigned int pollInterval;
+
+private:
+	GLBI_File_Watcher(const GLBI_File_Watcher&);
+	GLBI_File_Watcher& operator=(const GLBI_File_Watcher&);
+
+	void watchNotifications(int fd);
+	void watchTimes();
+	/// Record a modified file (once until it is taken by changedFiles)
+	void push(const std::string& name);
+
+	std::thread worker;
+	std::atomic<bool> running;
+	std::mutex mutex;
+	std::vector<std::string> changed;
+};
+
+}
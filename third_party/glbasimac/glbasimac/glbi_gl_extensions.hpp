@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+namespace glbasimac {
+
+/**
+ * Access to GL entry points and extensions above the GL 4.0 core profile loaded by glad.
+ * Functions are looked up in the current context, whether it was created by GLFW or by EGL
+ * (headless). Every query needs a current context.
+ */
+
+/// Address of the GL function \param name (nullptr if the driver does not have it)
+void* glbiGetProcAddress(const char* name);
+/// True if the current context exposes extension \param name (like "GL_ARB_texture_storage")
+bool glbiHasExtension(const char* name);
+/// True if the current context version is at least major.minor
+bool glbiHasVersion(int major,int minor);
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include "glbasimac/glbi_render_target.hpp"
+#include "glbasimac/glbi_image_io.hpp"
+
+struct GLFWwindow;
+
+namespace glbasimac {
+
+/// Context creation API used for headless rendering
+enum GLBI_Context_API {
+	GLBI_CONTEXT_AUTO = 0, ///< EGL surfaceless if available, else GLFW
+	GLBI_CONTEXT_EGL,      ///< EGL surfaceless (Mesa llvmpipe or GPU drivers) : no window, no display server
+	GLBI_CONTEXT_GLFW,     ///< Invisible GLFW window with the native API of the platform (GLX, WGL, NSGL)
+	GLBI_CONTEXT_OSMESA    ///< Invisible GLFW window with an OSMesa context (software rendering in main memory)
+};
+
+/**
+ * GL 4.1 core context without visible window. The EGL path is only compiled when cmake finds EGL
+ * (GLBI_HAS_EGL). GLFW windows need a display server, unless GLFW is built with its OSMesa backend
+ * (GLBASIMAC_HEADLESS cmake option).
+ */
+struct GLBI_Headless_Context {
+	GLBI_Headless_Context():window(nullptr),eglDisplay(nullptr),eglContext(nullptr) {}
+	~GLBI_Headless_Context() {destroy();}
+
+	/// Create the context, make it current and load glad. Return false on failure
+	bool create(int w,int h,GLBI_Context_API api = GLBI_CONTEXT_AUTO);
+	/// Destroy the context
+	void destroy();
+	/// Name of the API really used
+	const char* apiName() const;
+
+	GLFWwindow* window;
+	void* eglDisplay;
+	void* eglContext;
+
+private:
+	bool createEGL();
+	bool createGLFW(int w,int h,GLBI_Context_API api);
+};
+
+/**
+ * Headless rendering : frames are drawn in an offscreen render target, read back asynchronously
+ * and written to image files by background threads.
+ * Typical use :
+ *   GLBI_Headless headless; headless.init(640,480); engine.initGL();
+ *   for each frame : headless.beginFrame(); draw...; headless.endFrame("frame_0001.png");
+ *   headless.finish();
+ * The GPU is never waited for in endFrame, except when every readback buffer is in use.
+ */
+struct GLBI_Headless {
+	GLBI_Headless(unsigned int nb_writers = 1):nbFrames(0),format(GLBI_IMAGE_PNG),writer(nb_writers) {}
+	~GLBI_Headless() {release();}
+
+	/** Create the context (unless \param create_context is false and a context is already current),
+	  * the render target and \param readback_depth pixel buffers.
+	  */
+	bool init(int w,int h,GLBI_Context_API api = GLBI_CONTEXT_AUTO,unsigned int readback_depth = GLBI_READBACK_DEFAULT_DEPTH,
+	          bool create_context = true);
+	/// Bind the render target (to call before drawing a frame)
+	void beginFrame();
+	/// Queue the readback of the frame. It will be written in \param filename (nothing written if empty)
+	void endFrame(const std::string& filename = std::string());
+	/// Read every pending frame and wait until all files are written
+	void finish();
+	/// Release GL objects and destroy the context created by init
+	void release();
+
+	GLBI_Headless_Context context;
+	GLBI_Render_Target target;
+	GLBI_Async_Readback readback;
+	/// Number of frames ended
+	long nbFrames;
+	/// Format of the written files
+	GLBI_Image_Format format;
+	GLBI_Image_Writer writer;
+
+private:
+	/// Hand the oldest pending frame to the writer. Return false if it is not ready and \param wait is false
+	bool collect(bool wait);
+
+	std::deque<std::string> filenames;
+	std::vector<unsigned char> pixels;
+};
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace glbasimac {
+
+/// Image file formats written by glbasimac
+enum GLBI_Image_Format {
+	GLBI_IMAGE_PNG = 0,
+	GLBI_IMAGE_PPM
+};
+
+/** Write a w x h image of \param channels bytes per pixel (3 or 4) in \param filename.
+  * If \param bottom_up is true, the first row of \param pixels is the bottom one (GL readback)
+  * and the image is flipped while written. PPM files are binary (P6) and drop the alpha channel.
+  * Return false (with a message on std::cerr) if the file can not be written.
+  */
+bool glbiWriteImage(const std::string& filename,GLBI_Image_Format format,int w,int h,int channels,
+                    const unsigned char* pixels,bool bottom_up = true);
+
+/** Decode a PNG, JPG, TGA, BMP or PPM/PGM file in \param pixels (\param channels bytes per pixel, 1 to 4).
+  * If \param bottom_up is true, the first row of \param pixels is the bottom one (GL upload) : the image
+  * is flipped while decoded. Thread-safe.
+  * Return false (with a message on std::cerr) if the file can not be read.
+  */
+bool glbiReadImage(const std::string& filename,int& w,int& h,int& channels,std::vector<unsigned char>& pixels,
+                   bool bottom_up = true);
+
+/**
+ * Background image writer : encoding and writing files is done by worker threads, so that
+ * the rendering thread only hands over the pixels of each frame.
+ */
+struct GLBI_Image_Writer {
+	GLBI_Image_Writer(unsigned int nb_threads = 1);
+	/// Write every queued image then stop the workers
+	~GLBI_Image_Writer();
+
+	/// Queue an image (\param pixels is moved : no copy). Same parameters as glbiWriteImage
+	void push(const std::string& filename,GLBI_Image_Format format,int w,int h,int channels,
+	          std::vector<unsigned char>& pixels,bool bottom_up = true);
+	/// Wait until every queued image is written
+	void flush();
+	/// Number of images not written yet
+	size_t pending();
+
+	/// Number of images written and of failures
+	unsigned long nbWritten;
+	unsigned long nbFailed;
+
+private:
+	GLBI_Image_Writer(const GLBI_Image_Writer&);
+	GLBI_Image_Writer& operator=(const GLBI_Image_Writer&);
+
+	struct Job {
+		std::string filename;
+		GLBI_Image_Format format;
+		int w,h,channels;
+		bool bottomUp;
+		std::vector<unsigned char> pixels;
+	};
+	void work();
+
+	std::vector<std::thread> workers;
+	std::deque<Job> jobs;
+	/// Jobs queued or being written
+	size_t nbBusy;
+	bool stopping;
+	std::mutex mutex;
+	std::condition_variable jobAdded;
+	std::condition_variable jobDone;
+};
+
+}
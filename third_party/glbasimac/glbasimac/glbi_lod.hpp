@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include "glbasimac/glbi_engine.hpp"
+#include "tools/indexed_mesh.hpp"
+#include "tools/matrix4d.hpp"
+
+using namespace STP3D;
+
+namespace glbasimac {
+
+/// One level of a GLBI_LOD_Mesh
+struct GLBI_LOD_Level {
+	IndexedMesh* mesh;
+	/// Maximal distance between this level and the full detail surface (object space)
+	float error;
+};
+
+struct GLBI_LOD_Mesh;
+
+/**
+ * Choice of the level of detail of each draw from its projected size : the geometric error of a level,
+ * seen at the distance of the object with the current projection of the engine (see set3DProjection),
+ * must stay under pixelError pixels. The coarsest level satisfying it is drawn.
+ */
+struct GLBI_LOD_Selector {
+	GLBI_LOD_Selector(float pixel_error = 1.0f):pixelError(pixel_error),pixelsPerUnit(0.0f),nbTriangles(0) {}
+
+	/** Read the projection of \param engine and the viewport height (GL_VIEWPORT if \param viewport_height is 0).
+	  * Call once per frame, after set3DProjection, and before selecting levels. Reset nbTriangles.
+	  */
+	void update(const GLBI_Engine& engine,int viewport_height = 0);
+	/// Level of \param lod to draw with the modelview matrix \param modelview (view and model transformations)
+	unsigned int select(const GLBI_LOD_Mesh& lod,const Matrix4D& modelview) const;
+	/// Size in pixels of the error of a level of \param lod drawn with \param modelview
+	float projectedError(const GLBI_LOD_Mesh& lod,unsigned int level,const Matrix4D& modelview) const;
+
+	/// Allowed error on screen, in pixels
+	float pixelError;
+	/// Pixels covered by one unit at distance 1 of the camera
+	float pixelsPerUnit;
+	/// Triangles drawn through GLBI_LOD_Mesh::draw since update
+	unsigned long nbTriangles;
+};
+
+/**
+ * Chain of levels of detail of a mesh, from the full detail (level 0) to the coarsest one.
+ * Basic shapes are built again with fewer divisions; any other indexed mesh is simplified
+ * (see tools/mesh_simplifier.hpp). Levels are owned by the chain.
+ */
+struct GLBI_LOD_Mesh {
+	GLBI_LOD_Mesh():radius(0.0f) {}
+	~GLBI_LOD_Mesh() {release();}
+
+	/// Chain of basicSphere from \param nb_div divisions, halved at each level (at least 4)
+	bool buildSphere(float sphere_radius,unsigned int nb_div = 64,unsigned int nb_levels = 5);
+	/// Chain of basicCylinder from \param div_round divisions, halved at each level (at least 4)
+	bool buildCylinder(float h,float cyl_radius,unsigned int div_round = 64,unsigned int div_height = 1,unsigned int nb_levels = 5);
+	/** Chain simplified from \param mesh (kept as level 0, owned by the chain) : each level has \param ratio
+	  * times the triangles of the previous one. The chain stops earlier when a mesh can not be simplified further.
+	  * CPU buffers of the mesh are needed.
+	  */
+	bool buildFromMesh(IndexedMesh* mesh,unsigned int nb_levels = 5,float ratio = 0.5f);
+	/// Add \param mesh (owned by the chain) as next level. Levels must be added from the most detailed.
+	void addLevel(IndexedMesh* mesh,float error);
+	/// Create the VAO of every level
+	bool createVAOs();
+	/// Delete every level
+	void release();
+
+	/// Draw the level chosen by \param selector for the current modelview of \param engine. Return the level
+	unsigned int draw(GLBI_LOD_Selector& selector,const GLBI_Engine& engine);
+	unsigned int nbLevels() const {return (unsigned int)levels.size();}
+
+	std::vector<GLBI_LOD_Level> levels;
+	/// Bounding sphere (object space) of level 0
+	Vector3D center;
+	float radius;
+
+private:
+	GLBI_LOD_Mesh(const GLBI_LOD_Mesh&);
+	GLBI_LOD_Mesh& operator=(const GLBI_LOD_Mesh&);
+};
+
+}
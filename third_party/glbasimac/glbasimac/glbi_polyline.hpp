@@ -0,0 +1,147 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "glbasimac/glbi_engine.hpp"
+#include "glbasimac/glbi_set_of_points.hpp"
+
+using namespace STP3D;
+
+namespace glbasimac {
+
+/// Points reserved on GPU by the first upload of a GLBI_Polyline
+#define GLBI_POLYLINE_INITIAL_CAPACITY 1024
+/// Visible points per pixel column above which a GLBI_Polyline is decimated
+#define GLBI_POLYLINE_DECIMATION_RATIO 8
+
+/// Point of a GLBI_Polyline (layout of its GL buffers)
+struct GLBI_Polyline_Point {
+	float x,y;
+	unsigned char rgba[4];
+};
+
+enum GLBI_Line_Join {GLBI_JOIN_MITER = 0,GLBI_JOIN_ROUND};
+enum GLBI_Line_Cap {GLBI_CAP_BUTT = 0,GLBI_CAP_SQUARE,GLBI_CAP_ROUND};
+
+/// Work done by the last draw of a GLBI_Polyline
+struct GLBI_Polyline_Stats {
+	GLBI_Polyline_Stats():visiblePoints(0),drawnSegments(0),uploadedBytes(0),decimated(false) {}
+	/// Points between the left and right borders of the view (all points if not culled)
+	unsigned long visiblePoints;
+	unsigned long drawnSegments;
+	/// Bytes sent to the GPU (new points, decimated points)
+	unsigned long uploadedBytes;
+	bool decimated;
+};
+
+/**
+ * Thick antialiased line strip (core profile replacement of glLineWidth on a GL_LINE_STRIP, see
+ * GLBI_Set_Of_Points). Points are stored once in a streaming buffer : adding points only uploads them.
+ * Segments are instances of a 4 vertices strip : the vertex shader reads the segment and its two
+ * neighbours from the same buffer and expands it to width pixels on screen (miter or round joins,
+ * butt, square or round caps); the fragment shader computes the distance to the segment for a one
+ * pixel wide antialiasing (blending is enabled during the draw).
+ * Points are transformed by the last projection of the engine and the top of its modelview stack.
+ * When the x coordinates are increasing (plots, time series) and the transformation is axis aligned,
+ * only the visible points are drawn, and above GLBI_POLYLINE_DECIMATION_RATIO points per pixel column
+ * the strip is replaced by the first, lowest, highest and last points of each column (at most 6 points
+ * per column, the extrema on both borders when it is dense) : a few thousand segments whatever the
+ * number of points. Columns are updated from the new points only while the view does not change.
+ * Typical use (a GL context must be current) :
+ *   GLBI_Polyline curve(engine); curve.width = 2.0f; curve.join = GLBI_JOIN_ROUND;
+ *   each frame : curve.addPoint(t,value); curve.draw();
+ */
+struct GLBI_Polyline {
+	GLBI_Polyline(GLBI_Engine& eng):width(1.0f),join(GLBI_JOIN_MITER),cap(GLBI_CAP_BUTT),miterLimit(4.0f),
+	                                decimation(true),engine(eng),idProgram(0),idVAO(0),idVBO(0),capacity(0),
+	                                nbUploaded(0),increasingX(true),idDecimatedVAO(0),idDecimatedVBO(0),
+	                                decimatedCapacity(0),columnsValid(false),columnsFirst(0),columnsEnd(0) {
+		color[0] = color[1] = color[2] = color[3] = 255;
+		for(int i=0;i<GLBI_POLYLINE_NB_UNIFORMS;i++) uniformLoc[i] = -1;
+		for(int i=0;i<3;i++) columnsView[i] = 0.0f;
+	}
+	~GLBI_Polyline() {release();}
+
+	/// Delete the GL buffers and program (a GL context must be current)
+	void release();
+
+	/// Color of the next points (components in [0,1])
+	void setColor(float r,float g,float b);
+	void addPoint(float x,float y);
+	/// Add \param nb_new points : 2 coordinates and, if \param new_color is not null, 3 color components per point
+	void addPoints(unsigned int nb_new,const float* new_coord,const float* new_color = nullptr);
+	/// Replace the points by the ones of \param set (x and y of each point)
+	void initFromSet(const GLBI_Set_Of_Points& set);
+	/// Remove every point
+	void clear();
+	unsigned int nbPoints() const {return (unsigned int)points.size();}
+
+	/// Upload the new points and draw the strip. The engine program and the blending state are restored afterwards
+	void draw();
+
+	/// Width in pixels
+	float width;
+	GLBI_Line_Join join;
+	GLBI_Line_Cap cap;
+	/// Miter joins longer than miterLimit half widths are drawn round
+	float miterLimit;
+	/// Draw the min/max of each pixel column when there are too many visible points
+	bool decimation;
+	GLBI_Engine& engine;
+	/// Statistics of the last draw
+	GLBI_Polyline_Stats stats;
+
+private:
+	GLBI_Polyline(const GLBI_Polyline&);
+	GLBI_Polyline& operator=(const GLBI_Polyline&);
+
+	enum {GLBI_POLYLINE_U_PROJECTION = 0,GLBI_POLYLINE_U_MODELVIEW,GLBI_POLYLINE_U_VIEWPORT,GLBI_POLYLINE_U_WIDTH,
+	      GLBI_POLYLINE_U_JOIN,GLBI_POLYLINE_U_CAP,GLBI_POLYLINE_U_MITER_LIMIT,GLBI_POLYLINE_U_CAP_ENDS,
+	      GLBI_POLYLINE_U_LAST_SEGMENT,GLBI_POLYLINE_NB_UNIFORMS};
+
+	/// Build the program and the buffers
+	bool createResources();
+	/// Send the points added since the last draw (and the padding point after the last one)
+	void uploadNewPoints();
+	/// Extrema of each of \param nb_columns columns between x0 and x1, then upload of the decimated strip.
+	/// If the view did not change, only the new points are added and only the columns they changed are sent
+	void decimate(unsigned int first,unsigned int end,float x0,float x1,unsigned int nb_columns);
+	/// Add the points in [first,end) to the columns. Return the first column changed
+	unsigned int addToColumns(unsigned int first,unsigned int end);
+	/// Write the decimated strip again from column \param from_column
+	void emitColumns(unsigned int from_column);
+	/// Draw the segments between \param nb_points points of a buffer, from point \param first.
+	/// \param cap_ends : bit 0 if the first point starts the line, bit 1 if the last one ends it
+	void drawSegments(unsigned int id_vao,unsigned int id_vbo,unsigned int first,unsigned int nb_points,int cap_ends);
+
+	unsigned char color[4];
+	/// Points added. The GL buffer has a copy of the first one before them and of the last one after
+	/// them : segment i reads the points i-1 to i+2 at slots i to i+3
+	std::vector<GLBI_Polyline_Point> points;
+	unsigned int idProgram;
+	int uniformLoc[GLBI_POLYLINE_NB_UNIFORMS];
+	unsigned int idVAO;
+	unsigned int idVBO;
+	/// Points allocated in the GL buffer, points already sent
+	size_t capacity;
+	size_t nbUploaded;
+	bool increasingX;
+
+	/// Decimation
+	unsigned int idDecimatedVAO;
+	unsigned int idDecimatedVBO;
+	size_t decimatedCapacity;
+	/// Indices of the first, lowest, highest and last points of each column (-1 if empty)
+	std::vector<int> columns;
+	/// Columns computed for the points in [columnsFirst,columnsEnd) of the view x0, x1 and width in pixels
+	bool columnsValid;
+	unsigned int columnsFirst;
+	unsigned int columnsEnd;
+	float columnsView[3];
+	/// Decimated strip, between two padding points (layout of its GL buffer)
+	std::vector<GLBI_Polyline_Point> decimated;
+	/// Index in decimated of the first point of each column
+	std::vector<unsigned int> columnOffsets;
+};
+
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "tools/gl_tools.hpp"
+
+namespace glbasimac {
+
+/// Frames in flight of the GPU queries : the results of a frame are read GLBI_PROFILER_LATENCY frames later
+#define GLBI_PROFILER_LATENCY 3
+
+/// Time spent in one zone of a frame. Times are in ms, starts are relative to the beginning of the frame
+struct GLBI_Profile_Zone {
+	const char* name;
+	/// Nesting level (0 for the zones opened directly in the frame)
+	int depth;
+	double cpuStart;
+	double cpuTime;
+	/// GPU times (-1 without timer queries)
+	double gpuStart;
+	double gpuTime;
+	/// Timestamp queries of the start and of the end of the zone in its ring slot
+	unsigned int queries[2];
+};
+
+/// Times (ms) and counters of one frame
+struct GLBI_Profile_Frame {
+	GLBI_Profile_Frame():index(0),cpuStart(0.0),cpuTime(0.0),gpuStart(-1.0),gpuTime(-1.0) {}
+
+	unsigned long index;
+	/// Start since the profiler was initialized (CPU clock, and GPU clock brought back to the CPU one)
+	double cpuStart;
+	double cpuTime;
+	/// GPU times (-1 without timer queries)
+	double gpuStart;
+	double gpuTime;
+	STP3D::GLCounters counters;
+	std::vector<GLBI_Profile_Zone> zones;
+};
+
+/**
+ * Frame profiler : CPU time of the frame and of nested zones (steady clock), GPU time of the same
+ * (GL_TIMESTAMP queries at each start and end : unlike GL_TIME_ELAPSED queries, they nest), and the
+ * GL work counted by the meshes and the engine (STP3D::GLCounters : draw calls, triangles, uniform
+ * uploads, bytes uploaded, binds).
+ * Queries are kept in a ring of GLBI_PROFILER_LATENCY frames : a frame is read when its slot comes back,
+ * when the GPU is done with it, so reading never stalls the pipeline (stalls are counted in nbStalls).
+ * Typical use (a GL context must be current) :
+ *   GLBI_Profiler profiler; profiler.init();
+ *   each frame : profiler.beginFrame(); { GLBI_PROFILE_ZONE(profiler,"scene"); ... } profiler.endFrame();
+ *   profiler.report() or lastFrame, startTrace() and writeTrace("frames.json") for chrome://tracing or Perfetto
+ * The engine opens its own zones (draw list, texture uploads, shader reload) in the initialized profiler.
+ */
+struct GLBI_Profiler {
+	GLBI_Profiler();
+	~GLBI_Profiler() {release();}
+
+	/// Create the query rings. Return false (and measure CPU times only) without timer queries
+	bool init();
+	/// Delete the queries (a GL context must be current)
+	void release();
+
+	/// Start a frame : reset the GL counters and read the frame issued GLBI_PROFILER_LATENCY frames ago
+	void beginFrame();
+	void endFrame();
+	/// Open a zone nested in the open ones. \param name must stay valid (string literal). Ignored out of frames
+	void beginZone(const char* name);
+	void endZone();
+
+	/// Keep in trace every frame begun from now on. The averages restart from these frames
+	void startTrace();
+	void stopTrace() {tracing = false;}
+	/// Write trace as Chrome trace events (JSON) : zones on a CPU and a GPU track, counters per frame
+	bool writeTrace(const std::string& filename) const;
+	/// Table of the zones of the last frame read (times averaged over the last frames) and its counters
+	std::string report() const;
+	/// One line summary of the last frame read (fit for a window title)
+	std::string summary() const;
+
+	/// Profiler in which the engine opens its zones (the last one initialized)
+	static GLBI_Profiler* active;
+
+	/// Timer queries available
+	bool gpuTimers;
+	/// Last frame read
+	GLBI_Profile_Frame lastFrame;
+	unsigned long nbFrames;
+	/// Frames whose queries were not available when their slot came back (read blocking)
+	unsigned long nbStalls;
+	bool tracing;
+	std::vector<GLBI_Profile_Frame> trace;
+
+private:
+	GLBI_Profiler(const GLBI_Profiler&);
+	GLBI_Profiler& operator=(const GLBI_Profiler&);
+
+	/// Queries and zones of one frame in flight
+	struct Slot {
+		Slot():nbQueries(0),pending(false) {}
+		GLBI_Profile_Frame frame;
+		/// Timestamp queries (the first and the last ones for the frame)
+		std::vector<unsigned int> queries;
+		unsigned int nbQueries;
+		bool pending;
+	};
+	/// Read the results of \param slot if it holds a frame
+	void collect(Slot& slot);
+	/// Issue a timestamp query in the current slot, return its index
+	unsigned int timestamp();
+	/// ms since init (CPU clock)
+	double now() const;
+	/// Bring the GPU clock to the CPU one (gpuOffset)
+	void syncClocks();
+
+	Slot slots[GLBI_PROFILER_LATENCY];
+	unsigned int current;
+	bool inFrame;
+	/// Zones open in the current frame (indices in its zone list)
+	std::vector<size_t> openZones;
+	std::chrono::steady_clock::time_point origin;
+	/// CPU time (ms) minus GPU time (ns converted to ms) at the same instant
+	double gpuOffset;
+	/// Averaged CPU and GPU times by zone name
+	std::map<std::string,std::pair<double,double> > averages;
+	/// Frames begun before this one (before init or startTrace) are dropped when read
+	unsigned long firstFrame;
+};
+
+/// Zone closed at the end of the scope
+struct GLBI_Profile_Scope {
+	GLBI_Profile_Scope(GLBI_Profiler* p,const char* name):profiler(p) {if (profiler) profiler->beginZone(name);}
+	~GLBI_Profile_Scope() {if (profiler) profiler->endZone();}
+
+	GLBI_Profiler* profiler;
+};
+
+#define GLBI_PROFILE_CONCAT_(a,b) a##b
+#define GLBI_PROFILE_CONCAT(a,b) GLBI_PROFILE_CONCAT_(a,b)
+#ifndef GLBI_NO_PROFILER
+/// Profile the rest of the scope as zone \a name of \a profiler
+#define GLBI_PROFILE_ZONE(profiler,name) glbasimac::GLBI_Profile_Scope GLBI_PROFILE_CONCAT(glbiProfileZone,__LINE__)(&(profiler),name)
+/// Profile the rest of the scope in the active profiler (if any) : engine stages
+#define GLBI_PROFILE_STAGE(name) glbasimac::GLBI_Profile_Scope GLBI_PROFILE_CONCAT(glbiProfileStage,__LINE__)(glbasimac::GLBI_Profiler::active,name)
+#else
+#define GLBI_PROFILE_ZONE(profiler,name)
+#define GLBI_PROFILE_STAGE(name)
+#endif
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "tools/shaders.hpp"
+
+using namespace STP3D;
+
+namespace glbasimac {
+
+/**
+ * Shader programs built from GLSL files, with a disk cache of linked program binaries
+ * (glGetProgramBinary / glProgramBinary, GL 4.1 or ARB_get_program_binary).
+ * Cache entries are keyed by a hash of the sources and of the driver (vendor, renderer, version) :
+ * a warm start loads every program without compiling, and a driver update invalidates the cache.
+ *
+ * Programs are built in two steps so that several of them compile at once : request starts the
+ * compilation without waiting for its result, finish waits and returns the program. With
+ * KHR_parallel_shader_compile, the driver compiles on its own threads and isReady can be polled;
+ * otherwise drivers still overlap work as long as no status is queried before finish.
+ *
+ * Variants of one program are requested with \param defines : lines (typically "#define NAME value")
+ * inserted after the #version line of every source. They are part of the cache key.
+ */
+struct GLBI_Program_Cache {
+	/// Binaries are stored in \param directory (created if needed). An empty name disables the disk cache
+	GLBI_Program_Cache(const std::string& cache_directory = "shader_cache");
+
+	/// Start building a program from shader files. Return its request id (-1 if a file can not be read)
+	int request(const std::vector<std::string>& files,const std::vector<ShaderType>& types,const std::string& defines = "");
+	int request(const std::string& vertex_file,const std::string& fragment_file,const std::string& defines = "");
+	/// True if finish will not block (unknown without KHR_parallel_shader_compile : always true)
+	bool isReady(int id);
+	/** Wait for the program of request \param id and return it (0 if compilation or link failed).
+	  * Every request must be finished, once : the request is then forgotten (its id is not reused).
+	  * Programs of pending requests are not deleted.
+	  */
+	unsigned int finish(int id);
+	/// True if the driver compiles on its own threads (KHR_parallel_shader_compile), known after the first request
+	bool compilesInBackground() const {return parallelCompile;}
+
+	/// Disk cache directory (empty : no disk cache)
+	std::string directory;
+	/// Programs loaded from the cache, compiled from sources, and compilation failures
+	unsigned long nbHits;
+	unsigned long nbCompiled;
+	unsigned long nbFailures;
+
+private:
+	GLBI_Program_Cache(const GLBI_Program_Cache&);
+	GLBI_Program_Cache& operator=(const GLBI_Program_Cache&);
+
+	struct Request {
+		unsigned int program;
+		std::vector<unsigned int> shaders;
+		std::vector<std::string> files;
+		std::string key;
+		bool fromCache;
+	};
+	/// Query the driver features (once)
+	void init();
+	bool loadBinary(Request& r);
+	void saveBinary(const Request& r);
+
+	/// Pending requests by id
+	std::map<int,Request> requests;
+	int nextRequest;
+	bool initialized;
+	bool binarySupported;
+	bool parallelCompile;
+	std::string driver;
+};
+
+}
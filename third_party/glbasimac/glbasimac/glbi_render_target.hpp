@@ -0,0 +1,89 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "tools/gl_tools.hpp"
+
+using namespace STP3D;
+
+namespace glbasimac {
+
+/// Number of pixel buffers used by default by GLBI_Async_Readback
+#define GLBI_READBACK_DEFAULT_DEPTH 3
+
+/**
+ * Offscreen render target : a framebuffer object with a RGBA8 color buffer and a 24 bits depth
+ * buffer. Once bound, every draw goes to the target instead of the window (or the absence of window).
+ */
+struct GLBI_Render_Target {
+	GLBI_Render_Target():id_fbo(0),width(0),height(0) {
+		id_rbo[0] = id_rbo[1] = 0;
+	}
+	~GLBI_Render_Target() {release();}
+
+	/// Create (or resize) the target. Return false if the framebuffer is not complete
+	bool create(int w,int h);
+	/// Draw in the target from now on, with a viewport covering it
+	void bind();
+	/// Draw again in the default framebuffer
+	void unbind();
+	/// Delete the GL objects
+	void release();
+
+	unsigned int id_fbo;
+	/// Render buffers of color (0) and depth (1)
+	unsigned int id_rbo[2];
+	int width;
+	int height;
+};
+
+/**
+ * Asynchronous readback of the current read framebuffer through a ring of pixel buffer objects.
+ * request() only queues the copy on the GPU (glReadPixels in a PBO followed by a fence) and returns
+ * at once ; the pixels of a frame are mapped by retrieve() a few frames later, when its fence is
+ * signaled, so the CPU never waits for the end of the frame being rendered.
+ * Pixels are RGBA, rows from bottom to top (GL convention).
+ */
+struct GLBI_Async_Readback {
+	GLBI_Async_Readback():width(0),height(0),nbStalls(0),first(0),nbPending(0) {}
+	~GLBI_Async_Readback() {release();}
+
+	/// Allocate \param depth pixel buffers of w x h RGBA pixels
+	bool init(int w,int h,unsigned int depth = GLBI_READBACK_DEFAULT_DEPTH);
+	/// Delete the GL objects (pending frames are lost)
+	void release();
+
+	/** Queue the copy of the current read framebuffer, tagged with \param frame_id.
+	  * If every buffer is in use, the oldest frame must be retrieved first : return false.
+	  */
+	bool request(long frame_id);
+	/** Get the oldest pending frame in \param pixels (4*width*height bytes).
+	  * If \param wait is false and the GPU did not finish the copy yet, return false.
+	  * With \param wait true, block until the copy is done (counted in nbStalls).
+	  * When the frame can not be read, it is removed from the pending frames and false is returned
+	  * (pending() decreases, unlike when the frame is not ready).
+	  */
+	bool retrieve(std::vector<unsigned char>& pixels,long& frame_id,bool wait = false);
+	/// True if every buffer holds a frame not yet retrieved
+	bool full() const {return nbPending == slots.size();}
+	unsigned int pending() const {return nbPending;}
+
+	int width;
+	int height;
+	/// Number of retrieve() that had to wait for the GPU
+	unsigned long nbStalls;
+
+private:
+	struct Slot {
+		Slot():id_pbo(0),fence(0),frame_id(-1) {}
+		unsigned int id_pbo;
+		GLsync fence;
+		long frame_id;
+	};
+	std::vector<Slot> slots;
+	/// Index of the oldest pending slot
+	unsigned int first;
+	unsigned int nbPending;
+};
+
+}
@@ -3,12 +3,15 @@
 #include <iostream>
 #include <cassert>
 #include "tools/mesh.hpp"
+#include "tools/batch_transform.hpp"
 
 using namespace STP3D;
 
 namespace glbasimac {
 
 #define MAX_NB_POINTS_SET_OF_POINTS 100
+/// Number of points reserved on GPU when the set is created point by point
+#define INITIAL_CAPACITY_SET_OF_POINTS 1024
 
 struct GLBI_Set_Of_Points {
 	// Constructor. Initially we render points
@@ -26,10 +29,18 @@ struct GLBI_Set_Of_Points {
 	void initSet(const std::vector<float> in_coord,float c_r,float c_v,float c_b);
 	void initSet(const std::vector<float> in_coord,const std::vector<float> in_color);
 
-	// Allow to add a point. Not an efficient way for rendering...
+	// Allow to add a point. Only the new point is sent to the GPU (streaming buffer
+	// growing geometrically), so adding n points costs O(n) overall.
 	void addAPoint(float* new_coord,float* new_color);
-
-	// Allow to switch between points (GL_POINTS) and a line (GL_LINE_STRIP)
+	// Add nb_new points at once (dimension coordinates and 3 color components per point)
+	void addPoints(unsigned int nb_new,const float* new_coord,const float* new_color);
+	// Same as addPoints but the points are first transformed by transfo (2D points are taken in the
+	// plane z = 0 and keep the x and y of the result).
+	// The transform is done in one batch (see tools/batch_transform.hpp) directly in coord_pts.
+	void addPoints(unsigned int nb_new,const float* new_coord,const float* new_color,const Matrix4D& transfo);
+
+	// Allow to switch between points (GL_POINTS) and a line (GL_LINE_STRIP).
+	// Thick or antialiased lines : see GLBI_Polyline (glbi_polyline.hpp)
 	void changeNature(unsigned int new_gl_type);
 
 	void drawSet();
@@ -40,6 +51,10 @@ struct GLBI_Set_Of_Points {
 	unsigned int dimension;
 	std::vector<float> coord_pts;
 	std::vector<float> color_pts;
+
+private:
+	// Send to the GPU the last nb_new points of coord_pts and color_pts
+	void uploadNewPoints(unsigned int nb_new);
 };
 
 }
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <vector>
+#include "tools/indexed_mesh.hpp"
+
+using namespace STP3D;
+
+namespace glbasimac {
+
+/// Polygons without hole up to this number of points are triangulated by ear clipping (O(n²)), larger ones by the sweep
+#define GLBI_EAR_CLIPPING_MAX_POINTS 64
+
+/// Work done by a GLBI_Tessellator
+struct GLBI_Tessellation_Stats {
+	GLBI_Tessellation_Stats():cacheHits(0),earClippings(0),sweeps(0),failures(0) {}
+	/// Polygons found in the cache
+	unsigned long cacheHits;
+	unsigned long earClippings;
+	unsigned long sweeps;
+	/// Polygons that could not be triangulated (self intersecting rings)
+	unsigned long failures;
+};
+
+/**
+ * Triangulation of 2D polygons, concave or with holes, given as rings of (x,y) pairs in any orientation
+ * (the outline first, then the holes, which must be inside it and must not cross). Indices of the triangles
+ * refer to the points of the rings in this order; triangles are counterclockwise.
+ * Small polygons are clipped ear by ear. Larger ones, and every polygon with holes, are split in
+ * y-monotone pieces by a sweep line (edges ordered in a balanced tree, diagonals from split and merge
+ * vertices), then each piece is triangulated in linear time : O(n log n) overall.
+ * Meshes are cached by a hash of the points : the same polygon is triangulated only once.
+ */
+struct GLBI_Tessellator {
+	GLBI_Tessellator():earClippingMaxPoints(GLBI_EAR_CLIPPING_MAX_POINTS),createVAOs(true) {}
+	~GLBI_Tessellator() {clearCache();}
+
+	/// Triangles of the polygon (3 indices each). Return false (with the triangles found) if it can not be triangulated
+	static bool triangulate(const std::vector<float>& outline,const std::vector<std::vector<float> >& holes,
+	                        std::vector<unsigned int>& triangles,unsigned int ear_clipping_max_points = GLBI_EAR_CLIPPING_MAX_POINTS);
+	/// Ear clipping of a simple polygon (O(n²))
+	static bool earClipping(const std::vector<float>& outline,std::vector<unsigned int>& triangles);
+	/// Monotone decomposition by a sweep line, then triangulation of the pieces (O(n log n))
+	static bool sweep(const std::vector<float>& outline,const std::vector<std::vector<float> >& holes,std::vector<unsigned int>& triangles);
+	/// 64 bits FNV-1a hash of the rings (key of the cache)
+	static unsigned long long hashPolygon(const std::vector<float>& outline,const std::vector<std::vector<float> >& holes);
+
+	/** Mesh of the polygon : GL_TRIANGLES, 2D coordinates (attribute 0) of every point of the rings.
+	  * Owned by the tessellator (until clearCache). Its VAO is created if createVAOs (a GL context must be current).
+	  * Return nullptr if the polygon can not be triangulated.
+	  */
+	IndexedMesh* tessellate(const std::vector<float>& outline,const std::vector<std::vector<float> >& holes = std::vector<std::vector<float> >());
+	/// Delete every cached mesh
+	void clearCache();
+
+	unsigned int earClippingMaxPoints;
+	bool createVAOs;
+	GLBI_Tessellation_Stats stats;
+	/// Meshes by hash of their polygon
+	std::map<unsigned long long,IndexedMesh*> cache;
+
+private:
+	GLBI_Tessellator(const GLBI_Tessellator&);
+	GLBI_Tessellator& operator=(const GLBI_Tessellator&);
+};
+
+}
@@ -2,14 +2,57 @@
 
 #include <iostream>
 #include <cassert>
+#include <vector>
 #include "tools/gl_tools.hpp"
 
 using namespace STP3D;
 
 namespace glbasimac {
 
+/// Internal (GPU side) format of a texture
+enum GLBI_Texture_Format {
+	GLBI_TEXTURE_AUTO = 0,          ///< R8, RG8, RGB8 or RGBA8 depending on the number of channels
+	GLBI_TEXTURE_RGB8,
+	GLBI_TEXTURE_RGBA8,
+	GLBI_TEXTURE_SRGB8,             ///< Colors stored in sRGB space, converted to linear when sampled
+	GLBI_TEXTURE_SRGB8_ALPHA8,
+	GLBI_TEXTURE_COMPRESSED,        ///< S3TC DXT1 (3 channels) or DXT5 (4 channels) if the driver exposes it, else AUTO
+	GLBI_TEXTURE_COMPRESSED_SRGB    ///< sRGB S3TC if the driver exposes it, else SRGB8 or SRGB8_ALPHA8
+};
+
+/// How the mipmap chain of a texture is built
+enum GLBI_Mipmap_Mode {
+	GLBI_MIPMAP_NONE = 0,  ///< Level 0 only
+	GLBI_MIPMAP_GPU,       ///< glGenerateMipmap (compressed formats fall back to CPU)
+	GLBI_MIPMAP_CPU        ///< Box filter on the CPU (in linear space for sRGB formats), every level uploaded
+};
+
+struct GLBI_Texture_Options {
+	GLBI_Texture_Options():format(GLBI_TEXTURE_AUTO),mipmaps(GLBI_MIPMAP_GPU),maxLevels(0),anisotropy(1.0f),immutable(true) {}
+
+	GLBI_Texture_Format format;
+	GLBI_Mipmap_Mode mipmaps;
+	/// Maximum number of mipmap levels (0 : full chain down to 1x1)
+	unsigned int maxLevels;
+	/// Maximum anisotropy (1 : off). Clamped to the driver limit, ignored without anisotropic filtering
+	float anisotropy;
+	/// Allocate every level at once with glTexStorage2D when available (GL 4.2 or ARB_texture_storage)
+	bool immutable;
+};
+
+/// Texture features of the current GL context, queried on first use
+struct GLBI_Texture_Caps {
+	bool textureStorage;
+	bool s3tc;
+	bool s3tcSRGB;
+	bool anisotropic;
+	float maxAnisotropy;
+
+	static const GLBI_Texture_Caps& get();
+};
+
 struct GLBI_Texture {
-	GLBI_Texture() : id_in_GL(0),width(0),height(0),channels(0) {
+	GLBI_Texture() : id_in_GL(0),width(0),height(0),channels(0),levels(0),internalFormat(0),immutable(false),cpuMipmaps(false) {
 	};
 
 	~GLBI_Texture() {
@@ -19,13 +62,47 @@ struct GLBI_Texture {
 	void createTexture();
 	void attachTexture();
 	void detachTexture();
-	void loadImage(unsigned int w,unsigned int h,unsigned int n_chan,unsigned char* pixels);
+	/** Upload an image (rows from bottom to top, tightly packed) and build its mipmap chain.
+	  * The texture is left attached. Min and mag filters are set to trilinear (bilinear without
+	  * mipmaps) : call setParameters afterwards to change them.
+	  * An immutable texture reloaded with another size or format gets a new id_in_GL.
+	  */
+	void loadImage(unsigned int w,unsigned int h,unsigned int n_chan,unsigned char* pixels,
+	               const GLBI_Texture_Options& options = GLBI_Texture_Options());
+	/** Step by step upload (used to stream an image over several frames) :
+	  * allocate the levels, fill them with uploadRows, then call completeUpload.
+	  * Only level 0 is uploaded unless cpuMipmaps is true. Return false on invalid size.
+	  */
+	bool allocate(unsigned int w,unsigned int h,unsigned int n_chan,const GLBI_Texture_Options& options);
+	/// Upload \param nb_rows rows of \param level from row \param y (an offset if a pixel unpack buffer is bound)
+	void uploadRows(unsigned int level,unsigned int y,unsigned int nb_rows,const void* pixels);
+	/// Generate GPU mipmaps if needed and set the filters
+	void completeUpload(const GLBI_Texture_Options& options);
 	void setParameters(unsigned int param,unsigned int value);
+	/// Set the maximum anisotropy (clamped to the driver limit). Return false if not supported
+	bool setAnisotropy(float value);
+	/// Nominal GPU memory used by every level (drivers may pad RGB8 texels to 4 bytes)
+	size_t memorySize() const;
+
+	/// Internal format used for \param format and \param n_chan channels (GLBI_Texture_Caps must have been queried)
+	static unsigned int chooseInternalFormat(GLBI_Texture_Format format,unsigned int n_chan);
+	static bool isCompressedFormat(unsigned int format);
+	static bool isSRGBFormat(unsigned int format);
 
 	// Texture parameters
 	unsigned int id_in_GL;
 	unsigned int width,height;
 	unsigned int channels;
+	unsigned int levels;          ///< Number of mipmap levels
+	unsigned int internalFormat;  ///< GL internal format really used
+	bool immutable;               ///< Storage allocated with glTexStorage2D
+	bool cpuMipmaps;              ///< Every level is uploaded (else levels above 0 are generated by the GPU)
 };
 
+/** 2x2 box filter of a w x h image into the next mipmap level (odd sizes drop the last row or column).
+  * With \param srgb, color channels are averaged in linear space.
+  */
+void glbiDownsample(unsigned int w,unsigned int h,unsigned int n_chan,const unsigned char* src,bool srgb,
+                    std::vector<unsigned char>& dst);
+
 }
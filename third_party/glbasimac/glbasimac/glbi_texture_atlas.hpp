@@ -0,0 +1,95 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "glbasimac/glbi_texture.hpp"
+
+namespace glbasimac {
+
+/// Place of an image in a texture atlas
+struct GLBI_Atlas_Region {
+	GLBI_Atlas_Region():page(0),x(0),y(0),w(0),h(0),u0(0.0f),v0(0.0f),u1(0.0f),v1(0.0f) {}
+
+	/// Map \param nb uv couples given for the image alone (in [0,1]) to the atlas page, in place
+	void remapUVs(float* uvs,size_t nb) const;
+
+	unsigned int page;      ///< Index of the page (GLBI_Texture_Atlas::pages)
+	unsigned int x,y,w,h;   ///< Texels of the image in the page (padding excluded)
+	float u0,v0,u1,v1;      ///< Same rectangle in texture coordinates
+};
+
+/**
+ * Skyline rectangle packer (bottom-left heuristic) : the top of the packed rectangles is kept as a
+ * list of horizontal segments, and each rectangle goes where its top is the lowest.
+ */
+struct GLBI_Skyline_Packer {
+	GLBI_Skyline_Packer():width(0),height(0),usedArea(0) {}
+
+	void init(unsigned int w,unsigned int h);
+	/// Find a place for a w x h rectangle. Return false if it does not fit
+	bool insert(unsigned int w,unsigned int h,unsigned int& x,unsigned int& y);
+	/// Highest point of the skyline
+	unsigned int usedHeight() const;
+	/// Ratio of the area covered by rectangles
+	float occupancy() const {return (width && height) ? float(usedArea)/(float(width)*height) : 0.0f;}
+
+	unsigned int width,height;
+	unsigned long usedArea;
+
+private:
+	struct Segment {
+		unsigned int x,y,w;
+	};
+	/// Lowest y where a rectangle of width w can sit from segment i (or height if it is out of the bin)
+	unsigned int fit(size_t i,unsigned int w) const;
+
+	std::vector<Segment> skyline;
+};
+
+/**
+ * Texture atlas : many small images (sprites, icons, glyphs) packed in one or a few RGBA pages,
+ * so that meshes using them share a texture and can be drawn without rebinding.
+ * Each image is surrounded by \param padding texels copied from its border, so that bilinear
+ * filtering does not bleed between neighbours. Mipmap levels above log2(padding) would bleed :
+ * they are not sampled (GL_TEXTURE_MAX_LEVEL).
+ * Typical use :
+ *   GLBI_Texture_Atlas atlas; int id = atlas.addImage("sprite.png"); ... atlas.build();
+ *   atlas.regions[id].remapUVs(uvs,nb_vertices); then draw with *atlas.pages[atlas.regions[id].page]
+ */
+struct GLBI_Texture_Atlas {
+	GLBI_Texture_Atlas(unsigned int page_size = 2048,unsigned int padding = 2)
+		:pageSize(page_size),padding(padding),built(false) {}
+	~GLBI_Texture_Atlas() {release();}
+
+	/// Add an image (copied, rows from bottom to top). Return its index in regions, -1 if it can not fit a page
+	/// or if the atlas is already built
+	int addImage(unsigned int w,unsigned int h,unsigned int n_chan,const unsigned char* pixels);
+	/// Add an image file (see glbiReadImage). Return -1 if it can not be read or does not fit
+	int addImage(const std::string& filename);
+	/** Pack every image, from the tallest, then create and upload the pages (CPU copies are freed).
+	  * Every page is shrunk to the height really used. An atlas is built once.
+	  * Return false if nothing to build.
+	  */
+	bool build(const GLBI_Texture_Options& options = GLBI_Texture_Options());
+	/// Delete the pages
+	void release();
+	/// Average ratio of the page area covered by images (padding included)
+	float occupancy() const;
+
+	unsigned int pageSize;
+	unsigned int padding;
+	std::vector<GLBI_Atlas_Region> regions;
+	std::vector<GLBI_Texture*> pages;
+
+private:
+	GLBI_Texture_Atlas(const GLBI_Texture_Atlas&);
+	GLBI_Texture_Atlas& operator=(const GLBI_Texture_Atlas&);
+
+	/// Images waiting for build, converted to RGBA (same index as their region)
+	std::vector<std::vector<unsigned char> > images;
+	bool built;
+	std::vector<GLBI_Skyline_Packer> packers;
+};
+
+}
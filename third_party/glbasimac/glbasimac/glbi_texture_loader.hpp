@@ -0,0 +1,86 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "glbasimac/glbi_texture.hpp"
+
+namespace glbasimac {
+
+/// Default number of bytes uploaded to the GPU per frame by GLBI_Texture_Loader
+#define GLBI_TEXTURE_UPLOAD_BUDGET (8*1024*1024)
+
+/**
+ * Asynchronous texture loader : image files are decoded (and flipped, and their CPU mipmaps built)
+ * by worker threads, then streamed to the GPU through a pixel unpack buffer, a few rows at a time,
+ * so that each frame uploads at most bytesPerFrame bytes.
+ * Typical use :
+ *   GLBI_Texture_Loader loader; loader.load("../assets/textures/poulpile.jpg",texture);
+ *   each frame : loader.update(); draw...
+ * load, update and finish must be called on the GL thread. Textures must live until they are loaded.
+ */
+struct GLBI_Texture_Loader {
+	/// \param nb_threads decoding threads (0 : one less than the number of cores)
+	GLBI_Texture_Loader(unsigned int nb_threads = 0,size_t bytes_per_frame = GLBI_TEXTURE_UPLOAD_BUDGET);
+	/// Stop the workers. GL objects must have been released with release()
+	~GLBI_Texture_Loader();
+
+	/// Queue the loading of \param filename in \param texture (created if needed). Return at once
+	void load(const std::string& filename,GLBI_Texture& texture,const GLBI_Texture_Options& options = GLBI_Texture_Options());
+	/// Upload decoded images within the budget of the frame. Return the number of textures completed
+	unsigned int update();
+	/// Decode and upload every queued texture (budget ignored)
+	void finish();
+	/// Number of textures queued and not completed yet
+	size_t pending() const {return nbPending;}
+	/// Release the pixel buffer
+	void release();
+
+	/// Maximum number of bytes uploaded by update (at least one band of 4 rows is uploaded per frame)
+	size_t bytesPerFrame;
+	/// Number of textures loaded, of files that could not be decoded, and of bytes uploaded
+	unsigned long nbLoaded;
+	unsigned long nbFailed;
+	unsigned long long nbBytesUploaded;
+
+private:
+	GLBI_Texture_Loader(const GLBI_Texture_Loader&);
+	GLBI_Texture_Loader& operator=(const GLBI_Texture_Loader&);
+
+	struct Job {
+		std::string filename;
+		GLBI_Texture* texture;
+		GLBI_Texture_Options options;
+		bool decoded;
+		int w,h,channels;
+		/// Level 0, and the levels above when the mipmaps are built on the CPU
+		std::vector<std::vector<unsigned char> > levels;
+		// Upload progress
+		bool allocated;
+		unsigned int level,row;
+	};
+	void work();
+	/// Upload at most \param budget bytes of the decoded images. Return the number of textures completed
+	unsigned int upload(size_t budget);
+
+	std::vector<std::thread> workers;
+	/// Files to decode (workers) and decoded images (GL thread)
+	std::deque<Job> toDecode;
+	std::deque<Job> decoded;
+	/// Images being uploaded (GL thread only)
+	std::deque<Job> uploading;
+	size_t nbPending;
+	bool stopping;
+	std::mutex mutex;
+	std::condition_variable jobAdded;
+	std::condition_variable jobDecoded;
+
+	unsigned int id_pbo;
+	size_t pboSize;
+};
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "tools/vector3d.hpp"
+#include "tools/matrix4d.hpp"
+
+using namespace STP3D;
+
+namespace glbasimac {
+
+/**
+ * Node of a transform hierarchy (scene graph). Each node has a local transform
+ * (translation, rotation then scaling, or any matrix) relative to its parent.
+ * World and normal matrices are computed lazily and cached : changing a local transform
+ * only marks the node and its descendants as dirty, and matrices are recomputed when read.
+ * Drawing with GLBI_Engine::updateMvMatrix(node) sends the cached matrices, so static nodes
+ * never pay for a matrix product or an inversion.
+ * To include the camera, use a root node whose local matrix is the view matrix.
+ */
+struct GLBI_Transform_Node {
+	GLBI_Transform_Node(GLBI_Transform_Node* parent_node = nullptr);
+	/// Detach the node from its parent. Children become roots
+	~GLBI_Transform_Node();
+
+	/// Move the node (and its subtree) under \param parent_node (nullptr : the node becomes a root)
+	void setParent(GLBI_Transform_Node* parent_node);
+	GLBI_Transform_Node* getParent() const {return parent;}
+
+	/// Set the local translation
+	void setTranslation(float x,float y,float z);
+	/// Set the local rotation of \param angle (radians, as MatrixStack::addRotation) around \param axe
+	void setRotation(float angle,const Vector3D& axe);
+	/// Set the local scaling
+	void setScale(float sx,float sy,float sz);
+	/// Set the local scaling (same on 3 axes)
+	void setScale(float s) {setScale(s,s,s);}
+	/// Replace the local TRS by any matrix
+	void setLocalMatrix(const Matrix4D& m);
+
+	/// Local transform (translation*rotation*scaling or matrix given to setLocalMatrix)
+	const Matrix4D& getLocalMatrix();
+	/// Product of the local matrices from the root to this node
+	const Matrix4D& getWorldMatrix();
+	/// Normal matrix of the world matrix (inverse transpose of its 3x3 part)
+	const Matrix4D& getNormalMatrix();
+	/// True if the world matrix is a rotation with an uniform scale (normal matrix without inversion)
+	bool isSimilarity();
+
+	/// Number of world and normal matrix computations of this node (to check the caching)
+	unsigned long nbWorldUpdates;
+	unsigned long nbNormalUpdates;
+
+private:
+	GLBI_Transform_Node(const GLBI_Transform_Node&);
+	GLBI_Transform_Node& operator=(const GLBI_Transform_Node&);
+
+	/// Local matrix changed : world and normal matrices of the subtree are out of date
+	void markDirty();
+	void removeChild(GLBI_Transform_Node* child);
+
+	GLBI_Transform_Node* parent;
+	std::vector<GLBI_Transform_Node*> children;
+
+	/// Local TRS (used if useTRS)
+	Vector3D translation;
+	float angle;
+	Vector3D axe;
+	Vector3D scale;
+	bool useTRS;
+
+	Matrix4D local;
+	Matrix4D world;
+	Matrix4D normal;
+	bool localDirty;
+	bool worldDirty;
+	bool normalDirty;
+	/// Local matrix is a rotation with an uniform scale
+	bool localSimilarity;
+	/// World matrix is a rotation with an uniform scale
+	bool worldSimilarity;
+};
+
+}
@@ -0,0 +1,147 @@
+#include "glbasimac/glbi_app_loop.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "glbasimac/glbi_profiler.hpp"
+#define GLFW_INCLUDE_NONE
+#include "GLFW/glfw3.h"
+
+namespace glbasimac {
+
+	std::string GLBI_Frame_Stats::toString() const {
+		char line[160];
+		snprintf(line,sizeof(line),"%lu frames : %.1f fps, p50 %.2f ms, p99 %.2f ms, max %.2f ms, jitter %.2f ms",
+		         nbFrames,(mean > 0.0) ? 1000.0/mean : 0.0,p50,p99,max,jitter);
+		return line;
+	}
+
+	GLBI_App_Loop::GLBI_App_Loop():fixedStep(1.0/60.0),maxSteps(8),targetFrameTime(0.0),swapInterval(1),benchmark(false),
+	                               benchmarkFrames(0),onDemand(false),simTime(0.0),nbUpdates(0),nbFrames(0),lastTime(-1.0),
+	                               accumulator(0.0),redraw(true),nextFrameTime(0) {
+		origin = std::chrono::steady_clock::now();
+		frameTimes.reserve(GLBI_FRAME_TIMES);
+	}
+
+	double GLBI_App_Loop::now() const {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now()-origin).count();
+	}
+
+	void GLBI_App_Loop::frame() {
+		double t = now();
+		if (lastTime >= 0.0) {
+			recordFrameTime(t-lastTime);
+			accumulator += t-lastTime;
+		}
+		lastTime = t;
+		{
+			GLBI_PROFILE_STAGE("update");
+			unsigned int nb_steps = 0;
+			while ((accumulator >= fixedStep) && (nb_steps < maxSteps)) {
+				if (update) update(fixedStep);
+				simTime += fixedStep;
+				accumulator -= fixedStep;
+				nbUpdates++;
+				nb_steps++;
+			}
+			// The simulation can not follow : the late time is dropped
+			if (accumulator >= fixedStep) accumulator = std::fmod(accumulator,fixedStep);
+		}
+		{
+			GLBI_PROFILE_STAGE("render");
+			if (render) render(accumulator/fixedStep);
+		}
+		nbFrames++;
+	}
+
+	void GLBI_App_Loop::run(GLFWwindow* window) {
+		// Vsync aware cap : whole refresh periods per frame when the refresh rate is known
+		int interval = benchmark ? 0 : swapInterval;
+		double refresh_rate = 0.0;
+		GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+		const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+		if (mode) refresh_rate = mode->refreshRate;
+		bool paced_by_swap = (interval > 0) && (refresh_rate > 0.0);
+		if (paced_by_swap && (targetFrameTime > 0.0)) {
+			interval = std::max(interval,int(std::lround(targetFrameTime*refresh_rate)));
+		}
+		glfwSwapInterval(interval);
+		// When vsync paces the frames, sleeping stops half a period before the frame is due
+		// (in case the driver does not block on swaps)
+		double slack = paced_by_swap ? 0.5/refresh_rate : 0.0;
+
+		double deadline = now();
+		resume();
+		while (!glfwWindowShouldClose(window)) {
+			if (glfwGetWindowAttrib(window,GLFW_ICONIFIED) || (onDemand && !redraw)) {
+				// Nothing to draw : sleep until an event, without simulating the pause
+				glfwWaitEvents();
+				resume();
+				if (onDemand) redraw = true;
+				continue;
+			}
+			redraw = false;
+			GLBI_Profiler* profiler = GLBI_Profiler::active;
+			if (profiler) profiler->beginFrame();
+			frame();
+			if (profiler) profiler->endFrame();
+			glfwSwapBuffers(window);
+			if (benchmark) {
+				glfwPollEvents();
+				if (benchmarkFrames && (nbFrames >= benchmarkFrames)) break;
+				continue;
+			}
+			// Unless the next iteration waits for an event (on demand, no redraw requested), events are
+			// processed here : the pacing wait below is skipped by late frames
+			if (!onDemand || redraw) glfwPollEvents();
+			if (targetFrameTime > 0.0) {
+				deadline += targetFrameTime;
+				double t = now();
+				// More than a frame late : start again from now instead of a burst of frames
+				if (deadline < t-targetFrameTime) deadline = t;
+				while ((t < deadline-slack) && !glfwWindowShouldClose(window)) {
+					glfwWaitEventsTimeout(deadline-slack-t);
+					t = now();
+				}
+			}
+		}
+	}
+
+	void GLBI_App_Loop::recordFrameTime(double dt) {
+		if (frameTimes.size() < GLBI_FRAME_TIMES) {
+			frameTimes.push_back(dt);
+		}
+		else {
+			frameTimes[nextFrameTime] = dt;
+		}
+		nextFrameTime = (nextFrameTime+1)%GLBI_FRAME_TIMES;
+	}
+
+	void GLBI_App_Loop::resetStats() {
+		frameTimes.clear();
+		nextFrameTime = 0;
+	}
+
+	GLBI_Frame_Stats GLBI_App_Loop::frameStats() const {
+		GLBI_Frame_Stats stats;
+		size_t n = frameTimes.size();
+		if (n == 0) return stats;
+		stats.nbFrames = n;
+		// Oldest time first
+		size_t first = (n < GLBI_FRAME_TIMES) ? 0 : nextFrameTime;
+		double sum = 0.0,diff = 0.0;
+		for(size_t i=0;i<n;i++) {
+			double dt = frameTimes[(first+i)%n];
+			sum += dt;
+			if (i > 0) diff += std::fabs(dt-frameTimes[(first+i-1)%n]);
+		}
+		std::vector<double> sorted(frameTimes);
+		std::sort(sorted.begin(),sorted.end());
+		stats.mean = 1000.0*sum/n;
+		stats.p50 = 1000.0*sorted[n/2];
+		stats.p99 = 1000.0*sorted[std::min(n-1,(n*99)/100)];
+		stats.max = 1000.0*sorted.back();
+		stats.jitter = (n > 1) ? 1000.0*diff/(n-1) : 0.0;
+		return stats;
+	}
+
+}
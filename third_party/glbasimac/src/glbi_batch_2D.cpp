@@ -0,0 +1,286 @@
+#include "glbasimac/glbi_batch_2D.hpp"
+#include "glbasimac/glbi_profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace glbasimac {
+
+	/// Component in [0,1] to 8 bits
+	static unsigned char toByte(float c) {
+		return (unsigned char)(std::min(std::max(c,0.0f),1.0f)*255.0f+0.5f);
+	}
+
+	void GLBI_Batch_2D::release() {
+		if (idVAO) glDeleteVertexArrays(1,&idVAO);
+		if (idVBO[0]) glDeleteBuffers(2,idVBO);
+		idVAO = idVBO[0] = idVBO[1] = 0;
+		capacity = idxCapacity = 0;
+	}
+
+	void GLBI_Batch_2D::setColor(float r,float g,float b) {
+		color[0] = toByte(r);
+		color[1] = toByte(g);
+		color[2] = toByte(b);
+	}
+
+	unsigned int GLBI_Batch_2D::reserve(size_t nb_vertices) {
+		if (chunks.empty() || (vertices.size()-chunks.back().baseVertex+nb_vertices > GLBI_BATCH_2D_MAX_VERTICES)) {
+			Chunk chunk;
+			chunk.firstIndex = indices.size();
+			chunk.nbIndices = 0;
+			chunk.baseVertex = vertices.size();
+			chunks.push_back(chunk);
+		}
+		return (unsigned int)(vertices.size()-chunks.back().baseVertex);
+	}
+
+	void GLBI_Batch_2D::addVertex(float x,float y) {
+		GLBI_Batch_2D_Vertex v;
+		v.x = x;
+		v.y = y;
+		v.rgba[0] = color[0];
+		v.rgba[1] = color[1];
+		v.rgba[2] = color[2];
+		v.rgba[3] = color[3];
+		vertices.push_back(v);
+	}
+
+	void GLBI_Batch_2D::addPoint(float x,float y) {
+		// Column major : only the 2D part of the matrix is used
+		const float* m = transform.stack.back().mat;
+		addVertex(m[0]*x+m[4]*y+m[12],m[1]*x+m[5]*y+m[13]);
+	}
+
+	void GLBI_Batch_2D::addFan(unsigned int first,unsigned int nb) {
+		for(unsigned int i=1;i+1<nb;i++) {
+			indices.push_back((unsigned short)first);
+			indices.push_back((unsigned short)(first+i));
+			indices.push_back((unsigned short)(first+i+1));
+		}
+	}
+
+	void GLBI_Batch_2D::triangle(float x0,float y0,float x1,float y1,float x2,float y2) {
+		unsigned int first = reserve(3);
+		addPoint(x0,y0);
+		addPoint(x1,y1);
+		addPoint(x2,y2);
+		addFan(first,3);
+	}
+
+	void GLBI_Batch_2D::quad(const float pts[8]) {
+		unsigned int first = reserve(4);
+		for(int i=0;i<4;i++) addPoint(pts[2*i],pts[2*i+1]);
+		addFan(first,4);
+	}
+
+	void GLBI_Batch_2D::rectangle(float xmin,float ymin,float xmax,float ymax) {
+		const float pts[8] = {xmin,ymin,xmax,ymin,xmax,ymax,xmin,ymax};
+		quad(pts);
+	}
+
+	void GLBI_Batch_2D::roundedRectangle(float xmin,float ymin,float xmax,float ymax,float radius,unsigned int nb_corner_segments) {
+		radius = std::min(radius,0.5f*std::min(xmax-xmin,ymax-ymin));
+		if ((radius <= 0.0f) || (nb_corner_segments == 0)) {
+			rectangle(xmin,ymin,xmax,ymax);
+			return;
+		}
+		// Corner centers, counterclockwise from the lower right one
+		const float cx[4] = {xmax-radius,xmax-radius,xmin+radius,xmin+radius};
+		const float cy[4] = {ymin+radius,ymax-radius,ymax-radius,ymin+radius};
+		unsigned int nb = 4*(nb_corner_segments+1);
+		unsigned int first = reserve(nb);
+		for(int c=0;c<4;c++) {
+			for(unsigned int s=0;s<=nb_corner_segments;s++) {
+				float angle = float(M_PI)*0.5f*(c-1+float(s)/nb_corner_segments);
+				addPoint(cx[c]+radius*std::cos(angle),cy[c]+radius*std::sin(angle));
+			}
+		}
+		addFan(first,nb);
+	}
+
+	void GLBI_Batch_2D::circle(float cx,float cy,float radius,unsigned int nb_segments) {
+		if (nb_segments < 3) return;
+		unsigned int first = reserve(nb_segments);
+		for(unsigned int s=0;s<nb_segments;s++) {
+			float angle = 2.0f*float(M_PI)*s/nb_segments;
+			addPoint(cx+radius*std::cos(angle),cy+radius*std::sin(angle));
+		}
+		addFan(first,nb_segments);
+	}
+
+	void GLBI_Batch_2D::polygon(const std::vector<float>& coords) {
+		unsigned int nb = coords.size()/2;
+		if (nb < 3) return;
+		if (nb > GLBI_BATCH_2D_MAX_VERTICES) {
+			std::cerr<<"Polygon of "<<nb<<" points can not be batched"<<std::endl;
+			return;
+		}
+		unsigned int first = reserve(nb);
+		for(unsigned int i=0;i<nb;i++) addPoint(coords[2*i],coords[2*i+1]);
+		addFan(first,nb);
+	}
+
+	void GLBI_Batch_2D::addSegment(float x0,float y0,float x1,float y1,float width) {
+		float dx = x1-x0,dy = y1-y0;
+		float length = std::sqrt(dx*dx+dy*dy);
+		if (length == 0.0f) return;
+		float nx = -0.5f*width*dy/length,ny = 0.5f*width*dx/length;
+		unsigned int first = reserve(4);
+		addVertex(x0+nx,y0+ny);
+		addVertex(x0-nx,y0-ny);
+		addVertex(x1-nx,y1-ny);
+		addVertex(x1+nx,y1+ny);
+		addFan(first,4);
+	}
+
+	void GLBI_Batch_2D::line(float x0,float y0,float x1,float y1,float width) {
+		const float* m = transform.stack.back().mat;
+		addSegment(m[0]*x0+m[4]*y0+m[12],m[1]*x0+m[5]*y0+m[13],m[0]*x1+m[4]*y1+m[12],m[1]*x1+m[5]*y1+m[13],width);
+	}
+
+	void GLBI_Batch_2D::polyline(const std::vector<float>& coords,float width,bool closed) {
+		// Transformed points, without repeated ones (no direction)
+		const float* m = transform.stack.back().mat;
+		std::vector<float> pts;
+		pts.reserve(coords.size());
+		for(size_t i=0;i+1<coords.size();i+=2) {
+			float x = m[0]*coords[i]+m[4]*coords[i+1]+m[12];
+			float y = m[1]*coords[i]+m[5]*coords[i+1]+m[13];
+			if (!pts.empty() && (x == pts[pts.size()-2]) && (y == pts.back())) continue;
+			pts.push_back(x);
+			pts.push_back(y);
+		}
+		unsigned int nb = pts.size()/2;
+		if (closed && (nb > 2) && (pts[0] == pts[2*nb-2]) && (pts[1] == pts[2*nb-1])) nb--;
+		if (nb < 2) return;
+		if (nb == 2) closed = false;
+		if (2*nb > GLBI_BATCH_2D_MAX_VERTICES) {
+			std::cerr<<"Polyline of "<<nb<<" points can not be batched"<<std::endl;
+			return;
+		}
+
+		// Unit normals of the segments (segment i goes from point i to point i+1)
+		unsigned int nb_segments = closed ? nb : nb-1;
+		std::vector<float> normals(2*nb_segments);
+		for(unsigned int i=0;i<nb_segments;i++) {
+			unsigned int j = (i+1)%nb;
+			float dx = pts[2*j]-pts[2*i],dy = pts[2*j+1]-pts[2*i+1];
+			float length = std::sqrt(dx*dx+dy*dy);
+			normals[2*i] = -dy/length;
+			normals[2*i+1] = dx/length;
+		}
+
+		// Two vertices per point, offset along the miter of the segments around the point
+		float half = 0.5f*width;
+		unsigned int first = reserve(2*nb);
+		for(unsigned int i=0;i<nb;i++) {
+			unsigned int after = (i < nb_segments) ? i : nb_segments-1;
+			unsigned int before = (i > 0) ? i-1 : (closed ? nb_segments-1 : 0);
+			float mx = normals[2*before]+normals[2*after],my = normals[2*before+1]+normals[2*after+1];
+			float ml = std::sqrt(mx*mx+my*my);
+			float ox = half*normals[2*after],oy = half*normals[2*after+1];
+			if (ml > 1e-4f) {
+				mx /= ml;
+				my /= ml;
+				// Miter length, limited for sharp angles
+				float scale = half/std::max(mx*normals[2*after]+my*normals[2*after+1],0.25f);
+				ox = scale*mx;
+				oy = scale*my;
+			}
+			addVertex(pts[2*i]+ox,pts[2*i+1]+oy);
+			addVertex(pts[2*i]-ox,pts[2*i+1]-oy);
+		}
+		for(unsigned int i=0;i<nb_segments;i++) {
+			unsigned int a = first+2*i,b = first+2*((i+1)%nb);
+			indices.push_back((unsigned short)a);
+			indices.push_back((unsigned short)(a+1));
+			indices.push_back((unsigned short)(b+1));
+			indices.push_back((unsigned short)a);
+			indices.push_back((unsigned short)(b+1));
+			indices.push_back((unsigned short)b);
+		}
+	}
+
+	void GLBI_Batch_2D::circleOutline(float cx,float cy,float radius,float width,unsigned int nb_segments) {
+		if (nb_segments < 3) return;
+		std::vector<float> coords(2*nb_segments);
+		for(unsigned int s=0;s<nb_segments;s++) {
+			float angle = 2.0f*float(M_PI)*s/nb_segments;
+			coords[2*s] = cx+radius*std::cos(angle);
+			coords[2*s+1] = cy+radius*std::sin(angle);
+		}
+		polyline(coords,width,true);
+	}
+
+	void GLBI_Batch_2D::rectangleOutline(float xmin,float ymin,float xmax,float ymax,float width) {
+		std::vector<float> coords = {xmin,ymin,xmax,ymin,xmax,ymax,xmin,ymax};
+		polyline(coords,width,true);
+	}
+
+	bool GLBI_Batch_2D::createBuffers() {
+		glGenVertexArrays(1,&idVAO);
+		glGenBuffers(2,idVBO);
+		if ((idVAO == 0) || (idVBO[0] == 0) || (idVBO[1] == 0)) {
+			std::cerr<<"Unable to create the buffers of the 2D batch"<<std::endl;
+			release();
+			return false;
+		}
+		glBindVertexArray(idVAO);
+		glBindBuffer(GL_ARRAY_BUFFER,idVBO[0]);
+		// Same locations as the meshes : position (0) and color (3)
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0,2,GL_FLOAT,GL_FALSE,sizeof(GLBI_Batch_2D_Vertex),(const void*)offsetof(GLBI_Batch_2D_Vertex,x));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3,3,GL_UNSIGNED_BYTE,GL_TRUE,sizeof(GLBI_Batch_2D_Vertex),(const void*)offsetof(GLBI_Batch_2D_Vertex,rgba));
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,idVBO[1]);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER,0);
+		return true;
+	}
+
+	void GLBI_Batch_2D::flush() {
+		GLBI_PROFILE_STAGE("batch 2D");
+		stats = GLBI_Batch_2D_Stats();
+		if (indices.empty() || ((idVAO == 0) && !createBuffers())) {
+			clear();
+			return;
+		}
+
+		// Buffers are orphaned each frame : no wait on the draws of the previous one
+		glBindVertexArray(idVAO);
+		STP3D_COUNT(binds,1);
+		glBindBuffer(GL_ARRAY_BUFFER,idVBO[0]);
+		capacity = std::max(capacity,vertices.size());
+		glBufferData(GL_ARRAY_BUFFER,capacity*sizeof(GLBI_Batch_2D_Vertex),NULL,GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER,0,vertices.size()*sizeof(GLBI_Batch_2D_Vertex),vertices.data());
+		idxCapacity = std::max(idxCapacity,indices.size());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER,idxCapacity*sizeof(unsigned short),NULL,GL_STREAM_DRAW);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,0,indices.size()*sizeof(unsigned short),indices.data());
+		glBindBuffer(GL_ARRAY_BUFFER,0);
+		STP3D_COUNT(buffer_bytes,vertices.size()*sizeof(GLBI_Batch_2D_Vertex)+indices.size()*sizeof(unsigned short));
+
+		// Vertices are already transformed
+		engine.mvMatrixStack.pushMatrix();
+		engine.mvMatrixStack.loadIdentity();
+		engine.updateMvMatrix();
+		for(size_t c=0;c<chunks.size();c++) {
+			size_t end = (c+1 < chunks.size()) ? chunks[c+1].firstIndex : indices.size();
+			chunks[c].nbIndices = end-chunks[c].firstIndex;
+			if (chunks[c].nbIndices == 0) continue;
+			glDrawElementsBaseVertex(GL_TRIANGLES,chunks[c].nbIndices,GL_UNSIGNED_SHORT,
+			                         (const void*)(chunks[c].firstIndex*sizeof(unsigned short)),chunks[c].baseVertex);
+			STP3D_COUNT(draw_calls,1);
+			STP3D_COUNT(triangles,chunks[c].nbIndices/3);
+			stats.drawCalls++;
+		}
+		glBindVertexArray(0);
+		engine.mvMatrixStack.popMatrix();
+		engine.updateMvMatrix();
+
+		stats.vertices = vertices.size();
+		stats.triangles = indices.size()/3;
+		clear();
+	}
+
+}
@@ -33,6 +33,8 @@ namespace glbasimac {
 	}
 
 	void GLBI_Convex_2D_Shape::changeNature(unsigned int new_gl_type) {
+		// GL_POLYGON does not exist in core profile : a fan fills a convex shape the same way
+		if (new_gl_type == GL_POLYGON) new_gl_type = GL_TRIANGLE_FAN;
 		shape.changeType(new_gl_type);
 	}
 
@@ -40,4 +42,23 @@ namespace glbasimac {
 		shape.draw();
 	}
 
+	void GLBI_Convex_2D_Shape::setInstances(const std::vector<Matrix4D>& transforms,const std::vector<Vector3D>& colors) {
+		static_assert(sizeof(Matrix4D) == 16*sizeof(float),"Matrix4D must be stored as 16 contiguous floats");
+		static_assert(sizeof(Vector3D) == 3*sizeof(float),"Vector3D must be stored as 3 contiguous floats");
+		assert(colors.empty() || (colors.size() == transforms.size()));
+		const float* col = colors.empty() ? nullptr : colors[0].val;
+		if (!shape.setInstances(transforms.size(),transforms.empty() ? nullptr : transforms[0].mat,col)) {
+			std::cerr<<"Unable to set instances of Convex 2D Shape"<<std::endl;
+			exit(1);
+		}
+	}
+
+	void GLBI_Convex_2D_Shape::drawShapeInstanced() {
+		shape.drawInstanced();
+	}
+
+	void GLBI_Convex_2D_Shape::clearInstances() {
+		shape.clearInstances();
+	}
+
 }
@@ -0,0 +1,231 @@
+#include "glbasimac/glbi_draw_list.hpp"
+#include "glbasimac/glbi_profiler.hpp"
+#include <algorithm>
+#include <tuple>
+
+namespace glbasimac {
+
+	/// True if the two commands can be drawn with the same instanced draw
+	static bool sameBatch(const GLBI_Draw_Command& a,const GLBI_Draw_Command& b) {
+		if ((a.shader != b.shader) || (a.texture != b.texture) || (a.mesh != b.mesh) || (a.idxMesh != b.idxMesh)) return false;
+		if (a.shader == 0) return true;
+		return (a.material.shininess == b.material.shininess) &&
+		       (a.material.specular.x == b.material.specular.x) &&
+		       (a.material.specular.y == b.material.specular.y) &&
+		       (a.material.specular.z == b.material.specular.z);
+	}
+
+	void GLBI_DrawList::record(StandardMesh* mesh,IndexedMesh* idx_mesh,unsigned int vao,const GLBI_Material& material,const GLBI_Texture* texture) {
+		GLBI_Draw_Command cmd;
+		cmd.mesh = mesh;
+		cmd.idxMesh = idx_mesh;
+		cmd.vao = vao;
+		cmd.shader = engine.currentShader;
+		cmd.texture = texture ? texture->id_in_GL : 0;
+		cmd.modelview = engine.mvMatrixStack.stack.back();
+		cmd.material = material;
+		commands.push_back(cmd);
+	}
+
+	void GLBI_DrawList::addDraw(StandardMesh& mesh,const GLBI_Material& material,const GLBI_Texture* texture) {
+		record(&mesh,nullptr,mesh.getIdVAO(),material,texture);
+	}
+
+	void GLBI_DrawList::addDraw(IndexedMesh& mesh,const GLBI_Material& material,const GLBI_Texture* texture) {
+		record(nullptr,&mesh,mesh.id_vao,material,texture);
+	}
+
+	void GLBI_DrawList::addDraw(GLBI_Convex_2D_Shape& shape,const GLBI_Material& material,const GLBI_Texture* texture) {
+		addDraw(shape.shape,material,texture);
+	}
+
+	void GLBI_DrawList::computeImmediateStats() {
+		beforeSort = GLBI_Draw_Stats();
+		beforeSort.commands = commands.size();
+		int current_shader = engine.currentShader;
+		unsigned int current_texture = 0;
+		for(size_t i=0;i<commands.size();i++) {
+			if (commands[i].shader != current_shader) {
+				current_shader = commands[i].shader;
+				beforeSort.programChanges++;
+			}
+			if (commands[i].texture != current_texture) {
+				current_texture = commands[i].texture;
+				beforeSort.textureChanges++;
+			}
+			// draw() binds then unbinds its VAO
+			beforeSort.vaoBinds += 2;
+			beforeSort.drawCalls++;
+		}
+	}
+
+	void GLBI_DrawList::drawMerged(size_t first,size_t last,unsigned int& current_vao) {
+		const GLBI_Draw_Command& cmd = commands[first];
+		unsigned int nb = last-first;
+		instanceTransforms.resize(16*nb);
+		instanceColors.resize(3*nb);
+		for(unsigned int i=0;i<nb;i++) {
+			memcpy(&instanceTransforms[16*i],commands[first+i].modelview.mat,16*sizeof(float));
+			memcpy(&instanceColors[3*i],commands[first+i].material.color.val,3*sizeof(float));
+		}
+		// Meshes with a color buffer keep their own colors
+		bool has_colors = cmd.mesh ? cmd.mesh->hasAttribute(3) :
+		                  (std::find(cmd.idxMesh->attr_id.begin(),cmd.idxMesh->attr_id.end(),3u) != cmd.idxMesh->attr_id.end());
+		const float* colors = has_colors ? nullptr : instanceColors.data();
+
+		// Modelview is carried by instances
+		engine.mvMatrixStack.loadIdentity();
+		engine.updateMvMatrix();
+		engine.setFlatColor(cmd.material.color.x,cmd.material.color.y,cmd.material.color.z);
+
+		// Instance update and reset bind and unbind the VAO
+		bool ok = cmd.mesh ? cmd.mesh->setInstances(nb,instanceTransforms.data(),colors)
+		                   : cmd.idxMesh->setInstances(nb,instanceTransforms.data(),colors);
+		afterSort.vaoBinds += 2;
+		current_vao = 0;
+		if (!ok) {
+			std::cerr<<"Unable to set instances in draw list"<<std::endl;
+			return;
+		}
+		glBindVertexArray(cmd.vao);
+		afterSort.vaoBinds++;
+		STP3D_COUNT(binds,1);
+		if (cmd.mesh) {
+			cmd.mesh->drawInstanced(false);
+			cmd.mesh->clearInstances();
+		}
+		else {
+			cmd.idxMesh->drawInstanced(false);
+			cmd.idxMesh->clearInstances();
+		}
+		afterSort.vaoBinds += 2;
+		afterSort.drawCalls++;
+	}
+
+	size_t GLBI_DrawList::cullCommands() {
+		// Boxes in view space (modelview of the commands) against the planes of the projection
+		culler.clear();
+		culler.reserve(commands.size());
+		for(size_t i=0;i<commands.size();i++) {
+			const GLBI_Draw_Command& cmd = commands[i];
+			const BoundingBox& box = cmd.mesh ? cmd.mesh->bbox : (cmd.idxMesh ? cmd.idxMesh->bbox : BoundingBox());
+			// Commands without bounds are always drawn
+			if (box.isEmpty()) culler.addBox(Vector3D(0.0f),Vector3D(FLT_MAX));
+			else culler.addBox(box,cmd.modelview);
+		}
+		size_t nb_visible = culler.cull(engine.viewFrustum,visibility);
+		if (nb_visible == commands.size()) return 0;
+		size_t kept = 0;
+		for(size_t i=0;i<commands.size();i++) {
+			if (visibility[i]) commands[kept++] = commands[i];
+		}
+		commands.resize(kept);
+		return visibility.size()-kept;
+	}
+
+	void GLBI_DrawList::submit() {
+		GLBI_PROFILE_STAGE("draw list");
+		computeImmediateStats();
+		afterSort = GLBI_Draw_Stats();
+		if (frustumCulling) {
+			GLBI_PROFILE_STAGE("frustum culling");
+			afterSort.culled = cullCommands();
+		}
+		afterSort.commands = commands.size();
+		if (commands.empty()) return;
+
+		if (sortCommands) {
+			GLBI_PROFILE_STAGE("sort");
+			std::stable_sort(commands.begin(),commands.end(),[](const GLBI_Draw_Command& a,const GLBI_Draw_Command& b) {
+				return std::tie(a.shader,a.texture,a.vao) < std::tie(b.shader,b.texture,b.vao);
+			});
+		}
+
+		// Engine state restored at the end : immediate draws after submit are not affected by the commands
+		int saved_shader = engine.currentShader;
+		int saved_use_texture = engine.useTexture;
+		GLint saved_texture = 0;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D,&saved_texture);
+		engine.mvMatrixStack.pushMatrix();
+		unsigned int current_vao = 0;
+		unsigned int current_texture = (unsigned int)saved_texture;
+		bool first = true;
+
+		size_t i = 0;
+		while (i < commands.size()) {
+			const GLBI_Draw_Command& cmd = commands[i];
+			bool texturing_dirty = first;
+			if (cmd.shader != engine.currentShader) {
+				if (cmd.shader == 1) engine.switchToPhongShading();
+				else engine.switchToFlatShading();
+				afterSort.programChanges++;
+				texturing_dirty = true;
+			}
+			if (cmd.texture != current_texture) {
+				glBindTexture(GL_TEXTURE_2D,cmd.texture);
+				afterSort.textureChanges++;
+				STP3D_COUNT(binds,1);
+				current_texture = cmd.texture;
+				texturing_dirty = true;
+			}
+			// Texturing flag is a uniform of the current program (cached by the engine)
+			if (texturing_dirty && !engine.mode2D) engine.activateTexturing(cmd.texture != 0);
+			first = false;
+
+			// Material uniforms (cached by the engine)
+			if (cmd.shader == 1) {
+				engine.setSpecularColor(cmd.material.specular);
+				engine.setShininess(cmd.material.shininess);
+			}
+
+			// Run of draws sharing mesh and material
+			size_t last = i+1;
+			while ((last < commands.size()) && sameBatch(cmd,commands[last])) last++;
+			bool mergeable = mergeInstances && (last-i > 1);
+			for(size_t k=i;mergeable && (cmd.shader == 1) && (k<last);k++) {
+				mergeable = commands[k].modelview.isSimilarity();
+			}
+
+			if (mergeable) {
+				drawMerged(i,last,current_vao);
+			}
+			else {
+				for(size_t k=i;k<last;k++) {
+					const GLBI_Draw_Command& c = commands[k];
+					engine.mvMatrixStack.loadTransformation(c.modelview);
+					engine.updateMvMatrix();
+					engine.setFlatColor(c.material.color.x,c.material.color.y,c.material.color.z);
+					if (c.vao != current_vao) {
+						glBindVertexArray(c.vao);
+						afterSort.vaoBinds++;
+						STP3D_COUNT(binds,1);
+						current_vao = c.vao;
+					}
+					if (c.mesh) c.mesh->draw(false);
+					else c.idxMesh->draw(false);
+					afterSort.drawCalls++;
+				}
+			}
+			i = last;
+		}
+
+		if (current_vao != 0) {
+			glBindVertexArray(0);
+			afterSort.vaoBinds++;
+		}
+		if (engine.currentShader != saved_shader) {
+			if (saved_shader == 1) engine.switchToPhongShading();
+			else engine.switchToFlatShading();
+			afterSort.programChanges++;
+		}
+		if (current_texture != (unsigned int)saved_texture) {
+			glBindTexture(GL_TEXTURE_2D,saved_texture);
+			STP3D_COUNT(binds,1);
+		}
+		if (!engine.mode2D) engine.activateTexturing(saved_use_texture != 0);
+		engine.mvMatrixStack.popMatrix();
+		engine.updateMvMatrix();
+		commands.clear();
+	}
+
+}
@@ -1,76 +1,271 @@
 #include "glbasimac/glbi_engine.hpp"
+#include "glbasimac/glbi_profiler.hpp"
 #include "tools/shaders.hpp"
+#include "tools/instance_buffer.hpp"
+#include <cstdlib>
+#include <filesystem>
 using namespace glbasimac;
 using namespace STP3D;
 
 namespace glbasimac {
 
+	static const char* uniformNames[GLBI_NB_UNIFORMS] = {
+		"projectionMat","modelviewMat","normalMat",
+		"use_texture","tex0","c_spec","shininess"
+	};
+
+	static const char* attributeNames[GLBI_NB_ATTRIBUTES] = {
+		"vx_col","vx_nml"
+	};
+	/// Layout locations of these attributes in the engine shaders
+	static const int attributeLayout[GLBI_NB_ATTRIBUTES] = {3,1};
+
+	/// Type of each uniform, to send a cached value again
+	static const GLenum uniformTypes[GLBI_NB_UNIFORMS] = {
+		GL_FLOAT_MAT4,GL_FLOAT_MAT4,GL_FLOAT_MAT4,
+		GL_INT,GL_INT,GL_FLOAT_VEC3,GL_FLOAT
+	};
+
+	/// Vertex and fragment shaders of the 3D flat and phong programs, then of the 2D flat program
+	static const char* shaderFiles[3][2] = {
+		{"../assets/shaders/flat_shading_3D.vert","../assets/shaders/flat_shading.frag"},
+		{"../assets/shaders/phong_shading.vert","../assets/shaders/phong_shading.frag"},
+		{"../assets/shaders/flat_shading_2D.vert","../assets/shaders/flat_shading.frag"}
+	};
+
+	void GLBI_Program::resolveLocations(unsigned int id_program) {
+		id = id_program;
+		for(int i=0;i<GLBI_NB_UNIFORMS;i++) {
+			uniformLoc[i] = glGetUniformLocation(id,uniformNames[i]);
+		}
+		for(int i=0;i<GLBI_NB_ATTRIBUTES;i++) {
+			attribLoc[i] = glGetAttribLocation(id,attributeNames[i]);
+			// Optimized out of a variant (textured, no color) : constant values still go to the shared location
+			if (attribLoc[i] < 0) attribLoc[i] = attributeLayout[i];
+		}
+		// Connect the per-frame block (if used by this program) to its binding point
+		unsigned int id_block = glGetUniformBlockIndex(id,"GLBI_Frame");
+		if (id_block != GL_INVALID_INDEX) {
+			glUniformBlockBinding(id,id_block,GLBI_FRAME_BLOCK_BINDING);
+		}
+		invalidateValues();
+	}
+
+	void GLBI_Program::invalidateValues() {
+		for(int i=0;i<GLBI_NB_UNIFORMS;i++) uniformValue[i].clear();
+	}
+
+	std::string GLBI_Shader_Variant::defines() const {
+		std::string lines = "#define GLBI_VARIANT\n";
+		if (textured) lines += "#define TEXTURED\n";
+		if (specular) lines += "#define SPECULAR\n";
+		lines += "#define NUM_POINT_LIGHTS "+std::to_string(nbPointLights)+"\n";
+		lines += "#define NUM_DIR_LIGHTS "+std::to_string(nbDirLights)+"\n";
+		return lines;
+	}
+
+	std::string GLBI_Engine::shaderDefines() {
+		return "#define GLBI_MAX_LIGHTS "+std::to_string(GLBI_MAX_LIGHTS)+"\n";
+	}
+
 	void GLBI_Engine::initGL() {
 		std::cout<<"Initialisation of GL Engine"<<std::endl;
 
+		// Every program is requested before the first finish : their compilations overlap
+		bool use_variants = shaderVariants && !mode2D;
+		int requests[2];
 		if (mode2D) {
 			std::cerr<<"Flat 2D"<<std::endl;
-			idShader[0] = ShaderManager::loadShader("../assets/shaders/flat_shading_2D.vert","../assets/shaders/flat_shading.frag",true);
+			requests[0] = programCache.request(shaderFiles[2][0],shaderFiles[2][1],shaderDefines());
 		}
 		else {
-			std::cerr<<"Flat 3D"<<std::endl;
-			idShader[0] = ShaderManager::loadShader("../assets/shaders/flat_shading_3D.vert","../assets/shaders/flat_shading.frag",true);
-			std::cerr<<"Phong 3D"<<std::endl;
-			idShader[1] = ShaderManager::loadShader("../assets/shaders/phong_shading.vert","../assets/shaders/phong_shading.frag",true);
+			std::cerr<<"Flat 3D and Phong 3D"<<(use_variants ? " (variants)" : "")<<std::endl;
+			for(int i=0;i<2;i++) {
+				requests[i] = programCache.request(shaderFiles[i][0],shaderFiles[i][1],
+				                                   shaderDefines()+(use_variants ? variantFor(i).defines() : ""));
+			}
+		}
+		for(int i=0;i<(mode2D ? 1 : 2);i++) {
+			idShader[i] = programCache.finish(requests[i]);
+			if (idShader[i] == 0) {
+				// Nothing can be drawn without the engine programs (errors are printed by the cache)
+				std::cerr<<"Unable to build the engine programs. Unable to continue the program."<<std::endl;
+				exit(EXIT_FAILURE);
+			}
+			program[i].resolveLocations(idShader[i]);
+			if (use_variants) {
+				currentVariant[i] = variantFor(i).key();
+				variants[i][currentVariant[i]] = GLBI_Program();
+			}
 		}
+		std::cerr<<"Shaders : "<<programCache.nbHits<<" from cache, "<<programCache.nbCompiled<<" compiled"<<std::endl;
 		mvMatrixStack.loadIdentity();
+		// Values of instanced attributes for meshes drawn without instances : identity and no color
+		InstanceBuffer::setDefaultValues();
 		glUseProgram(idShader[0]);
 		if (!mode2D) {
-			glUniform1i(glGetUniformLocation(idShader[0],"use_texture"),useTexture);
+			// Per-frame uniform buffer, shared by flat and phong programs
+			glGenBuffers(1,&idFrameUBO);
+			glBindBuffer(GL_UNIFORM_BUFFER,idFrameUBO);
+			glBufferData(GL_UNIFORM_BUFFER,sizeof(GLBI_Frame_Block),NULL,GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_UNIFORM_BUFFER,0);
+			glBindBufferBase(GL_UNIFORM_BUFFER,GLBI_FRAME_BLOCK_BINDING,idFrameUBO);
+			frameDataDirty = true;
+			updateFrameData();
+
+			sendUniformInt(0,GLBI_U_USE_TEXTURE,useTexture);
 			glUseProgram(idShader[1]);
-			glUniform3fv(glGetUniformLocation(idShader[1],"attenuationFactor"),1,attFactors);
-			glUniform1f(glGetUniformLocation(idShader[1],"shininess"),0.0);
-			glUniform1i(glGetUniformLocation(idShader[1],"numOfLight"),numberOfLight);
-			glUniform1i(glGetUniformLocation(idShader[1],"use_texture"),useTexture);
+			sendUniformFloat(1,GLBI_U_SHININESS,0.0);
+			sendUniformInt(1,GLBI_U_USE_TEXTURE,useTexture);
 			glUseProgram(idShader[0]);
 		}
 		else {
-			glUniformMatrix4fv(glGetUniformLocation(idShader[currentShader],"modelviewMat"),1,GL_FALSE,mvMatrixStack.getTopGLMatrix());
+			sendUniformMatrix(currentShader,GLBI_U_MODELVIEW,mvMatrixStack.getTopGLMatrix());
+		}
+	}
+
+	bool GLBI_Engine::isUniformUpToDate(int ids,GLBI_Uniform u,const float* val,size_t nb_val) {
+		std::vector<float>& cached = program[ids].uniformValue[u];
+		if ((cached.size() == nb_val) && (memcmp(cached.data(),val,nb_val*sizeof(float)) == 0)) {
+			uploadStats.skipped++;
+			return true;
 		}
+		cached.assign(val,val+nb_val);
+		uploadStats.issued++;
+		STP3D_COUNT(uniform_uploads,1);
+		return false;
+	}
+
+	bool GLBI_Engine::sendUniformMatrix(int ids,GLBI_Uniform u,const float* mat) {
+		int loc = program[ids].uniformLoc[u];
+		if ((loc < 0) || isUniformUpToDate(ids,u,mat,16)) return false;
+		glUniformMatrix4fv(loc,1,GL_FALSE,mat);
+		return true;
+	}
+
+	bool GLBI_Engine::sendUniformVec3(int ids,GLBI_Uniform u,const float* val,int count) {
+		int loc = program[ids].uniformLoc[u];
+		if ((loc < 0) || isUniformUpToDate(ids,u,val,3*count)) return false;
+		glUniform3fv(loc,count,val);
+		return true;
+	}
+
+	bool GLBI_Engine::sendUniformVec4(int ids,GLBI_Uniform u,const float* val,int count) {
+		int loc = program[ids].uniformLoc[u];
+		if ((loc < 0) || isUniformUpToDate(ids,u,val,4*count)) return false;
+		glUniform4fv(loc,count,val);
+		return true;
+	}
+
+	bool GLBI_Engine::sendUniformFloat(int ids,GLBI_Uniform u,float val) {
+		int loc = program[ids].uniformLoc[u];
+		if ((loc < 0) || isUniformUpToDate(ids,u,&val,1)) return false;
+		glUniform1f(loc,val);
+		return true;
+	}
+
+	bool GLBI_Engine::sendUniformInt(int ids,GLBI_Uniform u,int val) {
+		int loc = program[ids].uniformLoc[u];
+		float f_val = (float)val;
+		if ((loc < 0) || isUniformUpToDate(ids,u,&f_val,1)) return false;
+		glUniform1i(loc,val);
+		return true;
 	}
 
 	void GLBI_Engine::setFlatColor(float r,float g,float b) {
-		glVertexAttrib3f(glGetAttribLocation(idShader[currentShader],"vx_col"),r,g,b);
+		// Current vertex attribute value is not cached : it is undefined after drawing a mesh with a color buffer
+		glVertexAttrib3f(program[currentShader].attribLoc[GLBI_A_COLOR],r,g,b);
+	}
+
+	void GLBI_Engine::updateFrameData() {
+		if (mode2D || !frameDataDirty) return;
+		memcpy(frameData.attenuationFactor,attFactors.val,3*sizeof(float));
+		frameData.numOfLight = numberOfLight;
+		// Point lights first, then directional lights : the order of the light loops in shader variants
+		int n = 0;
+		for(int pass=0;pass<2;pass++) {
+			for(int i=0;i<numberOfLight;i++) {
+				if ((lightPos[i].w > 0.0f) != (pass == 0)) continue;
+				memcpy(frameData.lightPos[n],lightPos[i].val,4*sizeof(float));
+				memcpy(frameData.lightIntensity[n],lightIntensity[i].val,3*sizeof(float));
+				n++;
+			}
+			if (pass == 0) nbPointLights = n;
+		}
+		nbDirLights = numberOfLight-nbPointLights;
+		// One upload for the whole frame state
+		glBindBuffer(GL_UNIFORM_BUFFER,idFrameUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER,0,sizeof(GLBI_Frame_Block),&frameData);
+		glBindBuffer(GL_UNIFORM_BUFFER,0);
+		uploadStats.issued++;
+		STP3D_COUNT(uniform_uploads,1);
+		STP3D_COUNT(buffer_bytes,sizeof(GLBI_Frame_Block));
+		frameDataDirty = false;
 	}
 
 	void GLBI_Engine::updateMvMatrix() {
-		glUniformMatrix4fv(glGetUniformLocation(idShader[currentShader],"modelviewMat"),1,GL_FALSE,mvMatrixStack.getTopGLMatrix());
+		updateFrameData();
+		selectVariant();
+		sendMvMatrix();
+	}
+
+	void GLBI_Engine::sendMvMatrix() {
+		// If the modelview did not change, the normal matrix did not change either
+		if (!sendUniformMatrix(currentShader,GLBI_U_MODELVIEW,mvMatrixStack.getTopGLMatrix())) return;
 		if (!mode2D) {
 			Matrix4D nmlMatrix = mvMatrixStack.getTopGLMatrix();
-			nmlMatrix.invert();
-			nmlMatrix.transpose();
-			glUniformMatrix4fv(glGetUniformLocation(idShader[currentShader],"normalMat"),1,GL_FALSE,nmlMatrix);
+			nmlMatrix.normalFromModelview();
+			sendUniformMatrix(currentShader,GLBI_U_NORMAL,nmlMatrix);
 		}
 	}
 
+	void GLBI_Engine::updateMvMatrix(GLBI_Transform_Node& node) {
+		updateFrameData();
+		mvMatrixStack.loadTransformation(node.getWorldMatrix());
+		selectVariant();
+		if (!sendUniformMatrix(currentShader,GLBI_U_MODELVIEW,mvMatrixStack.getTopGLMatrix())) return;
+		if (!mode2D) sendUniformMatrix(currentShader,GLBI_U_NORMAL,node.getNormalMatrix().mat);
+	}
+
 	void GLBI_Engine::set2DProjection(float xmin,float xmax,float ymin,float ymax) {
 		Matrix4D proj = Matrix4D::ortho2D(xmin,xmax,ymin,ymax);
-		glUniformMatrix4fv(glGetUniformLocation(idShader[currentShader],"projectionMat"),1,GL_FALSE,proj);
+		projectionMatrix = proj;
+		viewFrustum.extract(proj);
+		sendUniformMatrix(currentShader,GLBI_U_PROJECTION,proj);
 	}
 
 	void GLBI_Engine::set3DProjection(float fov,float ratio,float z_near,float z_far) {
 		Matrix4D proj = Matrix4D::perspective(fov,ratio,z_near,z_far);
-		glUseProgram(idShader[0]);
-		glUniformMatrix4fv(glGetUniformLocation(idShader[0],"projectionMat"),1,GL_FALSE,proj);
-		if (!mode2D) {
-			glUseProgram(idShader[1]);
-			glUniformMatrix4fv(glGetUniformLocation(idShader[1],"projectionMat"),1,GL_FALSE,proj);
-			glUseProgram(idShader[currentShader]);
+		projectionFov = fov;
+		projectionRatio = ratio;
+		projectionMatrix = proj;
+		viewFrustum.extract(proj);
+		if (mode2D) {
+			sendUniformMatrix(currentShader,GLBI_U_PROJECTION,proj);
+		}
+		else {
+			proj.get(frameData.projectionMat);
+			frameDataDirty = true;
 		}
 	}
 
+	bool GLBI_Engine::isVisible(const BoundingBox& box) {
+		// Meshes without bounds are always drawn
+		if (box.isEmpty()) return true;
+		Vector3D center,extent;
+		transformBox(box,mvMatrixStack.stack.back(),center,extent);
+		bool visible = viewFrustum.testBox(center,extent);
+		if (visible) cullStats.visible++;
+		else cullStats.culled++;
+		return visible;
+	}
+
 	void GLBI_Engine::setViewMatrix(const Matrix4D& mat) {
 		viewMatrix = mat;
-		// Mettre le uniform dans le shader correspondant.
+		// Stored in the per-frame block, shared by all programs
 		if (!mode2D) {
-			glUseProgram(idShader[1]);
-			glUniformMatrix4fv(glGetUniformLocation(idShader[1],"viewMatrix"),1,GL_FALSE,viewMatrix);
-			glUseProgram(idShader[currentShader]);
+			viewMatrix.get(frameData.viewMatrix);
+			frameDataDirty = true;
 		}
 		mvMatrixStack.addTransformation(mat);
 	}
@@ -79,8 +274,9 @@ namespace glbasimac {
 		useTexture = use_texture;
 		glActiveTexture(GL_TEXTURE0);
 		if (!mode2D) {
-			glUniform1i(glGetUniformLocation(idShader[currentShader],"tex0"),0);
-			glUniform1i(glGetUniformLocation(idShader[currentShader],"use_texture"),useTexture);
+			selectVariant();
+			sendUniformInt(currentShader,GLBI_U_TEX0,0);
+			sendUniformInt(currentShader,GLBI_U_USE_TEXTURE,useTexture);
 		}
 		else {
 			std::cerr<<"Unable to use texturing in 2D mode"<<std::endl;
@@ -90,6 +286,8 @@ namespace glbasimac {
 	void GLBI_Engine::switchToFlatShading() {
 		currentShader = 0;
 		glUseProgram(idShader[0]);
+		STP3D_COUNT(binds,1);
+		selectVariant();
 	}
 
 	void GLBI_Engine::switchToPhongShading() {
@@ -99,29 +297,80 @@ namespace glbasimac {
 		else {
 			currentShader = 1;
 			glUseProgram(idShader[1]);
+			STP3D_COUNT(binds,1);
+			selectVariant();
+		}
+	}
+
+	GLBI_Shader_Variant GLBI_Engine::variantFor(int ids) const {
+		GLBI_Shader_Variant variant;
+		variant.textured = (useTexture != 0);
+		// Flat shading ignores material and lights
+		if (ids == 1) {
+			variant.specular = (shininess > 0.0f);
+			variant.nbPointLights = nbPointLights;
+			variant.nbDirLights = nbDirLights;
+		}
+		return variant;
+	}
+
+	unsigned int GLBI_Engine::buildVariant(int ids,const GLBI_Shader_Variant& variant) {
+		unsigned int id = programCache.finish(programCache.request(shaderFiles[ids][0],shaderFiles[ids][1],shaderDefines()+variant.defines()));
+		if (!id) std::cerr<<"Unable to build shader variant "<<variant.key()<<" of "<<shaderFiles[ids][1]<<std::endl;
+		return id;
+	}
+
+	void GLBI_Engine::selectVariant() {
+		if (mode2D || !shaderVariants || (currentShader > 1)) return;
+		int ids = currentShader;
+		GLBI_Shader_Variant variant = variantFor(ids);
+		unsigned int key = variant.key();
+		if (key == currentVariant[ids]) return;
+
+		// The program in use goes back to its table entry, with its uniform cache
+		std::map<unsigned int,GLBI_Program>& table = variants[ids];
+		std::swap(program[ids],table[currentVariant[ids]]);
+		std::map<unsigned int,GLBI_Program>::iterator it = table.find(key);
+		if (it == table.end()) {
+			// First use : compiled now, or loaded from the program binary cache
+			it = table.insert(std::make_pair(key,GLBI_Program())).first;
+			it->second.resolveLocations(buildVariant(ids,variant));
+		}
+		std::swap(program[ids],it->second);
+		currentVariant[ids] = key;
+		idShader[ids] = program[ids].id;
+		glUseProgram(idShader[ids]);
+		STP3D_COUNT(binds,1);
+
+		// State already sent to the previous variant (uploads are skipped if this one has it)
+		sendUniformInt(ids,GLBI_U_TEX0,0);
+		if (ids == 1) {
+			sendUniformFloat(1,GLBI_U_SHININESS,shininess);
+			sendUniformVec3(1,GLBI_U_C_SPEC,specularColor.val);
 		}
+		sendMvMatrix();
 	}
 
 	void GLBI_Engine::setLightPosition(const Vector4D& light_pos,int num_light) {
-		if (mode2D || currentShader == 0) {
-			std::cerr<<"Unable to set light position in 2D mode or in Flat shading"<<std::endl;
+		if (mode2D) {
+			std::cerr<<"Unable to set light position in 2D mode"<<std::endl;
 		}
 		else {
 			if (num_light<numberOfLight) {
 				lightPos[num_light] = light_pos;
-				glUniform4fv(glGetUniformLocation(idShader[currentShader],"lightPos"),numberOfLight,&lightPos[0][0]);
+				frameDataDirty = true;
 			}
 		}
 	}
 
 	void GLBI_Engine::setLightIntensity(const Vector3D& light_intensity,int num_light) {
-		if (mode2D || currentShader == 0) {
-			std::cerr<<"Unable to set light position in 2D mode or in Flat shading"<<std::endl;
+		if (mode2D) {
+			std::cerr<<"Unable to set light intensity in 2D mode"<<std::endl;
 		}
 		else {
 			if (num_light<numberOfLight) {
 				lightIntensity[num_light] = light_intensity;
-				glUniform3fv(glGetUniformLocation(idShader[currentShader],"lightIntensity"),numberOfLight,&lightIntensity[0][0]);
+				frameDataDirty = true;
 			}
 		}
 	}
@@ -131,17 +380,17 @@ namespace glbasimac {
 			std::cerr<<"Unable to set light position in 2D mode or in Flat shading"<<std::endl;
 		}
 		else {
-			glVertexAttrib3f(glGetAttribLocation(idShader[currentShader],"vx_nml"),nml.x,nml.y,nml.z);
+			glVertexAttrib3f(program[currentShader].attribLoc[GLBI_A_NORMAL],nml.x,nml.y,nml.z);
 		}
 	}
 
 	void GLBI_Engine::setAttenuationFactor(const Vector3D& factors) {
-		if (mode2D || currentShader == 0) {
-			std::cerr<<"Unable to set light position in 2D mode or in Flat shading"<<std::endl;
+		if (mode2D) {
+			std::cerr<<"Unable to set attenuation factors in 2D mode"<<std::endl;
 		}
 		else {
 			attFactors = factors;
-			glUniform3fv(glGetUniformLocation(idShader[1],"attenuationFactor"),1,attFactors);
+			frameDataDirty = true;
 		}
 	}
 
@@ -149,13 +398,14 @@ namespace glbasimac {
 		if (mode2D) {
 			std::cerr<<"Unable to add light in 2D mode"<<std::endl;
 		}
+		else if (numberOfLight >= GLBI_MAX_LIGHTS) {
+			std::cerr<<"Unable to add light : maximum number of lights ("<<GLBI_MAX_LIGHTS<<") reached"<<std::endl;
+		}
 		else {
 			numberOfLight++;
 			lightPos.push_back(light_pos);
 			lightIntensity.push_back(light_intensity);
-			glUseProgram(idShader[1]);
-			glUniform1i(glGetUniformLocation(idShader[1],"numOfLight"),numberOfLight);
-			glUseProgram(idShader[currentShader]);
+			frameDataDirty = true;
 		}
 	}
 
@@ -164,7 +414,10 @@ namespace glbasimac {
 			std::cerr<<"Unable to set shininess in 2D mode or in Flat shading"<<std::endl;
 		}
 		else {
-			glUniform1f(glGetUniformLocation(idShader[1],"shininess"),new_shininess);
+			// Switching specular on or off changes the variant
+			shininess = new_shininess;
+			selectVariant();
+			sendUniformFloat(1,GLBI_U_SHININESS,shininess);
 		}
 	}
 
@@ -173,9 +426,113 @@ namespace glbasimac {
 			std::cerr<<"Unable to set shininess in 2D mode or in Flat shading"<<std::endl;
 		}
 		else {
-			glUniform3fv(glGetUniformLocation(idShader[1],"c_spec"),1,c_spec.val);
+			specularColor = c_spec;
+			sendUniformVec3(1,GLBI_U_C_SPEC,specularColor.val);
 		}
 	}
 
+	bool GLBI_Engine::enableShaderReload(const std::string& directory) {
+		if (!shaderWatcher.start(directory)) return false;
+		std::cerr<<"Shader reload : watching "<<directory<<std::endl;
+		if (!programCache.compilesInBackground()) {
+			std::cerr<<"Shader reload : no parallel shader compilation, frames will stall while programs are rebuilt"<<std::endl;
+		}
+		return true;
+	}
+
+	void GLBI_Engine::requestReload(int ids) {
+		const char** files = shaderFiles[mode2D ? 2 : ids];
+		Shader_Reload reload;
+		reload.ids = ids;
+		reload.started = true;
+		if (mode2D || !shaderVariants) {
+			reload.key = 0;
+			reload.request = programCache.request(files[0],files[1],shaderDefines());
+			reloads.push_back(reload);
+			return;
+		}
+		// Every compiled variant : the one in use and the ones stored in the table
+		std::map<unsigned int,GLBI_Program>::iterator it;
+		for(it=variants[ids].begin();it!=variants[ids].end();++it) {
+			if ((it->first != currentVariant[ids]) && !it->second.id) continue;
+			reload.key = it->first;
+			reload.request = programCache.request(files[0],files[1],shaderDefines()+GLBI_Shader_Variant::fromKey(it->first).defines());
+			reloads.push_back(reload);
+		}
+	}
+
+	unsigned int GLBI_Engine::pollShaderReload() {
+		GLBI_PROFILE_STAGE("shader reload");
+		std::vector<std::string> changed;
+		if (shaderWatcher.changedFiles(changed)) {
+			for(int ids=0;ids<(mode2D ? 1 : 2);ids++) {
+				const char** files = shaderFiles[mode2D ? 2 : ids];
+				bool modified = false;
+				for(size_t i=0;i<changed.size();i++) {
+					for(int f=0;f<2;f++) modified |= (std::filesystem::path(files[f]).filename().string() == changed[i]);
+				}
+				if (modified) {
+					std::cerr<<"Shader reload : "<<files[0]<<" "<<files[1]<<std::endl;
+					requestReload(ids);
+				}
+			}
+		}
+
+		unsigned int nb_replaced = 0;
+		for(size_t i=0;i<reloads.size();) {
+			Shader_Reload& reload = reloads[i];
+			if (reload.started || !programCache.isReady(reload.request)) {
+				reload.started = false;
+				i++;
+				continue;
+			}
+			unsigned int id = programCache.finish(reload.request);
+			// The variant may have been swapped in or out of program[ids] since the request
+			GLBI_Program* target = nullptr;
+			if (mode2D || !shaderVariants || (reload.key == currentVariant[reload.ids])) {
+				target = &program[reload.ids];
+			}
+			else {
+				std::map<unsigned int,GLBI_Program>::iterator it = variants[reload.ids].find(reload.key);
+				if (it != variants[reload.ids].end()) target = &it->second;
+			}
+			if (!id) {
+				std::cerr<<"Shader reload failed : previous program kept"<<std::endl;
+			}
+			else if (target) {
+				replaceProgram(*target,id);
+				nb_replaced++;
+			}
+			else {
+				glDeleteProgram(id);
+			}
+			reloads.erase(reloads.begin()+i);
+		}
+		if (nb_replaced) {
+			for(int ids=0;ids<(mode2D ? 1 : 2);ids++) idShader[ids] = program[ids].id;
+			glUseProgram(idShader[currentShader]);
+		}
+		return nb_replaced;
+	}
+
+	void GLBI_Engine::replaceProgram(GLBI_Program& target,unsigned int id_program) {
+		GLBI_Program fresh;
+		fresh.resolveLocations(id_program);
+		glUseProgram(id_program);
+		for(int u=0;u<GLBI_NB_UNIFORMS;u++) {
+			const std::vector<float>& val = target.uniformValue[u];
+			int loc = fresh.uniformLoc[u];
+			if (val.empty() || (loc < 0)) continue;
+			switch (uniformTypes[u]) {
+				case GL_FLOAT_MAT4 : glUniformMatrix4fv(loc,1,GL_FALSE,val.data()); break;
+				case GL_FLOAT_VEC3 : glUniform3fv(loc,GLsizei(val.size()/3),val.data()); break;
+				case GL_FLOAT : glUniform1f(loc,val[0]); break;
+				default : glUniform1i(loc,int(val[0]));
+			}
+			fresh.uniformValue[u] = val;
+		}
+		glDeleteProgram(target.id);
+		std::swap(target,fresh);
+	}
 
 }
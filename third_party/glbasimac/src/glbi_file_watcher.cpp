@@ -0,0 +1,96 @@
+#include "glbasimac/glbi_file_watcher.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace glbasimac {
+
+	bool GLBI_File_Watcher::start(const std::string& dir) {
+		stop();
+		std::error_code error;
+		if (!std::filesystem::is_directory(dir,error)) {
+			std::cerr<<"Unable to watch "<<dir<<" : not a directory"<<std::endl;
+			return false;
+		}
+		directory = dir;
+		running = true;
+#ifdef __linux__
+		int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if ((fd >= 0) && (inotify_add_watch(fd,dir.c_str(),IN_CLOSE_WRITE | IN_MOVED_TO) >= 0)) {
+			worker = std::thread(&GLBI_File_Watcher::watchNotifications,this,fd);
+			return true;
+		}
+		std::cerr<<"inotify unavailable, "<<dir<<" is polled every "<<pollInterval<<" ms"<<std::endl;
+		if (fd >= 0) close(fd);
+#endif
+		worker = std::thread(&GLBI_File_Watcher::watchTimes,this);
+		return true;
+	}
+
+	void GLBI_File_Watcher::stop() {
+		running = false;
+		if (worker.joinable()) worker.join();
+	}
+
+	bool GLBI_File_Watcher::changedFiles(std::vector<std::string>& files) {
+		files.clear();
+		std::lock_guard<std::mutex> lock(mutex);
+		files.swap(changed);
+		return !files.empty();
+	}
+
+	void GLBI_File_Watcher::push(const std::string& name) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (std::find(changed.begin(),changed.end(),name) == changed.end()) changed.push_back(name);
+	}
+
+	void GLBI_File_Watcher::watchNotifications(int fd) {
+#ifdef __linux__
+		alignas(inotify_event) char buffer[4096];
+		pollfd pfd = {fd,POLLIN,0};
+		while (running) {
+			// Short timeout : stop() is noticed quickly
+			if (poll(&pfd,1,100) <= 0) continue;
+			ssize_t length;
+			while ((length = read(fd,buffer,sizeof(buffer))) > 0) {
+				for(char* p=buffer;p<buffer+length;) {
+					const inotify_event* event = (const inotify_event*)p;
+					if (event->len > 0) push(event->name);
+					p += sizeof(inotify_event)+event->len;
+				}
+			}
+		}
+		close(fd);
+#else
+		(void)fd;
+#endif
+	}
+
+	void GLBI_File_Watcher::watchTimes() {
+		std::map<std::string,std::filesystem::file_time_type> times;
+		bool first = true;
+		while (running) {
+			std::error_code error;
+			for(std::filesystem::directory_iterator it(directory,error),end;!error && (it != end);it.increment(error)) {
+				if (!it->is_regular_file(error)) continue;
+				std::string name = it->path().filename().string();
+				std::filesystem::file_time_type time = it->last_write_time(error);
+				std::map<std::string,std::filesystem::file_time_type>::iterator known = times.find(name);
+				if ((known == times.end()) || (known->second != time)) {
+					// Files found by the first scan are the reference state
+					if (!first) push(name);
+					times[name] = time;
+				}
+			}
+			first = false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(pollInterval));
+		}
+	}
+
+}
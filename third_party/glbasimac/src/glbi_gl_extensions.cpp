@@ -0,0 +1,36 @@
+#include "glbasimac/glbi_gl_extensions.hpp"
+#include <cstring>
+#include "tools/gl_tools.hpp"
+#define GLFW_INCLUDE_NONE
+#include "GLFW/glfw3.h"
+#ifdef GLBI_HAS_EGL
+#include <EGL/egl.h>
+#endif
+
+namespace glbasimac {
+
+	void* glbiGetProcAddress(const char* name) {
+#ifdef GLBI_HAS_EGL
+		if (eglGetCurrentContext() != EGL_NO_CONTEXT) return (void*)eglGetProcAddress(name);
+#endif
+		return (void*)glfwGetProcAddress(name);
+	}
+
+	bool glbiHasExtension(const char* name) {
+		GLint nb_ext = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS,&nb_ext);
+		for(GLint i=0;i<nb_ext;i++) {
+			const char* ext = (const char*)glGetStringi(GL_EXTENSIONS,i);
+			if (ext && !strcmp(ext,name)) return true;
+		}
+		return false;
+	}
+
+	bool glbiHasVersion(int major,int minor) {
+		GLint ctx_major = 0,ctx_minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION,&ctx_major);
+		glGetIntegerv(GL_MINOR_VERSION,&ctx_minor);
+		return (ctx_major > major) || ((ctx_major == major) && (ctx_minor >= minor));
+	}
+
+}
@@ -0,0 +1,161 @@
+#include "glbasimac/glbi_headless.hpp"
+#define GLFW_INCLUDE_NONE
+#include "GLFW/glfw3.h"
+#ifdef GLBI_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace glbasimac {
+
+	bool GLBI_Headless_Context::create(int w,int h,GLBI_Context_API api) {
+		destroy();
+		if ((api == GLBI_CONTEXT_AUTO) || (api == GLBI_CONTEXT_EGL)) {
+			if (createEGL()) return true;
+			if (api == GLBI_CONTEXT_EGL) {
+				std::cerr<<"Unable to create an EGL surfaceless context"<<std::endl;
+				return false;
+			}
+		}
+		return createGLFW(w,h,api);
+	}
+
+	bool GLBI_Headless_Context::createEGL() {
+#ifdef GLBI_HAS_EGL
+		// Surfaceless platform of Mesa : no window system at all
+		EGLDisplay display = EGL_NO_DISPLAY;
+		PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (get_platform_display) display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,EGL_DEFAULT_DISPLAY,NULL);
+		if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		EGLint major,minor;
+		if ((display == EGL_NO_DISPLAY) || !eglInitialize(display,&major,&minor)) return false;
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			eglTerminate(display);
+			return false;
+		}
+		EGLint config_attribs[] = {EGL_RENDERABLE_TYPE,EGL_OPENGL_BIT,EGL_NONE};
+		EGLConfig config = 0;
+		EGLint nb_configs = 0;
+		eglChooseConfig(display,config_attribs,&config,1,&nb_configs);
+		EGLint context_attribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION,4,EGL_CONTEXT_MINOR_VERSION,1,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK,EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,EGL_NONE
+		};
+		// Without surface, a context without config is fine (EGL_KHR_no_config_context)
+		EGLContext context = eglCreateContext(display,nb_configs ? config : (EGLConfig)0,EGL_NO_CONTEXT,context_attribs);
+		if ((context == EGL_NO_CONTEXT) || !eglMakeCurrent(display,EGL_NO_SURFACE,EGL_NO_SURFACE,context)) {
+			if (context != EGL_NO_CONTEXT) eglDestroyContext(display,context);
+			eglTerminate(display);
+			return false;
+		}
+		eglDisplay = display;
+		eglContext = context;
+		if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+			std::cerr<<"Unable to load GL functions for headless rendering"<<std::endl;
+			destroy();
+			return false;
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	bool GLBI_Headless_Context::createGLFW(int w,int h,GLBI_Context_API api) {
+		if (!glfwInit()) {
+			std::cerr<<"Unable to initialize GLFW for headless rendering"<<std::endl;
+			return false;
+		}
+		glfwDefaultWindowHints();
+		glfwWindowHint(GLFW_VISIBLE,GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR,4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR,1);
+		glfwWindowHint(GLFW_OPENGL_PROFILE,GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT,GLFW_TRUE);
+		if (api == GLBI_CONTEXT_OSMESA) glfwWindowHint(GLFW_CONTEXT_CREATION_API,GLFW_OSMESA_CONTEXT_API);
+		window = glfwCreateWindow(w,h,"glbasimac headless",nullptr,nullptr);
+		glfwDefaultWindowHints();
+		if (!window) {
+			std::cerr<<"Unable to create a headless GL context"<<std::endl;
+			return false;
+		}
+		glfwMakeContextCurrent(window);
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+			std::cerr<<"Unable to load GL functions for headless rendering"<<std::endl;
+			destroy();
+			return false;
+		}
+		return true;
+	}
+
+	void GLBI_Headless_Context::destroy() {
+		if (window) glfwDestroyWindow(window);
+		window = nullptr;
+#ifdef GLBI_HAS_EGL
+		if (eglContext) {
+			eglMakeCurrent((EGLDisplay)eglDisplay,EGL_NO_SURFACE,EGL_NO_SURFACE,EGL_NO_CONTEXT);
+			eglDestroyContext((EGLDisplay)eglDisplay,(EGLContext)eglContext);
+			eglTerminate((EGLDisplay)eglDisplay);
+		}
+#endif
+		eglDisplay = eglContext = nullptr;
+	}
+
+	const char* GLBI_Headless_Context::apiName() const {
+		if (eglContext) return "EGL surfaceless";
+		if (window) return "GLFW";
+		return "none";
+	}
+
+	bool GLBI_Headless::init(int w,int h,GLBI_Context_API api,unsigned int readback_depth,bool create_context) {
+		if (create_context && !context.create(w,h,api)) return false;
+		if (!target.create(w,h)) return false;
+		if (!readback.init(w,h,readback_depth)) {
+			std::cerr<<"Unable to create readback buffers"<<std::endl;
+			return false;
+		}
+		nbFrames = 0;
+		return true;
+	}
+
+	void GLBI_Headless::beginFrame() {
+		target.bind();
+	}
+
+	void GLBI_Headless::endFrame(const std::string& filename) {
+		nbFrames++;
+		if (filename.empty()) return;
+		// Oldest frames are collected as soon as they are ready, and waited for only if no buffer is free
+		while (readback.pending() && collect(false));
+		if (readback.full()) collect(true);
+		readback.request(nbFrames-1);
+		filenames.push_back(filename);
+	}
+
+	bool GLBI_Headless::collect(bool wait) {
+		long frame_id;
+		unsigned int nb_pending = readback.pending();
+		if (!readback.retrieve(pixels,frame_id,wait)) {
+			// A frame lost (wait failed, map failed) still frees its slot : keep file names in sync with pending frames
+			if (readback.pending() < nb_pending) filenames.pop_front();
+			return false;
+		}
+		writer.push(filenames.front(),format,readback.width,readback.height,4,pixels);
+		filenames.pop_front();
+		return true;
+	}
+
+	void GLBI_Headless::finish() {
+		while (readback.pending()) collect(true);
+		writer.flush();
+	}
+
+	void GLBI_Headless::release() {
+		finish();
+		target.release();
+		readback.release();
+		context.destroy();
+	}
+
+}
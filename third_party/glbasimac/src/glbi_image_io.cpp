@@ -0,0 +1,123 @@
+#include "glbasimac/glbi_image_io.hpp"
+#include <cstdio>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_STATIC
+#include "stb_image_write.h"
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_STATIC
+#include "stb_image.h"
+
+namespace glbasimac {
+
+	static bool writePPM(const std::string& filename,int w,int h,int channels,const unsigned char* pixels,bool bottom_up) {
+		FILE* f = fopen(filename.c_str(),"wb");
+		if (!f) return false;
+		fprintf(f,"P6\n%d %d\n255\n",w,h);
+		std::vector<unsigned char> row(3*w);
+		bool ok = true;
+		for(int j=0;ok && (j<h);j++) {
+			const unsigned char* src = pixels+size_t(channels)*w*(bottom_up ? h-1-j : j);
+			for(int i=0;i<w;i++) {
+				row[3*i] = src[channels*i];
+				row[3*i+1] = src[channels*i+1];
+				row[3*i+2] = src[channels*i+2];
+			}
+			ok = (fwrite(row.data(),1,row.size(),f) == row.size());
+		}
+		return (fclose(f) == 0) && ok;
+	}
+
+	bool glbiWriteImage(const std::string& filename,GLBI_Image_Format format,int w,int h,int channels,
+	                    const unsigned char* pixels,bool bottom_up) {
+		bool ok = false;
+		if ((channels == 3) || (channels == 4)) {
+			if (format == GLBI_IMAGE_PPM) {
+				ok = writePPM(filename,w,h,channels,pixels,bottom_up);
+			}
+			else {
+				// A negative stride starting on the last row flips the image without copy
+				int stride = channels*w;
+				if (bottom_up) ok = stbi_write_png(filename.c_str(),w,h,channels,pixels+size_t(stride)*(h-1),-stride);
+				else ok = stbi_write_png(filename.c_str(),w,h,channels,pixels,stride);
+			}
+		}
+		if (!ok) std::cerr<<"Unable to write image "<<filename<<std::endl;
+		return ok;
+	}
+
+	bool glbiReadImage(const std::string& filename,int& w,int& h,int& channels,std::vector<unsigned char>& pixels,
+	                   bool bottom_up) {
+		// The flag is per thread : decoders running in parallel do not interfere
+		stbi_set_flip_vertically_on_load_thread(bottom_up ? 1 : 0);
+		unsigned char* data = stbi_load(filename.c_str(),&w,&h,&channels,0);
+		if (!data) {
+			std::cerr<<"Unable to read image "<<filename<<" ("<<stbi_failure_reason()<<")"<<std::endl;
+			return false;
+		}
+		pixels.assign(data,data+size_t(w)*h*channels);
+		stbi_image_free(data);
+		return true;
+	}
+
+	GLBI_Image_Writer::GLBI_Image_Writer(unsigned int nb_threads)
+		:nbWritten(0),nbFailed(0),nbBusy(0),stopping(false) {
+		if (nb_threads == 0) nb_threads = 1;
+		for(unsigned int i=0;i<nb_threads;i++) workers.push_back(std::thread(&GLBI_Image_Writer::work,this));
+	}
+
+	GLBI_Image_Writer::~GLBI_Image_Writer() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		jobAdded.notify_all();
+		for(size_t i=0;i<workers.size();i++) workers[i].join();
+	}
+
+	void GLBI_Image_Writer::push(const std::string& filename,GLBI_Image_Format format,int w,int h,int channels,
+	                             std::vector<unsigned char>& pixels,bool bottom_up) {
+		Job job;
+		job.filename = filename;
+		job.format = format;
+		job.w = w;
+		job.h = h;
+		job.channels = channels;
+		job.bottomUp = bottom_up;
+		job.pixels.swap(pixels);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(job));
+			nbBusy++;
+		}
+		jobAdded.notify_one();
+	}
+
+	void GLBI_Image_Writer::flush() {
+		std::unique_lock<std::mutex> lock(mutex);
+		jobDone.wait(lock,[this]() {return nbBusy == 0;});
+	}
+
+	size_t GLBI_Image_Writer::pending() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return nbBusy;
+	}
+
+	void GLBI_Image_Writer::work() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			jobAdded.wait(lock,[this]() {return stopping || !jobs.empty();});
+			if (jobs.empty()) return; // Stopping and nothing left to write
+			Job job = std::move(jobs.front());
+			jobs.pop_front();
+			lock.unlock();
+			bool ok = glbiWriteImage(job.filename,job.format,job.w,job.h,job.channels,job.pixels.data(),job.bottomUp);
+			lock.lock();
+			if (ok) nbWritten++;
+			else nbFailed++;
+			nbBusy--;
+			jobDone.notify_all();
+		}
+	}
+
+}
@@ -0,0 +1,130 @@
+#include "glbasimac/glbi_lod.hpp"
+#include "tools/basic_mesh.hpp"
+#include "tools/mesh_simplifier.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace glbasimac {
+
+	void GLBI_LOD_Selector::update(const GLBI_Engine& engine,int viewport_height) {
+		if (viewport_height <= 0) {
+			int viewport[4];
+			glGetIntegerv(GL_VIEWPORT,viewport);
+			viewport_height = viewport[3];
+		}
+		// Projected size of one unit at distance 1 : height / (2 tan(fov/2))
+		float half_fov = 0.5f*engine.projectionFov*float(M_PI)/180.0f;
+		pixelsPerUnit = (half_fov > 0.0f) ? 0.5f*viewport_height/std::tan(half_fov) : 0.0f;
+		nbTriangles = 0;
+	}
+
+	float GLBI_LOD_Selector::projectedError(const GLBI_LOD_Mesh& lod,unsigned int level,const Matrix4D& modelview) const {
+		const float* m = modelview.mat;
+		// Depth of the center in view space, scale of the model transformation
+		float depth = -(m[2]*lod.center.x+m[6]*lod.center.y+m[10]*lod.center.z+m[14]);
+		float scale = 0.0f;
+		for(int col=0;col<3;col++) {
+			scale = std::max(scale,std::sqrt(m[4*col]*m[4*col]+m[4*col+1]*m[4*col+1]+m[4*col+2]*m[4*col+2]));
+		}
+		// Nearest point of the bounding sphere
+		float distance = depth-scale*lod.radius;
+		if (depth+scale*lod.radius < 0.0f) return 0.0f;       // Behind the camera
+		if (distance <= 1e-4f) return HUGE_VALF;               // Camera inside the bounding sphere
+		return lod.levels[level].error*scale*pixelsPerUnit/distance;
+	}
+
+	unsigned int GLBI_LOD_Selector::select(const GLBI_LOD_Mesh& lod,const Matrix4D& modelview) const {
+		if (lod.levels.empty() || (pixelsPerUnit <= 0.0f)) return 0;
+		unsigned int level = lod.nbLevels()-1;
+		while ((level > 0) && (projectedError(lod,level,modelview) > pixelError)) level--;
+		return level;
+	}
+
+	bool GLBI_LOD_Mesh::buildSphere(float sphere_radius,unsigned int nb_div,unsigned int nb_levels) {
+		release();
+		for(unsigned int l=0;l<nb_levels;l++,nb_div/=2) {
+			if (nb_div < 4) break;
+			// Largest distance to the sphere : center of a facet, half a step away in latitude and longitude
+			float error = sphere_radius*(1.0f-std::cos(float(M_PI)/(2*nb_div))*std::cos(float(M_PI)/nb_div));
+			addLevel(basicSphere(sphere_radius,nb_div,nb_div),error);
+		}
+		return !levels.empty();
+	}
+
+	bool GLBI_LOD_Mesh::buildCylinder(float h,float cyl_radius,unsigned int div_round,unsigned int div_height,unsigned int nb_levels) {
+		release();
+		for(unsigned int l=0;l<nb_levels;l++,div_round/=2) {
+			if (div_round < 4) break;
+			float error = cyl_radius*(1.0f-std::cos(float(M_PI)/div_round));
+			addLevel(basicCylinder(h,cyl_radius,div_round,std::max(1u,div_height>>l)),error);
+		}
+		return !levels.empty();
+	}
+
+	bool GLBI_LOD_Mesh::buildFromMesh(IndexedMesh* mesh,unsigned int nb_levels,float ratio) {
+		release();
+		addLevel(mesh,0.0f);
+		for(unsigned int l=1;l<nb_levels;l++) {
+			unsigned int nb_prev = levels.back().mesh->nb_primitive;
+			unsigned int target = (unsigned int)(nb_prev*ratio);
+			if (target < 4) break;
+			// From the full detail mesh : errors are measured against it
+			float error = 0.0f;
+			IndexedMesh* simplified = simplifyMesh(*mesh,target,FLT_MAX,&error);
+			if (!simplified) return false;
+			// Not simplified enough (locked seams or borders) : stop the chain
+			if (simplified->nb_primitive > nb_prev-(nb_prev-target)/2) {
+				delete simplified;
+				break;
+			}
+			addLevel(simplified,error);
+		}
+		return true;
+	}
+
+	void GLBI_LOD_Mesh::addLevel(IndexedMesh* mesh,float error) {
+		GLBI_LOD_Level level = {mesh,error};
+		levels.push_back(level);
+		if (levels.size() > 1) return;
+		// Bounding sphere of the full detail level : center of the box, farthest vertex
+		const float* pos = NULL;
+		for(size_t b=0;b<mesh->buffers.size();b++) {
+			if ((mesh->attr_id[b] == 0) && (mesh->size_one_elt[b] == 3)) pos = mesh->buffers[b];
+		}
+		if (!pos || (mesh->nb_elts == 0)) return;
+		Vector3D pmin(pos[0],pos[1],pos[2]),pmax(pmin);
+		for(unsigned int v=1;v<mesh->nb_elts;v++) {
+			for(int c=0;c<3;c++) {
+				pmin[c] = std::min(pmin[c],pos[3*v+c]);
+				pmax[c] = std::max(pmax[c],pos[3*v+c]);
+			}
+		}
+		center = (pmin+pmax)*0.5f;
+		radius = 0.0f;
+		for(unsigned int v=0;v<mesh->nb_elts;v++) {
+			radius = std::max(radius,(Vector3D(pos[3*v],pos[3*v+1],pos[3*v+2])-center).norme());
+		}
+	}
+
+	bool GLBI_LOD_Mesh::createVAOs() {
+		for(size_t l=0;l<levels.size();l++) {
+			if (!levels[l].mesh->createVAO()) return false;
+		}
+		return true;
+	}
+
+	void GLBI_LOD_Mesh::release() {
+		for(size_t l=0;l<levels.size();l++) delete levels[l].mesh;
+		levels.clear();
+		radius = 0.0f;
+	}
+
+	unsigned int GLBI_LOD_Mesh::draw(GLBI_LOD_Selector& selector,const GLBI_Engine& engine) {
+		if (levels.empty()) return 0;
+		unsigned int level = selector.select(*this,engine.mvMatrixStack.getTopGLMatrix());
+		levels[level].mesh->draw();
+		selector.nbTriangles += levels[level].mesh->nb_primitive;
+		return level;
+	}
+
+}
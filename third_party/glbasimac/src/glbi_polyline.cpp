@@ -0,0 +1,332 @@
+#include "glbasimac/glbi_polyline.hpp"
+#include "glbasimac/glbi_profiler.hpp"
+#include "tools/instance_buffer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace glbasimac {
+
+	static const char* polylineUniformNames[] = {
+		"projectionMat","modelviewMat","viewportSize","lineWidth",
+		"joinStyle","capStyle","miterLimit","capEnds","lastSegment"
+	};
+
+	/// Component in [0,1] to 8 bits
+	static unsigned char toByte(float c) {
+		return (unsigned char)(std::min(std::max(c,0.0f),1.0f)*255.0f+0.5f);
+	}
+
+	static bool lowerX(const GLBI_Polyline_Point& p,float x) {
+		return p.x < x;
+	}
+
+	static bool greaterX(float x,const GLBI_Polyline_Point& p) {
+		return x < p.x;
+	}
+
+	void GLBI_Polyline::release() {
+		if (idVAO) glDeleteVertexArrays(1,&idVAO);
+		if (idDecimatedVAO) glDeleteVertexArrays(1,&idDecimatedVAO);
+		if (idVBO) glDeleteBuffers(1,&idVBO);
+		if (idDecimatedVBO) glDeleteBuffers(1,&idDecimatedVBO);
+		if (idProgram) glDeleteProgram(idProgram);
+		idVAO = idDecimatedVAO = idVBO = idDecimatedVBO = idProgram = 0;
+		capacity = nbUploaded = decimatedCapacity = 0;
+		columnsValid = false;
+	}
+
+	void GLBI_Polyline::setColor(float r,float g,float b) {
+		color[0] = toByte(r);
+		color[1] = toByte(g);
+		color[2] = toByte(b);
+	}
+
+	void GLBI_Polyline::addPoint(float x,float y) {
+		if (!points.empty() && (x < points.back().x)) increasingX = false;
+		GLBI_Polyline_Point p;
+		p.x = x;
+		p.y = y;
+		for(int c=0;c<4;c++) p.rgba[c] = color[c];
+		points.push_back(p);
+	}
+
+	void GLBI_Polyline::addPoints(unsigned int nb_new,const float* new_coord,const float* new_color) {
+		points.reserve(points.size()+nb_new);
+		for(unsigned int i=0;i<nb_new;i++) {
+			if (new_color) setColor(new_color[3*i],new_color[3*i+1],new_color[3*i+2]);
+			addPoint(new_coord[2*i],new_coord[2*i+1]);
+		}
+	}
+
+	void GLBI_Polyline::initFromSet(const GLBI_Set_Of_Points& set) {
+		clear();
+		points.reserve(set.nb_pts);
+		for(unsigned int i=0;i<set.nb_pts;i++) {
+			setColor(set.color_pts[3*i],set.color_pts[3*i+1],set.color_pts[3*i+2]);
+			addPoint(set.coord_pts[set.dimension*i],set.coord_pts[set.dimension*i+1]);
+		}
+	}
+
+	void GLBI_Polyline::clear() {
+		points.clear();
+		nbUploaded = 0;
+		increasingX = true;
+		columnsValid = false;
+	}
+
+	/// Attributes of the segments : previous point, the two ends, next point (slots 0 to 3 from
+	/// the first segment) and the colors of the ends. Pointers depend on the first segment drawn
+	static void setSegmentPointers(unsigned int first) {
+		const size_t stride = sizeof(GLBI_Polyline_Point);
+		for(unsigned int a=0;a<4;a++) {
+			glVertexAttribPointer(a,2,GL_FLOAT,GL_FALSE,stride,(const void*)((first+a)*stride));
+		}
+		for(unsigned int a=0;a<2;a++) {
+			glVertexAttribPointer(4+a,4,GL_UNSIGNED_BYTE,GL_TRUE,stride,(const void*)((first+1+a)*stride+offsetof(GLBI_Polyline_Point,rgba)));
+		}
+	}
+
+	/// VAO of a segment buffer : every attribute is per instance
+	static void createSegmentVAO(unsigned int& id_vao,unsigned int& id_vbo) {
+		glGenVertexArrays(1,&id_vao);
+		glGenBuffers(1,&id_vbo);
+		glBindVertexArray(id_vao);
+		glBindBuffer(GL_ARRAY_BUFFER,id_vbo);
+		for(unsigned int a=0;a<6;a++) {
+			glEnableVertexAttribArray(a);
+			glVertexAttribDivisor(a,1);
+		}
+		setSegmentPointers(0);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER,0);
+	}
+
+	bool GLBI_Polyline::createResources() {
+		idProgram = engine.programCache.finish(engine.programCache.request("../assets/shaders/polyline.vert","../assets/shaders/polyline.frag"));
+		if (idProgram == 0) {
+			std::cerr<<"GLBI_Polyline : unable to build the polyline program"<<std::endl;
+			return false;
+		}
+		for(int i=0;i<GLBI_POLYLINE_NB_UNIFORMS;i++) {
+			uniformLoc[i] = glGetUniformLocation(idProgram,polylineUniformNames[i]);
+		}
+		createSegmentVAO(idVAO,idVBO);
+		createSegmentVAO(idDecimatedVAO,idDecimatedVBO);
+		return true;
+	}
+
+	void GLBI_Polyline::uploadNewPoints() {
+		size_t nb = points.size();
+		const size_t stride = sizeof(GLBI_Polyline_Point);
+		glBindBuffer(GL_ARRAY_BUFFER,idVBO);
+		if (nb+2 > capacity) {
+			// Geometric growth : the points already sent are copied on the GPU, not uploaded again
+			size_t new_capacity = std::max(capacity ? 2*capacity : size_t(GLBI_POLYLINE_INITIAL_CAPACITY),nb+2);
+			unsigned int id_new;
+			glGenBuffers(1,&id_new);
+			glBindBuffer(GL_COPY_WRITE_BUFFER,id_new);
+			glBufferData(GL_COPY_WRITE_BUFFER,new_capacity*stride,NULL,GL_DYNAMIC_DRAW);
+			if (nbUploaded) {
+				glBindBuffer(GL_COPY_READ_BUFFER,idVBO);
+				glCopyBufferSubData(GL_COPY_READ_BUFFER,GL_COPY_WRITE_BUFFER,0,0,(nbUploaded+1)*stride);
+				glBindBuffer(GL_COPY_READ_BUFFER,0);
+			}
+			glBindBuffer(GL_COPY_WRITE_BUFFER,0);
+			glDeleteBuffers(1,&idVBO);
+			idVBO = id_new;
+			capacity = new_capacity;
+			glBindBuffer(GL_ARRAY_BUFFER,idVBO);
+		}
+		size_t bytes = 0;
+		if (nbUploaded == 0) {
+			glBufferSubData(GL_ARRAY_BUFFER,0,stride,&points[0]);
+			bytes += stride;
+		}
+		glBufferSubData(GL_ARRAY_BUFFER,(nbUploaded+1)*stride,(nb-nbUploaded)*stride,&points[nbUploaded]);
+		glBufferSubData(GL_ARRAY_BUFFER,(nb+1)*stride,stride,&points[nb-1]);
+		glBindBuffer(GL_ARRAY_BUFFER,0);
+		bytes += (nb-nbUploaded+1)*stride;
+		STP3D_COUNT(buffer_bytes,bytes);
+		stats.uploadedBytes += bytes;
+		nbUploaded = nb;
+	}
+
+	unsigned int GLBI_Polyline::addToColumns(unsigned int first,unsigned int end) {
+		float x0 = columnsView[0];
+		float scale = columnsView[2]/(columnsView[1]-x0);
+		int nb_columns = int(columns.size()/4);
+		int first_column = nb_columns;
+		for(unsigned int i=first;i<end;i++) {
+			// Points out of the view (the neighbours of the visible ones) go to the border columns
+			int c = std::min(std::max(int(std::floor((points[i].x-x0)*scale)),0),nb_columns-1);
+			first_column = std::min(first_column,c);
+			int* column = &columns[4*c];
+			if (column[0] < 0) {
+				column[0] = column[1] = column[2] = column[3] = int(i);
+				continue;
+			}
+			if (points[i].y < points[column[1]].y) column[1] = int(i);
+			if (points[i].y > points[column[2]].y) column[2] = int(i);
+			column[3] = int(i);
+		}
+		return (unsigned int)first_column;
+	}
+
+	void GLBI_Polyline::emitColumns(unsigned int from_column) {
+		// Columns before from_column are unchanged, the padding point after the last one is written again
+		decimated.resize(columnOffsets[from_column]);
+		float column_width = (columnsView[1]-columnsView[0])/columnsView[2];
+		for(size_t c=from_column;c<columnOffsets.size();c++) {
+			columnOffsets[c] = (unsigned int)decimated.size();
+			if (columns[4*c] < 0) continue;
+			int ids[4] = {columns[4*c],columns[4*c+1],columns[4*c+2],columns[4*c+3]};
+			std::sort(ids,ids+4);
+			int* last = std::unique(ids,ids+4);
+			if (last-ids < 4) {
+				for(int* id=ids;id!=last;id++) decimated.push_back(points[*id]);
+				continue;
+			}
+			// Points of a dense column fill it from min to max, and thick lines spread them over the neighbour
+			// columns from both borders : both extrema are drawn on both borders
+			GLBI_Polyline_Point band[4] = {points[ids[1]],points[ids[2]],points[ids[2]],points[ids[1]]};
+			band[0].x = band[1].x = columnsView[0]+c*column_width;
+			band[2].x = band[3].x = band[0].x+column_width;
+			decimated.push_back(points[ids[0]]);
+			decimated.insert(decimated.end(),band,band+4);
+			decimated.push_back(points[ids[3]]);
+		}
+		decimated.push_back(decimated.back());
+	}
+
+	void GLBI_Polyline::decimate(unsigned int first,unsigned int end,float x0,float x1,unsigned int nb_columns) {
+		bool same_view = columnsValid && (columnsView[0] == x0) && (columnsView[1] == x1) && (columnsView[2] == float(nb_columns))
+		                 && (columnsFirst == first) && (columnsEnd <= end);
+		if (same_view && (columnsEnd == end)) return;
+		const size_t stride = sizeof(GLBI_Polyline_Point);
+		size_t from = 0;
+		if (same_view) {
+			// Only the new points, and the columns they changed
+			unsigned int from_column = addToColumns(columnsEnd,end);
+			from = columnOffsets[from_column];
+			emitColumns(from_column);
+		}
+		else {
+			columnsView[0] = x0;
+			columnsView[1] = x1;
+			columnsView[2] = float(nb_columns);
+			columnsFirst = first;
+			columns.assign(4*nb_columns,-1);
+			addToColumns(first,end);
+			// Strip of the first, lowest, highest and last points of each column, in their order, between two padding points
+			decimated.assign(1,points[first]);
+			columnOffsets.assign(nb_columns,1);
+			emitColumns(0);
+		}
+		columnsEnd = end;
+		columnsValid = true;
+
+		glBindBuffer(GL_ARRAY_BUFFER,idDecimatedVBO);
+		if ((from == 0) || (decimated.size() > decimatedCapacity)) {
+			// Whole strip, in a buffer orphaned (no wait on the previous draw) and grown geometrically
+			if (decimated.size() > decimatedCapacity) decimatedCapacity = std::max(2*decimatedCapacity,decimated.size());
+			from = 0;
+			glBufferData(GL_ARRAY_BUFFER,decimatedCapacity*stride,NULL,GL_DYNAMIC_DRAW);
+		}
+		glBufferSubData(GL_ARRAY_BUFFER,from*stride,(decimated.size()-from)*stride,&decimated[from]);
+		glBindBuffer(GL_ARRAY_BUFFER,0);
+		STP3D_COUNT(buffer_bytes,(decimated.size()-from)*stride);
+		stats.uploadedBytes += (decimated.size()-from)*stride;
+	}
+
+	void GLBI_Polyline::drawSegments(unsigned int id_vao,unsigned int id_vbo,unsigned int first,unsigned int nb_points,int cap_ends) {
+		glBindVertexArray(id_vao);
+		STP3D_COUNT(binds,1);
+		glBindBuffer(GL_ARRAY_BUFFER,id_vbo);
+		setSegmentPointers(first);
+		glBindBuffer(GL_ARRAY_BUFFER,0);
+		glUniform1i(uniformLoc[GLBI_POLYLINE_U_CAP_ENDS],cap_ends);
+		glUniform1i(uniformLoc[GLBI_POLYLINE_U_LAST_SEGMENT],int(nb_points)-2);
+		STP3D_COUNT(uniform_uploads,2);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP,0,4,nb_points-1);
+		// Locations 4 and 5 (colors) are those of the instance transform of the meshes
+		InstanceBuffer::setDefaultValues();
+		STP3D_COUNT(draw_calls,1);
+		STP3D_COUNT(triangles,2*(nb_points-1));
+		glBindVertexArray(0);
+		stats.drawnSegments += nb_points-1;
+	}
+
+	void GLBI_Polyline::draw() {
+		GLBI_PROFILE_STAGE("polyline");
+		stats = GLBI_Polyline_Stats();
+		if (points.size() < 2) return;
+		if ((idProgram == 0) && !createResources()) return;
+		if (nbUploaded < points.size()) uploadNewPoints();
+
+		int viewport[4];
+		glGetIntegerv(GL_VIEWPORT,viewport);
+		const Matrix4D& modelview = engine.mvMatrixStack.stack.back();
+		Matrix4D transfo = engine.projectionMatrix*modelview;
+		const float* m = transfo.mat;
+
+		// Points in the view : x on screen depends on x only (column major, no perspective)
+		unsigned int first = 0,end = (unsigned int)points.size();
+		bool culled = increasingX && (m[0] != 0.0f) && (m[4] == 0.0f) && (m[3] == 0.0f) && (m[7] == 0.0f) && (m[15] == 1.0f);
+		float x0 = 0.0f,x1 = 0.0f;
+		if (culled) {
+			x0 = (-1.0f-m[12])/m[0];
+			x1 = (1.0f-m[12])/m[0];
+			if (x0 > x1) std::swap(x0,x1);
+			// Thick lines of points just out of the view are still visible
+			float margin = (0.5f*width+1.0f)*(x1-x0)/std::max(viewport[2],1);
+			// With the neighbours of the first and last visible points
+			first = (unsigned int)(std::lower_bound(points.begin(),points.end(),x0-margin,lowerX)-points.begin());
+			end = (unsigned int)(std::upper_bound(points.begin(),points.end(),x1+margin,greaterX)-points.begin());
+			if (first > 0) first--;
+			if (end < points.size()) end++;
+			if (end-first < 2) return;
+		}
+		stats.visiblePoints = end-first;
+
+		glUseProgram(idProgram);
+		glUniformMatrix4fv(uniformLoc[GLBI_POLYLINE_U_PROJECTION],1,GL_FALSE,engine.projectionMatrix.mat);
+		glUniformMatrix4fv(uniformLoc[GLBI_POLYLINE_U_MODELVIEW],1,GL_FALSE,modelview.mat);
+		glUniform2f(uniformLoc[GLBI_POLYLINE_U_VIEWPORT],float(viewport[2]),float(viewport[3]));
+		glUniform1f(uniformLoc[GLBI_POLYLINE_U_WIDTH],width);
+		glUniform1i(uniformLoc[GLBI_POLYLINE_U_JOIN],int(join));
+		glUniform1i(uniformLoc[GLBI_POLYLINE_U_CAP],int(cap));
+		glUniform1f(uniformLoc[GLBI_POLYLINE_U_MITER_LIMIT],miterLimit);
+		STP3D_COUNT(uniform_uploads,7);
+		// Blending state of the application, restored after the draw
+		GLboolean blend = glIsEnabled(GL_BLEND);
+		GLint blend_func[4],blend_equation[2];
+		glGetIntegerv(GL_BLEND_SRC_RGB,&blend_func[0]);
+		glGetIntegerv(GL_BLEND_DST_RGB,&blend_func[1]);
+		glGetIntegerv(GL_BLEND_SRC_ALPHA,&blend_func[2]);
+		glGetIntegerv(GL_BLEND_DST_ALPHA,&blend_func[3]);
+		glGetIntegerv(GL_BLEND_EQUATION_RGB,&blend_equation[0]);
+		glGetIntegerv(GL_BLEND_EQUATION_ALPHA,&blend_equation[1]);
+		if (!blend) glEnable(GL_BLEND);
+		// Destination alpha composited as well : an opaque target stays opaque
+		glBlendEquation(GL_FUNC_ADD);
+		glBlendFuncSeparate(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA,GL_ONE,GL_ONE_MINUS_SRC_ALPHA);
+
+		if (culled && decimation && (stats.visiblePoints > size_t(GLBI_POLYLINE_DECIMATION_RATIO)*viewport[2])) {
+			decimate(first,end,x0,x1,(unsigned int)viewport[2]);
+			stats.decimated = true;
+			// Ends of the decimated strip are the ends of the line or out of the view
+			drawSegments(idDecimatedVAO,idDecimatedVBO,0,(unsigned int)decimated.size()-2,3);
+		}
+		else {
+			int cap_ends = ((first == 0) ? 1 : 0) | ((end == points.size()) ? 2 : 0);
+			drawSegments(idVAO,idVBO,first,end-first,cap_ends);
+		}
+
+		if (!blend) glDisable(GL_BLEND);
+		glBlendEquationSeparate(blend_equation[0],blend_equation[1]);
+		glBlendFuncSeparate(blend_func[0],blend_func[1],blend_func[2],blend_func[3]);
+		glUseProgram(engine.idShader[engine.currentShader]);
+	}
+
+}
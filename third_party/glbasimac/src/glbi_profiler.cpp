@@ -0,0 +1,271 @@
+#include "glbasimac/glbi_profiler.hpp"
+#include <cstdio>
+#include <fstream>
+#include "glbasimac/glbi_gl_extensions.hpp"
+
+namespace glbasimac {
+
+	GLBI_Profiler* GLBI_Profiler::active = nullptr;
+
+	/// Weight of a new frame in the averaged zone times
+	static const double averageWeight = 0.1;
+
+	GLBI_Profiler::GLBI_Profiler():gpuTimers(false),nbFrames(0),nbStalls(0),tracing(false),current(0),inFrame(false),
+	                               gpuOffset(0.0),firstFrame(0) {
+		origin = std::chrono::steady_clock::now();
+	}
+
+	bool GLBI_Profiler::init() {
+		release();
+		origin = std::chrono::steady_clock::now();
+		averages.clear();
+		firstFrame = nbFrames;
+		GLint bits = 0;
+		if (glbiHasVersion(3,3) || glbiHasExtension("GL_ARB_timer_query")) glGetQueryiv(GL_TIMESTAMP,GL_QUERY_COUNTER_BITS,&bits);
+		gpuTimers = (bits > 0);
+		if (gpuTimers) {
+			syncClocks();
+		}
+		else {
+			std::cerr<<"No timer queries : the profiler measures CPU times only"<<std::endl;
+		}
+		active = this;
+		return gpuTimers;
+	}
+
+	void GLBI_Profiler::release() {
+		for(int s=0;s<GLBI_PROFILER_LATENCY;s++) {
+			Slot& slot = slots[s];
+			if (!slot.queries.empty()) glDeleteQueries(GLsizei(slot.queries.size()),slot.queries.data());
+			slot = Slot();
+		}
+		gpuTimers = false;
+		inFrame = false;
+		openZones.clear();
+		current = 0;
+		if (active == this) active = nullptr;
+	}
+
+	double GLBI_Profiler::now() const {
+		return std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-origin).count();
+	}
+
+	void GLBI_Profiler::syncClocks() {
+		GLint64 gpu_now = 0;
+		glGetInteger64v(GL_TIMESTAMP,&gpu_now);
+		gpuOffset = now()-gpu_now*1e-6;
+	}
+
+	unsigned int GLBI_Profiler::timestamp() {
+		Slot& slot = slots[current];
+		if (slot.nbQueries == slot.queries.size()) {
+			unsigned int id = 0;
+			glGenQueries(1,&id);
+			slot.queries.push_back(id);
+		}
+		glQueryCounter(slot.queries[slot.nbQueries],GL_TIMESTAMP);
+		return slot.nbQueries++;
+	}
+
+	void GLBI_Profiler::beginFrame() {
+		if (inFrame) endFrame();
+		Slot& slot = slots[current];
+		// The GPU had GLBI_PROFILER_LATENCY-1 frames to finish the previous frame of this slot
+		collect(slot);
+		GLBI_Profile_Frame& frame = slot.frame;
+		frame.zones.clear();
+		frame.index = nbFrames++;
+		frame.cpuStart = now();
+		frame.cpuTime = 0.0;
+		frame.gpuStart = frame.gpuTime = -1.0;
+		slot.nbQueries = 0;
+		STP3D::glCounters().reset();
+		inFrame = true;
+		if (gpuTimers) timestamp();
+	}
+
+	void GLBI_Profiler::endFrame() {
+		if (!inFrame) return;
+		while (!openZones.empty()) endZone();
+		Slot& slot = slots[current];
+		if (gpuTimers) timestamp();
+		slot.frame.cpuTime = now()-slot.frame.cpuStart;
+		slot.frame.counters = STP3D::glCounters();
+		slot.pending = true;
+		inFrame = false;
+		if (!gpuTimers) collect(slot);
+		current = (current+1)%GLBI_PROFILER_LATENCY;
+	}
+
+	void GLBI_Profiler::beginZone(const char* name) {
+		if (!inFrame) return;
+		GLBI_Profile_Frame& frame = slots[current].frame;
+		GLBI_Profile_Zone zone;
+		zone.name = name;
+		zone.depth = int(openZones.size());
+		zone.cpuStart = now()-frame.cpuStart;
+		zone.cpuTime = 0.0;
+		zone.gpuStart = zone.gpuTime = -1.0;
+		zone.queries[0] = gpuTimers ? timestamp() : 0;
+		zone.queries[1] = 0;
+		openZones.push_back(frame.zones.size());
+		frame.zones.push_back(zone);
+	}
+
+	void GLBI_Profiler::endZone() {
+		if (!inFrame || openZones.empty()) return;
+		GLBI_Profile_Frame& frame = slots[current].frame;
+		GLBI_Profile_Zone& zone = frame.zones[openZones.back()];
+		openZones.pop_back();
+		zone.cpuTime = now()-frame.cpuStart-zone.cpuStart;
+		if (gpuTimers) zone.queries[1] = timestamp();
+	}
+
+	void GLBI_Profiler::collect(Slot& slot) {
+		if (!slot.pending) return;
+		slot.pending = false;
+		GLBI_Profile_Frame& frame = slot.frame;
+		// Frames still in flight when profiling restarted (queries are reused without being read)
+		if (frame.index < firstFrame) return;
+		if (gpuTimers) {
+			// Queries complete in order : the last one is enough to know if reading would block
+			GLint available = 0;
+			glGetQueryObjectiv(slot.queries[slot.nbQueries-1],GL_QUERY_RESULT_AVAILABLE,&available);
+			if (!available) nbStalls++;
+			std::vector<GLuint64> times(slot.nbQueries);
+			for(unsigned int q=0;q<slot.nbQueries;q++) glGetQueryObjectui64v(slot.queries[q],GL_QUERY_RESULT,&times[q]);
+			frame.gpuStart = times[0]*1e-6+gpuOffset;
+			frame.gpuTime = (times.back()-times[0])*1e-6;
+			for(size_t z=0;z<frame.zones.size();z++) {
+				GLBI_Profile_Zone& zone = frame.zones[z];
+				zone.gpuStart = (times[zone.queries[0]]-times[0])*1e-6;
+				zone.gpuTime = (times[zone.queries[1]]-times[zone.queries[0]])*1e-6;
+			}
+		}
+		// Running averages by zone name (the frame is the empty name)
+		for(size_t z=0;z<=frame.zones.size();z++) {
+			std::string name = (z < frame.zones.size()) ? frame.zones[z].name : "";
+			double cpu = (z < frame.zones.size()) ? frame.zones[z].cpuTime : frame.cpuTime;
+			double gpu = (z < frame.zones.size()) ? frame.zones[z].gpuTime : frame.gpuTime;
+			std::map<std::string,std::pair<double,double> >::iterator it = averages.find(name);
+			if (it == averages.end()) {
+				averages[name] = std::make_pair(cpu,gpu);
+			}
+			else {
+				it->second.first += averageWeight*(cpu-it->second.first);
+				it->second.second += averageWeight*(gpu-it->second.second);
+			}
+		}
+		lastFrame = frame;
+		if (tracing) trace.push_back(frame);
+	}
+
+	void GLBI_Profiler::startTrace() {
+		trace.clear();
+		tracing = true;
+		averages.clear();
+		firstFrame = nbFrames;
+		if (gpuTimers) syncClocks();
+	}
+
+	/// Name as a JSON string
+	static std::string jsonString(const char* name) {
+		std::string s = "\"";
+		for(const char* c=name;*c;c++) {
+			if ((*c == '"') || (*c == '\\')) s += '\\';
+			s += *c;
+		}
+		return s+"\"";
+	}
+
+	bool GLBI_Profiler::writeTrace(const std::string& filename) const {
+		std::ofstream file(filename.c_str());
+		if (!file) {
+			std::cerr<<"Unable to write profile trace "<<filename<<std::endl;
+			return false;
+		}
+		// Times in us. Zones of the CPU on thread 1, of the GPU on thread 2
+		char line[512];
+		file<<"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		file<<"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+		file<<"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+		for(size_t f=0;f<trace.size();f++) {
+			const GLBI_Profile_Frame& frame = trace[f];
+			snprintf(line,sizeof(line),",\n{\"name\":\"frame %lu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+			         frame.index,1000.0*frame.cpuStart,1000.0*frame.cpuTime);
+			file<<line;
+			if (frame.gpuTime >= 0.0) {
+				snprintf(line,sizeof(line),",\n{\"name\":\"frame %lu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f}",
+				         frame.index,1000.0*frame.gpuStart,1000.0*frame.gpuTime);
+				file<<line;
+			}
+			for(size_t z=0;z<frame.zones.size();z++) {
+				const GLBI_Profile_Zone& zone = frame.zones[z];
+				std::string name = jsonString(zone.name);
+				snprintf(line,sizeof(line),",\n{\"name\":%s,\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+				         name.c_str(),1000.0*(frame.cpuStart+zone.cpuStart),1000.0*zone.cpuTime);
+				file<<line;
+				if (zone.gpuTime < 0.0) continue;
+				snprintf(line,sizeof(line),",\n{\"name\":%s,\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f}",
+				         name.c_str(),1000.0*(frame.gpuStart+zone.gpuStart),1000.0*zone.gpuTime);
+				file<<line;
+			}
+			// One counter track each : their scales differ too much to share a chart
+			const STP3D::GLCounters& c = frame.counters;
+			const char* names[5] = {"draw calls","triangles","uniform uploads","bytes uploaded","binds"};
+			unsigned long long values[5] = {c.draw_calls,c.triangles,c.uniform_uploads,c.buffer_bytes,c.binds};
+			for(int k=0;k<5;k++) {
+				snprintf(line,sizeof(line),",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%llu}}",
+				         names[k],1000.0*frame.cpuStart,values[k]);
+				file<<line;
+			}
+		}
+		file<<"\n]}\n";
+		return bool(file);
+	}
+
+	/// Time in ms, or "-" when it was not measured
+	static std::string formatTime(double t) {
+		char s[32];
+		if (t < 0.0) snprintf(s,sizeof(s),"%9s","-");
+		else snprintf(s,sizeof(s),"%9.3f",t);
+		return s;
+	}
+
+	std::string GLBI_Profiler::report() const {
+		std::string s;
+		char line[256];
+		snprintf(line,sizeof(line),"Frame %lu (times averaged over the last frames, in ms, %lu stalls)\n%-32s %9s %9s\n",
+		         lastFrame.index,nbStalls,"zone","CPU","GPU");
+		s += line;
+		std::map<std::string,std::pair<double,double> >::const_iterator it = averages.find("");
+		if (it != averages.end()) {
+			snprintf(line,sizeof(line),"%-32s",nbFrames ? "frame" : "no frame");
+			s += line+formatTime(it->second.first)+" "+formatTime(it->second.second)+"\n";
+		}
+		for(size_t z=0;z<lastFrame.zones.size();z++) {
+			const GLBI_Profile_Zone& zone = lastFrame.zones[z];
+			it = averages.find(zone.name);
+			if (it == averages.end()) continue;
+			std::string name = std::string(2*(zone.depth+1),' ')+zone.name;
+			snprintf(line,sizeof(line),"%-32s",name.c_str());
+			s += line+formatTime(it->second.first)+" "+formatTime(it->second.second)+"\n";
+		}
+		const STP3D::GLCounters& c = lastFrame.counters;
+		snprintf(line,sizeof(line),"%llu draw calls, %llu triangles, %llu uniform uploads, %llu bytes uploaded, %llu binds\n",
+		         c.draw_calls,c.triangles,c.uniform_uploads,c.buffer_bytes,c.binds);
+		return s+line;
+	}
+
+	std::string GLBI_Profiler::summary() const {
+		char line[160];
+		std::map<std::string,std::pair<double,double> >::const_iterator it = averages.find("");
+		double cpu = (it != averages.end()) ? it->second.first : 0.0;
+		double gpu = (it != averages.end()) ? it->second.second : -1.0;
+		const STP3D::GLCounters& c = lastFrame.counters;
+		if (gpu >= 0.0) snprintf(line,sizeof(line),"CPU %.2f ms | GPU %.2f ms | %llu draws | %llu triangles",cpu,gpu,c.draw_calls,c.triangles);
+		else snprintf(line,sizeof(line),"CPU %.2f ms | %llu draws | %llu triangles",cpu,c.draw_calls,c.triangles);
+		return line;
+	}
+
+}
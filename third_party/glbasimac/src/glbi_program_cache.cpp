@@ -0,0 +1,222 @@
+#include "glbasimac/glbi_program_cache.hpp"
+#include "glbasimac/glbi_gl_extensions.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+// GL 4.1 (ARB_get_program_binary) and KHR_parallel_shader_compile, missing from the GL 4.0 loader
+#define GLBI_GL_PROGRAM_BINARY_RETRIEVABLE_HINT  0x8257
+#define GLBI_GL_PROGRAM_BINARY_LENGTH            0x8741
+#define GLBI_GL_NUM_PROGRAM_BINARY_FORMATS       0x87FE
+#define GLBI_GL_COMPLETION_STATUS                0x91B1
+
+namespace glbasimac {
+
+	typedef void (APIENTRYP GLBI_GetProgramBinary_Proc)(GLuint,GLsizei,GLsizei*,GLenum*,void*);
+	typedef void (APIENTRYP GLBI_ProgramBinary_Proc)(GLuint,GLenum,const void*,GLsizei);
+	typedef void (APIENTRYP GLBI_ProgramParameteri_Proc)(GLuint,GLenum,GLint);
+	typedef void (APIENTRYP GLBI_MaxShaderCompilerThreads_Proc)(GLuint);
+	static GLBI_GetProgramBinary_Proc glbiGetProgramBinary = nullptr;
+	static GLBI_ProgramBinary_Proc glbiProgramBinary = nullptr;
+	static GLBI_ProgramParameteri_Proc glbiProgramParameteri = nullptr;
+
+	static const char cacheMagic[8] = {'G','L','B','I','P','R','G','1'};
+
+	/// 64 bits FNV-1a hash, as hexadecimal string
+	static std::string hashKey(const std::string& data) {
+		unsigned long long h = 14695981039346656037ULL;
+		for(size_t i=0;i<data.size();i++) {
+			h ^= (unsigned char)data[i];
+			h *= 1099511628211ULL;
+		}
+		char key[17];
+		snprintf(key,17,"%016llx",h);
+		return key;
+	}
+
+	/// Insert \param defines after the #version line of \param source (which must stay first)
+	static void injectDefines(std::string& source,const std::string& defines) {
+		if (defines.empty()) return;
+		size_t pos = 0;
+		int line = 1;
+		if (source.compare(0,8,"#version") == 0) {
+			pos = source.find('\n');
+			if (pos == std::string::npos) {
+				source += "\n";
+				pos = source.size();
+			}
+			else pos++;
+			line = 2;
+		}
+		// #line keeps the line numbers of compilation errors
+		std::string lines = defines;
+		if (lines.back() != '\n') lines += "\n";
+		source.insert(pos,lines+"#line "+std::to_string(line)+"\n");
+	}
+
+	GLBI_Program_Cache::GLBI_Program_Cache(const std::string& cache_directory)
+		:directory(cache_directory),nbHits(0),nbCompiled(0),nbFailures(0),nextRequest(0),initialized(false),
+		 binarySupported(false),parallelCompile(false) {
+	}
+
+	void GLBI_Program_Cache::init() {
+		initialized = true;
+		driver = std::string((const char*)glGetString(GL_VENDOR))+"|"+(const char*)glGetString(GL_RENDERER)+"|"+
+		         (const char*)glGetString(GL_VERSION);
+		if (glbiHasVersion(4,1) || glbiHasExtension("GL_ARB_get_program_binary")) {
+			glbiGetProgramBinary = (GLBI_GetProgramBinary_Proc)glbiGetProcAddress("glGetProgramBinary");
+			glbiProgramBinary = (GLBI_ProgramBinary_Proc)glbiGetProcAddress("glProgramBinary");
+			glbiProgramParameteri = (GLBI_ProgramParameteri_Proc)glbiGetProcAddress("glProgramParameteri");
+			GLint nb_formats = 0;
+			glGetIntegerv(GLBI_GL_NUM_PROGRAM_BINARY_FORMATS,&nb_formats);
+			binarySupported = glbiGetProgramBinary && glbiProgramBinary && glbiProgramParameteri && (nb_formats > 0);
+		}
+		GLBI_MaxShaderCompilerThreads_Proc max_threads = nullptr;
+		if (glbiHasExtension("GL_KHR_parallel_shader_compile")) {
+			max_threads = (GLBI_MaxShaderCompilerThreads_Proc)glbiGetProcAddress("glMaxShaderCompilerThreadsKHR");
+		}
+		else if (glbiHasExtension("GL_ARB_parallel_shader_compile")) {
+			max_threads = (GLBI_MaxShaderCompilerThreads_Proc)glbiGetProcAddress("glMaxShaderCompilerThreadsARB");
+		}
+		if (max_threads) {
+			// Let the driver use as many threads as it wants
+			max_threads(0xFFFFFFFF);
+			parallelCompile = true;
+		}
+	}
+
+	int GLBI_Program_Cache::request(const std::string& vertex_file,const std::string& fragment_file,const std::string& defines) {
+		std::vector<std::string> files;
+		files.push_back(vertex_file);
+		files.push_back(fragment_file);
+		std::vector<ShaderType> types;
+		types.push_back(Vertex);
+		types.push_back(Fragment);
+		return request(files,types,defines);
+	}
+
+	int GLBI_Program_Cache::request(const std::vector<std::string>& files,const std::vector<ShaderType>& types,const std::string& defines) {
+		if (!initialized) init();
+		std::vector<std::string> sources;
+		std::string keyed = driver;
+		for(size_t i=0;i<files.size();i++) {
+			char* source;
+			if (!ShaderManager::loadSource(files[i].c_str(),&source)) return -1;
+			sources.push_back(source);
+			delete[](source);
+			injectDefines(sources[i],defines);
+			keyed += "|"+ShaderManager::writeShaderType(types[i])+"|"+sources[i];
+		}
+		Request r;
+		r.program = glCreateProgram();
+		r.files = files;
+		r.key = hashKey(keyed);
+		r.fromCache = binarySupported && !directory.empty() && loadBinary(r);
+		if (r.fromCache) {
+			nbHits++;
+		}
+		else {
+			// Status queries are delayed until finish : the driver may compile every request at once
+			for(size_t i=0;i<sources.size();i++) {
+				unsigned int shader = glCreateShader(ShaderManager::convertToGLShaderType(types[i]));
+				const GLchar* src = sources[i].c_str();
+				glShaderSource(shader,1,&src,0);
+				glCompileShader(shader);
+				glAttachShader(r.program,shader);
+				r.shaders.push_back(shader);
+			}
+			if (binarySupported) glbiProgramParameteri(r.program,GLBI_GL_PROGRAM_BINARY_RETRIEVABLE_HINT,GL_TRUE);
+			glLinkProgram(r.program);
+		}
+		requests[nextRequest] = r;
+		return nextRequest++;
+	}
+
+	bool GLBI_Program_Cache::isReady(int id) {
+		std::map<int,Request>::const_iterator it = requests.find(id);
+		if (it == requests.end()) return true;
+		const Request& r = it->second;
+		if (r.fromCache || !parallelCompile) return true;
+		GLint done = 0;
+		glGetProgramiv(r.program,GLBI_GL_COMPLETION_STATUS,&done);
+		return done != 0;
+	}
+
+	unsigned int GLBI_Program_Cache::finish(int id) {
+		std::map<int,Request>::iterator it = requests.find(id);
+		if (it == requests.end()) return 0;
+		Request r = it->second;
+		requests.erase(it);
+		if (r.fromCache) return r.program;
+		GLint linked = 0;
+		glGetProgramiv(r.program,GL_LINK_STATUS,&linked);
+		if (!linked) {
+			for(size_t i=0;i<r.shaders.size();i++) {
+				GLint compiled = 0;
+				glGetShaderiv(r.shaders[i],GL_COMPILE_STATUS,&compiled);
+				if (compiled) continue;
+				char log[4096];
+				glGetShaderInfoLog(r.shaders[i],4096,0,log);
+				std::cerr<<"Unable to compile shader "<<r.files[i]<<" :"<<std::endl<<log<<std::endl;
+			}
+			char log[4096];
+			glGetProgramInfoLog(r.program,4096,0,log);
+			std::cerr<<"Unable to link program ("<<r.files[0]<<"...) : "<<log<<std::endl;
+			glDeleteProgram(r.program);
+			r.program = 0;
+			nbFailures++;
+		}
+		else {
+			nbCompiled++;
+			saveBinary(r);
+		}
+		for(size_t i=0;i<r.shaders.size();i++) {
+			if (r.program) glDetachShader(r.program,r.shaders[i]);
+			glDeleteShader(r.shaders[i]);
+		}
+		return r.program;
+	}
+
+	bool GLBI_Program_Cache::loadBinary(Request& r) {
+		std::ifstream file(directory+"/"+r.key+".bin",std::ios::binary);
+		if (!file) return false;
+		char magic[8];
+		unsigned int format = 0;
+		file.read(magic,8);
+		file.read((char*)&format,sizeof(format));
+		if (!file || memcmp(magic,cacheMagic,8)) return false;
+		std::vector<char> binary((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
+		glbiProgramBinary(r.program,format,binary.data(),GLsizei(binary.size()));
+		// A binary refused by the driver leaves the program ready for a normal compilation
+		GLint linked = 0;
+		glGetProgramiv(r.program,GL_LINK_STATUS,&linked);
+		return linked != 0;
+	}
+
+	void GLBI_Program_Cache::saveBinary(const Request& r) {
+		if (!binarySupported || directory.empty()) return;
+		GLint length = 0;
+		glGetProgramiv(r.program,GLBI_GL_PROGRAM_BINARY_LENGTH,&length);
+		if (length <= 0) return;
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		glbiGetProgramBinary(r.program,length,NULL,&format,binary.data());
+		std::error_code error;
+		std::filesystem::create_directories(directory,error);
+		// Written under a temporary name then renamed : concurrent processes never read half a file
+		std::string filename = directory+"/"+r.key+".bin";
+		std::string tmp_name = filename+".tmp";
+		std::ofstream file(tmp_name,std::ios::binary);
+		unsigned int format32 = format;
+		file.write(cacheMagic,8);
+		file.write((const char*)&format32,sizeof(format32));
+		file.write(binary.data(),binary.size());
+		file.close();
+		if (!file || std::rename(tmp_name.c_str(),filename.c_str())) {
+			std::cerr<<"Unable to write shader cache file "<<filename<<std::endl;
+			std::remove(tmp_name.c_str());
+		}
+	}
+
+}
@@ -0,0 +1,130 @@
+#include "glbasimac/glbi_render_target.hpp"
+#include <cstring>
+
+namespace glbasimac {
+
+	bool GLBI_Render_Target::create(int w,int h) {
+		if ((w <= 0) || (h <= 0)) {
+			std::cerr<<"Invalid size for render target : "<<w<<"x"<<h<<std::endl;
+			return false;
+		}
+		if (id_fbo == 0) {
+			glGenFramebuffers(1,&id_fbo);
+			glGenRenderbuffers(2,id_rbo);
+		}
+		width = w;
+		height = h;
+		glBindRenderbuffer(GL_RENDERBUFFER,id_rbo[0]);
+		glRenderbufferStorage(GL_RENDERBUFFER,GL_RGBA8,w,h);
+		glBindRenderbuffer(GL_RENDERBUFFER,id_rbo[1]);
+		glRenderbufferStorage(GL_RENDERBUFFER,GL_DEPTH_COMPONENT24,w,h);
+		glBindRenderbuffer(GL_RENDERBUFFER,0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER,id_fbo);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_RENDERBUFFER,id_rbo[0]);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER,GL_DEPTH_ATTACHMENT,GL_RENDERBUFFER,id_rbo[1]);
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		glBindFramebuffer(GL_FRAMEBUFFER,0);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			std::cerr<<"Render target framebuffer is not complete (status "<<status<<")"<<std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	void GLBI_Render_Target::bind() {
+		glBindFramebuffer(GL_FRAMEBUFFER,id_fbo);
+		glViewport(0,0,width,height);
+	}
+
+	void GLBI_Render_Target::unbind() {
+		glBindFramebuffer(GL_FRAMEBUFFER,0);
+	}
+
+	void GLBI_Render_Target::release() {
+		if (id_fbo) {
+			glDeleteFramebuffers(1,&id_fbo);
+			glDeleteRenderbuffers(2,id_rbo);
+		}
+		id_fbo = id_rbo[0] = id_rbo[1] = 0;
+		width = height = 0;
+	}
+
+	bool GLBI_Async_Readback::init(int w,int h,unsigned int depth) {
+		release();
+		if (depth == 0) depth = 1;
+		width = w;
+		height = h;
+		slots.resize(depth);
+		for(size_t i=0;i<slots.size();i++) {
+			glGenBuffers(1,&slots[i].id_pbo);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER,slots[i].id_pbo);
+			glBufferData(GL_PIXEL_PACK_BUFFER,4*w*h,NULL,GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER,0);
+		return glGetError() == GL_NO_ERROR;
+	}
+
+	void GLBI_Async_Readback::release() {
+		for(size_t i=0;i<slots.size();i++) {
+			if (slots[i].fence) glDeleteSync(slots[i].fence);
+			if (slots[i].id_pbo) glDeleteBuffers(1,&slots[i].id_pbo);
+		}
+		slots.clear();
+		first = nbPending = 0;
+	}
+
+	bool GLBI_Async_Readback::request(long frame_id) {
+		if (slots.empty() || full()) return false;
+		Slot& s = slots[(first+nbPending)%slots.size()];
+		glPixelStorei(GL_PACK_ALIGNMENT,1);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER,s.id_pbo);
+		// With a pack buffer bound, the last parameter is an offset : the call returns at once
+		glReadPixels(0,0,width,height,GL_RGBA,GL_UNSIGNED_BYTE,0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER,0);
+		s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+		s.frame_id = frame_id;
+		nbPending++;
+		return true;
+	}
+
+	bool GLBI_Async_Readback::retrieve(std::vector<unsigned char>& pixels,long& frame_id,bool wait) {
+		if (nbPending == 0) return false;
+		Slot& s = slots[first];
+		GLenum res = glClientWaitSync(s.fence,GL_SYNC_FLUSH_COMMANDS_BIT,0);
+		if ((res == GL_TIMEOUT_EXPIRED) && !wait) return false;
+		if (res == GL_TIMEOUT_EXPIRED) {
+			nbStalls++;
+			while ((res = glClientWaitSync(s.fence,GL_SYNC_FLUSH_COMMANDS_BIT,1000000000)) == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync(s.fence);
+		s.fence = 0;
+		if (res == GL_WAIT_FAILED) {
+			// Frame lost : free its slot
+			std::cerr<<"Unable to wait for the readback of frame "<<s.frame_id<<std::endl;
+			frame_id = s.frame_id;
+			first = (first+1)%slots.size();
+			nbPending--;
+			return false;
+		}
+
+		size_t size = 4*size_t(width)*height;
+		pixels.resize(size);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER,s.id_pbo);
+		const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER,0,size,GL_MAP_READ_BIT);
+		if (data) {
+			memcpy(pixels.data(),data,size);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER,0);
+		frame_id = s.frame_id;
+		first = (first+1)%slots.size();
+		nbPending--;
+		if (!data) {
+			std::cerr<<"Unable to map the readback buffer of frame "<<frame_id<<std::endl;
+			return false;
+		}
+		return true;
+	}
+
+}
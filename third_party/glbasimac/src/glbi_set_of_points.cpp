@@ -63,22 +63,60 @@ namespace glbasimac {
 	}
 
 	void GLBI_Set_Of_Points::addAPoint(float* n_coord,float* n_col) {
-		coord_pts.push_back(n_coord[0]);
-		coord_pts.push_back(n_coord[1]);
-		if (dimension == 3) coord_pts.push_back(n_coord[2]);
-		color_pts.push_back(n_col[0]);
-		color_pts.push_back(n_col[1]);
-		color_pts.push_back(n_col[2]);
+		addPoints(1,n_coord,n_col);
+	}
 
-		pts.setNbElt(color_pts.size()/3);
-		pts.reInit();
+	void GLBI_Set_Of_Points::addPoints(unsigned int nb_new,const float* n_coord,const float* n_col) {
+		coord_pts.insert(coord_pts.end(),n_coord,n_coord+dimension*nb_new);
+		color_pts.insert(color_pts.end(),n_col,n_col+3*nb_new);
+		uploadNewPoints(nb_new);
+	}
 
-		pts.addOneBuffer(0,2,coord_pts.data(),"Coordinates",false);
-		pts.addOneBuffer(3,3,color_pts.data(),"Color",false);
-		if(!pts.createVAO()) {
-			std::cerr<<"Unable to create VAO for Set of Points"<<std::endl;
+	void GLBI_Set_Of_Points::addPoints(unsigned int nb_new,const float* n_coord,const float* n_col,const Matrix4D& transfo) {
+		size_t first = coord_pts.size();
+		if (dimension == 3) {
+			coord_pts.resize(first+3*nb_new);
+			transformPoints(transfo,n_coord,coord_pts.data()+first,nb_new);
+		}
+		else {
+			// Points of the plane z = 0, only x and y of the transformed points are kept
+			std::vector<float> xyz(3*nb_new,0.0f);
+			for(unsigned int i=0;i<nb_new;i++) {
+				xyz[3*i] = n_coord[2*i];
+				xyz[3*i+1] = n_coord[2*i+1];
+			}
+			transformPoints(transfo,xyz.data(),xyz.data(),nb_new);
+			coord_pts.resize(first+2*nb_new);
+			for(unsigned int i=0;i<nb_new;i++) {
+				coord_pts[first+2*i] = xyz[3*i];
+				coord_pts[first+2*i+1] = xyz[3*i+1];
+			}
+		}
+		color_pts.insert(color_pts.end(),n_col,n_col+3*nb_new);
+		uploadNewPoints(nb_new);
+	}
+
+	void GLBI_Set_Of_Points::uploadNewPoints(unsigned int nb_new) {
+		if (pts.getIdVAO() == 0) {
+			// First points of the set : create GPU buffers with room for the following ones
+			nb_pts = nb_new;
+			pts.setNbElt(nb_pts);
+			pts.addOneBuffer(0,dimension,coord_pts.data(),"Coordinates",false);
+			pts.addOneBuffer(3,3,color_pts.data(),"Color",false);
+			if(!pts.createVAO(INITIAL_CAPACITY_SET_OF_POINTS)) {
+				std::cerr<<"Unable to create VAO for Set of Points"<<std::endl;
+				exit(1);
+			}
+			return;
+		}
+
+		const float* new_data[2] = {coord_pts.data()+coord_pts.size()-dimension*nb_new,
+		                            color_pts.data()+color_pts.size()-3*nb_new};
+		if (!pts.appendElements(nb_new,new_data)) {
+			std::cerr<<"Unable to add points to Set of Points : "<<STP3D::getError()<<std::endl;
 			exit(1);
 		}
+		nb_pts = pts.getNbElt();
 	}
 
 	void GLBI_Set_Of_Points::changeNature(unsigned int new_gl_type) {
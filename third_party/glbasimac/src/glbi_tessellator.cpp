@@ -0,0 +1,454 @@
+#include "glbasimac/glbi_tessellator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+namespace glbasimac {
+
+	/// Points of the rings, linked with the interior of the polygon on the left (outline counterclockwise, holes clockwise)
+	struct GLBI_Tess_Rings {
+		/// Coordinates by point index (every point of the rings)
+		std::vector<double> x,y;
+		std::vector<unsigned int> prev,next;
+		/// Points kept in the rings (without repeated points), ring by ring
+		std::vector<unsigned int> vertices;
+		std::vector<size_t> ringStarts;
+
+		double orient(unsigned int a,unsigned int b,unsigned int c) const {
+			return (x[b]-x[a])*(y[c]-y[a])-(y[b]-y[a])*(x[c]-x[a]);
+		}
+		/// Sweep order : from top to bottom, then from left to right
+		bool above(unsigned int a,unsigned int b) const {
+			if (y[a] != y[b]) return y[a] > y[b];
+			if (x[a] != x[b]) return x[a] < x[b];
+			return a < b;
+		}
+		bool samePosition(unsigned int a,unsigned int b) const {return (x[a] == x[b]) && (y[a] == y[b]);}
+	};
+
+	/// Link the rings. Return false if the outline has less than 3 distinct points
+	static bool buildRings(const std::vector<float>& outline,const std::vector<std::vector<float> >& holes,GLBI_Tess_Rings& rings) {
+		size_t nb_points = outline.size()/2;
+		for(size_t h=0;h<holes.size();h++) nb_points += holes[h].size()/2;
+		rings.x.resize(nb_points);
+		rings.y.resize(nb_points);
+		rings.prev.assign(nb_points,0);
+		rings.next.assign(nb_points,0);
+		rings.vertices.reserve(nb_points);
+
+		unsigned int offset = 0;
+		std::vector<unsigned int> ids;
+		for(size_t r=0;r<=holes.size();r++) {
+			const std::vector<float>& coords = (r == 0) ? outline : holes[r-1];
+			unsigned int nb = coords.size()/2;
+			ids.clear();
+			for(unsigned int i=0;i<nb;i++) {
+				unsigned int id = offset+i;
+				rings.x[id] = coords[2*i];
+				rings.y[id] = coords[2*i+1];
+				if (!ids.empty() && rings.samePosition(ids.back(),id)) continue;
+				ids.push_back(id);
+			}
+			offset += nb;
+			while ((ids.size() > 1) && rings.samePosition(ids.front(),ids.back())) ids.pop_back();
+			if (ids.size() < 3) {
+				if (r == 0) return false;
+				continue;
+			}
+			double area = 0.0;
+			for(size_t i=0;i<ids.size();i++) {
+				unsigned int a = ids[i],b = ids[(i+1)%ids.size()];
+				area += rings.x[a]*rings.y[b]-rings.x[b]*rings.y[a];
+			}
+			if ((r == 0) != (area > 0.0)) std::reverse(ids.begin(),ids.end());
+			rings.ringStarts.push_back(rings.vertices.size());
+			for(size_t i=0;i<ids.size();i++) {
+				rings.next[ids[i]] = ids[(i+1)%ids.size()];
+				rings.prev[ids[i]] = ids[(i+ids.size()-1)%ids.size()];
+				rings.vertices.push_back(ids[i]);
+			}
+		}
+		return true;
+	}
+
+	/// Add triangle (a,b,c) counterclockwise. Flat triangles are skipped
+	static void addTriangle(const GLBI_Tess_Rings& rings,unsigned int a,unsigned int b,unsigned int c,std::vector<unsigned int>& triangles) {
+		double o = rings.orient(a,b,c);
+		if (o == 0.0) return;
+		triangles.push_back(a);
+		triangles.push_back((o > 0.0) ? b : c);
+		triangles.push_back((o > 0.0) ? c : b);
+	}
+
+	/// Ear clipping of the first ring
+	static bool clipEars(const GLBI_Tess_Rings& rings,std::vector<unsigned int>& triangles) {
+		size_t end = (rings.ringStarts.size() > 1) ? rings.ringStarts[1] : rings.vertices.size();
+		std::vector<unsigned int> prev(rings.prev),next(rings.next);
+		unsigned int v = rings.vertices[0];
+		size_t remaining = end;
+		size_t tries = 0;
+		while (remaining > 3) {
+			unsigned int p = prev[v],n = next[v];
+			bool ear = rings.orient(p,v,n) > 0.0;
+			// No point of the ring inside the ear
+			for(unsigned int q=next[n];ear && (q != p);q=next[q]) {
+				if (rings.samePosition(q,p) || rings.samePosition(q,v) || rings.samePosition(q,n)) continue;
+				if ((rings.orient(p,v,q) >= 0.0) && (rings.orient(v,n,q) >= 0.0) && (rings.orient(n,p,q) >= 0.0)) ear = false;
+			}
+			if (ear) {
+				addTriangle(rings,p,v,n,triangles);
+				next[p] = n;
+				prev[n] = p;
+				remaining--;
+				tries = 0;
+				v = n;
+			}
+			else {
+				v = n;
+				// A whole turn without ear : the ring is not simple
+				if (++tries > remaining) return false;
+			}
+		}
+		addTriangle(rings,prev[v],v,next[v],triangles);
+		return true;
+	}
+
+	/// Vertex types of the sweep
+	enum GLBI_Tess_Vertex_Type {GLBI_TESS_START,GLBI_TESS_END,GLBI_TESS_SPLIT,GLBI_TESS_MERGE,GLBI_TESS_REGULAR};
+
+	/// Left to right order of the edges crossing the sweep line. Edge v goes from v to next[v] (downward).
+	/// Edge -1 stands for the current vertex (query)
+	struct GLBI_Tess_Edge_Less {
+		const GLBI_Tess_Rings* rings;
+		const unsigned int* query;
+
+		bool operator()(int a,int b) const {
+			if (a == b) return false;
+			const GLBI_Tess_Rings& r = *rings;
+			if (a < 0) return r.orient(b,r.next[b],*query) < 0.0;
+			if (b < 0) return r.orient(a,r.next[a],*query) > 0.0;
+			unsigned int la = r.next[a],lb = r.next[b];
+			if (r.samePosition(a,b)) return r.orient(a,la,lb) > 0.0;
+			// Compare the highest edge to the upper end of the other one
+			if (r.above(a,b)) {
+				double o = r.orient(a,la,b);
+				if (o == 0.0) o = r.orient(a,la,lb);
+				return o > 0.0;
+			}
+			double o = r.orient(b,lb,a);
+			if (o == 0.0) o = r.orient(b,lb,la);
+			return o < 0.0;
+		}
+	};
+
+	/// Diagonals splitting the polygon in y-monotone pieces. Return false if the rings cross
+	static bool monotoneDiagonals(const GLBI_Tess_Rings& rings,std::vector<unsigned int>& diagonals) {
+		size_t nb_points = rings.x.size();
+		std::vector<unsigned int> order(rings.vertices);
+		std::sort(order.begin(),order.end(),[&rings](unsigned int a,unsigned int b) {return rings.above(a,b);});
+
+		std::vector<unsigned char> type(nb_points,GLBI_TESS_REGULAR);
+		for(size_t i=0;i<rings.vertices.size();i++) {
+			unsigned int v = rings.vertices[i],p = rings.prev[v],n = rings.next[v];
+			bool convex = rings.orient(p,v,n) >= 0.0;
+			if (rings.above(v,p) && rings.above(v,n)) type[v] = convex ? GLBI_TESS_START : GLBI_TESS_SPLIT;
+			else if (rings.above(p,v) && rings.above(n,v)) type[v] = convex ? GLBI_TESS_END : GLBI_TESS_MERGE;
+		}
+
+		unsigned int query = 0;
+		GLBI_Tess_Edge_Less less = {&rings,&query};
+		typedef std::set<int,GLBI_Tess_Edge_Less> Status;
+		Status status(less);
+		std::vector<Status::iterator> position(nb_points,status.end());
+		std::vector<unsigned int> helper(nb_points,0);
+
+		// Edge directly on the left of the current vertex (-1 if none)
+		auto leftEdge = [&]() -> int {
+			Status::iterator it = status.lower_bound(-1);
+			if (it == status.begin()) return -1;
+			--it;
+			return *it;
+		};
+		// Fail if an edge equal to v is already crossing the sweep line (overlapping collinear edges)
+		auto insertEdge = [&](unsigned int v) -> bool {
+			std::pair<Status::iterator,bool> inserted = status.insert(int(v));
+			if (!inserted.second) return false;
+			position[v] = inserted.first;
+			helper[v] = v;
+			return true;
+		};
+		// Remove the edge ending at v, with a diagonal to its helper if it is a merge vertex
+		auto closeEdge = [&](unsigned int v,unsigned int e) -> bool {
+			if (position[e] == status.end()) return false;
+			if (type[helper[e]] == GLBI_TESS_MERGE) {
+				diagonals.push_back(v);
+				diagonals.push_back(helper[e]);
+			}
+			status.erase(position[e]);
+			position[e] = status.end();
+			return true;
+		};
+		// Make v the helper of the edge on its left, with a diagonal to the previous helper if it is a merge vertex
+		auto helpLeft = [&](unsigned int v,bool always_diagonal) -> bool {
+			int e = leftEdge();
+			if (e < 0) return false;
+			if (always_diagonal || (type[helper[e]] == GLBI_TESS_MERGE)) {
+				diagonals.push_back(v);
+				diagonals.push_back(helper[e]);
+			}
+			helper[e] = v;
+			return true;
+		};
+
+		for(size_t i=0;i<order.size();i++) {
+			unsigned int v = order[i];
+			unsigned int p = rings.prev[v];
+			query = v;
+			bool ok = true;
+			switch (type[v]) {
+			case GLBI_TESS_START:
+				ok = insertEdge(v);
+				break;
+			case GLBI_TESS_END:
+				ok = closeEdge(v,p);
+				break;
+			case GLBI_TESS_SPLIT:
+				ok = helpLeft(v,true) && insertEdge(v);
+				break;
+			case GLBI_TESS_MERGE:
+				ok = closeEdge(v,p) && helpLeft(v,false);
+				break;
+			default:
+				// Interior on the right of the vertex when the ring goes down
+				if (rings.above(p,v)) {
+					ok = closeEdge(v,p) && insertEdge(v);
+				}
+				else ok = helpLeft(v,false);
+				break;
+			}
+			if (!ok) return false;
+		}
+		return true;
+	}
+
+	/// Triangulate the y-monotone piece \param face (counterclockwise)
+	static void triangulateMonotone(const GLBI_Tess_Rings& rings,const std::vector<unsigned int>& face,std::vector<unsigned int>& triangles) {
+		size_t m = face.size();
+		if (m < 3) return;
+		if (m == 3) {
+			addTriangle(rings,face[0],face[1],face[2],triangles);
+			return;
+		}
+		size_t top = 0,bottom = 0;
+		for(size_t i=1;i<m;i++) {
+			if (rings.above(face[i],face[top])) top = i;
+			if (rings.above(face[bottom],face[i])) bottom = i;
+		}
+		// Merge the left chain (counterclockwise from the top) and the right one in sweep order
+		std::vector<unsigned int> u;
+		std::vector<bool> left;
+		u.reserve(m);
+		left.reserve(m);
+		u.push_back(face[top]);
+		left.push_back(true);
+		size_t i = (top+1)%m,k = (top+m-1)%m;
+		while ((i != bottom) || (k != bottom)) {
+			if ((i != bottom) && ((k == bottom) || rings.above(face[i],face[k]))) {
+				u.push_back(face[i]);
+				left.push_back(true);
+				i = (i+1)%m;
+			}
+			else {
+				u.push_back(face[k]);
+				left.push_back(false);
+				k = (k+m-1)%m;
+			}
+		}
+		u.push_back(face[bottom]);
+		left.push_back(false);
+
+		std::vector<size_t> stack;
+		stack.reserve(m);
+		stack.push_back(0);
+		stack.push_back(1);
+		for(size_t j=2;j+1<m;j++) {
+			if (left[j] != left[stack.back()]) {
+				// Opposite chain : fan to every vertex of the stack
+				for(size_t s=stack.size()-1;s>0;s--) addTriangle(rings,u[j],u[stack[s]],u[stack[s-1]],triangles);
+				stack.clear();
+				stack.push_back(j-1);
+				stack.push_back(j);
+			}
+			else {
+				// Same chain : clip while the diagonal is inside the piece
+				size_t last = stack.back();
+				stack.pop_back();
+				while (!stack.empty()) {
+					double o = rings.orient(u[j],u[last],u[stack.back()]);
+					if (left[j] ? (o >= 0.0) : (o <= 0.0)) break;
+					addTriangle(rings,u[j],u[last],u[stack.back()],triangles);
+					last = stack.back();
+					stack.pop_back();
+				}
+				stack.push_back(last);
+				stack.push_back(j);
+			}
+		}
+		for(size_t s=stack.size()-1;s>0;s--) addTriangle(rings,u[m-1],u[stack[s]],u[stack[s-1]],triangles);
+	}
+
+	/// Pieces bounded by the rings and the diagonals (interior on the left of every half edge), each triangulated
+	static void triangulatePieces(const GLBI_Tess_Rings& rings,const std::vector<unsigned int>& diagonals,std::vector<unsigned int>& triangles) {
+		// Half edges : ring edges, then both directions of the diagonals
+		std::vector<unsigned int> org,dst;
+		size_t nb_half = rings.vertices.size()+diagonals.size();
+		org.reserve(nb_half);
+		dst.reserve(nb_half);
+		for(size_t i=0;i<rings.vertices.size();i++) {
+			org.push_back(rings.vertices[i]);
+			dst.push_back(rings.next[rings.vertices[i]]);
+		}
+		for(size_t d=0;d<diagonals.size();d+=2) {
+			org.push_back(diagonals[d]);
+			dst.push_back(diagonals[d+1]);
+			org.push_back(diagonals[d+1]);
+			dst.push_back(diagonals[d]);
+		}
+		std::vector<double> angle(nb_half);
+		for(size_t h=0;h<nb_half;h++) angle[h] = std::atan2(rings.y[dst[h]]-rings.y[org[h]],rings.x[dst[h]]-rings.x[org[h]]);
+
+		// Outgoing half edges of each point, by increasing angle
+		size_t nb_points = rings.x.size();
+		std::vector<unsigned int> first(nb_points+1,0),outgoing(nb_half);
+		for(size_t h=0;h<nb_half;h++) first[org[h]+1]++;
+		for(size_t p=0;p<nb_points;p++) first[p+1] += first[p];
+		std::vector<unsigned int> fill(first.begin(),first.end()-1);
+		for(size_t h=0;h<nb_half;h++) outgoing[fill[org[h]]++] = (unsigned int)h;
+		for(size_t p=0;p<nb_points;p++) {
+			if (first[p+1]-first[p] > 1) {
+				std::sort(outgoing.begin()+first[p],outgoing.begin()+first[p+1],[&angle](unsigned int a,unsigned int b) {return angle[a] < angle[b];});
+			}
+		}
+
+		// Next half edge of a piece : first clockwise after the way back
+		auto nextHalfEdge = [&](unsigned int h) -> unsigned int {
+			unsigned int v = dst[h];
+			unsigned int begin = first[v],end = first[v+1];
+			if (end-begin == 1) return outgoing[begin];
+			double back = std::atan2(rings.y[org[h]]-rings.y[v],rings.x[org[h]]-rings.x[v]);
+			unsigned int best = outgoing[end-1];
+			for(unsigned int o=begin;o<end;o++) {
+				if (angle[outgoing[o]] >= back) break;
+				best = outgoing[o];
+			}
+			if (dst[best] == org[h]) {
+				// Way back itself (diagonal) : the previous one clockwise
+				unsigned int pos = begin;
+				while (outgoing[pos] != best) pos++;
+				best = outgoing[(pos == begin) ? end-1 : pos-1];
+			}
+			return best;
+		};
+
+		std::vector<bool> used(nb_half,false);
+		std::vector<unsigned int> face;
+		for(size_t start=0;start<nb_half;start++) {
+			if (used[start]) continue;
+			face.clear();
+			unsigned int h = (unsigned int)start;
+			while (!used[h] && (face.size() <= nb_half)) {
+				used[h] = true;
+				face.push_back(org[h]);
+				h = nextHalfEdge(h);
+			}
+			triangulateMonotone(rings,face,triangles);
+		}
+	}
+
+	bool GLBI_Tessellator::triangulate(const std::vector<float>& outline,const std::vector<std::vector<float> >& holes,
+	                                   std::vector<unsigned int>& triangles,unsigned int ear_clipping_max_points) {
+		bool has_holes = false;
+		for(size_t h=0;h<holes.size();h++) has_holes = has_holes || (holes[h].size() >= 6);
+		bool ear_clipping = !has_holes && (outline.size()/2 <= ear_clipping_max_points);
+		if (ear_clipping && earClipping(outline,triangles)) return true;
+		triangles.clear();
+		if (sweep(outline,holes,triangles)) return true;
+		if (ear_clipping || has_holes) return false;
+		// Last chance for rings the sweep can not order
+		triangles.clear();
+		return earClipping(outline,triangles);
+	}
+
+	bool GLBI_Tessellator::earClipping(const std::vector<float>& outline,std::vector<unsigned int>& triangles) {
+		GLBI_Tess_Rings rings;
+		if (!buildRings(outline,std::vector<std::vector<float> >(),rings)) return false;
+		return clipEars(rings,triangles);
+	}
+
+	bool GLBI_Tessellator::sweep(const std::vector<float>& outline,const std::vector<std::vector<float> >& holes,std::vector<unsigned int>& triangles) {
+		GLBI_Tess_Rings rings;
+		if (!buildRings(outline,holes,rings)) return false;
+		std::vector<unsigned int> diagonals;
+		if (!monotoneDiagonals(rings,diagonals)) return false;
+		triangulatePieces(rings,diagonals,triangles);
+		return true;
+	}
+
+	unsigned long long GLBI_Tessellator::hashPolygon(const std::vector<float>& outline,const std::vector<std::vector<float> >& holes) {
+		unsigned long long h = 14695981039346656037ULL;
+		auto addBytes = [&h](const void* data,size_t size) {
+			const unsigned char* bytes = (const unsigned char*)data;
+			for(size_t i=0;i<size;i++) {
+				h ^= bytes[i];
+				h *= 1099511628211ULL;
+			}
+		};
+		// Sizes of the rings are hashed too : the same points split differently are another polygon
+		for(size_t r=0;r<=holes.size();r++) {
+			const std::vector<float>& coords = (r == 0) ? outline : holes[r-1];
+			unsigned long long size = coords.size();
+			addBytes(&size,sizeof(size));
+			if (!coords.empty()) addBytes(coords.data(),coords.size()*sizeof(float));
+		}
+		return h;
+	}
+
+	IndexedMesh* GLBI_Tessellator::tessellate(const std::vector<float>& outline,const std::vector<std::vector<float> >& holes) {
+		unsigned long long key = hashPolygon(outline,holes);
+		std::map<unsigned long long,IndexedMesh*>::iterator found = cache.find(key);
+		if (found != cache.end()) {
+			stats.cacheHits++;
+			return found->second;
+		}
+
+		bool has_holes = false;
+		for(size_t h=0;h<holes.size();h++) has_holes = has_holes || (holes[h].size() >= 6);
+		if (!has_holes && (outline.size()/2 <= earClippingMaxPoints)) stats.earClippings++;
+		else stats.sweeps++;
+		std::vector<unsigned int> triangles;
+		if (!triangulate(outline,holes,triangles,earClippingMaxPoints) || triangles.empty()) {
+			std::cerr<<"Unable to triangulate a polygon of "<<outline.size()/2<<" points and "<<holes.size()<<" holes"<<std::endl;
+			stats.failures++;
+			return nullptr;
+		}
+
+		std::vector<float> coords(outline);
+		for(size_t h=0;h<holes.size();h++) coords.insert(coords.end(),holes[h].begin(),holes[h].end());
+		IndexedMesh* mesh = new IndexedMesh(triangles.size()/3,coords.size()/2,GL_TRIANGLES);
+		mesh->addOneBuffer(0,2,coords.data(),"coordinates",true);
+		mesh->addIndexBuffer(triangles.data(),true);
+		if (createVAOs && !mesh->createVAO()) {
+			std::cerr<<"Unable to create the VAO of a tessellated polygon"<<std::endl;
+			delete mesh;
+			return nullptr;
+		}
+		cache[key] = mesh;
+		return mesh;
+	}
+
+	void GLBI_Tessellator::clearCache() {
+		for(std::map<unsigned long long,IndexedMesh*>::iterator it=cache.begin();it!=cache.end();++it) delete it->second;
+		cache.clear();
+	}
+
+}
@@ -1,6 +1,111 @@
 #include "glbasimac/glbi_texture.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "glbasimac/glbi_gl_extensions.hpp"
+
+// Extension enums missing from the GL 4.0 loader
+#define GLBI_GL_TEXTURE_MAX_ANISOTROPY           0x84FE
+#define GLBI_GL_MAX_TEXTURE_MAX_ANISOTROPY       0x84FF
+#define GLBI_GL_COMPRESSED_RGB_S3TC_DXT1         0x83F0
+#define GLBI_GL_COMPRESSED_RGBA_S3TC_DXT5        0x83F3
+#define GLBI_GL_COMPRESSED_SRGB_S3TC_DXT1        0x8C4C
+#define GLBI_GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5  0x8C4F
 
 namespace glbasimac {
+
+	typedef void (APIENTRYP GLBI_TexStorage2D_Proc)(GLenum,GLsizei,GLenum,GLsizei,GLsizei);
+	static GLBI_TexStorage2D_Proc glbiTexStorage2D = nullptr;
+
+	const GLBI_Texture_Caps& GLBI_Texture_Caps::get() {
+		static GLBI_Texture_Caps caps;
+		static bool queried = false;
+		if (queried) return caps;
+		queried = true;
+		caps.textureStorage = false;
+		if (glbiHasVersion(4,2) || glbiHasExtension("GL_ARB_texture_storage")) {
+			glbiTexStorage2D = (GLBI_TexStorage2D_Proc)glbiGetProcAddress("glTexStorage2D");
+			caps.textureStorage = (glbiTexStorage2D != nullptr);
+		}
+		caps.s3tc = glbiHasExtension("GL_EXT_texture_compression_s3tc");
+		caps.s3tcSRGB = caps.s3tc && glbiHasExtension("GL_EXT_texture_sRGB");
+		caps.anisotropic = glbiHasExtension("GL_EXT_texture_filter_anisotropic") || glbiHasExtension("GL_ARB_texture_filter_anisotropic");
+		caps.maxAnisotropy = 1.0f;
+		if (caps.anisotropic) glGetFloatv(GLBI_GL_MAX_TEXTURE_MAX_ANISOTROPY,&caps.maxAnisotropy);
+		return caps;
+	}
+
+	static unsigned int nbMipLevels(unsigned int w,unsigned int h) {
+		unsigned int nb = 1;
+		for(unsigned int s=std::max(w,h);s>1;s>>=1) nb++;
+		return nb;
+	}
+
+	unsigned int GLBI_Texture::chooseInternalFormat(GLBI_Texture_Format format,unsigned int n_chan) {
+		const GLBI_Texture_Caps& caps = GLBI_Texture_Caps::get();
+		bool alpha = (n_chan == 4);
+		switch (format) {
+			case GLBI_TEXTURE_RGB8 : return GL_RGB8;
+			case GLBI_TEXTURE_RGBA8 : return GL_RGBA8;
+			case GLBI_TEXTURE_SRGB8 : return GL_SRGB8;
+			case GLBI_TEXTURE_SRGB8_ALPHA8 : return GL_SRGB8_ALPHA8;
+			case GLBI_TEXTURE_COMPRESSED :
+				if (caps.s3tc && (n_chan >= 3)) return alpha ? GLBI_GL_COMPRESSED_RGBA_S3TC_DXT5 : GLBI_GL_COMPRESSED_RGB_S3TC_DXT1;
+				break;
+			case GLBI_TEXTURE_COMPRESSED_SRGB :
+				if (caps.s3tcSRGB && (n_chan >= 3)) return alpha ? GLBI_GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5 : GLBI_GL_COMPRESSED_SRGB_S3TC_DXT1;
+				return alpha ? GL_SRGB8_ALPHA8 : GL_SRGB8;
+			default :
+				break;
+		}
+		static const GLenum formats[4] = {GL_R8,GL_RG8,GL_RGB8,GL_RGBA8};
+		return formats[n_chan-1];
+	}
+
+	bool GLBI_Texture::isCompressedFormat(unsigned int format) {
+		return (format == GLBI_GL_COMPRESSED_RGB_S3TC_DXT1) || (format == GLBI_GL_COMPRESSED_RGBA_S3TC_DXT5) ||
+		       (format == GLBI_GL_COMPRESSED_SRGB_S3TC_DXT1) || (format == GLBI_GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5);
+	}
+
+	bool GLBI_Texture::isSRGBFormat(unsigned int format) {
+		return (format == GL_SRGB8) || (format == GL_SRGB8_ALPHA8) ||
+		       (format == GLBI_GL_COMPRESSED_SRGB_S3TC_DXT1) || (format == GLBI_GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5);
+	}
+
+	void glbiDownsample(unsigned int w,unsigned int h,unsigned int n_chan,const unsigned char* src,bool srgb,
+	                       std::vector<unsigned char>& dst) {
+		static float to_linear[256];
+		static bool table_done = false;
+		if (!table_done) {
+			for(int i=0;i<256;i++) {
+				float c = i/255.0f;
+				to_linear[i] = (c <= 0.04045f) ? c/12.92f : std::pow((c+0.055f)/1.055f,2.4f);
+			}
+			table_done = true;
+		}
+		unsigned int nw = std::max(w/2,1u),nh = std::max(h/2,1u);
+		dst.resize(size_t(nw)*nh*n_chan);
+		for(unsigned int y=0;y<nh;y++) {
+			const unsigned char* row0 = src+size_t(2*y)*w*n_chan;
+			const unsigned char* row1 = src+size_t(std::min(2*y+1,h-1))*w*n_chan;
+			unsigned char* out = dst.data()+size_t(y)*nw*n_chan;
+			for(unsigned int x=0;x<nw;x++) {
+				unsigned int x0 = 2*x*n_chan,x1 = std::min(2*x+1,w-1)*n_chan;
+				for(unsigned int c=0;c<n_chan;c++) {
+					if (srgb && (c < 3)) {
+						float l = 0.25f*(to_linear[row0[x0+c]]+to_linear[row0[x1+c]]+to_linear[row1[x0+c]]+to_linear[row1[x1+c]]);
+						float s = (l <= 0.0031308f) ? 12.92f*l : 1.055f*std::pow(l,1.0f/2.4f)-0.055f;
+						out[x*n_chan+c] = (unsigned char)(255.0f*s+0.5f);
+					}
+					else {
+						out[x*n_chan+c] = (unsigned char)((row0[x0+c]+row0[x1+c]+row1[x0+c]+row1[x1+c]+2)/4);
+					}
+				}
+			}
+		}
+	}
+
 	void GLBI_Texture::createTexture() {
 		glGenTextures(1,&id_in_GL);
 		if (id_in_GL == 0) {
@@ -15,18 +120,91 @@ namespace glbasimac {
 			exit(1);
 		}
 		glBindTexture(GL_TEXTURE_2D,id_in_GL);
+		STP3D_COUNT(binds,1);
 	}
 
-	void GLBI_Texture::loadImage(unsigned int w,unsigned int h,unsigned int n_chan,unsigned char* pixels) {
+	void GLBI_Texture::loadImage(unsigned int w,unsigned int h,unsigned int n_chan,unsigned char* pixels,
+	                             const GLBI_Texture_Options& options) {
+		if (!allocate(w,h,n_chan,options)) return;
+		std::vector<unsigned char> level_pixels[2];
+		const unsigned char* src = pixels;
+		unsigned int lw = width,lh = height;
+		for(unsigned int l=0;l<(cpuMipmaps ? levels : 1u);l++) {
+			if (l > 0) {
+				std::vector<unsigned char>& dst = level_pixels[l%2];
+				glbiDownsample(lw,lh,channels,src,isSRGBFormat(internalFormat),dst);
+				src = dst.data();
+				lw = std::max(lw/2,1u);
+				lh = std::max(lh/2,1u);
+			}
+			uploadRows(l,0,lh,src);
+		}
+		completeUpload(options);
+	}
+
+	bool GLBI_Texture::allocate(unsigned int w,unsigned int h,unsigned int n_chan,const GLBI_Texture_Options& options) {
 		if (!id_in_GL) {
 			std::cerr<<"Unable to attach an uncreated Texture"<<std::endl;
 			exit(1);
 		}
+		if ((n_chan < 1) || (n_chan > 4) || (w == 0) || (h == 0)) {
+			std::cerr<<"Unable to load a "<<w<<"x"<<h<<" texture with "<<n_chan<<" channels"<<std::endl;
+			return false;
+		}
+		const GLBI_Texture_Caps& caps = GLBI_Texture_Caps::get();
+		GLenum format = chooseInternalFormat(options.format,n_chan);
+		unsigned int nb_levels = (options.mipmaps == GLBI_MIPMAP_NONE) ? 1 : nbMipLevels(w,h);
+		if (options.maxLevels > 0) nb_levels = std::min(nb_levels,options.maxLevels);
+		bool use_storage = options.immutable && caps.textureStorage;
+
+		// Immutable storage cannot be redefined : a new texture object is needed
+		if (immutable && (!use_storage || (w != width) || (h != height) || (format != internalFormat) || (nb_levels != levels))) {
+			glDeleteTextures(1,&id_in_GL);
+			createTexture();
+			immutable = false;
+		}
 		width = w;
 		height = h;
 		channels = n_chan;
-		if (channels == 3) glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,width,height,0,GL_RGB,GL_UNSIGNED_BYTE,pixels);
-		if (channels == 4) glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,pixels);
+		levels = nb_levels;
+		internalFormat = format;
+		// Compressed formats are not color-renderable : glGenerateMipmap cannot fill them
+		cpuMipmaps = (levels > 1) && ((options.mipmaps == GLBI_MIPMAP_CPU) || isCompressedFormat(format));
+		glBindTexture(GL_TEXTURE_2D,id_in_GL);
+		if (use_storage) {
+			if (!immutable) glbiTexStorage2D(GL_TEXTURE_2D,levels,internalFormat,width,height);
+			immutable = true;
+		}
+		else {
+			// Levels filled on the GPU are allocated by glGenerateMipmap
+			static const GLenum pixel_formats[4] = {GL_RED,GL_RG,GL_RGB,GL_RGBA};
+			unsigned int lw = width,lh = height;
+			for(unsigned int l=0;l<(cpuMipmaps ? levels : 1u);l++) {
+				glTexImage2D(GL_TEXTURE_2D,l,internalFormat,lw,lh,0,pixel_formats[channels-1],GL_UNSIGNED_BYTE,NULL);
+				lw = std::max(lw/2,1u);
+				lh = std::max(lh/2,1u);
+			}
+		}
+		glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_BASE_LEVEL,0);
+		glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAX_LEVEL,levels-1);
+		return true;
+	}
+
+	void GLBI_Texture::uploadRows(unsigned int level,unsigned int y,unsigned int nb_rows,const void* pixels) {
+		static const GLenum pixel_formats[4] = {GL_RED,GL_RG,GL_RGB,GL_RGBA};
+		GLint alignment;
+		glGetIntegerv(GL_UNPACK_ALIGNMENT,&alignment);
+		glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+		glTexSubImage2D(GL_TEXTURE_2D,level,0,y,std::max(width>>level,1u),nb_rows,pixel_formats[channels-1],GL_UNSIGNED_BYTE,pixels);
+		STP3D_COUNT(buffer_bytes,(unsigned long long)std::max(width>>level,1u)*nb_rows*channels);
+		glPixelStorei(GL_UNPACK_ALIGNMENT,alignment);
+	}
+
+	void GLBI_Texture::completeUpload(const GLBI_Texture_Options& options) {
+		if ((levels > 1) && !cpuMipmaps) glGenerateMipmap(GL_TEXTURE_2D);
+		glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,(levels > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+		if (options.anisotropy > 1.0f) setAnisotropy(options.anisotropy);
 	}
 
 	void GLBI_Texture::detachTexture() {
@@ -41,5 +219,37 @@ namespace glbasimac {
 		glTexParameteri(GL_TEXTURE_2D,param,value);
 	}
 
-	
+	bool GLBI_Texture::setAnisotropy(float value) {
+		if (!id_in_GL) {
+			std::cerr<<"Unable to set parameters of an uncreated texture"<<std::endl;
+			exit(1);
+		}
+		const GLBI_Texture_Caps& caps = GLBI_Texture_Caps::get();
+		if (!caps.anisotropic) return false;
+		glTexParameterf(GL_TEXTURE_2D,GLBI_GL_TEXTURE_MAX_ANISOTROPY,std::max(1.0f,std::min(value,caps.maxAnisotropy)));
+		return true;
+	}
+
+	size_t GLBI_Texture::memorySize() const {
+		size_t size = 0;
+		unsigned int lw = width,lh = height;
+		for(unsigned int l=0;l<levels;l++) {
+			if (isCompressedFormat(internalFormat)) {
+				// 4x4 blocks of 8 bytes (DXT1) or 16 bytes (DXT5)
+				bool dxt1 = (internalFormat == GLBI_GL_COMPRESSED_RGB_S3TC_DXT1) || (internalFormat == GLBI_GL_COMPRESSED_SRGB_S3TC_DXT1);
+				size += size_t((lw+3)/4)*((lh+3)/4)*(dxt1 ? 8 : 16);
+			}
+			else {
+				unsigned int texel = 4;
+				if (internalFormat == GL_R8) texel = 1;
+				else if (internalFormat == GL_RG8) texel = 2;
+				else if ((internalFormat == GL_RGB8) || (internalFormat == GL_SRGB8)) texel = 3;
+				size += size_t(lw)*lh*texel;
+			}
+			lw = std::max(lw/2,1u);
+			lh = std::max(lh/2,1u);
+		}
+		return size;
+	}
+
 }
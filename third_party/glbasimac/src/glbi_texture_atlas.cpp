@@ -0,0 +1,201 @@
+#include "glbasimac/glbi_texture_atlas.hpp"
+#include "glbasimac/glbi_image_io.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace glbasimac {
+
+	void GLBI_Atlas_Region::remapUVs(float* uvs,size_t nb) const {
+		float du = u1-u0,dv = v1-v0;
+		for(size_t i=0;i<nb;i++) {
+			uvs[2*i] = u0+du*uvs[2*i];
+			uvs[2*i+1] = v0+dv*uvs[2*i+1];
+		}
+	}
+
+	void GLBI_Skyline_Packer::init(unsigned int w,unsigned int h) {
+		width = w;
+		height = h;
+		usedArea = 0;
+		skyline.clear();
+		Segment ground = {0,0,w};
+		skyline.push_back(ground);
+	}
+
+	unsigned int GLBI_Skyline_Packer::fit(size_t i,unsigned int w) const {
+		if (skyline[i].x+w > width) return height;
+		unsigned int y = 0,remaining = w;
+		for(size_t j=i;remaining > 0;j++) {
+			y = std::max(y,skyline[j].y);
+			if (skyline[j].w >= remaining) break;
+			remaining -= skyline[j].w;
+		}
+		return y;
+	}
+
+	bool GLBI_Skyline_Packer::insert(unsigned int w,unsigned int h,unsigned int& x,unsigned int& y) {
+		size_t best = skyline.size();
+		unsigned int best_top = 0,best_width = 0;
+		for(size_t i=0;i<skyline.size();i++) {
+			unsigned int top = fit(i,w)+h;
+			if (top > height) continue;
+			// Lowest top, then the narrowest segment (less wasted space beside the rectangle)
+			if ((best == skyline.size()) || (top < best_top) || ((top == best_top) && (skyline[i].w < best_width))) {
+				best = i;
+				best_top = top;
+				best_width = skyline[i].w;
+			}
+		}
+		if (best == skyline.size()) return false;
+		x = skyline[best].x;
+		y = best_top-h;
+
+		// The new segment hides the ones below it
+		Segment top = {x,best_top,w};
+		skyline.insert(skyline.begin()+best,top);
+		for(size_t i=best+1;(i<skyline.size()) && (skyline[i].x < x+w);) {
+			unsigned int hidden = x+w-skyline[i].x;
+			if (hidden >= skyline[i].w) {
+				skyline.erase(skyline.begin()+i);
+				continue;
+			}
+			skyline[i].x += hidden;
+			skyline[i].w -= hidden;
+			break;
+		}
+		for(size_t i=0;i+1<skyline.size();) {
+			if (skyline[i].y == skyline[i+1].y) {
+				skyline[i].w += skyline[i+1].w;
+				skyline.erase(skyline.begin()+i+1);
+			}
+			else i++;
+		}
+		usedArea += (unsigned long)w*h;
+		return true;
+	}
+
+	unsigned int GLBI_Skyline_Packer::usedHeight() const {
+		unsigned int h = 0;
+		for(size_t i=0;i<skyline.size();i++) h = std::max(h,skyline[i].y);
+		return h;
+	}
+
+	int GLBI_Texture_Atlas::addImage(unsigned int w,unsigned int h,unsigned int n_chan,const unsigned char* pixels) {
+		if (built) {
+			// Pixels of the packed images are freed : the pages can not be built again
+			std::cerr<<"Texture atlas : images can not be added after build"<<std::endl;
+			return -1;
+		}
+		if ((w == 0) || (h == 0) || (n_chan < 1) || (n_chan > 4) || (w+2*padding > pageSize) || (h+2*padding > pageSize)) {
+			std::cerr<<"Unable to add a "<<w<<"x"<<h<<" image with "<<n_chan<<" channels to an atlas of "
+			         <<pageSize<<"x"<<pageSize<<" pages"<<std::endl;
+			return -1;
+		}
+		std::vector<unsigned char> rgba(4*size_t(w)*h);
+		for(size_t i=0;i<size_t(w)*h;i++) {
+			const unsigned char* src = pixels+n_chan*i;
+			unsigned char* dst = rgba.data()+4*i;
+			if (n_chan < 3) dst[0] = dst[1] = dst[2] = src[0];
+			else memcpy(dst,src,3);
+			dst[3] = (n_chan == 2) ? src[1] : ((n_chan == 4) ? src[3] : 255);
+		}
+		images.push_back(std::vector<unsigned char>());
+		images.back().swap(rgba);
+		GLBI_Atlas_Region region;
+		region.w = w;
+		region.h = h;
+		regions.push_back(region);
+		return int(regions.size())-1;
+	}
+
+	int GLBI_Texture_Atlas::addImage(const std::string& filename) {
+		int w,h,channels;
+		std::vector<unsigned char> pixels;
+		if (!glbiReadImage(filename,w,h,channels,pixels)) return -1;
+		return addImage(w,h,channels,pixels.data());
+	}
+
+	bool GLBI_Texture_Atlas::build(const GLBI_Texture_Options& options) {
+		if (built || images.empty()) {
+			std::cerr<<"Texture atlas : no image to pack (build must be called once, after every addImage)"<<std::endl;
+			return false;
+		}
+		release();
+		packers.clear();
+
+		// Tallest images first : the skyline stays flat
+		std::vector<size_t> order(regions.size());
+		for(size_t i=0;i<order.size();i++) order[i] = i;
+		std::sort(order.begin(),order.end(),[this](size_t a,size_t b) {
+			if (regions[a].h != regions[b].h) return regions[a].h > regions[b].h;
+			return regions[a].w > regions[b].w;
+		});
+		for(size_t k=0;k<order.size();k++) {
+			GLBI_Atlas_Region& r = regions[order[k]];
+			unsigned int x,y;
+			size_t p = 0;
+			while ((p < packers.size()) && !packers[p].insert(r.w+2*padding,r.h+2*padding,x,y)) p++;
+			if (p == packers.size()) {
+				packers.push_back(GLBI_Skyline_Packer());
+				packers.back().init(pageSize,pageSize);
+				packers.back().insert(r.w+2*padding,r.h+2*padding,x,y);
+			}
+			r.page = p;
+			r.x = x+padding;
+			r.y = y+padding;
+		}
+
+		// Mip levels coarser than the padding would mix neighbours
+		unsigned int clean_levels = 1;
+		for(unsigned int s=padding;s>1;s>>=1) clean_levels++;
+		GLBI_Texture_Options page_options = options;
+		if ((page_options.maxLevels == 0) || (page_options.maxLevels > clean_levels)) page_options.maxLevels = clean_levels;
+
+		for(size_t p=0;p<packers.size();p++) {
+			// Pages are cut to the height used (multiple of 4 for block compression)
+			unsigned int page_h = std::min(pageSize,(packers[p].usedHeight()+3)&~3u);
+			std::vector<unsigned char> page(4*size_t(pageSize)*page_h,0);
+			for(size_t i=0;i<regions.size();i++) {
+				GLBI_Atlas_Region& r = regions[i];
+				if (r.page != p) continue;
+				// Padding texels repeat the border of the image
+				const unsigned char* img = images[i].data();
+				for(int row=-int(padding);row<int(r.h+padding);row++) {
+					const unsigned char* src = img+4*size_t(r.w)*std::min(std::max(row,0),int(r.h)-1);
+					unsigned char* dst = page.data()+4*(size_t(pageSize)*(r.y+row)+r.x);
+					for(unsigned int c=1;c<=padding;c++) {
+						memcpy(dst-4*c,src,4);
+						memcpy(dst+4*(r.w-1+c),src+4*(r.w-1),4);
+					}
+					memcpy(dst,src,4*size_t(r.w));
+				}
+				r.u0 = float(r.x)/pageSize;
+				r.u1 = float(r.x+r.w)/pageSize;
+				r.v0 = float(r.y)/page_h;
+				r.v1 = float(r.y+r.h)/page_h;
+			}
+			GLBI_Texture* texture = new GLBI_Texture();
+			texture->createTexture();
+			texture->attachTexture();
+			texture->loadImage(pageSize,page_h,4,page.data(),page_options);
+			texture->detachTexture();
+			pages.push_back(texture);
+		}
+		images.clear();
+		built = true;
+		return true;
+	}
+
+	void GLBI_Texture_Atlas::release() {
+		for(size_t i=0;i<pages.size();i++) delete pages[i];
+		pages.clear();
+	}
+
+	float GLBI_Texture_Atlas::occupancy() const {
+		if (packers.empty()) return 0.0f;
+		float sum = 0.0f;
+		for(size_t i=0;i<packers.size();i++) sum += packers[i].occupancy();
+		return sum/packers.size();
+	}
+
+}
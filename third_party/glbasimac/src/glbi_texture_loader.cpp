@@ -0,0 +1,195 @@
+#include "glbasimac/glbi_texture_loader.hpp"
+#include "glbasimac/glbi_image_io.hpp"
+#include "glbasimac/glbi_profiler.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace glbasimac {
+
+	GLBI_Texture_Loader::GLBI_Texture_Loader(unsigned int nb_threads,size_t bytes_per_frame)
+		:bytesPerFrame(bytes_per_frame),nbLoaded(0),nbFailed(0),nbBytesUploaded(0),nbPending(0),stopping(false),
+		 id_pbo(0),pboSize(0) {
+		if (nb_threads == 0) nb_threads = std::max(std::thread::hardware_concurrency(),2u)-1;
+		for(unsigned int i=0;i<nb_threads;i++) workers.push_back(std::thread(&GLBI_Texture_Loader::work,this));
+	}
+
+	GLBI_Texture_Loader::~GLBI_Texture_Loader() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		jobAdded.notify_all();
+		for(size_t i=0;i<workers.size();i++) workers[i].join();
+	}
+
+	void GLBI_Texture_Loader::load(const std::string& filename,GLBI_Texture& texture,const GLBI_Texture_Options& options) {
+		// Workers choose the internal format : driver features are queried here, on the GL thread
+		GLBI_Texture_Caps::get();
+		Job job;
+		job.filename = filename;
+		job.texture = &texture;
+		job.options = options;
+		job.decoded = job.allocated = false;
+		job.w = job.h = job.channels = 0;
+		job.level = job.row = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			toDecode.push_back(std::move(job));
+		}
+		nbPending++;
+		jobAdded.notify_one();
+	}
+
+	void GLBI_Texture_Loader::work() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			jobAdded.wait(lock,[this]() {return stopping || !toDecode.empty();});
+			if (stopping) return;
+			Job job = std::move(toDecode.front());
+			toDecode.pop_front();
+			lock.unlock();
+
+			std::vector<unsigned char> pixels;
+			job.decoded = glbiReadImage(job.filename,job.w,job.h,job.channels,pixels);
+			if (job.decoded) {
+				job.levels.push_back(std::move(pixels));
+				unsigned int format = GLBI_Texture::chooseInternalFormat(job.options.format,job.channels);
+				bool cpu_mipmaps = (job.options.mipmaps == GLBI_MIPMAP_CPU) ||
+				                   ((job.options.mipmaps == GLBI_MIPMAP_GPU) && GLBI_Texture::isCompressedFormat(format));
+				unsigned int lw = job.w,lh = job.h;
+				unsigned int max_levels = job.options.maxLevels ? job.options.maxLevels : ~0u;
+				while (cpu_mipmaps && ((lw > 1) || (lh > 1)) && (job.levels.size() < max_levels)) {
+					job.levels.push_back(std::vector<unsigned char>());
+					size_t l = job.levels.size()-1;
+					glbiDownsample(lw,lh,job.channels,job.levels[l-1].data(),GLBI_Texture::isSRGBFormat(format),job.levels[l]);
+					lw = std::max(lw/2,1u);
+					lh = std::max(lh/2,1u);
+				}
+			}
+
+			lock.lock();
+			decoded.push_back(std::move(job));
+			jobDecoded.notify_all();
+		}
+	}
+
+	unsigned int GLBI_Texture_Loader::update() {
+		GLBI_PROFILE_STAGE("texture uploads");
+		return upload(bytesPerFrame);
+	}
+
+	void GLBI_Texture_Loader::finish() {
+		while (nbPending > 0) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobDecoded.wait(lock,[this]() {return !decoded.empty() || !uploading.empty();});
+			}
+			upload(bytesPerFrame);
+		}
+	}
+
+	unsigned int GLBI_Texture_Loader::upload(size_t budget) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			while (!decoded.empty()) {
+				uploading.push_back(std::move(decoded.front()));
+				decoded.pop_front();
+			}
+		}
+
+		// Bands of rows to upload this frame, packed one after the other in the pixel buffer
+		struct Band {
+			Job* job;
+			unsigned int level,y,nbRows;
+			const unsigned char* src;
+			size_t offset,size;
+		};
+		std::vector<Band> bands;
+		size_t total = 0;
+		for(size_t i=0;(i<uploading.size()) && (total<budget);i++) {
+			Job& job = uploading[i];
+			if (!job.decoded) continue;
+			bool compressed = GLBI_Texture::isCompressedFormat(GLBI_Texture::chooseInternalFormat(job.options.format,job.channels));
+			while (job.level < job.levels.size()) {
+				unsigned int lw = std::max(unsigned(job.w)>>job.level,1u),lh = std::max(unsigned(job.h)>>job.level,1u);
+				size_t row_size = size_t(lw)*job.channels;
+				unsigned int nb_rows = lh-job.row;
+				if (total+nb_rows*row_size > budget) {
+					nb_rows = (budget > total) ? unsigned((budget-total)/row_size) : 0;
+					// Compressed formats are updated by blocks of 4x4 texels
+					if (compressed) nb_rows &= ~3u;
+					if (nb_rows == 0) {
+						if (!bands.empty()) break;
+						nb_rows = std::min(4u,lh-job.row);
+					}
+				}
+				Band band = {&job,job.level,job.row,nb_rows,job.levels[job.level].data()+job.row*row_size,total,nb_rows*row_size};
+				bands.push_back(band);
+				total += band.size;
+				job.row += nb_rows;
+				if (job.row < lh) break;
+				job.level++;
+				job.row = 0;
+			}
+		}
+
+		if (!bands.empty()) {
+			// Storage is allocated before binding the pixel buffer (glTexImage2D would read it)
+			for(size_t i=0;i<bands.size();i++) {
+				Job& job = *bands[i].job;
+				if (job.allocated) continue;
+				if (!job.texture->id_in_GL) job.texture->createTexture();
+				job.allocated = job.texture->allocate(job.w,job.h,job.channels,job.options);
+			}
+			if (!id_pbo) glGenBuffers(1,&id_pbo);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER,id_pbo);
+			// Orphaning : if the GPU still reads the previous content, the driver hands a new storage
+			pboSize = std::max(pboSize,total);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER,pboSize,NULL,GL_STREAM_DRAW);
+			unsigned char* dst = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,0,total,
+			                                                      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			if (!dst) glBindBuffer(GL_PIXEL_UNPACK_BUFFER,0);
+			for(size_t i=0;dst && (i<bands.size());i++) memcpy(dst+bands[i].offset,bands[i].src,bands[i].size);
+			if (dst) glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			for(size_t i=0;i<bands.size();i++) {
+				const Band& b = bands[i];
+				glBindTexture(GL_TEXTURE_2D,b.job->texture->id_in_GL);
+				// Without pixel buffer (mapping failure), rows are read from main memory
+				b.job->texture->uploadRows(b.level,b.y,b.nbRows,dst ? (const void*)b.offset : b.src);
+			}
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER,0);
+			nbBytesUploaded += total;
+		}
+
+		// Completed and failed textures
+		unsigned int nb_completed = 0;
+		std::deque<Job> remaining;
+		for(size_t i=0;i<uploading.size();i++) {
+			Job& job = uploading[i];
+			if (!job.decoded) {
+				nbFailed++;
+				nbPending--;
+			}
+			else if (job.level == job.levels.size()) {
+				glBindTexture(GL_TEXTURE_2D,job.texture->id_in_GL);
+				job.texture->completeUpload(job.options);
+				nbLoaded++;
+				nbPending--;
+				nb_completed++;
+			}
+			else {
+				remaining.push_back(std::move(job));
+			}
+		}
+		uploading.swap(remaining);
+		if (!bands.empty()) glBindTexture(GL_TEXTURE_2D,0);
+		return nb_completed;
+	}
+
+	void GLBI_Texture_Loader::release() {
+		if (id_pbo) glDeleteBuffers(1,&id_pbo);
+		id_pbo = 0;
+		pboSize = 0;
+	}
+
+}
@@ -0,0 +1,133 @@
+#include "glbasimac/glbi_transform_node.hpp"
+#include <algorithm>
+
+namespace glbasimac {
+
+	GLBI_Transform_Node::GLBI_Transform_Node(GLBI_Transform_Node* parent_node)
+		:nbWorldUpdates(0),nbNormalUpdates(0),parent(nullptr),
+		 translation(0.0),angle(0.0),axe(0.0,0.0,1.0),scale(1.0),useTRS(true),
+		 localDirty(false),worldDirty(true),normalDirty(true),localSimilarity(true),worldSimilarity(true) {
+		setParent(parent_node);
+	}
+
+	GLBI_Transform_Node::~GLBI_Transform_Node() {
+		if (parent) parent->removeChild(this);
+		for(size_t i=0;i<children.size();i++) {
+			children[i]->parent = nullptr;
+			children[i]->markDirty();
+		}
+	}
+
+	void GLBI_Transform_Node::removeChild(GLBI_Transform_Node* child) {
+		children.erase(std::remove(children.begin(),children.end(),child),children.end());
+	}
+
+	void GLBI_Transform_Node::setParent(GLBI_Transform_Node* parent_node) {
+		if (parent_node == parent) return;
+		for(GLBI_Transform_Node* p = parent_node;p != nullptr;p = p->parent) {
+			if (p == this) {
+				std::cerr<<"Unable to set a descendant as parent of a transform node"<<std::endl;
+				return;
+			}
+		}
+		if (parent) parent->removeChild(this);
+		parent = parent_node;
+		if (parent) parent->children.push_back(this);
+		worldDirty = false; // Force the propagation
+		markDirty();
+	}
+
+	void GLBI_Transform_Node::markDirty() {
+		// A dirty node has only dirty descendants : no need to go further
+		if (worldDirty) return;
+		worldDirty = true;
+		for(size_t i=0;i<children.size();i++) children[i]->markDirty();
+	}
+
+	void GLBI_Transform_Node::setTranslation(float x,float y,float z) {
+		translation = Vector3D(x,y,z);
+		useTRS = localDirty = true;
+		markDirty();
+	}
+
+	void GLBI_Transform_Node::setRotation(float new_angle,const Vector3D& new_axe) {
+		angle = new_angle;
+		axe = new_axe;
+		useTRS = localDirty = true;
+		markDirty();
+	}
+
+	void GLBI_Transform_Node::setScale(float sx,float sy,float sz) {
+		scale = Vector3D(sx,sy,sz);
+		useTRS = localDirty = true;
+		markDirty();
+	}
+
+	void GLBI_Transform_Node::setLocalMatrix(const Matrix4D& m) {
+		local = m;
+		useTRS = localDirty = false;
+		localSimilarity = local.isSimilarity();
+		markDirty();
+	}
+
+	const Matrix4D& GLBI_Transform_Node::getLocalMatrix() {
+		if (localDirty) {
+			// Same specialized products as the matrix stack
+			local = Matrix4D::translation(translation.x,translation.y,translation.z);
+			if (angle != 0.0f) local.mulTransformation(Matrix4D::rotation(angle,axe));
+			local.mulHomothety(scale.x,scale.y,scale.z);
+			localSimilarity = (fabs(scale.x) == fabs(scale.y)) && (fabs(scale.x) == fabs(scale.z));
+			localDirty = false;
+		}
+		return local;
+	}
+
+	const Matrix4D& GLBI_Transform_Node::getWorldMatrix() {
+		if (worldDirty) {
+			const Matrix4D& l = getLocalMatrix();
+			if (parent) {
+				world = parent->getWorldMatrix();
+				world.mulTransformation(l);
+				worldSimilarity = localSimilarity && parent->worldSimilarity;
+			}
+			else {
+				world = l;
+				worldSimilarity = localSimilarity;
+			}
+			worldDirty = false;
+			normalDirty = true;
+			nbWorldUpdates++;
+		}
+		return world;
+	}
+
+	const Matrix4D& GLBI_Transform_Node::getNormalMatrix() {
+		const Matrix4D& w = getWorldMatrix();
+		if (normalDirty) {
+			if (worldSimilarity) {
+				// Inverse transpose of s*R is R/s = (s*R)/s^2
+				float s2 = w.mat[0]*w.mat[0]+w.mat[1]*w.mat[1]+w.mat[2]*w.mat[2];
+				float inv_s2 = (s2 > 0.0f) ? 1.0f/s2 : 0.0f;
+				for(int c=0;c<3;c++) {
+					for(int l=0;l<3;l++) normal.mat[4*c+l] = w.mat[4*c+l]*inv_s2;
+					normal.mat[4*c+3] = 0.0f;
+				}
+				normal.mat[12] = normal.mat[13] = normal.mat[14] = 0.0f;
+				normal.mat[15] = 1.0f;
+			}
+			else {
+				normal = w;
+				normal.normalFromModelview();
+			}
+			normalDirty = false;
+			nbNormalUpdates++;
+		}
+		return normal;
+	}
+
+	bool GLBI_Transform_Node::isSimilarity() {
+		getWorldMatrix();
+		return worldSimilarity;
+	}
+
+}
@@ -0,0 +1,270 @@
+#ifndef _STP3D_BATCH_TRANSFORM_HPP_
+#define _STP3D_BATCH_TRANSFORM_HPP_
+
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "globals.hpp"
+#include "vector3d.hpp"
+#include "matrix4d.hpp"
+
+/** \addtogroup Macros */
+/*@{*/
+/** Minimum number of points given to each thread by the batch transforms.
+  * Smaller batches are transformed by the calling thread only.
+  */
+#define STP3D_BATCH_POINTS_PER_THREAD 65536
+/*@}*/
+
+namespace STP3D {
+
+	/**
+	  * Batch transforms : apply one Matrix4D to arrays of 3D points or directions.
+	  * Two layouts are accepted :
+	  *   - AoS : packed xyz triplets (as in the buffers of a StandardMesh or an array of Vector3D) ;
+	  *   - SoA : one array per coordinate.
+	  * Points use w = 1, directions use w = 0 (translation ignored), projected points use w = 1
+	  * and are divided by the resulting w (clip space to normalized device coordinates : points
+	  * with w <= 0, behind the eye, give meaningless results).
+	  * Output arrays may be the input arrays (in place transform) but must not partially overlap them.
+	  * Large batches are split between \a nb_threads threads (0 : one per core, as long as each
+	  * thread gets STP3D_BATCH_POINTS_PER_THREAD points).
+	  */
+	enum BatchTransformMode {
+		STP3D_BATCH_POINTS = 0,
+		STP3D_BATCH_DIRECTIONS = 1,
+		STP3D_BATCH_PROJECT = 2
+	};
+
+	namespace batch_detail {
+
+		/// Transform of one xyz triplet
+		template<int mode>
+		inline void scalarPoint(const float* m,float x,float y,float z,float* ox,float* oy,float* oz) {
+			float w = (mode == STP3D_BATCH_DIRECTIONS) ? 0.0f : 1.0f;
+			float rx = m[0]*x + m[4]*y + m[8]*z + m[12]*w;
+			float ry = m[1]*x + m[5]*y + m[9]*z + m[13]*w;
+			float rz = m[2]*x + m[6]*y + m[10]*z + m[14]*w;
+			if (mode == STP3D_BATCH_PROJECT) {
+				float inv_w = 1.0f/(m[3]*x + m[7]*y + m[11]*z + m[15]);
+				rx *= inv_w; ry *= inv_w; rz *= inv_w;
+			}
+			*ox = rx; *oy = ry; *oz = rz;
+		}
+
+#ifdef STP3D_USE_SSE
+		/// Coefficients of the matrix, each broadcast in a register
+		struct SSEMatrix {
+			SSEMatrix(const float* m,BatchTransformMode mode) {
+				for(int i=0;i<16;i++) c[i] = _mm_set1_ps(m[i]);
+				if (mode == STP3D_BATCH_DIRECTIONS) c[12] = c[13] = c[14] = c[15] = _mm_setzero_ps();
+			}
+			__m128 c[16];
+		};
+
+		/// Transform 4 points given by coordinates
+		template<int mode>
+		inline void sse4(const SSEMatrix& m,__m128& x,__m128& y,__m128& z) {
+			__m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.c[0],x),_mm_mul_ps(m.c[4],y)),_mm_add_ps(_mm_mul_ps(m.c[8],z),m.c[12]));
+			__m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.c[1],x),_mm_mul_ps(m.c[5],y)),_mm_add_ps(_mm_mul_ps(m.c[9],z),m.c[13]));
+			__m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.c[2],x),_mm_mul_ps(m.c[6],y)),_mm_add_ps(_mm_mul_ps(m.c[10],z),m.c[14]));
+			if (mode == STP3D_BATCH_PROJECT) {
+				__m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.c[3],x),_mm_mul_ps(m.c[7],y)),_mm_add_ps(_mm_mul_ps(m.c[11],z),m.c[15]));
+				__m128 inv_w = _mm_div_ps(_mm_set1_ps(1.0f),w);
+				rx = _mm_mul_ps(rx,inv_w);
+				ry = _mm_mul_ps(ry,inv_w);
+				rz = _mm_mul_ps(rz,inv_w);
+			}
+			x = rx; y = ry; z = rz;
+		}
+#endif
+
+#ifdef STP3D_USE_AVX2
+		/// Transform 8 points given by coordinates (same as sse4 on 256 bits registers)
+		template<int mode>
+		inline void avx8(const __m256* c,__m256& x,__m256& y,__m256& z) {
+#ifdef __FMA__
+			__m256 rx = _mm256_fmadd_ps(c[0],x,_mm256_fmadd_ps(c[4],y,_mm256_fmadd_ps(c[8],z,c[12])));
+			__m256 ry = _mm256_fmadd_ps(c[1],x,_mm256_fmadd_ps(c[5],y,_mm256_fmadd_ps(c[9],z,c[13])));
+			__m256 rz = _mm256_fmadd_ps(c[2],x,_mm256_fmadd_ps(c[6],y,_mm256_fmadd_ps(c[10],z,c[14])));
+#else
+			__m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[0],x),_mm256_mul_ps(c[4],y)),_mm256_add_ps(_mm256_mul_ps(c[8],z),c[12]));
+			__m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[1],x),_mm256_mul_ps(c[5],y)),_mm256_add_ps(_mm256_mul_ps(c[9],z),c[13]));
+			__m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[2],x),_mm256_mul_ps(c[6],y)),_mm256_add_ps(_mm256_mul_ps(c[10],z),c[14]));
+#endif
+			if (mode == STP3D_BATCH_PROJECT) {
+				__m256 w = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[3],x),_mm256_mul_ps(c[7],y)),_mm256_add_ps(_mm256_mul_ps(c[11],z),c[15]));
+				__m256 inv_w = _mm256_div_ps(_mm256_set1_ps(1.0f),w);
+				rx = _mm256_mul_ps(rx,inv_w);
+				ry = _mm256_mul_ps(ry,inv_w);
+				rz = _mm256_mul_ps(rz,inv_w);
+			}
+			x = rx; y = ry; z = rz;
+		}
+#endif
+
+		/// SoA transform of points [first,last[
+		template<int mode>
+		inline void rangeSoA(const float* m,size_t first,size_t last,
+		                     const float* x,const float* y,const float* z,float* ox,float* oy,float* oz) {
+			size_t i = first;
+			// Local copy : the compiler knows stores to the outputs do not change the matrix
+			float mc[16];
+			memcpy(mc,m,16*sizeof(float));
+#if defined(STP3D_USE_AVX2)
+			__m256 c[16];
+			for(int k=0;k<16;k++) c[k] = _mm256_set1_ps(((mode == STP3D_BATCH_DIRECTIONS) && (k >= 12)) ? 0.0f : mc[k]);
+			for(;i+8<=last;i+=8) {
+				__m256 vx = _mm256_loadu_ps(x+i);
+				__m256 vy = _mm256_loadu_ps(y+i);
+				__m256 vz = _mm256_loadu_ps(z+i);
+				avx8<mode>(c,vx,vy,vz);
+				_mm256_storeu_ps(ox+i,vx);
+				_mm256_storeu_ps(oy+i,vy);
+				_mm256_storeu_ps(oz+i,vz);
+			}
+#elif defined(STP3D_USE_SSE)
+			SSEMatrix sm(mc,BatchTransformMode(mode));
+			for(;i+4<=last;i+=4) {
+				__m128 vx = _mm_loadu_ps(x+i);
+				__m128 vy = _mm_loadu_ps(y+i);
+				__m128 vz = _mm_loadu_ps(z+i);
+				sse4<mode>(sm,vx,vy,vz);
+				_mm_storeu_ps(ox+i,vx);
+				_mm_storeu_ps(oy+i,vy);
+				_mm_storeu_ps(oz+i,vz);
+			}
+#endif
+			for(;i<last;i++) scalarPoint<mode>(mc,x[i],y[i],z[i],ox+i,oy+i,oz+i);
+		}
+
+		/// AoS transform of points [first,last[ (xyz triplets)
+		template<int mode>
+		inline void rangeAoS(const float* m,size_t first,size_t last,const float* src,float* dst) {
+			size_t i = first;
+			// Local copy : the compiler knows stores to the outputs do not change the matrix
+			float mc[16];
+			memcpy(mc,m,16*sizeof(float));
+#if defined(STP3D_USE_SSE)
+			SSEMatrix sm(mc,BatchTransformMode(mode));
+#define STP3D_SHUF(a,b,x,y,z,w) _mm_shuffle_ps(a,b,_MM_SHUFFLE(w,z,y,x))
+			// 4 points are 3 registers : (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3)
+			for(;i+4<=last;i+=4) {
+				__m128 v0 = _mm_loadu_ps(src+3*i);
+				__m128 v1 = _mm_loadu_ps(src+3*i+4);
+				__m128 v2 = _mm_loadu_ps(src+3*i+8);
+				__m128 x = STP3D_SHUF(v0,STP3D_SHUF(v1,v2,2,2,1,1),0,3,0,2);
+				__m128 y = STP3D_SHUF(STP3D_SHUF(v0,v1,1,1,0,0),STP3D_SHUF(v1,v2,3,3,2,2),0,2,0,2);
+				__m128 z = STP3D_SHUF(STP3D_SHUF(v0,v1,2,2,1,1),STP3D_SHUF(v2,v2,0,0,3,3),0,2,0,2);
+				sse4<mode>(sm,x,y,z);
+				__m128 xy_lo = _mm_unpacklo_ps(x,y);
+				__m128 xy_hi = _mm_unpackhi_ps(x,y);
+				_mm_storeu_ps(dst+3*i,STP3D_SHUF(xy_lo,STP3D_SHUF(z,x,0,0,1,1),0,1,0,2));
+				_mm_storeu_ps(dst+3*i+4,STP3D_SHUF(STP3D_SHUF(y,z,1,1,1,1),xy_hi,0,2,0,1));
+				_mm_storeu_ps(dst+3*i+8,STP3D_SHUF(STP3D_SHUF(z,x,2,2,3,3),STP3D_SHUF(y,z,3,3,3,3),0,2,0,2));
+			}
+#undef STP3D_SHUF
+#endif
+			for(;i<last;i++) scalarPoint<mode>(mc,src[3*i],src[3*i+1],src[3*i+2],dst+3*i,dst+3*i+1,dst+3*i+2);
+		}
+
+		/// Number of threads used for \a nb points
+		inline unsigned int nbThreads(size_t nb,unsigned int nb_threads) {
+			if (nb_threads == 0) {
+				nb_threads = std::thread::hardware_concurrency();
+				if (nb_threads == 0) nb_threads = 1;
+			}
+			size_t max_threads = nb/STP3D_BATCH_POINTS_PER_THREAD;
+			if (max_threads < nb_threads) nb_threads = (max_threads == 0) ? 1 : (unsigned int)max_threads;
+			return nb_threads;
+		}
+
+		/// Call \a job on ranges of [0,nb[ spread between threads (ranges are multiple of 8 points)
+		template<typename Job>
+		inline void parallelFor(size_t nb,unsigned int nb_threads,Job job) {
+			nb_threads = nbThreads(nb,nb_threads);
+			if (nb_threads <= 1) {
+				job(0,nb);
+				return;
+			}
+			size_t chunk = ((nb/nb_threads)+7) & ~size_t(7);
+			std::vector<std::thread> workers;
+			workers.reserve(nb_threads-1);
+			size_t first = chunk;
+			for(unsigned int t=1;(t<nb_threads) && (first<nb);t++,first+=chunk) {
+				size_t last = (first+chunk < nb) ? first+chunk : nb;
+				workers.push_back(std::thread(job,first,last));
+			}
+			job(0,(chunk < nb) ? chunk : nb);
+			for(size_t t=0;t<workers.size();t++) workers[t].join();
+		}
+	}
+
+	/** Transform \a nb points stored as packed xyz triplets (AoS layout).
+	  * \param mode points, directions or projected points (see BatchTransformMode)
+	  * \param src,dst 3*nb floats (dst may be src)
+	  */
+	inline void batchTransform(const Matrix4D& m,BatchTransformMode mode,const float* src,float* dst,size_t nb,unsigned int nb_threads = 0) {
+		const float* coef = m.mat;
+		batch_detail::parallelFor(nb,nb_threads,[=](size_t first,size_t last) {
+			switch (mode) {
+				case STP3D_BATCH_POINTS : batch_detail::rangeAoS<STP3D_BATCH_POINTS>(coef,first,last,src,dst); break;
+				case STP3D_BATCH_DIRECTIONS : batch_detail::rangeAoS<STP3D_BATCH_DIRECTIONS>(coef,first,last,src,dst); break;
+				case STP3D_BATCH_PROJECT : batch_detail::rangeAoS<STP3D_BATCH_PROJECT>(coef,first,last,src,dst); break;
+			}
+		});
+	}
+
+	/** Transform \a nb points stored in one array per coordinate (SoA layout).
+	  * \param mode points, directions or projected points (see BatchTransformMode)
+	  * \param x,y,z input coordinates (nb floats each)
+	  * \param ox,oy,oz output coordinates (may be x, y and z)
+	  */
+	inline void batchTransform(const Matrix4D& m,BatchTransformMode mode,const float* x,const float* y,const float* z,
+	                           float* ox,float* oy,float* oz,size_t nb,unsigned int nb_threads = 0) {
+		const float* coef = m.mat;
+		batch_detail::parallelFor(nb,nb_threads,[=](size_t first,size_t last) {
+			switch (mode) {
+				case STP3D_BATCH_POINTS : batch_detail::rangeSoA<STP3D_BATCH_POINTS>(coef,first,last,x,y,z,ox,oy,oz); break;
+				case STP3D_BATCH_DIRECTIONS : batch_detail::rangeSoA<STP3D_BATCH_DIRECTIONS>(coef,first,last,x,y,z,ox,oy,oz); break;
+				case STP3D_BATCH_PROJECT : batch_detail::rangeSoA<STP3D_BATCH_PROJECT>(coef,first,last,x,y,z,ox,oy,oz); break;
+			}
+		});
+	}
+
+	/** \name Shortcuts
+	  */
+	//@{
+	/// Points (w = 1), AoS layout
+	inline void transformPoints(const Matrix4D& m,const float* src,float* dst,size_t nb,unsigned int nb_threads = 0) {
+		batchTransform(m,STP3D_BATCH_POINTS,src,dst,nb,nb_threads);
+	}
+	/// Directions (w = 0), AoS layout
+	inline void transformDirections(const Matrix4D& m,const float* src,float* dst,size_t nb,unsigned int nb_threads = 0) {
+		batchTransform(m,STP3D_BATCH_DIRECTIONS,src,dst,nb,nb_threads);
+	}
+	/// Points with perspective divide, AoS layout
+	inline void projectPoints(const Matrix4D& m,const float* src,float* dst,size_t nb,unsigned int nb_threads = 0) {
+		batchTransform(m,STP3D_BATCH_PROJECT,src,dst,nb,nb_threads);
+	}
+	/// Points (w = 1), array of Vector3D
+	inline void transformPoints(const Matrix4D& m,const Vector3D* src,Vector3D* dst,size_t nb,unsigned int nb_threads = 0) {
+		static_assert(sizeof(Vector3D) == 3*sizeof(float),"Vector3D must be packed xyz floats");
+		batchTransform(m,STP3D_BATCH_POINTS,reinterpret_cast<const float*>(src),reinterpret_cast<float*>(dst),nb,nb_threads);
+	}
+	/// Directions (w = 0), array of Vector3D
+	inline void transformDirections(const Matrix4D& m,const Vector3D* src,Vector3D* dst,size_t nb,unsigned int nb_threads = 0) {
+		static_assert(sizeof(Vector3D) == 3*sizeof(float),"Vector3D must be packed xyz floats");
+		batchTransform(m,STP3D_BATCH_DIRECTIONS,reinterpret_cast<const float*>(src),reinterpret_cast<float*>(dst),nb,nb_threads);
+	}
+	/// Points with perspective divide, array of Vector3D
+	inline void projectPoints(const Matrix4D& m,const Vector3D* src,Vector3D* dst,size_t nb,unsigned int nb_threads = 0) {
+		static_assert(sizeof(Vector3D) == 3*sizeof(float),"Vector3D must be packed xyz floats");
+		batchTransform(m,STP3D_BATCH_PROJECT,reinterpret_cast<const float*>(src),reinterpret_cast<float*>(dst),nb,nb_threads);
+	}
+	//@}
+
+};
+
+#endif
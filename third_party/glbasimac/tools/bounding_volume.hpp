@@ -0,0 +1,69 @@
+#ifndef _STP3D_BOUNDING_VOLUME_HPP_
+#define _STP3D_BOUNDING_VOLUME_HPP_
+
+#include <cfloat>
+#include <cmath>
+#include "globals.hpp"
+#include "vector3d.hpp"
+
+namespace STP3D {
+
+	/**
+	  * Axis aligned bounding box. An empty box has pmin > pmax.
+	  * Meshes compute the box of their coordinates (attribute 0) when their buffers are created (see createVAO).
+	  */
+	struct BoundingBox {
+		BoundingBox():pmin(FLT_MAX),pmax(-FLT_MAX) {}
+		BoundingBox(const Vector3D& p_min,const Vector3D& p_max):pmin(p_min),pmax(p_max) {}
+
+		bool isEmpty() const {return pmin.x > pmax.x;}
+		/// Extend the box to \param nb points of \param dim coordinates (2 or 3, z = 0 in 2D)
+		void extend(const float* coords,unsigned int nb,unsigned int dim = 3) {
+			for(unsigned int i=0;i<nb;i++,coords+=dim) {
+				for(unsigned int c=0;c<3;c++) {
+					float v = (c < dim) ? coords[c] : 0.0f;
+					if (v < pmin[c]) pmin[c] = v;
+					if (v > pmax[c]) pmax[c] = v;
+				}
+			}
+		}
+		Vector3D center() const {return (pmin+pmax)*0.5f;}
+		/// Half size along each axis
+		Vector3D extent() const {return (pmax-pmin)*0.5f;}
+
+		Vector3D pmin;
+		Vector3D pmax;
+	};
+
+	/// Bounding sphere. An empty sphere has a negative radius.
+	struct BoundingSphere {
+		BoundingSphere():center(0.0f),radius(-1.0f) {}
+
+		bool isEmpty() const {return radius < 0.0f;}
+		/// Sphere centered on \param box enclosing \param nb points of \param dim coordinates
+		void around(const BoundingBox& box,const float* coords,unsigned int nb,unsigned int dim = 3) {
+			center = box.center();
+			radius = -1.0f;
+			enclose(coords,nb,dim);
+		}
+		/// Grow the radius (center kept) to enclose \param nb more points
+		void enclose(const float* coords,unsigned int nb,unsigned int dim = 3) {
+			float r2 = (radius < 0.0f) ? -1.0f : radius*radius;
+			for(unsigned int i=0;i<nb;i++,coords+=dim) {
+				float d2 = 0.0f;
+				for(unsigned int c=0;c<3;c++) {
+					float d = ((c < dim) ? coords[c] : 0.0f)-center[c];
+					d2 += d*d;
+				}
+				if (d2 > r2) r2 = d2;
+			}
+			radius = (r2 < 0.0f) ? -1.0f : std::sqrt(r2);
+		}
+
+		Vector3D center;
+		float radius;
+	};
+
+};
+
+#endif
@@ -24,6 +24,7 @@
 #include "vector4d.hpp"
 #include "vector3d.hpp"
 #include "matrix4d.hpp"
+#include "frustum.hpp"
 
 #define STP3D_DEFAULT_LEFT_RIGHT 0.1*0.577350269
 #define STP3D_DEFAULT_TOP_BOTTOM 0.1*0.577350269
@@ -96,6 +97,10 @@ public:
 	Matrix4D returnViewMatrix() {
 		return viewMatrix;
 	};
+	/// Return the view frustum in world space (planes of projection*view) to cull world space bounds
+	Frustum returnFrustum() {
+		return Frustum(projMatrix*viewMatrix);
+	};
 
 	/** \name Fonctions de déplacement générique (déplacement / orientation)
 	  * \todo English traduction
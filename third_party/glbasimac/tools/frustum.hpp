@@ -0,0 +1,194 @@
+#ifndef _STP3D_FRUSTUM_HPP_
+#define _STP3D_FRUSTUM_HPP_
+
+#include <cmath>
+#include <vector>
+#include "globals.hpp"
+#include "vector3d.hpp"
+#include "matrix4d.hpp"
+#include "bounding_volume.hpp"
+
+namespace STP3D {
+
+	/**
+	  * View frustum as 6 planes (left, right, bottom, top, near, far), extracted from a projection matrix
+	  * (Gribb and Hartmann). Planes are normalized and point inside : a x + b y + c z + d >= 0 inside.
+	  * Planes are in the space of the points given to the matrix : with projection*view, bounds are
+	  * tested in world space; with the projection only, they are tested in view space.
+	  */
+	struct Frustum {
+		Frustum() {}
+		explicit Frustum(const Matrix4D& clip_matrix) {extract(clip_matrix);}
+
+		void extract(const Matrix4D& clip_matrix);
+		/// True if the sphere intersects the frustum
+		bool testSphere(const Vector3D& center,float radius) const;
+		/// True if the box given by its \param center and half size \param extent intersects the frustum.
+		/// Conservative : boxes near a corner of the frustum may be accepted while outside.
+		bool testBox(const Vector3D& center,const Vector3D& extent) const;
+		bool testBox(const BoundingBox& box) const {return testBox(box.center(),box.extent());}
+
+		float planes[6][4];
+	};
+
+	/// Box enclosing \param box transformed by the affine matrix \param m, given by its \param center and half size \param extent
+	void transformBox(const BoundingBox& box,const Matrix4D& m,Vector3D& center,Vector3D& extent);
+
+	/**
+	  * Batch culling : boxes are transformed (typically by model or modelview matrices) then stored
+	  * by coordinates (center and half size), so that cull tests 4 (SSE) or 8 (AVX2) boxes at a time
+	  * against every plane.
+	  */
+	struct FrustumCuller {
+		void clear() {cx.clear(); cy.clear(); cz.clear(); ex.clear(); ey.clear(); ez.clear();}
+		size_t size() const {return cx.size();}
+		void reserve(size_t nb);
+		/// Add \param box transformed by the affine matrix \param transform (box enclosing the result). Return its index
+		size_t addBox(const BoundingBox& box,const Matrix4D& transform);
+		/// Add a box given by its \param center and half size \param extent. Return its index
+		size_t addBox(const Vector3D& center,const Vector3D& extent);
+		/// Test every box : visible[i] is 1 if box i intersects \param frustum, 0 otherwise. Return the number of visible boxes
+		size_t cull(const Frustum& frustum,std::vector<unsigned char>& visible) const;
+
+		/// Centers and half sizes of the boxes
+		std::vector<float> cx,cy,cz;
+		std::vector<float> ex,ey,ez;
+	};
+
+	namespace frustum_detail {
+
+		/// Test of boxes [first,last[ with one box at a time
+		inline size_t cullScalar(const Frustum& f,const FrustumCuller& b,size_t first,size_t last,unsigned char* visible) {
+			size_t nb = 0;
+			for(size_t i=first;i<last;i++) {
+				bool inside = true;
+				for(int p=0;(p<6) && inside;p++) {
+					const float* pl = f.planes[p];
+					float d = pl[0]*b.cx[i]+pl[1]*b.cy[i]+pl[2]*b.cz[i]+pl[3];
+					float r = std::fabs(pl[0])*b.ex[i]+std::fabs(pl[1])*b.ey[i]+std::fabs(pl[2])*b.ez[i];
+					inside = (d+r >= 0.0f);
+				}
+				visible[i] = inside ? 1 : 0;
+				nb += inside;
+			}
+			return nb;
+		}
+
+	}
+
+	inline void Frustum::extract(const Matrix4D& clip_matrix) {
+		// Row i of the column-major matrix : m[i], m[4+i], m[8+i], m[12+i]
+		const float* m = clip_matrix.mat;
+		for(int p=0;p<6;p++) {
+			int row = p/2;
+			float sign = (p%2 == 0) ? 1.0f : -1.0f;
+			for(int c=0;c<4;c++) planes[p][c] = m[4*c+3]+sign*m[4*c+row];
+			float len = std::sqrt(planes[p][0]*planes[p][0]+planes[p][1]*planes[p][1]+planes[p][2]*planes[p][2]);
+			if (len > 0.0f) for(int c=0;c<4;c++) planes[p][c] /= len;
+		}
+	}
+
+	inline bool Frustum::testSphere(const Vector3D& center,float radius) const {
+		for(int p=0;p<6;p++) {
+			if (planes[p][0]*center.x+planes[p][1]*center.y+planes[p][2]*center.z+planes[p][3] < -radius) return false;
+		}
+		return true;
+	}
+
+	inline bool Frustum::testBox(const Vector3D& center,const Vector3D& extent) const {
+		for(int p=0;p<6;p++) {
+			const float* pl = planes[p];
+			float d = pl[0]*center.x+pl[1]*center.y+pl[2]*center.z+pl[3];
+			float r = std::fabs(pl[0])*extent.x+std::fabs(pl[1])*extent.y+std::fabs(pl[2])*extent.z;
+			if (d+r < 0.0f) return false;
+		}
+		return true;
+	}
+
+	inline void transformBox(const BoundingBox& box,const Matrix4D& transform,Vector3D& center,Vector3D& extent) {
+		// Center transformed as a point, half size by the absolute values of the linear part (Arvo)
+		const float* m = transform.mat;
+		Vector3D c = box.center(),e = box.extent();
+		for(int i=0;i<3;i++) {
+			center[i] = m[i]*c.x+m[4+i]*c.y+m[8+i]*c.z+m[12+i];
+			extent[i] = std::fabs(m[i])*e.x+std::fabs(m[4+i])*e.y+std::fabs(m[8+i])*e.z;
+		}
+	}
+
+	inline void FrustumCuller::reserve(size_t nb) {
+		cx.reserve(nb); cy.reserve(nb); cz.reserve(nb);
+		ex.reserve(nb); ey.reserve(nb); ez.reserve(nb);
+	}
+
+	inline size_t FrustumCuller::addBox(const BoundingBox& box,const Matrix4D& transform) {
+		Vector3D center,extent;
+		transformBox(box,transform,center,extent);
+		return addBox(center,extent);
+	}
+
+	inline size_t FrustumCuller::addBox(const Vector3D& center,const Vector3D& extent) {
+		cx.push_back(center.x); cy.push_back(center.y); cz.push_back(center.z);
+		ex.push_back(extent.x); ey.push_back(extent.y); ez.push_back(extent.z);
+		return cx.size()-1;
+	}
+
+	inline size_t FrustumCuller::cull(const Frustum& frustum,std::vector<unsigned char>& visible) const {
+		size_t n = size();
+		visible.resize(n);
+		size_t i = 0,nb = 0;
+#if defined(STP3D_USE_AVX2)
+		const __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+		__m256 pl[6][4];
+		for(int p=0;p<6;p++) {
+			for(int c=0;c<4;c++) pl[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+		}
+		for(;i+8<=n;i+=8) {
+			__m256 x = _mm256_loadu_ps(&cx[i]),y = _mm256_loadu_ps(&cy[i]),z = _mm256_loadu_ps(&cz[i]);
+			__m256 hx = _mm256_loadu_ps(&ex[i]),hy = _mm256_loadu_ps(&ey[i]),hz = _mm256_loadu_ps(&ez[i]);
+			__m256 outside = _mm256_setzero_ps();
+			for(int p=0;p<6;p++) {
+				__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(pl[p][0],x),_mm256_mul_ps(pl[p][1],y)),
+				                         _mm256_add_ps(_mm256_mul_ps(pl[p][2],z),pl[p][3]));
+				__m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_and_ps(pl[p][0],sign_mask),hx),
+				                                       _mm256_mul_ps(_mm256_and_ps(pl[p][1],sign_mask),hy)),
+				                         _mm256_mul_ps(_mm256_and_ps(pl[p][2],sign_mask),hz));
+				outside = _mm256_or_ps(outside,_mm256_cmp_ps(_mm256_add_ps(d,r),_mm256_setzero_ps(),_CMP_LT_OQ));
+			}
+			int mask = _mm256_movemask_ps(outside);
+			for(int k=0;k<8;k++) {
+				visible[i+k] = ((mask>>k) & 1) ? 0 : 1;
+				nb += visible[i+k];
+			}
+		}
+#elif defined(STP3D_USE_SSE)
+		const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		__m128 pl[6][4];
+		for(int p=0;p<6;p++) {
+			for(int c=0;c<4;c++) pl[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+		}
+		for(;i+4<=n;i+=4) {
+			__m128 x = _mm_loadu_ps(&cx[i]),y = _mm_loadu_ps(&cy[i]),z = _mm_loadu_ps(&cz[i]);
+			__m128 hx = _mm_loadu_ps(&ex[i]),hy = _mm_loadu_ps(&ey[i]),hz = _mm_loadu_ps(&ez[i]);
+			__m128 outside = _mm_setzero_ps();
+			for(int p=0;p<6;p++) {
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pl[p][0],x),_mm_mul_ps(pl[p][1],y)),
+				                      _mm_add_ps(_mm_mul_ps(pl[p][2],z),pl[p][3]));
+				__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(pl[p][0],sign_mask),hx),
+				                                 _mm_mul_ps(_mm_and_ps(pl[p][1],sign_mask),hy)),
+				                      _mm_mul_ps(_mm_and_ps(pl[p][2],sign_mask),hz));
+				outside = _mm_or_ps(outside,_mm_cmplt_ps(_mm_add_ps(d,r),_mm_setzero_ps()));
+			}
+			int mask = _mm_movemask_ps(outside);
+			for(int k=0;k<4;k++) {
+				visible[i+k] = ((mask>>k) & 1) ? 0 : 1;
+				nb += visible[i+k];
+			}
+		}
+#endif
+		if (i < n) nb += frustum_detail::cullScalar(frustum,*this,i,n,visible.data());
+		return nb;
+	}
+
+};
+
+#endif
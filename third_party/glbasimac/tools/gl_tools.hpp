@@ -102,6 +102,41 @@ inline float deg2rad(float deg) {
 	return M_PI*deg/180.;
 }
 
+// ///////////////////////////////////////////////////////////////////////////
+// GL work counters
+// ///////////////////////////////////////////////////////////////////////////
+/** Counters of the GL work issued by the meshes and by glbasimac, read (and reset every frame) by
+  * glbasimac::GLBI_Profiler. One set for the whole program : GL calls are made by one thread.
+  * Define STP3D_NO_GL_COUNTERS to compile the counting out.
+  */
+struct GLCounters {
+	GLCounters() {reset();}
+	void reset() {draw_calls = triangles = uniform_uploads = buffer_bytes = binds = 0;}
+
+	unsigned long long draw_calls;
+	unsigned long long triangles;
+	unsigned long long uniform_uploads;
+	/// Bytes sent to buffers and textures
+	unsigned long long buffer_bytes;
+	/// VAO, texture and program binds
+	unsigned long long binds;
+};
+
+inline GLCounters& glCounters() {static GLCounters counters; return counters;}
+
+/// Number of triangles drawn from \param nb_vertices vertices (or indices) of primitive \param type
+inline unsigned long long trianglesOf(GLenum type,unsigned long long nb_vertices) {
+	if (type == GL_TRIANGLES) return nb_vertices/3;
+	if ((type == GL_TRIANGLE_STRIP) || (type == GL_TRIANGLE_FAN)) return (nb_vertices > 2) ? nb_vertices-2 : 0;
+	return 0;
+}
+
+#ifndef STP3D_NO_GL_COUNTERS
+#define STP3D_COUNT(counter,n) (STP3D::glCounters().counter += (n))
+#else
+#define STP3D_COUNT(counter,n) ((void)0)
+#endif
+
 
 } // End namespace
 #endif
@@ -21,6 +21,9 @@
 #include <iostream>
 #include <vector>
 #include "globals.hpp"
+#include "vertex_layout.hpp"
+#include "instance_buffer.hpp"
+#include "bounding_volume.hpp"
 
 
 namespace STP3D {
@@ -29,6 +32,7 @@ namespace STP3D {
 	  * \class IndexedMesh allows to store generic informations about an indexed mesh.
 	  * IndexedMesh class allows to store several float buffer to use with a GL shaders in
 	  * an indexed way. Such buffers are not interleaved and each has a semantic on his own. 
+	  * On GPU side, buffers may however be interleaved (and packed) in a single VBO (see setInterleaved).
 	  * Note that an indexed mesh MUST have at least one buffer of coordinates.
 	  * This class allows also the creation of the corresponding VBO.
 	  * This class may or may not store the data.
@@ -36,7 +40,7 @@ namespace STP3D {
 	class IndexedMesh {
 	public:
 		/// Standard construtor. Creates an empty mesh withouh any information.
-		IndexedMesh(unsigned int n_prim = 0,unsigned int elts = 0,unsigned int new_gl_type = GL_TRIANGLES) : id_vao(0) {
+		IndexedMesh(unsigned int n_prim = 0,unsigned int elts = 0,unsigned int new_gl_type = GL_TRIANGLES) : id_vao(0),interleaved(false),packing(STP3D_PACK_NONE),stride(0),index_type(GL_UNSIGNED_INT) {
 			buffers.clear();
 			size_one_elt.clear();
 			attr_id.clear();
@@ -79,6 +83,16 @@ namespace STP3D {
 		std::vector<unsigned int> vbo_id;
 		/// Id of the corresponding VAO
 		unsigned int id_vao;
+		/// True if all buffers are interleaved in a single VBO
+		bool interleaved;
+		/// Packing flags used with the interleaved layout
+		unsigned int packing;
+		/// Size in bytes of one vertex in the interleaved VBO
+		unsigned int stride;
+		/// Type of the GPU index buffer : GL_UNSIGNED_SHORT when every index fits 16 bits (chosen by createVAO)
+		unsigned int index_type;
+		/// Per-instance data used by drawInstanced
+		InstanceBuffer instances;
 
 		/// Set the number of elements in each buffers
 		void setNbElt(unsigned int elts) {nb_elts = elts;};
@@ -91,8 +105,50 @@ namespace STP3D {
 		 *                      GL RELATED FUNCTIONS
 		 *****************************************************************/
 		void changeType(unsigned int new_gl_type) {gl_type_mesh = new_gl_type;};
+		/** Store all buffers in one interleaved VBO instead of one VBO per buffer.
+		  * Must be called before createVAO.
+		  * \param pack_flags combination of STP3D_PACK_* flags to use compact formats
+		  */
+		void setInterleaved(bool use_interleaved,unsigned int pack_flags = STP3D_PACK_NONE) {
+			interleaved = use_interleaved;
+			packing = use_interleaved ? pack_flags : STP3D_PACK_NONE;
+		};
 		bool createVAO();
-		void draw();
+		/// Size in bytes of one vertex on GPU with the current layout
+		unsigned int getVertexByteSize() const;
+		/// Size in bytes of one index on GPU (known before createVAO)
+		unsigned int getIndexByteSize() const {return (nb_elts < 65536) ? sizeof(unsigned short) : sizeof(unsigned int);};
+		/// Size in bytes of vertex and index data on GPU with the current layout (computed on CPU side)
+		size_t getGPUByteSize() const {
+			return (size_t)getVertexByteSize()*nb_elts+(size_t)nb_primitive*nb_idx_per_primitive*getIndexByteSize();
+		};
+		/// Print the GPU memory used by the mesh compared to separate float buffers
+		void printByteSize(std::ostream& os = std::cerr) const;
+		/** Draw the mesh.
+		  * \param bind_vao if false, the VAO must already be bound by the caller and is left bound
+		  * (allows to chain draws of the same mesh without redundant binds).
+		  */
+		void draw(bool bind_vao = true);
+		/** Set the per-instance transforms (16 floats, column major) and colors (3 floats, may be NULL)
+		  * used by drawInstanced. Can be called every frame : storage is reused when large enough.
+		  */
+		bool setInstances(unsigned int nb,const float* transforms,const float* colors = NULL) {
+			return instances.update(id_vao,nb,transforms,colors);
+		};
+		/// Remove per-instance data : draw renders again the mesh with the generic transform and color
+		void clearInstances() {instances.detach(id_vao);};
+		unsigned int getNbInstances() const {return instances.nb_instances;};
+		/// Draw all instances set with setInstances in a single draw call
+		void drawInstanced(bool bind_vao = true);
+
+		/// Number of indices of one primitive (1, 2 or 3)
+		unsigned int getNbIndexPerPrimitive() const {return nb_idx_per_primitive;};
+		/// Compute bbox and bsphere from the coordinates (attribute 0). Called by createVAO
+		void computeBounds();
+
+		/// Bounds of the coordinates in object space (empty without CPU coordinates)
+		BoundingBox bbox;
+		BoundingSphere bsphere;
 
 	private:
 		unsigned int nb_idx_per_primitive;
@@ -131,43 +187,75 @@ namespace STP3D {
 		if (buffers.size()==0) {
 			STP3D::setError("Impossible to create VBO from empty buffers. This mesh has not been initialized");
 		}
+		computeBounds();
 
-		// Create all VBO (and check)
-		vbo_id.resize(buffers.size());
-		unsigned int* new_id = new unsigned int[buffers.size()];
-		glGenBuffers(buffers.size(),new_id);
-		for(unsigned int i=0;i<buffers.size();++i) {
-			if (new_id[i]==0) {STP3D::setError("Unable to find an empty VBO");return false;}
-			vbo_id[i]=new_id[i];
+		if (interleaved) {
+			// One VBO with all attributes packed
+			vbo_id.resize(1);
+			stride = STP3D::createInterleavedVBO(buffers,nb_elts,attr_id,size_one_elt,packing,vbo_id[0]);
+			if (stride == 0) {glBindVertexArray(0);return false;}
 		}
-		delete[](new_id);
+		else {
+			// Create all VBO (and check)
+			vbo_id.resize(buffers.size());
+			unsigned int* new_id = new unsigned int[buffers.size()];
+			glGenBuffers(buffers.size(),new_id);
+			for(unsigned int i=0;i<buffers.size();++i) {
+				if (new_id[i]==0) {STP3D::setError("Unable to find an empty VBO");return false;}
+				vbo_id[i]=new_id[i];
+			}
+			delete[](new_id);
 
-		// Create the index VBO (and check)
-		glGenBuffers(1,&id_index);
-		if (id_index==0) {STP3D::setError("Unable to find an empty VBO for index buffer");return false;}
+			// Transfer all data for all VBO from CPU to GPU
+			for(std::vector<int>::size_type i = 0; i < buffers.size(); ++i) {
+				glEnableVertexAttribArray(attr_id[i]);
 
+				glBindBuffer(GL_ARRAY_BUFFER,vbo_id[i]);
 
-		// Transfer all data for all VBO from CPU to GPU
-		for(std::vector<int>::size_type i = 0; i < buffers.size(); ++i) {
-			glEnableVertexAttribArray(attr_id[i]);
+				glBufferData(GL_ARRAY_BUFFER,nb_elts*size_one_elt[i]*sizeof(GLfloat),buffers[i],GL_STATIC_DRAW);
+				STP3D_COUNT(buffer_bytes,nb_elts*size_one_elt[i]*sizeof(GLfloat));
 
-			glBindBuffer(GL_ARRAY_BUFFER,vbo_id[i]);
+				glVertexAttribPointer(attr_id[i], size_one_elt[i], GL_FLOAT, GL_FALSE, 0, 0);
 
-			glBufferData(GL_ARRAY_BUFFER,nb_elts*size_one_elt[i]*sizeof(GLfloat),buffers[i],GL_STATIC_DRAW);
+				glBindBuffer(GL_ARRAY_BUFFER,0);
+			}
+		}
 
-			glVertexAttribPointer(attr_id[i], size_one_elt[i], GL_FLOAT, GL_FALSE, 0, 0);
+		// Create the index VBO (and check)
+		glGenBuffers(1,&id_index);
+		if (id_index==0) {STP3D::setError("Unable to find an empty VBO for index buffer");return false;}
 
-			glBindBuffer(GL_ARRAY_BUFFER,0);
-		}
-		// Transfer index data VBO from CPU to GPU
+		// Transfer index data VBO from CPU to GPU (the binding is kept in the VAO)
+		// Meshes of less than 65536 vertices use 16 bits indices : half the memory and bandwidth
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,id_index);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER,nb_idx_per_primitive*nb_primitive*sizeof(unsigned int),index_buffer,GL_STATIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
+		unsigned int nb_idx = nb_idx_per_primitive*nb_primitive;
+		if (getIndexByteSize() == sizeof(unsigned short)) {
+			index_type = GL_UNSIGNED_SHORT;
+			std::vector<unsigned short> short_idx(index_buffer,index_buffer+nb_idx);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER,nb_idx*sizeof(unsigned short),short_idx.data(),GL_STATIC_DRAW);
+			STP3D_COUNT(buffer_bytes,nb_idx*sizeof(unsigned short));
+		}
+		else {
+			index_type = GL_UNSIGNED_INT;
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER,nb_idx*sizeof(unsigned int),index_buffer,GL_STATIC_DRAW);
+			STP3D_COUNT(buffer_bytes,nb_idx*sizeof(unsigned int));
+		}
 
 		glBindVertexArray(0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
 		return true;
 	}
 
+	inline void IndexedMesh::computeBounds() {
+		bbox = BoundingBox();
+		bsphere = BoundingSphere();
+		for(std::vector<int>::size_type i = 0; i < attr_id.size(); ++i) {
+			if ((attr_id[i] != 0) || (size_one_elt[i] < 2) || (size_one_elt[i] > 3) || !buffers[i]) continue;
+			bbox.extend(buffers[i],nb_elts,size_one_elt[i]);
+			bsphere.around(bbox,buffers[i],nb_elts,size_one_elt[i]);
+		}
+	}
+
 	inline void IndexedMesh::addIndexBuffer(unsigned int* data,bool copy) {
 		if (copy) {
 			memcpy(index_buffer,data,nb_idx_per_primitive*nb_primitive*sizeof(unsigned int));
@@ -191,13 +279,43 @@ namespace STP3D {
 		attr_semantic.push_back(semantic);
 	}
 
-	inline void IndexedMesh::draw() {
-		glBindVertexArray(id_vao);
+	inline unsigned int IndexedMesh::getVertexByteSize() const {
+		if (!interleaved) {
+			unsigned int size = 0;
+			for(std::vector<int>::size_type i = 0; i < size_one_elt.size(); ++i) size += size_one_elt[i]*sizeof(GLfloat);
+			return size;
+		}
+		std::vector<VertexAttribFormat> formats;
+		return STP3D::computeInterleavedLayout(attr_id,size_one_elt,packing,formats);
+	}
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,id_index);
-		glDrawElements(gl_type_mesh,nb_primitive*nb_idx_per_primitive,GL_UNSIGNED_INT,0);
+	inline void IndexedMesh::printByteSize(std::ostream& os) const {
+		unsigned int float_size = 0;
+		for(std::vector<int>::size_type i = 0; i < size_one_elt.size(); ++i) float_size += size_one_elt[i]*sizeof(GLfloat);
+		size_t index_size = (size_t)nb_primitive*nb_idx_per_primitive*sizeof(unsigned int);
+		os<<"Indexed mesh of "<<nb_elts<<" vertices : "<<getVertexByteSize()<<" bytes per vertex, "<<getIndexByteSize()<<" bytes per index, "
+		  <<getGPUByteSize()<<" bytes on GPU (separate float buffers and 32 bits indices : "<<(size_t)float_size*nb_elts+index_size<<" bytes)"<<std::endl;
+	}
 
-		glBindVertexArray(0);
+	inline void IndexedMesh::draw(bool bind_vao) {
+		if (bind_vao) {glBindVertexArray(id_vao); STP3D_COUNT(binds,1);}
+
+		glDrawElements(gl_type_mesh,nb_primitive*nb_idx_per_primitive,index_type,0);
+		STP3D_COUNT(draw_calls,1);
+		STP3D_COUNT(triangles,trianglesOf(gl_type_mesh,nb_primitive*nb_idx_per_primitive));
+
+		if (bind_vao) glBindVertexArray(0);
+	}
+
+	inline void IndexedMesh::drawInstanced(bool bind_vao) {
+		if (bind_vao) {glBindVertexArray(id_vao); STP3D_COUNT(binds,1);}
+
+		glDrawElementsInstanced(gl_type_mesh,nb_primitive*nb_idx_per_primitive,index_type,0,instances.nb_instances);
+		InstanceBuffer::setDefaultValues();
+		STP3D_COUNT(draw_calls,1);
+		STP3D_COUNT(triangles,trianglesOf(gl_type_mesh,nb_primitive*nb_idx_per_primitive)*instances.nb_instances);
+
+		if (bind_vao) glBindVertexArray(0);
 	}
 
 
@@ -0,0 +1,133 @@
+#ifndef _STP3D_INSTANCE_BUFFER_HPP_
+#define _STP3D_INSTANCE_BUFFER_HPP_
+
+
+#include <iostream>
+#include "globals.hpp"
+#include "gl_tools.hpp"
+
+/** \addtogroup Macros */
+/*@{*/
+/** \defgroup instancing Attribute locations used by instanced drawing */
+/*@{*/
+/** First location of the per-instance transform (a mat4 uses locations 4 to 7). */
+#define STP3D_INSTANCE_MATRIX_ATTR  4
+/** Location of the per-instance color. */
+#define STP3D_INSTANCE_COLOR_ATTR   8
+/*@}*/
+/*@}*/
+
+namespace STP3D {
+
+	/**
+	  * \brief Per-instance data (transform and color) attached to the VAO of a mesh.
+	  * Transforms are column major 4x4 matrices applied before the current modelview matrix.
+	  * Colors are rgb triplets replacing the vertex color. When no array is enabled, shaders
+	  * get the current generic values of the attributes : setDefaultValues sets them to the
+	  * identity matrix and to a null color (alpha 0 meaning "keep the vertex color").
+	  */
+	class InstanceBuffer {
+	public:
+		InstanceBuffer():nb_instances(0),capacity(0) {
+			vbo_id[0] = vbo_id[1] = 0;
+		};
+		~InstanceBuffer() {release();};
+
+		/** Send \a nb transforms (16 floats each) and colors (3 floats each, may be NULL) to the GPU
+		  * and attach them as instanced attributes to \a id_vao.
+		  * Storage is reallocated only when \a nb exceeds the current capacity.
+		  */
+		bool update(unsigned int id_vao,unsigned int nb,const float* transforms,const float* colors);
+		/** Disable the instanced attributes of \a id_vao : non instanced draws of the mesh use again
+		  * the generic values. GL buffers are kept for a future update.
+		  */
+		void detach(unsigned int id_vao);
+		/// Delete the GL buffers
+		void release();
+		/** Set the generic values of the instanced attributes (identity, no color). They are undefined
+		  * after a draw with their arrays enabled : called by the GL engine and after each instanced draw.
+		  */
+		static void setDefaultValues();
+
+		/// Number of instances to draw
+		unsigned int nb_instances;
+	private:
+		/// Number of instances allocated in both VBOs
+		unsigned int capacity;
+		/// VBO of transforms (0) and colors (1)
+		unsigned int vbo_id[2];
+	};
+
+	inline bool InstanceBuffer::update(unsigned int id_vao,unsigned int nb,const float* transforms,const float* colors) {
+		if (id_vao == 0) {
+			STP3D::setError("Impossible to set instances of a mesh without VAO");
+			return false;
+		}
+		if (vbo_id[0] == 0) {
+			glGenBuffers(2,vbo_id);
+			if ((vbo_id[0] == 0) || (vbo_id[1] == 0)) {
+				STP3D::setError("Unable to find an empty VBO for instances");
+				return false;
+			}
+		}
+		glBindVertexArray(id_vao);
+
+		// Transforms : one mat4 spread on 4 consecutive locations
+		glBindBuffer(GL_ARRAY_BUFFER,vbo_id[0]);
+		if (nb > capacity) glBufferData(GL_ARRAY_BUFFER,nb*16*sizeof(GLfloat),transforms,GL_STREAM_DRAW);
+		else if (nb > 0) glBufferSubData(GL_ARRAY_BUFFER,0,nb*16*sizeof(GLfloat),transforms);
+		STP3D_COUNT(buffer_bytes,nb*16*sizeof(GLfloat));
+		for(unsigned int c=0;c<4;c++) {
+			glEnableVertexAttribArray(STP3D_INSTANCE_MATRIX_ATTR+c);
+			glVertexAttribPointer(STP3D_INSTANCE_MATRIX_ATTR+c,4,GL_FLOAT,GL_FALSE,16*sizeof(GLfloat),
+			                      (const void*)(c*4*sizeof(GLfloat)));
+			glVertexAttribDivisor(STP3D_INSTANCE_MATRIX_ATTR+c,1);
+		}
+
+		// Colors (optional)
+		glBindBuffer(GL_ARRAY_BUFFER,vbo_id[1]);
+		if (colors) {
+			if (nb > capacity) glBufferData(GL_ARRAY_BUFFER,nb*3*sizeof(GLfloat),colors,GL_STREAM_DRAW);
+			else if (nb > 0) glBufferSubData(GL_ARRAY_BUFFER,0,nb*3*sizeof(GLfloat),colors);
+			STP3D_COUNT(buffer_bytes,nb*3*sizeof(GLfloat));
+			glEnableVertexAttribArray(STP3D_INSTANCE_COLOR_ATTR);
+			glVertexAttribPointer(STP3D_INSTANCE_COLOR_ATTR,3,GL_FLOAT,GL_FALSE,0,0);
+			glVertexAttribDivisor(STP3D_INSTANCE_COLOR_ATTR,1);
+		}
+		else {
+			if (nb > capacity) glBufferData(GL_ARRAY_BUFFER,nb*3*sizeof(GLfloat),NULL,GL_STREAM_DRAW);
+			glDisableVertexAttribArray(STP3D_INSTANCE_COLOR_ATTR);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER,0);
+		glBindVertexArray(0);
+
+		if (nb > capacity) capacity = nb;
+		nb_instances = nb;
+		return true;
+	}
+
+	inline void InstanceBuffer::release() {
+		if (vbo_id[0]) glDeleteBuffers(2,vbo_id);
+		vbo_id[0] = vbo_id[1] = 0;
+		nb_instances = capacity = 0;
+	}
+
+	inline void InstanceBuffer::setDefaultValues() {
+		for(int c=0;c<4;c++) glVertexAttrib4f(STP3D_INSTANCE_MATRIX_ATTR+c,c==0,c==1,c==2,c==3);
+		glVertexAttrib4f(STP3D_INSTANCE_COLOR_ATTR,0.0,0.0,0.0,0.0);
+	}
+
+	inline void InstanceBuffer::detach(unsigned int id_vao) {
+		if (id_vao == 0) return;
+		glBindVertexArray(id_vao);
+		for(unsigned int c=0;c<4;c++) glDisableVertexAttribArray(STP3D_INSTANCE_MATRIX_ATTR+c);
+		glDisableVertexAttribArray(STP3D_INSTANCE_COLOR_ATTR);
+		glBindVertexArray(0);
+		nb_instances = 0;
+	}
+
+};
+
+#endif
+
+
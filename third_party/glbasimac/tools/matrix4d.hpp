@@ -20,6 +20,7 @@
 #include "globals.hpp"
 #include "vector4d.hpp"
 #include "vector3d.hpp"
+#include "matrix4d_simd.hpp"
 #include <string>
 
 namespace STP3D {
@@ -173,6 +174,8 @@ public:
 	/// Multiplication Matrix Vector. 
 	/// \return Resulting 4D vector.
 	Vector4D operator*(const Vector4D& vec) const;
+	/// Multiplication of two affine matrix (last row (0,0,0,1)), cheaper than operator*
+	Matrix4D mulAffine(const Matrix4D& mat) const;
 	/// Copy operator.
 	Matrix4D operator=(const Matrix4D& src);
 	/// Cast operator (float*)
@@ -222,6 +225,20 @@ public:
 	  * Performs the following transformation : erase the translation part, invert and transpose.
 	  */
 	void normalFromModelview();
+	/// Return true if the last row is (0,0,0,1)
+	bool isAffine() const {return (mat[3] == 0.0f) && (mat[7] == 0.0f) && (mat[11] == 0.0f) && (mat[15] == 1.0f);};
+	/** Return true if the 3x3 part is a rotation with an uniform scale (up to a relative \a eps).
+	  * For such matrices, the normal matrix is the 3x3 part itself divided by the square scale.
+	  */
+	bool isSimilarity(float eps = 1e-4f) const;
+	/** Right multiplication by a translation, in place (this = this * translation(x,y,z)).
+	  * Only the last column changes.
+	  */
+	void mulTranslation(float x,float y,float z);
+	/// Right multiplication by a scaling, in place (this = this * homothety(sx,sy,sz))
+	void mulHomothety(float sx,float sy,float sz);
+	/// Right multiplication by an affine matrix, in place (uses mulAffine if this is affine too)
+	void mulTransformation(const Matrix4D& transfo);
 	/** Set a value.
 	  * Set a value at column \a col and at line \a lgn (starting from 0) with value \a val
 	  * \param col,lgn Case index (column and line)
@@ -285,63 +302,25 @@ inline Matrix4D Matrix4D::operator-=(const Matrix4D& ml) {
 
 inline Matrix4D Matrix4D::operator*(const Matrix4D& ml) const {
 	Matrix4D m;
-	
-	// First column
-	m.mat[0]  = ml.mat[0]*mat[0] + ml.mat[1]*mat[4] + ml.mat[2]*mat[8]  + ml.mat[3]*mat[12];
-	m.mat[1]  = ml.mat[0]*mat[1] + ml.mat[1]*mat[5] + ml.mat[2]*mat[9]  + ml.mat[3]*mat[13];
-	m.mat[2]  = ml.mat[0]*mat[2] + ml.mat[1]*mat[6] + ml.mat[2]*mat[10] + ml.mat[3]*mat[14];
-	m.mat[3]  = ml.mat[0]*mat[3] + ml.mat[1]*mat[7] + ml.mat[2]*mat[11] + ml.mat[3]*mat[15];
-	// Second column
-	m.mat[4]  = ml.mat[4]*mat[0] + ml.mat[5]*mat[4] + ml.mat[6]*mat[8]  + ml.mat[7]*mat[12];
-	m.mat[5]  = ml.mat[4]*mat[1] + ml.mat[5]*mat[5] + ml.mat[6]*mat[9]  + ml.mat[7]*mat[13];
-	m.mat[6]  = ml.mat[4]*mat[2] + ml.mat[5]*mat[6] + ml.mat[6]*mat[10] + ml.mat[7]*mat[14];
-	m.mat[7]  = ml.mat[4]*mat[3] + ml.mat[5]*mat[7] + ml.mat[6]*mat[11] + ml.mat[7]*mat[15];
-	// Third column
-	m.mat[8]  = ml.mat[8]*mat[0] + ml.mat[9]*mat[4] + ml.mat[10]*mat[8]  + ml.mat[11]*mat[12];
-	m.mat[9]  = ml.mat[8]*mat[1] + ml.mat[9]*mat[5] + ml.mat[10]*mat[9]  + ml.mat[11]*mat[13];
-	m.mat[10] = ml.mat[8]*mat[2] + ml.mat[9]*mat[6] + ml.mat[10]*mat[10] + ml.mat[11]*mat[14];
-	m.mat[11] = ml.mat[8]*mat[3] + ml.mat[9]*mat[7] + ml.mat[10]*mat[11] + ml.mat[11]*mat[15];
-	// Fourth column
-	m.mat[12] = ml.mat[12]*mat[0] + ml.mat[13]*mat[4] + ml.mat[14]*mat[8]  + ml.mat[15]*mat[12];
-	m.mat[13] = ml.mat[12]*mat[1] + ml.mat[13]*mat[5] + ml.mat[14]*mat[9]  + ml.mat[15]*mat[13];
-	m.mat[14] = ml.mat[12]*mat[2] + ml.mat[13]*mat[6] + ml.mat[14]*mat[10] + ml.mat[15]*mat[14];
-	m.mat[15] = ml.mat[12]*mat[3] + ml.mat[13]*mat[7] + ml.mat[14]*mat[11] + ml.mat[15]*mat[15];
+	STP3D::mat4Mul(mat,ml.mat,m.mat);
 	return m;
 }
 
 inline Matrix4D Matrix4D::operator*=(const Matrix4D& ml) {
-	float mt[16];
-	// First column
-	mt[0]  = ml.mat[0]*mat[0] + ml.mat[1]*mat[4] + ml.mat[2]*mat[8]  + ml.mat[3]*mat[12];
-	mt[1]  = ml.mat[0]*mat[1] + ml.mat[1]*mat[5] + ml.mat[2]*mat[9]  + ml.mat[3]*mat[13];
-	mt[2]  = ml.mat[0]*mat[2] + ml.mat[1]*mat[6] + ml.mat[2]*mat[10] + ml.mat[3]*mat[14];
-	mt[3]  = ml.mat[0]*mat[3] + ml.mat[1]*mat[7] + ml.mat[2]*mat[11] + ml.mat[3]*mat[15];
-	// Second column
-	mt[4]  = ml.mat[4]*mat[0] + ml.mat[5]*mat[4] + ml.mat[6]*mat[8]  + ml.mat[7]*mat[12];
-	mt[5]  = ml.mat[4]*mat[1] + ml.mat[5]*mat[5] + ml.mat[6]*mat[9]  + ml.mat[7]*mat[13];
-	mt[6]  = ml.mat[4]*mat[2] + ml.mat[5]*mat[6] + ml.mat[6]*mat[10] + ml.mat[7]*mat[14];
-	mt[7]  = ml.mat[4]*mat[3] + ml.mat[5]*mat[7] + ml.mat[6]*mat[11] + ml.mat[7]*mat[15];
-	// Third column
-	mt[8]  = ml.mat[8]*mat[0] + ml.mat[9]*mat[4] + ml.mat[10]*mat[8]  + ml.mat[11]*mat[12];
-	mt[9]  = ml.mat[8]*mat[1] + ml.mat[9]*mat[5] + ml.mat[10]*mat[9]  + ml.mat[11]*mat[13];
-	mt[10] = ml.mat[8]*mat[2] + ml.mat[9]*mat[6] + ml.mat[10]*mat[10] + ml.mat[11]*mat[14];
-	mt[11] = ml.mat[8]*mat[3] + ml.mat[9]*mat[7] + ml.mat[10]*mat[11] + ml.mat[11]*mat[15];
-	// Fourth column
-	mt[12] = ml.mat[12]*mat[0] + ml.mat[13]*mat[4] + ml.mat[14]*mat[8]  + ml.mat[15]*mat[12];
-	mt[13] = ml.mat[12]*mat[1] + ml.mat[13]*mat[5] + ml.mat[14]*mat[9]  + ml.mat[15]*mat[13];
-	mt[14] = ml.mat[12]*mat[2] + ml.mat[13]*mat[6] + ml.mat[14]*mat[10] + ml.mat[15]*mat[14];
-	mt[15] = ml.mat[12]*mat[3] + ml.mat[13]*mat[7] + ml.mat[14]*mat[11] + ml.mat[15]*mat[15];
-
-	for(unsigned int i=0;i<16;i++) mat[i] = mt[i];
-
+	STP3D::mat4Mul(mat,ml.mat,mat);
 	return *this;
 }
 
 inline Vector4D Matrix4D::operator*(const Vector4D& ml) const {
-	return Vector4D(ml[0]*mat[0] + ml[1]*mat[4] + ml[2]*mat[8]  + ml[3]*mat[12],
-	                ml[0]*mat[1] + ml[1]*mat[5] + ml[2]*mat[9]  + ml[3]*mat[13],
-	                ml[0]*mat[2] + ml[1]*mat[6] + ml[2]*mat[10] + ml[3]*mat[14],
-	                ml[0]*mat[3] + ml[1]*mat[7] + ml[2]*mat[11] + ml[3]*mat[15]);
+	Vector4D res;
+	STP3D::mat4MulVec4(mat,ml.val,res.val);
+	return res;
+}
+
+inline Matrix4D Matrix4D::mulAffine(const Matrix4D& ml) const {
+	Matrix4D m;
+	STP3D::mat4MulAffine(mat,ml.mat,m.mat);
+	return m;
 }
 
 inline Matrix4D Matrix4D::operator=(const Matrix4D& src) {
@@ -555,144 +534,44 @@ inline void Matrix4D::transpose() {
 }
 
 inline void Matrix4D::normalFromModelview() {
-	// Destroy the third line
-	mat[12] = mat[13] = mat[14] = 0.0; mat[15] = 1.0;
-	// Invert and transpose
-	invert();
-	transpose();
+	// Inverse transpose of the 3x3 part, translation erased
+	STP3D::mat4NormalMatrix(mat,mat);
 }
 
+inline void Matrix4D::mulTranslation(float x,float y,float z) {
+	for(int i=0;i<4;i++) mat[12+i] += mat[i]*x + mat[4+i]*y + mat[8+i]*z;
+}
+
+inline void Matrix4D::mulHomothety(float sx,float sy,float sz) {
+	for(int i=0;i<4;i++) {
+		mat[i] *= sx;
+		mat[4+i] *= sy;
+		mat[8+i] *= sz;
+	}
+}
+
+inline void Matrix4D::mulTransformation(const Matrix4D& transfo) {
+	if (isAffine() && transfo.isAffine()) STP3D::mat4MulAffine(mat,transfo.mat,mat);
+	else STP3D::mat4Mul(mat,transfo.mat,mat);
+}
+
+inline bool Matrix4D::isSimilarity(float eps) const {
+	const float* c0 = mat;
+	const float* c1 = mat+4;
+	const float* c2 = mat+8;
+	float l0 = c0[0]*c0[0]+c0[1]*c0[1]+c0[2]*c0[2];
+	float l1 = c1[0]*c1[0]+c1[1]*c1[1]+c1[2]*c1[2];
+	float l2 = c2[0]*c2[0]+c2[1]*c2[1]+c2[2]*c2[2];
+	float tol = eps*l0;
+	if ((fabs(l1-l0) > tol) || (fabs(l2-l0) > tol)) return false;
+	float d01 = c0[0]*c1[0]+c0[1]*c1[1]+c0[2]*c1[2];
+	float d02 = c0[0]*c2[0]+c0[1]*c2[1]+c0[2]*c2[2];
+	float d12 = c1[0]*c2[0]+c1[1]*c2[1]+c1[2]*c2[2];
+	return (fabs(d01) <= tol) && (fabs(d02) <= tol) && (fabs(d12) <= tol);
+}
 
 inline bool Matrix4D::invert() {
-	float m[16];
-	float invOut[16];
-	this->get(m);
-	double inv[16], det;
-	int i;
-
-	inv[0] = m[5]  * m[10] * m[15] - 
-	         m[5]  * m[11] * m[14] - 
-	         m[9]  * m[6]  * m[15] + 
-	         m[9]  * m[7]  * m[14] +
-	         m[13] * m[6]  * m[11] - 
-	         m[13] * m[7]  * m[10];
-
-	inv[4] = -m[4]  * m[10] * m[15] + 
-	          m[4]  * m[11] * m[14] + 
-	          m[8]  * m[6]  * m[15] - 
-	          m[8]  * m[7]  * m[14] - 
-	          m[12] * m[6]  * m[11] + 
-	          m[12] * m[7]  * m[10];
-
-	inv[8] = m[4]  * m[9] * m[15] - 
-	         m[4]  * m[11] * m[13] - 
-	         m[8]  * m[5] * m[15] + 
-	         m[8]  * m[7] * m[13] + 
-	         m[12] * m[5] * m[11] - 
-	         m[12] * m[7] * m[9];
-
-	inv[12] = -m[4]  * m[9] * m[14] + 
-	           m[4]  * m[10] * m[13] +
-	           m[8]  * m[5] * m[14] - 
-	           m[8]  * m[6] * m[13] - 
-	           m[12] * m[5] * m[10] + 
-	           m[12] * m[6] * m[9];
-
-	inv[1] = -m[1]  * m[10] * m[15] + 
-	          m[1]  * m[11] * m[14] + 
-	          m[9]  * m[2] * m[15] - 
-	          m[9]  * m[3] * m[14] - 
-	          m[13] * m[2] * m[11] + 
-	          m[13] * m[3] * m[10];
-
-	inv[5] = m[0]  * m[10] * m[15] - 
-	         m[0]  * m[11] * m[14] - 
-	         m[8]  * m[2] * m[15] + 
-	         m[8]  * m[3] * m[14] + 
-	         m[12] * m[2] * m[11] - 
-	         m[12] * m[3] * m[10];
-
-	inv[9] = -m[0]  * m[9] * m[15] + 
-	          m[0]  * m[11] * m[13] + 
-	          m[8]  * m[1] * m[15] - 
-	          m[8]  * m[3] * m[13] - 
-	          m[12] * m[1] * m[11] + 
-	          m[12] * m[3] * m[9];
-
-	inv[13] = m[0]  * m[9] * m[14] - 
-	          m[0]  * m[10] * m[13] - 
-	          m[8]  * m[1] * m[14] + 
-	          m[8]  * m[2] * m[13] + 
-	          m[12] * m[1] * m[10] - 
-	          m[12] * m[2] * m[9];
-
-	inv[2] = m[1]  * m[6] * m[15] - 
-	         m[1]  * m[7] * m[14] - 
-	         m[5]  * m[2] * m[15] + 
-	         m[5]  * m[3] * m[14] + 
-	         m[13] * m[2] * m[7] - 
-	         m[13] * m[3] * m[6];
-
-	inv[6] = -m[0]  * m[6] * m[15] + 
-	          m[0]  * m[7] * m[14] + 
-	          m[4]  * m[2] * m[15] - 
-	          m[4]  * m[3] * m[14] - 
-	          m[12] * m[2] * m[7] + 
-	          m[12] * m[3] * m[6];
-
-	inv[10] = m[0]  * m[5] * m[15] - 
-	          m[0]  * m[7] * m[13] - 
-	          m[4]  * m[1] * m[15] + 
-	          m[4]  * m[3] * m[13] + 
-	          m[12] * m[1] * m[7] - 
-	          m[12] * m[3] * m[5];
-
-	inv[14] = -m[0]  * m[5] * m[14] + 
-	           m[0]  * m[6] * m[13] + 
-	           m[4]  * m[1] * m[14] - 
-	           m[4]  * m[2] * m[13] - 
-	           m[12] * m[1] * m[6] + 
-	           m[12] * m[2] * m[5];
-
-	inv[3] = -m[1] * m[6] * m[11] + 
-	          m[1] * m[7] * m[10] + 
-	          m[5] * m[2] * m[11] - 
-	          m[5] * m[3] * m[10] - 
-	          m[9] * m[2] * m[7] + 
-	          m[9] * m[3] * m[6];
-
-	inv[7] = m[0] * m[6] * m[11] - 
-	         m[0] * m[7] * m[10] - 
-	         m[4] * m[2] * m[11] + 
-	         m[4] * m[3] * m[10] + 
-	         m[8] * m[2] * m[7] - 
-	         m[8] * m[3] * m[6];
-
-	inv[11] = -m[0] * m[5] * m[11] + 
-	           m[0] * m[7] * m[9] + 
-	           m[4] * m[1] * m[11] - 
-	           m[4] * m[3] * m[9] - 
-	           m[8] * m[1] * m[7] + 
-	           m[8] * m[3] * m[5];
-
-	inv[15] = m[0] * m[5] * m[10] - 
-	          m[0] * m[6] * m[9] - 
-	          m[4] * m[1] * m[10] + 
-	          m[4] * m[2] * m[9] + 
-	          m[8] * m[1] * m[6] - 
-	          m[8] * m[2] * m[5];
-
-	det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
-
-	if (fabs(det) < STP3D_EPSILON)
-	    return false;
-
-	det = 1.0 / det;
-
-	for (i = 0; i < 16; i++)
-	    invOut[i] = inv[i] * det;
-	this->set(invOut);
-	return true;
+	return STP3D::mat4Invert(mat,mat);
 }
 
 inline void Matrix4D::set(unsigned int col,unsigned int lgn,float val) {
@@ -0,0 +1,364 @@
+#ifndef _STP3D_MATRIX4D_SIMD_HPP_
+#define _STP3D_MATRIX4D_SIMD_HPP_
+
+#include <cmath>
+#include <cstring>
+#include "globals.hpp"
+
+/** \addtogroup Macros */
+/*@{*/
+/** \defgroup simd SIMD instruction set used by the matrix kernels
+  * Selected at compile time from the compiler flags (-mavx2 -mfma, SSE2 is the x86-64 baseline).
+  * Define STP3D_NO_SIMD to force the scalar kernels.
+  */
+/*@{*/
+#if !defined(STP3D_NO_SIMD) && defined(__AVX2__)
+#define STP3D_USE_AVX2 1
+#define STP3D_USE_SSE 1
+#define STP3D_SIMD_NAME "AVX2"
+#elif !defined(STP3D_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define STP3D_USE_SSE 1
+#define STP3D_SIMD_NAME "SSE2"
+#else
+#define STP3D_SIMD_NAME "scalar"
+#endif
+/*@}*/
+/*@}*/
+
+#ifdef STP3D_USE_SSE
+#include <emmintrin.h>
+#endif
+#ifdef STP3D_USE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace STP3D {
+
+	/**
+	  * Matrix kernels working on column major float[16] arrays (Matrix4D storage).
+	  * Every kernel exists in a scalar version (namespace mat4_scalar) and, when available,
+	  * in a SIMD version. The mat4XXX functions below pick the best version at compile time.
+	  * Output arrays may alias input arrays.
+	  */
+	namespace mat4_scalar {
+
+		/// r = a*b
+		inline void mul(const float* a,const float* b,float* r) {
+			float t[16];
+			for(int j=0;j<4;j++) {
+				for(int i=0;i<4;i++) {
+					t[4*j+i] = a[i]*b[4*j] + a[4+i]*b[4*j+1] + a[8+i]*b[4*j+2] + a[12+i]*b[4*j+3];
+				}
+			}
+			memcpy(r,t,16*sizeof(float));
+		}
+
+		/// r = a*b where the last row of a and b is (0,0,0,1)
+		inline void mulAffine(const float* a,const float* b,float* r) {
+			// Last row of a is (0,0,0,1) : the last row of the result is right without special care
+			float t[16];
+			for(int j=0;j<3;j++) {
+				for(int i=0;i<4;i++) {
+					t[4*j+i] = a[i]*b[4*j] + a[4+i]*b[4*j+1] + a[8+i]*b[4*j+2];
+				}
+			}
+			for(int i=0;i<4;i++) {
+				t[12+i] = a[i]*b[12] + a[4+i]*b[13] + a[8+i]*b[14] + a[12+i];
+			}
+			memcpy(r,t,16*sizeof(float));
+		}
+
+		/// r = m*v (v and r are 4 floats)
+		inline void mulVec4(const float* m,const float* v,float* r) {
+			float t[4];
+			for(int i=0;i<4;i++) t[i] = m[i]*v[0] + m[4+i]*v[1] + m[8+i]*v[2] + m[12+i]*v[3];
+			memcpy(r,t,4*sizeof(float));
+		}
+
+		/// r = inverse of m (computed in double precision). Return false if m is singular
+		inline bool invert(const float* m,float* r) {
+			double inv[16], det;
+
+			inv[0]  =  m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+			inv[4]  = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+			inv[8]  =  m[4]*m[9]*m[15]  - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+			inv[12] = -m[4]*m[9]*m[14]  + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+			inv[1]  = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+			inv[5]  =  m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+			inv[9]  = -m[0]*m[9]*m[15]  + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+			inv[13] =  m[0]*m[9]*m[14]  - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+			inv[2]  =  m[1]*m[6]*m[15]  - m[1]*m[7]*m[14]  - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7]  - m[13]*m[3]*m[6];
+			inv[6]  = -m[0]*m[6]*m[15]  + m[0]*m[7]*m[14]  + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7]  + m[12]*m[3]*m[6];
+			inv[10] =  m[0]*m[5]*m[15]  - m[0]*m[7]*m[13]  - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7]  - m[12]*m[3]*m[5];
+			inv[14] = -m[0]*m[5]*m[14]  + m[0]*m[6]*m[13]  + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6]  + m[12]*m[2]*m[5];
+			inv[3]  = -m[1]*m[6]*m[11]  + m[1]*m[7]*m[10]  + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7]   + m[9]*m[3]*m[6];
+			inv[7]  =  m[0]*m[6]*m[11]  - m[0]*m[7]*m[10]  - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7]   - m[8]*m[3]*m[6];
+			inv[11] = -m[0]*m[5]*m[11]  + m[0]*m[7]*m[9]   + m[4]*m[1]*m[11] - m[4]*m[3]*m[9]  - m[8]*m[1]*m[7]   + m[8]*m[3]*m[5];
+			inv[15] =  m[0]*m[5]*m[10]  - m[0]*m[6]*m[9]   - m[4]*m[1]*m[10] + m[4]*m[2]*m[9]  + m[8]*m[1]*m[6]   - m[8]*m[2]*m[5];
+
+			det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
+			if (fabs(det) < STP3D_EPSILON) return false;
+
+			det = 1.0 / det;
+			for(int i=0;i<16;i++) r[i] = inv[i]*det;
+			return true;
+		}
+
+		/** r = normal matrix of the modelview m : inverse transpose of its upper 3x3 part,
+		  * without translation. Return false if m is singular.
+		  */
+		inline bool normalMatrix(const float* m,float* r) {
+			// Columns of the inverse transpose are (c1^c2, c2^c0, c0^c1) / det
+			const float* c0 = m;
+			const float* c1 = m+4;
+			const float* c2 = m+8;
+			float t[16];
+			t[0]  = c1[1]*c2[2]-c1[2]*c2[1]; t[1]  = c1[2]*c2[0]-c1[0]*c2[2]; t[2]  = c1[0]*c2[1]-c1[1]*c2[0];
+			t[4]  = c2[1]*c0[2]-c2[2]*c0[1]; t[5]  = c2[2]*c0[0]-c2[0]*c0[2]; t[6]  = c2[0]*c0[1]-c2[1]*c0[0];
+			t[8]  = c0[1]*c1[2]-c0[2]*c1[1]; t[9]  = c0[2]*c1[0]-c0[0]*c1[2]; t[10] = c0[0]*c1[1]-c0[1]*c1[0];
+			float det = c0[0]*t[0] + c0[1]*t[1] + c0[2]*t[2];
+			if (fabs(det) < STP3D_EPSILON) return false;
+			float inv_det = 1.0f/det;
+			t[3] = t[7] = t[11] = t[12] = t[13] = t[14] = 0.0f;
+			for(int i=0;i<11;i++) t[i] *= inv_det;
+			t[15] = 1.0f;
+			memcpy(r,t,16*sizeof(float));
+			return true;
+		}
+	}
+
+#ifdef STP3D_USE_SSE
+	namespace mat4_sse {
+
+		/// Linear combination of the 4 columns of a with the 4 coefficients in b
+		inline __m128 combine(const __m128 a[4],const float* b) {
+			__m128 res = _mm_mul_ps(a[0],_mm_set1_ps(b[0]));
+			res = _mm_add_ps(res,_mm_mul_ps(a[1],_mm_set1_ps(b[1])));
+			res = _mm_add_ps(res,_mm_mul_ps(a[2],_mm_set1_ps(b[2])));
+			res = _mm_add_ps(res,_mm_mul_ps(a[3],_mm_set1_ps(b[3])));
+			return res;
+		}
+
+		inline void mul(const float* a,const float* b,float* r) {
+			__m128 ca[4] = {_mm_loadu_ps(a),_mm_loadu_ps(a+4),_mm_loadu_ps(a+8),_mm_loadu_ps(a+12)};
+			__m128 r0 = combine(ca,b);
+			__m128 r1 = combine(ca,b+4);
+			__m128 r2 = combine(ca,b+8);
+			__m128 r3 = combine(ca,b+12);
+			_mm_storeu_ps(r,r0);
+			_mm_storeu_ps(r+4,r1);
+			_mm_storeu_ps(r+8,r2);
+			_mm_storeu_ps(r+12,r3);
+		}
+
+		inline void mulAffine(const float* a,const float* b,float* r) {
+			__m128 a0 = _mm_loadu_ps(a);
+			__m128 a1 = _mm_loadu_ps(a+4);
+			__m128 a2 = _mm_loadu_ps(a+8);
+			__m128 a3 = _mm_loadu_ps(a+12);
+			__m128 res[4];
+			for(int j=0;j<4;j++) {
+				res[j] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0,_mm_set1_ps(b[4*j])),
+				                               _mm_mul_ps(a1,_mm_set1_ps(b[4*j+1]))),
+				                    _mm_mul_ps(a2,_mm_set1_ps(b[4*j+2])));
+			}
+			// Last row of a is (0,0,0,1) : last column only gets a3
+			res[3] = _mm_add_ps(res[3],a3);
+			for(int j=0;j<4;j++) _mm_storeu_ps(r+4*j,res[j]);
+		}
+
+		inline void mulVec4(const float* m,const float* v,float* r) {
+			__m128 cm[4] = {_mm_loadu_ps(m),_mm_loadu_ps(m+4),_mm_loadu_ps(m+8),_mm_loadu_ps(m+12)};
+			_mm_storeu_ps(r,combine(cm,v));
+		}
+
+#define STP3D_SHUF(a,b,x,y,z,w) _mm_shuffle_ps(a,b,_MM_SHUFFLE(w,z,y,x))
+#define STP3D_SWZ(a,x,y,z,w)    _mm_shuffle_ps(a,a,_MM_SHUFFLE(w,z,y,x))
+
+		/// 2x2 matrix product a*b (matrices stored as (m00,m01,m10,m11))
+		inline __m128 mat2Mul(__m128 a,__m128 b) {
+			return _mm_add_ps(_mm_mul_ps(a,STP3D_SWZ(b,0,3,0,3)),_mm_mul_ps(STP3D_SWZ(a,1,0,3,2),STP3D_SWZ(b,2,1,2,1)));
+		}
+		/// 2x2 matrix product adj(a)*b
+		inline __m128 mat2AdjMul(__m128 a,__m128 b) {
+			return _mm_sub_ps(_mm_mul_ps(STP3D_SWZ(a,3,3,0,0),b),_mm_mul_ps(STP3D_SWZ(a,1,1,2,2),STP3D_SWZ(b,2,3,0,1)));
+		}
+		/// 2x2 matrix product a*adj(b)
+		inline __m128 mat2MulAdj(__m128 a,__m128 b) {
+			return _mm_sub_ps(_mm_mul_ps(a,STP3D_SWZ(b,3,0,3,0)),_mm_mul_ps(STP3D_SWZ(a,1,0,3,2),STP3D_SWZ(b,2,1,2,1)));
+		}
+
+		/** Inverse by 2x2 blocks (single precision). The layout does not matter since
+		  * inverting the transpose gives the transpose of the inverse.
+		  */
+		inline bool invert(const float* m,float* r) {
+			__m128 c0 = _mm_loadu_ps(m);
+			__m128 c1 = _mm_loadu_ps(m+4);
+			__m128 c2 = _mm_loadu_ps(m+8);
+			__m128 c3 = _mm_loadu_ps(m+12);
+
+			// 2x2 sub matrices
+			__m128 A = _mm_movelh_ps(c0,c1);
+			__m128 B = _mm_movehl_ps(c1,c0);
+			__m128 C = _mm_movelh_ps(c2,c3);
+			__m128 D = _mm_movehl_ps(c3,c2);
+
+			// Determinants (|A|,|B|,|C|,|D|)
+			__m128 det_sub = _mm_sub_ps(_mm_mul_ps(STP3D_SHUF(c0,c2,0,2,0,2),STP3D_SHUF(c1,c3,1,3,1,3)),
+			                            _mm_mul_ps(STP3D_SHUF(c0,c2,1,3,1,3),STP3D_SHUF(c1,c3,0,2,0,2)));
+			__m128 det_A = STP3D_SWZ(det_sub,0,0,0,0);
+			__m128 det_B = STP3D_SWZ(det_sub,1,1,1,1);
+			__m128 det_C = STP3D_SWZ(det_sub,2,2,2,2);
+			__m128 det_D = STP3D_SWZ(det_sub,3,3,3,3);
+
+			__m128 D_C = mat2AdjMul(D,C);
+			__m128 A_B = mat2AdjMul(A,B);
+			__m128 X_ = _mm_sub_ps(_mm_mul_ps(det_D,A),mat2Mul(B,D_C));
+			__m128 W_ = _mm_sub_ps(_mm_mul_ps(det_A,D),mat2Mul(C,A_B));
+			__m128 Y_ = _mm_sub_ps(_mm_mul_ps(det_B,C),mat2MulAdj(D,A_B));
+			__m128 Z_ = _mm_sub_ps(_mm_mul_ps(det_C,B),mat2MulAdj(A,D_C));
+
+			// |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+			__m128 det_M = _mm_add_ps(_mm_mul_ps(det_A,det_D),_mm_mul_ps(det_B,det_C));
+			__m128 tr = _mm_mul_ps(A_B,STP3D_SWZ(D_C,0,2,1,3));
+			tr = _mm_add_ps(tr,_mm_movehl_ps(tr,tr));
+			tr = _mm_add_ps(tr,STP3D_SWZ(tr,1,1,1,1));
+			det_M = _mm_sub_ps(det_M,STP3D_SWZ(tr,0,0,0,0));
+
+			if (fabs(_mm_cvtss_f32(det_M)) < STP3D_EPSILON) return false;
+
+			__m128 r_det_M = _mm_div_ps(_mm_setr_ps(1.0f,-1.0f,-1.0f,1.0f),det_M);
+			X_ = _mm_mul_ps(X_,r_det_M);
+			Y_ = _mm_mul_ps(Y_,r_det_M);
+			Z_ = _mm_mul_ps(Z_,r_det_M);
+			W_ = _mm_mul_ps(W_,r_det_M);
+
+			// Adjugate shuffle and store
+			_mm_storeu_ps(r,STP3D_SHUF(X_,Y_,3,1,3,1));
+			_mm_storeu_ps(r+4,STP3D_SHUF(X_,Y_,2,0,2,0));
+			_mm_storeu_ps(r+8,STP3D_SHUF(Z_,W_,3,1,3,1));
+			_mm_storeu_ps(r+12,STP3D_SHUF(Z_,W_,2,0,2,0));
+			return true;
+		}
+
+		/// Cross product of the xyz parts (w of the result is 0 if w of inputs are 0)
+		inline __m128 cross(__m128 a,__m128 b) {
+			__m128 a_yzx = STP3D_SWZ(a,1,2,0,3);
+			__m128 b_yzx = STP3D_SWZ(b,1,2,0,3);
+			__m128 c = _mm_sub_ps(_mm_mul_ps(a,b_yzx),_mm_mul_ps(a_yzx,b));
+			return STP3D_SWZ(c,1,2,0,3);
+		}
+
+		inline bool normalMatrix(const float* m,float* r) {
+			// Clear the last row coefficient of the 3 first columns
+			const __m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1,-1,-1,0));
+			__m128 c0 = _mm_and_ps(_mm_loadu_ps(m),mask);
+			__m128 c1 = _mm_and_ps(_mm_loadu_ps(m+4),mask);
+			__m128 c2 = _mm_and_ps(_mm_loadu_ps(m+8),mask);
+			__m128 n0 = cross(c1,c2);
+			__m128 n1 = cross(c2,c0);
+			__m128 n2 = cross(c0,c1);
+			__m128 d = _mm_mul_ps(c0,n0);
+			d = _mm_add_ps(d,_mm_movehl_ps(d,d));
+			d = _mm_add_ps(d,STP3D_SWZ(d,1,1,1,1));
+			float det = _mm_cvtss_f32(d);
+			if (fabs(det) < STP3D_EPSILON) return false;
+			__m128 inv_det = _mm_set1_ps(1.0f/det);
+			_mm_storeu_ps(r,_mm_mul_ps(n0,inv_det));
+			_mm_storeu_ps(r+4,_mm_mul_ps(n1,inv_det));
+			_mm_storeu_ps(r+8,_mm_mul_ps(n2,inv_det));
+			_mm_storeu_ps(r+12,_mm_setr_ps(0.0f,0.0f,0.0f,1.0f));
+			return true;
+		}
+
+#undef STP3D_SHUF
+#undef STP3D_SWZ
+	}
+#endif
+
+#ifdef STP3D_USE_AVX2
+	namespace mat4_avx2 {
+
+		/// r = a*b, two columns of the result per 256 bits register
+		inline void mul(const float* a,const float* b,float* r) {
+			__m256 a0 = _mm256_broadcast_ps((const __m128*)a);
+			__m256 a1 = _mm256_broadcast_ps((const __m128*)(a+4));
+			__m256 a2 = _mm256_broadcast_ps((const __m128*)(a+8));
+			__m256 a3 = _mm256_broadcast_ps((const __m128*)(a+12));
+			__m256 b01 = _mm256_loadu_ps(b);
+			__m256 b23 = _mm256_loadu_ps(b+8);
+			__m256 r01 = _mm256_mul_ps(a0,_mm256_shuffle_ps(b01,b01,_MM_SHUFFLE(0,0,0,0)));
+			__m256 r23 = _mm256_mul_ps(a0,_mm256_shuffle_ps(b23,b23,_MM_SHUFFLE(0,0,0,0)));
+#ifdef __FMA__
+			r01 = _mm256_fmadd_ps(a1,_mm256_shuffle_ps(b01,b01,_MM_SHUFFLE(1,1,1,1)),r01);
+			r23 = _mm256_fmadd_ps(a1,_mm256_shuffle_ps(b23,b23,_MM_SHUFFLE(1,1,1,1)),r23);
+			r01 = _mm256_fmadd_ps(a2,_mm256_shuffle_ps(b01,b01,_MM_SHUFFLE(2,2,2,2)),r01);
+			r23 = _mm256_fmadd_ps(a2,_mm256_shuffle_ps(b23,b23,_MM_SHUFFLE(2,2,2,2)),r23);
+			r01 = _mm256_fmadd_ps(a3,_mm256_shuffle_ps(b01,b01,_MM_SHUFFLE(3,3,3,3)),r01);
+			r23 = _mm256_fmadd_ps(a3,_mm256_shuffle_ps(b23,b23,_MM_SHUFFLE(3,3,3,3)),r23);
+#else
+			r01 = _mm256_add_ps(r01,_mm256_mul_ps(a1,_mm256_shuffle_ps(b01,b01,_MM_SHUFFLE(1,1,1,1))));
+			r23 = _mm256_add_ps(r23,_mm256_mul_ps(a1,_mm256_shuffle_ps(b23,b23,_MM_SHUFFLE(1,1,1,1))));
+			r01 = _mm256_add_ps(r01,_mm256_mul_ps(a2,_mm256_shuffle_ps(b01,b01,_MM_SHUFFLE(2,2,2,2))));
+			r23 = _mm256_add_ps(r23,_mm256_mul_ps(a2,_mm256_shuffle_ps(b23,b23,_MM_SHUFFLE(2,2,2,2))));
+			r01 = _mm256_add_ps(r01,_mm256_mul_ps(a3,_mm256_shuffle_ps(b01,b01,_MM_SHUFFLE(3,3,3,3))));
+			r23 = _mm256_add_ps(r23,_mm256_mul_ps(a3,_mm256_shuffle_ps(b23,b23,_MM_SHUFFLE(3,3,3,3))));
+#endif
+			_mm256_storeu_ps(r,r01);
+			_mm256_storeu_ps(r+8,r23);
+		}
+	}
+#endif
+
+	/// r = a*b (a, b and r column major float[16])
+	inline void mat4Mul(const float* a,const float* b,float* r) {
+#if defined(STP3D_USE_AVX2)
+		mat4_avx2::mul(a,b,r);
+#elif defined(STP3D_USE_SSE)
+		mat4_sse::mul(a,b,r);
+#else
+		mat4_scalar::mul(a,b,r);
+#endif
+	}
+
+	/// r = a*b when the last row of a and b is (0,0,0,1)
+	inline void mat4MulAffine(const float* a,const float* b,float* r) {
+#if defined(STP3D_USE_SSE)
+		mat4_sse::mulAffine(a,b,r);
+#else
+		mat4_scalar::mulAffine(a,b,r);
+#endif
+	}
+
+	/// r = m*v
+	inline void mat4MulVec4(const float* m,const float* v,float* r) {
+#if defined(STP3D_USE_SSE)
+		mat4_sse::mulVec4(m,v,r);
+#else
+		mat4_scalar::mulVec4(m,v,r);
+#endif
+	}
+
+	/// r = inverse of m. Return false (r unchanged) if m is singular
+	inline bool mat4Invert(const float* m,float* r) {
+#if defined(STP3D_USE_SSE)
+		return mat4_sse::invert(m,r);
+#else
+		return mat4_scalar::invert(m,r);
+#endif
+	}
+
+	/// r = normal matrix of the modelview m. Return false (r unchanged) if m is singular
+	inline bool mat4NormalMatrix(const float* m,float* r) {
+#if defined(STP3D_USE_SSE)
+		return mat4_sse::normalMatrix(m,r);
+#else
+		return mat4_scalar::normalMatrix(m,r);
+#endif
+	}
+
+};
+
+#endif
+
+
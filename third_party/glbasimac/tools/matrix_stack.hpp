@@ -80,24 +80,25 @@ namespace STP3D {
 		stack.back() = transfo;
 	}
 
+	// Specialized right multiplications : no full 4x4 product for translations and scalings
 	inline void MatrixStack::addTransformation(const Matrix4D& transfo) {
-		stack.back() *= transfo;
+		stack.back().mulTransformation(transfo);
 	}
 
 	inline void MatrixStack::addTranslation(const Vector3D& trans) {
-		stack.back() *= Matrix4D::translation(trans);
+		stack.back().mulTranslation(trans.x,trans.y,trans.z);
 	}
 
 	inline void MatrixStack::addRotation(float angle,const Vector3D& axe) {
-		stack.back() *= Matrix4D::rotation(angle,axe);
+		stack.back().mulTransformation(Matrix4D::rotation(angle,axe));
 	}
 
 	inline void MatrixStack::addHomothety(float scale) {
-		stack.back() *= Matrix4D::homothety(scale,scale,scale);
+		stack.back().mulHomothety(scale,scale,scale);
 	}
 
 	inline void MatrixStack::addHomothety(const Vector3D& scale) {
-		stack.back() *= Matrix4D::homothety(scale.x,scale.y,scale.z);
+		stack.back().mulHomothety(scale.x,scale.y,scale.z);
 	}
 
 };
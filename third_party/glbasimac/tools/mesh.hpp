@@ -26,6 +26,9 @@
 #include <string>
 #include <vector>
 #include "gl_tools.hpp"
+#include "vertex_layout.hpp"
+#include "instance_buffer.hpp"
+#include "bounding_volume.hpp"
 
 namespace STP3D {
 
@@ -34,6 +37,7 @@ namespace STP3D {
 	  * that has no indirect order.
 	  * Mesh class allows to store several float buffer to use with a GL shaders.
 	  * Such buffers are not interleaved and each has a semantic on his own. 
+	  * On GPU side, buffers may however be interleaved (and packed) in a single VBO (see setInterleaved).
 	  * Note that a mesh MUST have at least one buffer of coordinates.
 	  * This class allows also the creation of the corresponding VBO.
 	  * This class may or may not store the data.
@@ -42,7 +46,8 @@ namespace STP3D {
 	public:
 		/// Standard construtor. Creates an empty mesh withouh any information.
 		StandardMesh(unsigned int elts = 0,unsigned int new_gl_type = GL_TRIANGLES) 
-			: nb_elts(elts),gl_type_mesh(new_gl_type),id_vao(0) {
+			: nb_elts(elts),gl_type_mesh(new_gl_type),id_vao(0),gpu_capacity(0),
+			  interleaved(false),packing(STP3D_PACK_NONE),stride(0) {
 			buffers.clear();
 			size_one_elt.clear();
 			attr_id.clear();
@@ -61,9 +66,63 @@ namespace STP3D {
 		 *                      GL RELATED FUNCTIONS
 		 *****************************************************************/
 		void changeType(unsigned int new_gl_type) {gl_type_mesh = new_gl_type;};
-		bool createVAO();
-		unsigned int getIdVAO();
-		void draw() const;
+		/** Store all buffers in one interleaved VBO instead of one VBO per buffer.
+		  * Must be called before createVAO. Interleaved meshes cannot be streamed with appendElements.
+		  * \param pack_flags combination of STP3D_PACK_* flags to use compact formats
+		  */
+		void setInterleaved(bool use_interleaved,unsigned int pack_flags = STP3D_PACK_NONE) {
+			interleaved = use_interleaved;
+			packing = use_interleaved ? pack_flags : STP3D_PACK_NONE;
+		};
+		/** Create the VAO and all VBOs.
+		  * \param capacity number of elements reserved on GPU (at least nb_elts). Reserving more
+		  * than nb_elts allows to stream new elements with appendElements without reallocation.
+		  */
+		bool createVAO(unsigned int capacity = 0);
+		/** Append \a nb_new elements at the end of every buffer (streaming).
+		  * Only the new elements are sent to the GPU and the VAO is kept. When the GPU storage is
+		  * full, it grows geometrically (copy done on GPU side), so the cost per element is constant.
+		  * CPU buffers given with addOneBuffer are neither read nor updated.
+		  * \param new_data one array per buffer (in the addOneBuffer order) of nb_new elements
+		  */
+		bool appendElements(unsigned int nb_new,const float* const* new_data);
+		unsigned int getIdVAO() const {return id_vao;};
+		/// True if one of the buffers is bound to attribute \a id_attribute
+		bool hasAttribute(unsigned int id_attribute) const {
+			for(std::vector<int>::size_type i = 0; i < attr_id.size(); ++i) if (attr_id[i] == id_attribute) return true;
+			return false;
+		};
+		unsigned int getNbElt() const {return nb_elts;};
+		/// Number of elements that can be stored on GPU without reallocation
+		unsigned int getCapacity() const {return gpu_capacity;};
+		/// Size in bytes of one vertex on GPU with the current layout
+		unsigned int getVertexByteSize() const;
+		/// Size in bytes of the vertex data on GPU with the current layout (computed on CPU side)
+		size_t getGPUByteSize() const {return (size_t)getVertexByteSize()*(nb_elts > gpu_capacity ? nb_elts : gpu_capacity);};
+		/// Print the GPU memory used by the mesh compared to separate float buffers
+		void printByteSize(std::ostream& os = std::cerr) const;
+		/** Draw the mesh.
+		  * \param bind_vao if false, the VAO must already be bound by the caller and is left bound
+		  * (allows to chain draws of the same mesh without redundant binds).
+		  */
+		void draw(bool bind_vao = true) const;
+		/** Set the per-instance transforms (16 floats, column major) and colors (3 floats, may be NULL)
+		  * used by drawInstanced. Can be called every frame : storage is reused when large enough.
+		  */
+		bool setInstances(unsigned int nb,const float* transforms,const float* colors = NULL) {
+			return instances.update(id_vao,nb,transforms,colors);
+		};
+		/// Remove per-instance data : draw renders again the mesh with the generic transform and color
+		void clearInstances() {instances.detach(id_vao);};
+		unsigned int getNbInstances() const {return instances.nb_instances;};
+		/// Draw all instances set with setInstances in a single draw call
+		void drawInstanced(bool bind_vao = true) const;
+		/// Compute bbox and bsphere from the coordinates (attribute 0). Called by createVAO
+		void computeBounds();
+
+		/// Bounds of the coordinates in object space (empty without CPU coordinates)
+		BoundingBox bbox;
+		BoundingSphere bsphere;
 private:
 		//  User defined members
 		/// All the data in CPU buffers
@@ -86,7 +145,19 @@ private:
 		std::vector<unsigned int> vbo_id;
 		/// Id of the corresponding VAO
 		unsigned int id_vao;
+		/// Number of elements allocated in each VBO
+		unsigned int gpu_capacity;
+		/// True if all buffers are interleaved in a single VBO
+		bool interleaved;
+		/// Packing flags used with the interleaved layout
+		unsigned int packing;
+		/// Size in bytes of one vertex in the interleaved VBO
+		unsigned int stride;
+		/// Per-instance data used by drawInstanced
+		InstanceBuffer instances;
 
+		/// Reallocate every VBO with room for \a new_capacity elements, keeping current content
+		bool growCapacity(unsigned int new_capacity);
 	};
 
 	inline StandardMesh::~StandardMesh() {
@@ -101,7 +172,7 @@ private:
 		glDeleteVertexArrays(1,&id_vao);
 	}
 
-	inline bool StandardMesh::createVAO() {
+	inline bool StandardMesh::createVAO(unsigned int capacity) {
 		// Create and use the VAO
 		glGenVertexArrays(1,&id_vao);
 		if (id_vao == 0) {
@@ -115,18 +186,37 @@ private:
 			STP3D::setError("Impossible to create VBO from empty buffers. This mesh has not been initialized");
 			return false;
 		}
+		computeBounds();
+
+		if (interleaved) {
+			// One VBO with all attributes packed
+			vbo_id.resize(1);
+			gpu_capacity = nb_elts;
+			stride = STP3D::createInterleavedVBO(buffers,nb_elts,attr_id,size_one_elt,packing,vbo_id[0]);
+			glBindVertexArray(0);
+			return (stride != 0);
+		}
 
 		// Create all VBO (\TODO check every VBO is created)
 		vbo_id.resize(buffers.size());
 
 		glGenBuffers(buffers.size(),&(vbo_id[0]));
+		gpu_capacity = (capacity > nb_elts) ? capacity : nb_elts;
 
 		// Transfer all data for all VBO from CPU to GPU
 		for(std::vector<int>::size_type i = 0; i < buffers.size(); ++i) {
 			std::cerr<<"Id VBO for "<<attr_semantic[i]<<" : "<<vbo_id[i]<<std::endl;
 			glBindBuffer(GL_ARRAY_BUFFER,vbo_id[i]);
 
-			glBufferData(GL_ARRAY_BUFFER,nb_elts*size_one_elt[i]*sizeof(GLfloat),buffers[i],GL_STATIC_DRAW);
+			if (gpu_capacity == nb_elts) {
+				glBufferData(GL_ARRAY_BUFFER,nb_elts*size_one_elt[i]*sizeof(GLfloat),buffers[i],GL_STATIC_DRAW);
+			}
+			else {
+				// Room reserved for streaming
+				glBufferData(GL_ARRAY_BUFFER,gpu_capacity*size_one_elt[i]*sizeof(GLfloat),NULL,GL_DYNAMIC_DRAW);
+				if (nb_elts>0) glBufferSubData(GL_ARRAY_BUFFER,0,nb_elts*size_one_elt[i]*sizeof(GLfloat),buffers[i]);
+			}
+			STP3D_COUNT(buffer_bytes,nb_elts*size_one_elt[i]*sizeof(GLfloat));
 
 			glEnableVertexAttribArray(attr_id[i]);
 
@@ -139,6 +229,79 @@ private:
 		return true;
 	}
 
+	inline bool StandardMesh::growCapacity(unsigned int new_capacity) {
+		glBindVertexArray(id_vao);
+		for(std::vector<int>::size_type i = 0; i < vbo_id.size(); ++i) {
+			unsigned int new_vbo = 0;
+			glGenBuffers(1,&new_vbo);
+			if (new_vbo == 0) {
+				STP3D::setError("Unable to find an empty VBO to grow the mesh");
+				glBindVertexArray(0);
+				return false;
+			}
+			glBindBuffer(GL_COPY_WRITE_BUFFER,new_vbo);
+			glBufferData(GL_COPY_WRITE_BUFFER,new_capacity*size_one_elt[i]*sizeof(GLfloat),NULL,GL_DYNAMIC_DRAW);
+			// Copy current content on GPU side
+			glBindBuffer(GL_COPY_READ_BUFFER,vbo_id[i]);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER,GL_COPY_WRITE_BUFFER,0,0,nb_elts*size_one_elt[i]*sizeof(GLfloat));
+			glBindBuffer(GL_COPY_READ_BUFFER,0);
+			glBindBuffer(GL_COPY_WRITE_BUFFER,0);
+			glDeleteBuffers(1,&(vbo_id[i]));
+			vbo_id[i] = new_vbo;
+
+			// Point the VAO to the new VBO
+			glBindBuffer(GL_ARRAY_BUFFER,vbo_id[i]);
+			glVertexAttribPointer(attr_id[i], size_one_elt[i], GL_FLOAT, GL_FALSE, 0, 0);
+			glBindBuffer(GL_ARRAY_BUFFER,0);
+		}
+		glBindVertexArray(0);
+		gpu_capacity = new_capacity;
+		return true;
+	}
+
+	inline bool StandardMesh::appendElements(unsigned int nb_new,const float* const* new_data) {
+		if (id_vao == 0) {
+			STP3D::setError("Impossible to append elements to a mesh without VAO");
+			return false;
+		}
+		if (interleaved) {
+			STP3D::setError("Impossible to append elements to an interleaved mesh");
+			return false;
+		}
+		if (nb_elts+nb_new > gpu_capacity) {
+			unsigned int new_capacity = (gpu_capacity < 64) ? 64 : 2*gpu_capacity;
+			if (new_capacity < nb_elts+nb_new) new_capacity = nb_elts+nb_new;
+			if (!growCapacity(new_capacity)) return false;
+		}
+		// Send only the new elements
+		for(std::vector<int>::size_type i = 0; i < vbo_id.size(); ++i) {
+			glBindBuffer(GL_ARRAY_BUFFER,vbo_id[i]);
+			glBufferSubData(GL_ARRAY_BUFFER,nb_elts*size_one_elt[i]*sizeof(GLfloat),
+			                nb_new*size_one_elt[i]*sizeof(GLfloat),new_data[i]);
+			STP3D_COUNT(buffer_bytes,nb_new*size_one_elt[i]*sizeof(GLfloat));
+		}
+		glBindBuffer(GL_ARRAY_BUFFER,0);
+		// Bounds grow with the new coordinates
+		for(std::vector<int>::size_type i = 0; i < attr_id.size(); ++i) {
+			if ((attr_id[i] != 0) || (size_one_elt[i] < 2) || (size_one_elt[i] > 3) || !new_data[i]) continue;
+			bbox.extend(new_data[i],nb_new,size_one_elt[i]);
+			if (bsphere.isEmpty()) bsphere.around(bbox,new_data[i],nb_new,size_one_elt[i]);
+			else bsphere.enclose(new_data[i],nb_new,size_one_elt[i]);
+		}
+		nb_elts += nb_new;
+		return true;
+	}
+
+	inline void StandardMesh::computeBounds() {
+		bbox = BoundingBox();
+		bsphere = BoundingSphere();
+		for(std::vector<int>::size_type i = 0; i < attr_id.size(); ++i) {
+			if ((attr_id[i] != 0) || (size_one_elt[i] < 2) || (size_one_elt[i] > 3) || !buffers[i]) continue;
+			bbox.extend(buffers[i],nb_elts,size_one_elt[i]);
+			bsphere.around(bbox,buffers[i],nb_elts,size_one_elt[i]);
+		}
+	}
+
 	inline void StandardMesh::addOneBuffer(unsigned int id_attribute,unsigned int one_elt_size,
 	                                       float* data,std::string semantic,bool copy) {
 		if (copy) {
@@ -156,12 +319,42 @@ private:
 		attr_semantic.push_back(semantic);
 	}
 
-	inline void StandardMesh::draw() const {
-		glBindVertexArray(id_vao);
+	inline unsigned int StandardMesh::getVertexByteSize() const {
+		if (!interleaved) {
+			unsigned int size = 0;
+			for(std::vector<int>::size_type i = 0; i < size_one_elt.size(); ++i) size += size_one_elt[i]*sizeof(GLfloat);
+			return size;
+		}
+		std::vector<VertexAttribFormat> formats;
+		return STP3D::computeInterleavedLayout(attr_id,size_one_elt,packing,formats);
+	}
+
+	inline void StandardMesh::printByteSize(std::ostream& os) const {
+		unsigned int float_size = 0;
+		for(std::vector<int>::size_type i = 0; i < size_one_elt.size(); ++i) float_size += size_one_elt[i]*sizeof(GLfloat);
+		os<<"Mesh of "<<nb_elts<<" vertices : "<<getVertexByteSize()<<" bytes per vertex, "
+		  <<getGPUByteSize()<<" bytes on GPU (separate float buffers : "<<(size_t)float_size*nb_elts<<" bytes)"<<std::endl;
+	}
+
+	inline void StandardMesh::draw(bool bind_vao) const {
+		if (bind_vao) {glBindVertexArray(id_vao); STP3D_COUNT(binds,1);}
 
 		glDrawArrays(gl_type_mesh,0,nb_elts);
+		STP3D_COUNT(draw_calls,1);
+		STP3D_COUNT(triangles,trianglesOf(gl_type_mesh,nb_elts));
 
-		glBindVertexArray(0);
+		if (bind_vao) glBindVertexArray(0);
+	}
+
+	inline void StandardMesh::drawInstanced(bool bind_vao) const {
+		if (bind_vao) {glBindVertexArray(id_vao); STP3D_COUNT(binds,1);}
+
+		glDrawArraysInstanced(gl_type_mesh,0,nb_elts,instances.nb_instances);
+		InstanceBuffer::setDefaultValues();
+		STP3D_COUNT(draw_calls,1);
+		STP3D_COUNT(triangles,trianglesOf(gl_type_mesh,nb_elts)*instances.nb_instances);
+
+		if (bind_vao) glBindVertexArray(0);
 	}
 
 	inline void StandardMesh::reInit() {
@@ -176,6 +369,10 @@ private:
 		glDeleteBuffers(vbo_id.size(),&(vbo_id[0]));
 		vbo_id.clear();
 		glDeleteVertexArrays(1,&id_vao);
+		instances.release();
+		id_vao = 0;
+		gpu_capacity = 0;
+		stride = 0;
 	}
 
 	inline void StandardMesh::releaseCPUMemory() {
@@ -0,0 +1,251 @@
+#ifndef _STP3D_MESH_FILE_HPP_
+#define _STP3D_MESH_FILE_HPP_
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <sys/stat.h>
+#include "globals.hpp"
+#include "indexed_mesh.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/** \addtogroup Macros */
+/*@{*/
+/// Version of the binary mesh files (files of other versions are refused)
+#define STP3D_MESH_FILE_VERSION 2
+/*@}*/
+
+namespace STP3D {
+
+	/**
+	  * Native binary mesh files (.stpm) : the buffers of an IndexedMesh as they are sent to the GPU,
+	  * so that loading needs no parsing. Layout (little endian) :
+	  *   - header : "STPM", version, number of vertices, of primitives, GL primitive type, of buffers,
+	  *     then the size and modification time of the file the mesh was converted from (0 if none) ;
+	  *   - for each buffer : attribute id, floats per vertex, semantic (24 characters) ;
+	  *   - the float buffers, then the 32 bits indices, each one starting on 16 bytes.
+	  * Files are memory mapped for loading : with \a gpu_only, VBOs are filled straight from the mapping
+	  * and the mesh keeps no CPU copy (a GL context is needed, the VAO is created).
+	  * A file converted from another one (OBJ) stores its stamp : loading with an \a expected stamp
+	  * refuses a file converted from another version of the source.
+	  */
+	struct MeshFileSource {
+		MeshFileSource():size(0),mtime_ns(0) {}
+		unsigned long long size;
+		/// Modification time in nanoseconds (seconds only where the system does not give more)
+		long long mtime_ns;
+
+		bool operator==(const MeshFileSource& other) const {return (size == other.size) && (mtime_ns == other.mtime_ns);}
+		/// Stamp of the file \a path. Return false if it does not exist
+		static bool of(const std::string& path,MeshFileSource& source);
+	};
+	bool saveMeshFile(const IndexedMesh& mesh,const std::string& filename,const MeshFileSource& source = MeshFileSource());
+	IndexedMesh* loadMeshFile(const std::string& filename,bool gpu_only = false,const MeshFileSource* expected = NULL);
+
+	namespace mesh_file_detail {
+
+		struct Header {
+			char magic[4];
+			unsigned int version;
+			unsigned int nb_elts;
+			unsigned int nb_primitive;
+			unsigned int gl_type;
+			unsigned int nb_buffers;
+			unsigned long long source_size;
+			long long source_mtime_ns;
+		};
+
+		struct BufferHeader {
+			unsigned int attr_id;
+			unsigned int size_one_elt;
+			char semantic[24];
+		};
+
+		inline size_t align16(size_t offset) {return (offset+15) & ~size_t(15);}
+
+		/// Read only mapping of a whole file
+		struct MappedFile {
+			MappedFile():data(NULL),size(0) {}
+			~MappedFile() {close();}
+
+			bool open(const std::string& filename) {
+#ifdef _WIN32
+				file = CreateFileA(filename.c_str(),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+				if (file == INVALID_HANDLE_VALUE) return false;
+				LARGE_INTEGER file_size;
+				GetFileSizeEx(file,&file_size);
+				size = size_t(file_size.QuadPart);
+				mapping = CreateFileMappingA(file,NULL,PAGE_READONLY,0,0,NULL);
+				if (mapping) data = (const unsigned char*)MapViewOfFile(mapping,FILE_MAP_READ,0,0,0);
+#else
+				int fd = ::open(filename.c_str(),O_RDONLY);
+				if (fd < 0) return false;
+				struct stat st;
+				if ((fstat(fd,&st) == 0) && (st.st_size > 0)) {
+					size = size_t(st.st_size);
+					void* ptr = mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+					if (ptr != MAP_FAILED) data = (const unsigned char*)ptr;
+				}
+				::close(fd);
+#endif
+				if (!data) close();
+				return data != NULL;
+			}
+
+			void close() {
+#ifdef _WIN32
+				if (data) UnmapViewOfFile(data);
+				if (mapping) CloseHandle(mapping);
+				if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+				mapping = NULL;
+				file = INVALID_HANDLE_VALUE;
+#else
+				if (data) munmap((void*)data,size);
+#endif
+				data = NULL;
+				size = 0;
+			}
+
+			const unsigned char* data;
+			size_t size;
+#ifdef _WIN32
+			HANDLE file = INVALID_HANDLE_VALUE;
+			HANDLE mapping = NULL;
+#endif
+		private:
+			MappedFile(const MappedFile&);
+			MappedFile& operator=(const MappedFile&);
+		};
+
+	}
+
+	inline bool MeshFileSource::of(const std::string& path,MeshFileSource& source) {
+		struct stat st;
+		if (stat(path.c_str(),&st) != 0) return false;
+		source.size = (unsigned long long)st.st_size;
+#if defined(_WIN32)
+		source.mtime_ns = (long long)st.st_mtime*1000000000LL;
+#elif defined(__APPLE__)
+		source.mtime_ns = (long long)st.st_mtimespec.tv_sec*1000000000LL+st.st_mtimespec.tv_nsec;
+#else
+		source.mtime_ns = (long long)st.st_mtim.tv_sec*1000000000LL+st.st_mtim.tv_nsec;
+#endif
+		return true;
+	}
+
+	inline bool saveMeshFile(const IndexedMesh& mesh,const std::string& filename,const MeshFileSource& source) {
+		bool ok = (mesh.index_buffer != NULL);
+		for(size_t b=0;b<mesh.buffers.size();b++) ok = ok && mesh.buffers[b];
+		if (!ok) {
+			STP3D::setError("saveMeshFile : CPU buffers needed to save a mesh");
+			return false;
+		}
+		FILE* file = fopen(filename.c_str(),"wb");
+		if (!file) {
+			STP3D::setError("saveMeshFile : unable to write "+filename);
+			return false;
+		}
+		mesh_file_detail::Header header = {{'S','T','P','M'},STP3D_MESH_FILE_VERSION,mesh.nb_elts,mesh.nb_primitive,
+		                                   mesh.gl_type_mesh,(unsigned int)mesh.buffers.size(),source.size,source.mtime_ns};
+		ok = fwrite(&header,sizeof(header),1,file) == 1;
+		for(size_t b=0;b<mesh.buffers.size();b++) {
+			mesh_file_detail::BufferHeader buffer;
+			memset(&buffer,0,sizeof(buffer));
+			buffer.attr_id = mesh.attr_id[b];
+			buffer.size_one_elt = mesh.size_one_elt[b];
+			strncpy(buffer.semantic,mesh.attr_semantic[b].c_str(),sizeof(buffer.semantic)-1);
+			ok = ok && (fwrite(&buffer,sizeof(buffer),1,file) == 1);
+		}
+		// Data blocks start on 16 bytes
+		static const char zeros[16] = {0};
+		size_t offset = sizeof(header)+mesh.buffers.size()*sizeof(mesh_file_detail::BufferHeader);
+		size_t nb_idx = size_t(mesh.nb_primitive)*mesh.getNbIndexPerPrimitive();
+		for(size_t b=0;b<=mesh.buffers.size();b++) {
+			size_t padding = mesh_file_detail::align16(offset)-offset;
+			if (padding) ok = ok && (fwrite(zeros,padding,1,file) == 1);
+			offset += padding;
+			const void* data = (b < mesh.buffers.size()) ? (const void*)mesh.buffers[b] : (const void*)mesh.index_buffer;
+			size_t bytes = (b < mesh.buffers.size()) ? size_t(mesh.nb_elts)*mesh.size_one_elt[b]*sizeof(float) : nb_idx*sizeof(unsigned int);
+			if (bytes) ok = ok && (fwrite(data,bytes,1,file) == 1);
+			offset += bytes;
+		}
+		ok = (fclose(file) == 0) && ok;
+		if (!ok) STP3D::setError("saveMeshFile : unable to write "+filename);
+		return ok;
+	}
+
+	inline IndexedMesh* loadMeshFile(const std::string& filename,bool gpu_only,const MeshFileSource* expected) {
+		mesh_file_detail::MappedFile file;
+		if (!file.open(filename)) {
+			STP3D::setError("loadMeshFile : unable to open "+filename);
+			return NULL;
+		}
+		const mesh_file_detail::Header* header = (const mesh_file_detail::Header*)file.data;
+		bool ok = (file.size >= sizeof(mesh_file_detail::Header)) && (memcmp(header->magic,"STPM",4) == 0) &&
+		          (header->version == STP3D_MESH_FILE_VERSION);
+		if (ok && expected && ((header->source_size != expected->size) || (header->source_mtime_ns != expected->mtime_ns))) {
+			STP3D::setError("loadMeshFile : "+filename+" was converted from another version of its source");
+			return NULL;
+		}
+		size_t offset = sizeof(mesh_file_detail::Header);
+		const mesh_file_detail::BufferHeader* buffers = (const mesh_file_detail::BufferHeader*)(file.data+offset);
+		if (ok) offset += header->nb_buffers*sizeof(mesh_file_detail::BufferHeader);
+		ok = ok && (offset <= file.size);
+		// Offsets of the data blocks (the last one is the index buffer)
+		IndexedMesh* mesh = ok ? new IndexedMesh(header->nb_primitive,header->nb_elts,header->gl_type) : NULL;
+		std::vector<size_t> blocks;
+		if (mesh) {
+			size_t nb_idx = size_t(header->nb_primitive)*mesh->getNbIndexPerPrimitive();
+			for(unsigned int b=0;b<=header->nb_buffers;b++) {
+				offset = mesh_file_detail::align16(offset);
+				blocks.push_back(offset);
+				offset += (b < header->nb_buffers) ? size_t(header->nb_elts)*buffers[b].size_one_elt*sizeof(float) : nb_idx*sizeof(unsigned int);
+			}
+			ok = (offset <= file.size);
+		}
+		if (!ok) {
+			delete mesh;
+			STP3D::setError("loadMeshFile : "+filename+" is not a mesh file of version "+intToString(STP3D_MESH_FILE_VERSION));
+			return NULL;
+		}
+
+		for(unsigned int b=0;b<header->nb_buffers;b++) {
+			float* data = (float*)(file.data+blocks[b]);
+			char semantic[sizeof(buffers[b].semantic)+1] = {0};
+			memcpy(semantic,buffers[b].semantic,sizeof(buffers[b].semantic));
+			mesh->addOneBuffer(buffers[b].attr_id,buffers[b].size_one_elt,data,semantic,!gpu_only);
+		}
+		unsigned int* indexes = (unsigned int*)(file.data+blocks.back());
+		if (!gpu_only) {
+			if (mesh->index_buffer) mesh->addIndexBuffer(indexes,true);
+			return mesh;
+		}
+		// VBOs filled from the mapping, then the mesh forgets the mapped pointers
+		if (mesh->index_buffer) delete[](mesh->index_buffer);
+		mesh->index_buffer = indexes;
+		ok = mesh->createVAO();
+		for(size_t b=0;b<mesh->buffers.size();b++) mesh->buffers[b] = NULL;
+		mesh->index_buffer = NULL;
+		if (!ok) {
+			delete mesh;
+			return NULL;
+		}
+		return mesh;
+	}
+
+};
+
+#endif
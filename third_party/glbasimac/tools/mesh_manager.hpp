@@ -18,10 +18,19 @@
 #define _STP3D_MESH_MANAGER_HPP_
 
 
+#include <cstdio>
 #include <iostream>
 #include <vector>
 #include <map>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
 #include "globals.hpp"
+#include "mesh.hpp"
+#include "indexed_mesh.hpp"
+#include "obj_loader.hpp"
+#include "mesh_file.hpp"
 
 
 namespace STP3D {
@@ -30,12 +39,15 @@ namespace STP3D {
 	  * \brief Mesh manager store efficiently meshes using symbolic names.
 	  * Mesh manager can be used to store, once, each mesh of a scene. It
 	  * can also be used for memory management. Mesh manager can handle only
-	  * generic mesh type which are StandardMesh and IndexedMesh
+	  * generic mesh type which are StandardMesh and IndexedMesh.
+	  * Indexed meshes can be loaded from files (OBJ or native .stpm files, see mesh_file.hpp) :
+	  * OBJ files are converted once to the native format in cache_directory, and later runs load
+	  * the converted file as long as the OBJ file keeps the size and modification time stored in it.
 	  */
 	class MeshManager {
 	public:
 		/// Standard construtor. Creates an empty mesh withouh any information.
-		MeshManager() {
+		MeshManager(const std::string& cache_dir = "mesh_cache") : cache_directory(cache_dir),nb_cache_hits(0),nb_converted(0) {
 			indexed_meshes.clear();
 			standard_meshes.clear();
 		};
@@ -70,6 +82,23 @@ namespace STP3D {
 		  * \return The found mesh. If it does not exist, return NULL
 		  */
 		const IndexedMesh* getIdxMesh(const std::string name);
+		/** Load an indexed mesh from a file, once : the mesh is stored with the path as name
+		  * (followed by "|gpu" with \a gpu_only : meshes with and without CPU copy are kept apart).
+		  * \param path OBJ file, or native mesh file (.stpm)
+		  * \param gpu_only native files are uploaded straight from the file mapping and the mesh keeps no CPU copy
+		  *        (a GL context is needed and the VAO is created)
+		  * \param nb_threads threads parsing OBJ files (0 : one per core)
+		  * \return The mesh, or NULL if it can not be loaded (see STP3D::getError)
+		  */
+		IndexedMesh* loadIdxMesh(const std::string& path,bool gpu_only = false,unsigned int nb_threads = 0);
+		/// Native file caching the conversion of \param path (in cache_directory)
+		std::string cachedFileName(const std::string& path) const;
+
+		/// Directory of the converted OBJ files (empty : no cache, OBJ files are always parsed)
+		std::string cache_directory;
+		/// Meshes loaded from the cache, and OBJ files converted
+		unsigned long nb_cache_hits;
+		unsigned long nb_converted;
 	};
 
 	inline MeshManager::~MeshManager() {
@@ -111,6 +140,58 @@ namespace STP3D {
 		return (res == indexed_meshes.end()) ? NULL : res->second;
 	}
 
+	inline std::string MeshManager::cachedFileName(const std::string& path) const {
+		// 64 bits FNV-1a hash of the path
+		unsigned long long hash = 14695981039346656037ULL;
+		for(size_t i=0;i<path.size();i++) hash = (hash ^ (unsigned char)path[i])*1099511628211ULL;
+		char name[32];
+		snprintf(name,sizeof(name),"%016llx.stpm",hash);
+		return cache_directory+"/"+name;
+	}
+
+	inline IndexedMesh* MeshManager::loadIdxMesh(const std::string& path,bool gpu_only,unsigned int nb_threads) {
+		std::string name = gpu_only ? path+"|gpu" : path;
+		map_idx_mesh::iterator res = indexed_meshes.find(name);
+		if (res != indexed_meshes.end()) return const_cast<IndexedMesh*>(res->second);
+
+		IndexedMesh* mesh = NULL;
+		bool native = (path.size() > 5) && (path.compare(path.size()-5,5,".stpm") == 0);
+		if (native) mesh = loadMeshFile(path,gpu_only);
+		else {
+			MeshFileSource source;
+			if (!MeshFileSource::of(path,source)) {
+				STP3D::setError("loadIdxMesh : unable to find "+path);
+				return NULL;
+			}
+			// Converted from this very version of the OBJ file (same size and modification time in ns)
+			std::string cache = cache_directory.empty() ? std::string() : cachedFileName(path);
+			struct stat cached;
+			if (!cache.empty() && (stat(cache.c_str(),&cached) == 0)) {
+				mesh = loadMeshFile(cache,gpu_only,&source);
+				if (mesh) nb_cache_hits++;
+			}
+			if (!mesh) {
+				mesh = loadOBJ(path,nb_threads);
+				if (!mesh) return NULL;
+				nb_converted++;
+				if (!cache.empty()) {
+#ifdef _WIN32
+					_mkdir(cache_directory.c_str());
+#else
+					mkdir(cache_directory.c_str(),0755);
+#endif
+					if (!saveMeshFile(*mesh,cache,source)) std::cerr<<"Unable to cache "<<path<<" in "<<cache<<std::endl;
+				}
+				if (gpu_only) {
+					if (!mesh->createVAO()) {delete mesh; return NULL;}
+					mesh->releaseCPUMemory();
+				}
+			}
+		}
+		if (mesh) addIdxMesh(name,mesh);
+		return mesh;
+	}
+
 };
 
 #endif
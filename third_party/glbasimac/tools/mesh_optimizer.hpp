@@ -0,0 +1,385 @@
+#ifndef _STP3D_MESH_OPTIMIZER_HPP_
+#define _STP3D_MESH_OPTIMIZER_HPP_
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "globals.hpp"
+#include "indexed_mesh.hpp"
+
+/** \addtogroup Macros */
+/*@{*/
+/// Number of entries of the post-transform vertex cache the triangle orders are optimized for
+#define STP3D_VERTEX_CACHE_SIZE 16
+/*@}*/
+
+namespace STP3D {
+
+	/**
+	  * Optimization of indexed triangle meshes (GL_TRIANGLES), done on the CPU buffers before createVAO :
+	  *   - weldVertices merges vertices whose attributes are all equal ;
+	  *   - optimizeVertexCache orders triangles so that their vertices are still in the post-transform
+	  *     cache of the GPU (Tipsify, Sander et al. 2007) : fewer vertex shader invocations ;
+	  *   - optimizeOverdraw then orders the clusters of this order from the outside of the mesh to the
+	  *     inside, so that more hidden fragments fail the depth test, keeping most of the cache efficiency ;
+	  *   - optimizeVertexFetch numbers the vertices in order of first use (memory locality of vertex fetch).
+	  * optimizeMesh runs all of them and reports the cache efficiency before and after, as
+	  * ACMR (vertices transformed per triangle, 0.5 at best, 3 at worst) and
+	  * ATVR (vertices transformed per vertex of the mesh, 1 at best).
+	  */
+
+	/// Efficiency of a triangle order for a FIFO vertex cache
+	struct MeshCacheStats {
+		MeshCacheStats():nbTransformed(0),acmr(0.0f),atvr(0.0f) {}
+		/// Number of vertices transformed (cache misses)
+		unsigned int nbTransformed;
+		/// Average cache miss ratio : transformed vertices per triangle
+		float acmr;
+		/// Average transform to vertex ratio : transformed vertices per vertex of the mesh
+		float atvr;
+	};
+
+	/// Report of optimizeMesh
+	struct MeshOptimizationReport {
+		MeshOptimizationReport():nbWelded(0),nbTriangles(0) {}
+		void print(std::ostream& os = std::cerr) const {
+			os<<"Mesh of "<<nbTriangles<<" triangles : "<<nbWelded<<" vertices welded, ACMR "<<before.acmr<<" -> "<<after.acmr
+			  <<", ATVR "<<before.atvr<<" -> "<<after.atvr<<std::endl;
+		}
+		unsigned int nbWelded;
+		unsigned int nbTriangles;
+		MeshCacheStats before;
+		MeshCacheStats after;
+	};
+
+	/// Simulate a FIFO post-transform cache of \param cache_size entries on \param nb_tri triangles
+	MeshCacheStats computeCacheStats(const unsigned int* idx,unsigned int nb_tri,unsigned int nb_verts,
+	                                 unsigned int cache_size = STP3D_VERTEX_CACHE_SIZE);
+	MeshCacheStats computeCacheStats(const IndexedMesh& mesh,unsigned int cache_size = STP3D_VERTEX_CACHE_SIZE);
+	/// Merge the vertices having the same value for every buffer. Return the number of vertices removed
+	unsigned int weldVertices(IndexedMesh& mesh);
+	/** Reorder the triangles of \param idx for a cache of \param cache_size entries (Tipsify).
+	  * If \param clusters is given, it receives the first triangle of each run of triangles started
+	  * where the cache was empty (plus nb_tri) : such runs can be reordered without loss of cache efficiency.
+	  */
+	void optimizeVertexCache(unsigned int* idx,unsigned int nb_tri,unsigned int nb_verts,
+	                         unsigned int cache_size = STP3D_VERTEX_CACHE_SIZE,std::vector<unsigned int>* clusters = NULL);
+	bool optimizeVertexCache(IndexedMesh& mesh,unsigned int cache_size = STP3D_VERTEX_CACHE_SIZE);
+	/** Reorder the triangles for the vertex cache, then their clusters to reduce overdraw. Clusters are
+	  * split while their ACMR stays below \param threshold times the one of the whole order.
+	  * Positions are the buffer of attribute 0 (3 floats per vertex).
+	  */
+	bool optimizeOverdraw(IndexedMesh& mesh,float threshold = 1.05f,unsigned int cache_size = STP3D_VERTEX_CACHE_SIZE);
+	/// Renumber the vertices in order of first use by the index buffer. Unused vertices are removed
+	bool optimizeVertexFetch(IndexedMesh& mesh);
+	/// Weld, reorder triangles for cache and overdraw, reorder vertices
+	MeshOptimizationReport optimizeMesh(IndexedMesh& mesh,float overdraw_threshold = 1.05f,
+	                                    unsigned int cache_size = STP3D_VERTEX_CACHE_SIZE);
+
+	namespace mesh_opt_detail {
+
+		/// Mesh can be optimized : triangles and every buffer on CPU
+		inline bool checkMesh(const IndexedMesh& mesh,const char* operation) {
+			bool ok = (mesh.gl_type_mesh == GL_TRIANGLES) && mesh.index_buffer;
+			for(size_t b=0;b<mesh.buffers.size();b++) ok = ok && mesh.buffers[b];
+			if (!ok) {
+				STP3D::setError(std::string(operation)+" : indexed triangles with CPU buffers needed (before releaseCPUMemory)");
+			}
+			return ok;
+		}
+
+		/// Triangles using each vertex (compressed adjacency)
+		struct Adjacency {
+			Adjacency(const unsigned int* idx,unsigned int nb_tri,unsigned int nb_verts)
+				:offsets(nb_verts+1,0),triangles(3*size_t(nb_tri)) {
+				for(size_t i=0;i<3*size_t(nb_tri);i++) offsets[idx[i]+1]++;
+				for(unsigned int v=0;v<nb_verts;v++) offsets[v+1] += offsets[v];
+				std::vector<unsigned int> fill(offsets.begin(),offsets.end()-1);
+				for(size_t i=0;i<3*size_t(nb_tri);i++) triangles[fill[idx[i]]++] = (unsigned int)(i/3);
+			}
+			std::vector<unsigned int> offsets;
+			std::vector<unsigned int> triangles;
+		};
+
+		/// Apply the vertex renumbering \param remap (old to new, ~0u : removed) to the buffers of mesh
+		inline void remapVertices(IndexedMesh& mesh,const std::vector<unsigned int>& remap,unsigned int new_nb_elts) {
+			for(size_t b=0;b<mesh.buffers.size();b++) {
+				unsigned int size = mesh.size_one_elt[b];
+				float* data = new float[size_t(size)*new_nb_elts];
+				for(unsigned int v=0;v<mesh.nb_elts;v++) {
+					if (remap[v] != ~0u) memcpy(data+size_t(size)*remap[v],mesh.buffers[b]+size_t(size)*v,size*sizeof(float));
+				}
+				delete[](mesh.buffers[b]);
+				mesh.buffers[b] = data;
+			}
+			size_t nb_idx = size_t(mesh.nb_primitive)*3;
+			for(size_t i=0;i<nb_idx;i++) mesh.index_buffer[i] = remap[mesh.index_buffer[i]];
+			mesh.nb_elts = new_nb_elts;
+		}
+
+		/// Next fanning vertex of Tipsify : a candidate whose triangles will still find it in cache, else a dead end
+		inline int nextVertex(const std::vector<unsigned int>& candidates,const std::vector<unsigned int>& live,
+		                      const std::vector<unsigned int>& time,unsigned int stamp,unsigned int cache_size,
+		                      std::vector<unsigned int>& dead_end,unsigned int& cursor,bool& cache_flushed) {
+			int best = -1,best_priority = 0;
+			for(size_t i=0;i<candidates.size();i++) {
+				unsigned int v = candidates[i];
+				if (live[v] == 0) continue;
+				// Age of the vertex in the cache, if it is still there after its triangles (0 : not a candidate)
+				int priority = 0;
+				if (stamp-time[v]+2*live[v] <= cache_size) priority = int(stamp-time[v]);
+				if (priority > best_priority) {
+					best_priority = priority;
+					best = int(v);
+				}
+			}
+			cache_flushed = false;
+			if (best >= 0) return best;
+			// Dead end : most recent vertices still having triangles, then the input order
+			while (!dead_end.empty()) {
+				unsigned int v = dead_end.back();
+				dead_end.pop_back();
+				if (live[v] > 0) return int(v);
+			}
+			cache_flushed = true;
+			for(;cursor<live.size();cursor++) {
+				if (live[cursor] > 0) return int(cursor);
+			}
+			return -1;
+		}
+
+	}
+
+	inline MeshCacheStats computeCacheStats(const unsigned int* idx,unsigned int nb_tri,unsigned int nb_verts,unsigned int cache_size) {
+		MeshCacheStats stats;
+		// Time stamps of entry in the FIFO : a vertex is in cache if it entered less than cache_size misses ago
+		std::vector<unsigned int> entered(nb_verts,0);
+		unsigned int misses = 0;
+		for(size_t i=0;i<3*size_t(nb_tri);i++) {
+			unsigned int v = idx[i];
+			if ((entered[v] == 0) || (misses+1-entered[v] > cache_size)) {
+				misses++;
+				entered[v] = misses;
+			}
+		}
+		stats.nbTransformed = misses;
+		if (nb_tri) stats.acmr = float(misses)/nb_tri;
+		if (nb_verts) stats.atvr = float(misses)/nb_verts;
+		return stats;
+	}
+
+	inline MeshCacheStats computeCacheStats(const IndexedMesh& mesh,unsigned int cache_size) {
+		if ((mesh.gl_type_mesh != GL_TRIANGLES) || !mesh.index_buffer) return MeshCacheStats();
+		return computeCacheStats(mesh.index_buffer,mesh.nb_primitive,mesh.nb_elts,cache_size);
+	}
+
+	inline unsigned int weldVertices(IndexedMesh& mesh) {
+		if (!mesh_opt_detail::checkMesh(mesh,"weldVertices")) return 0;
+		unsigned int nb = mesh.nb_elts;
+		// Open addressing hash table of vertex ids, hashed on the bits of every attribute
+		size_t table_size = 1;
+		while (table_size < 2*size_t(nb)) table_size <<= 1;
+		std::vector<unsigned int> table(table_size,~0u);
+		std::vector<unsigned int> remap(nb);
+		unsigned int nb_unique = 0;
+		for(unsigned int v=0;v<nb;v++) {
+			unsigned long long h = 14695981039346656037ULL;
+			for(size_t b=0;b<mesh.buffers.size();b++) {
+				const float* val = mesh.buffers[b]+size_t(mesh.size_one_elt[b])*v;
+				for(unsigned int c=0;c<mesh.size_one_elt[b];c++) {
+					// -0 and +0 are the same value
+					float f = (val[c] == 0.0f) ? 0.0f : val[c];
+					unsigned int bits;
+					memcpy(&bits,&f,sizeof(bits));
+					h = (h^bits)*1099511628211ULL;
+				}
+			}
+			size_t slot = size_t(h^(h>>29))&(table_size-1);
+			for(;;slot = (slot+1)&(table_size-1)) {
+				unsigned int other = table[slot];
+				if (other == ~0u) {
+					table[slot] = v;
+					remap[v] = nb_unique++;
+					break;
+				}
+				bool same = true;
+				for(size_t b=0;same && (b<mesh.buffers.size());b++) {
+					unsigned int size = mesh.size_one_elt[b];
+					const float* a = mesh.buffers[b]+size_t(size)*v;
+					const float* o = mesh.buffers[b]+size_t(size)*other;
+					for(unsigned int c=0;same && (c<size);c++) same = (a[c] == o[c]);
+				}
+				if (same) {
+					remap[v] = remap[other];
+					break;
+				}
+			}
+		}
+		if (nb_unique == nb) return 0;
+		mesh_opt_detail::remapVertices(mesh,remap,nb_unique);
+		return nb-nb_unique;
+	}
+
+	inline void optimizeVertexCache(unsigned int* idx,unsigned int nb_tri,unsigned int nb_verts,unsigned int cache_size,
+	                                std::vector<unsigned int>* clusters) {
+		if (clusters) clusters->clear();
+		if (nb_tri == 0) return;
+		mesh_opt_detail::Adjacency adjacency(idx,nb_tri,nb_verts);
+		std::vector<unsigned int> live(nb_verts);
+		for(unsigned int v=0;v<nb_verts;v++) live[v] = adjacency.offsets[v+1]-adjacency.offsets[v];
+		std::vector<unsigned int> time(nb_verts,0);
+		std::vector<bool> emitted(nb_tri,false);
+		std::vector<unsigned int> dead_end,candidates;
+		std::vector<unsigned int> output;
+		output.reserve(3*size_t(nb_tri));
+		unsigned int stamp = cache_size+1,cursor = 0;
+		bool cache_flushed = true;
+		int fanning = mesh_opt_detail::nextVertex(candidates,live,time,stamp,cache_size,dead_end,cursor,cache_flushed);
+		while (fanning >= 0) {
+			if (cache_flushed && clusters) clusters->push_back((unsigned int)(output.size()/3));
+			// Emit every remaining triangle around the fanning vertex
+			candidates.clear();
+			for(unsigned int k=adjacency.offsets[fanning];k<adjacency.offsets[fanning+1];k++) {
+				unsigned int t = adjacency.triangles[k];
+				if (emitted[t]) continue;
+				emitted[t] = true;
+				for(int c=0;c<3;c++) {
+					unsigned int v = idx[3*size_t(t)+c];
+					output.push_back(v);
+					dead_end.push_back(v);
+					candidates.push_back(v);
+					live[v]--;
+					if (stamp-time[v] > cache_size) time[v] = stamp++;
+				}
+			}
+			fanning = mesh_opt_detail::nextVertex(candidates,live,time,stamp,cache_size,dead_end,cursor,cache_flushed);
+		}
+		memcpy(idx,output.data(),output.size()*sizeof(unsigned int));
+		if (clusters) clusters->push_back(nb_tri);
+	}
+
+	inline bool optimizeVertexCache(IndexedMesh& mesh,unsigned int cache_size) {
+		if (!mesh_opt_detail::checkMesh(mesh,"optimizeVertexCache")) return false;
+		optimizeVertexCache(mesh.index_buffer,mesh.nb_primitive,mesh.nb_elts,cache_size);
+		return true;
+	}
+
+	inline bool optimizeOverdraw(IndexedMesh& mesh,float threshold,unsigned int cache_size) {
+		if (!mesh_opt_detail::checkMesh(mesh,"optimizeOverdraw")) return false;
+		const float* pos = NULL;
+		for(size_t b=0;b<mesh.buffers.size();b++) {
+			if ((mesh.attr_id[b] == 0) && (mesh.size_one_elt[b] == 3)) pos = mesh.buffers[b];
+		}
+		if (!pos) {
+			STP3D::setError("optimizeOverdraw : no 3D coordinates (attribute 0)");
+			return false;
+		}
+		unsigned int* idx = mesh.index_buffer;
+		unsigned int nb_tri = mesh.nb_primitive;
+		std::vector<unsigned int> hard;
+		optimizeVertexCache(idx,nb_tri,mesh.nb_elts,cache_size,&hard);
+		if (nb_tri == 0) return true;
+
+		// Soft boundaries : a cluster is cut where its ACMR so far is close enough to the global one
+		float limit = computeCacheStats(idx,nb_tri,mesh.nb_elts,cache_size).acmr*threshold;
+		std::vector<unsigned int> clusters;
+		// FIFO simulation : a vertex is in cache if it entered less than cache_size misses ago
+		std::vector<unsigned int> entered(mesh.nb_elts,0);
+		unsigned int misses = 0;
+		for(size_t h=0;h+1<hard.size();h++) {
+			unsigned int start = hard[h];
+			// Each cluster starts with an empty cache
+			misses += cache_size;
+			unsigned int start_misses = misses;
+			clusters.push_back(start);
+			for(unsigned int t=hard[h];t<hard[h+1];t++) {
+				for(int c=0;c<3;c++) {
+					unsigned int v = idx[3*size_t(t)+c];
+					if ((entered[v] == 0) || (misses-entered[v] >= cache_size)) entered[v] = ++misses;
+				}
+				if ((t+1 < hard[h+1]) && (float(misses-start_misses)/(t+1-start) <= limit)) {
+					start = t+1;
+					misses += cache_size;
+					start_misses = misses;
+					clusters.push_back(start);
+				}
+			}
+		}
+		clusters.push_back(nb_tri);
+
+		// Mesh centroid, then clusters sorted by how much they face outward
+		double center[3] = {0.0,0.0,0.0};
+		for(unsigned int v=0;v<mesh.nb_elts;v++) {
+			for(int c=0;c<3;c++) center[c] += pos[3*size_t(v)+c];
+		}
+		for(int c=0;c<3;c++) center[c] /= std::max(1u,mesh.nb_elts);
+		size_t nb_clusters = clusters.size()-1;
+		std::vector<std::pair<float,unsigned int> > order(nb_clusters);
+		for(size_t k=0;k<nb_clusters;k++) {
+			double centroid[3] = {0.0,0.0,0.0},normal[3] = {0.0,0.0,0.0},area = 0.0;
+			for(unsigned int t=clusters[k];t<clusters[k+1];t++) {
+				const float* p0 = pos+3*size_t(idx[3*size_t(t)]);
+				const float* p1 = pos+3*size_t(idx[3*size_t(t)+1]);
+				const float* p2 = pos+3*size_t(idx[3*size_t(t)+2]);
+				double e1[3] = {p1[0]-p0[0],p1[1]-p0[1],p1[2]-p0[2]};
+				double e2[3] = {p2[0]-p0[0],p2[1]-p0[1],p2[2]-p0[2]};
+				double n[3] = {e1[1]*e2[2]-e1[2]*e2[1],e1[2]*e2[0]-e1[0]*e2[2],e1[0]*e2[1]-e1[1]*e2[0]};
+				double a = std::sqrt(n[0]*n[0]+n[1]*n[1]+n[2]*n[2]);
+				for(int c=0;c<3;c++) {
+					// Area weighted
+					centroid[c] += a*(p0[c]+p1[c]+p2[c])/3.0;
+					normal[c] += n[c];
+				}
+				area += a;
+			}
+			double dot = 0.0;
+			if (area > 0.0) {
+				for(int c=0;c<3;c++) dot += (centroid[c]/area-center[c])*normal[c];
+				double len = std::sqrt(normal[0]*normal[0]+normal[1]*normal[1]+normal[2]*normal[2]);
+				if (len > 0.0) dot /= len;
+			}
+			order[k] = std::make_pair(float(dot),(unsigned int)k);
+		}
+		// Outer clusters first : they hide the inner ones
+		std::stable_sort(order.begin(),order.end(),[](const std::pair<float,unsigned int>& a,const std::pair<float,unsigned int>& b) {
+			return a.first > b.first;
+		});
+		std::vector<unsigned int> sorted;
+		sorted.reserve(3*size_t(nb_tri));
+		for(size_t k=0;k<nb_clusters;k++) {
+			unsigned int c = order[k].second;
+			sorted.insert(sorted.end(),idx+3*size_t(clusters[c]),idx+3*size_t(clusters[c+1]));
+		}
+		memcpy(idx,sorted.data(),sorted.size()*sizeof(unsigned int));
+		return true;
+	}
+
+	inline bool optimizeVertexFetch(IndexedMesh& mesh) {
+		if (!mesh_opt_detail::checkMesh(mesh,"optimizeVertexFetch")) return false;
+		std::vector<unsigned int> remap(mesh.nb_elts,~0u);
+		unsigned int nb_used = 0;
+		size_t nb_idx = 3*size_t(mesh.nb_primitive);
+		for(size_t i=0;i<nb_idx;i++) {
+			unsigned int& r = remap[mesh.index_buffer[i]];
+			if (r == ~0u) r = nb_used++;
+		}
+		mesh_opt_detail::remapVertices(mesh,remap,nb_used);
+		return true;
+	}
+
+	inline MeshOptimizationReport optimizeMesh(IndexedMesh& mesh,float overdraw_threshold,unsigned int cache_size) {
+		MeshOptimizationReport report;
+		if (!mesh_opt_detail::checkMesh(mesh,"optimizeMesh")) return report;
+		report.nbTriangles = mesh.nb_primitive;
+		report.before = computeCacheStats(mesh,cache_size);
+		report.nbWelded = weldVertices(mesh);
+		if (!optimizeOverdraw(mesh,overdraw_threshold,cache_size)) optimizeVertexCache(mesh,cache_size);
+		optimizeVertexFetch(mesh);
+		report.after = computeCacheStats(mesh,cache_size);
+		return report;
+	}
+
+};
+
+#endif
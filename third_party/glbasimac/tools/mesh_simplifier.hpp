@@ -0,0 +1,307 @@
+#ifndef _STP3D_MESH_SIMPLIFIER_HPP_
+#define _STP3D_MESH_SIMPLIFIER_HPP_
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <vector>
+#include "globals.hpp"
+#include "indexed_mesh.hpp"
+
+namespace STP3D {
+
+	/**
+	  * Simplification of indexed triangle meshes with quadric error metrics (Garland and Heckbert 1997).
+	  * Edges are collapsed in order of increasing error, each vertex keeping the sum of the squared
+	  * distances to the planes of its original triangles. Collapses move a vertex onto one of its
+	  * neighbours (half edge collapse) : the kept vertices are original ones, with all their attributes.
+	  * Collapses are ordered by their quadric error weighted by triangle area; the error reported is the root mean
+	  * square distance of the kept vertex to the planes of the triangles it replaces.
+	  * Collapses that would flip a triangle or make the mesh non manifold are refused. Open borders only
+	  * collapse along themselves, and vertices on attribute seams (same position, other normal or uvs,
+	  * as the seam of basicSphere) are kept.
+	  * Positions are the buffer of attribute 0 (3 floats per vertex).
+	  */
+
+	/** Return a simplified copy of \param mesh with at most \param target_triangles triangles, or fewer
+	  * triangles if the error would exceed \param max_error (distance in mesh units). The error of the
+	  * result is written in \param result_error. Return NULL if the mesh can not be simplified
+	  * (not indexed triangles with CPU buffers and positions).
+	  */
+	IndexedMesh* simplifyMesh(const IndexedMesh& mesh,unsigned int target_triangles,float max_error = FLT_MAX,
+	                          float* result_error = NULL);
+
+	namespace simplify_detail {
+
+		/// Symmetric 4x4 quadric : weighted sum of squared distances to planes (10 coefficients)
+		struct Quadric {
+			Quadric():weight(0.0) {for(int i=0;i<10;i++) q[i] = 0.0;}
+			/// Quadric of plane (a,b,c,d) weighted by \param w
+			Quadric(double a,double b,double c,double d,double w):weight(w) {
+				q[0] = w*a*a; q[1] = w*a*b; q[2] = w*a*c; q[3] = w*a*d;
+				q[4] = w*b*b; q[5] = w*b*c; q[6] = w*b*d;
+				q[7] = w*c*c; q[8] = w*c*d; q[9] = w*d*d;
+			}
+			void add(const Quadric& o) {
+				for(int i=0;i<10;i++) q[i] += o.q[i];
+				weight += o.weight;
+			}
+			/// Root mean square distance to the planes (weighted)
+			double distance(const float* p) const {return (weight > 0.0) ? std::sqrt(std::max(0.0,error(p))/weight) : 0.0;}
+			double error(const float* p) const {
+				double x = p[0],y = p[1],z = p[2];
+				return q[0]*x*x + 2.0*q[1]*x*y + 2.0*q[2]*x*z + 2.0*q[3]*x
+				     + q[4]*y*y + 2.0*q[5]*y*z + 2.0*q[6]*y
+				     + q[7]*z*z + 2.0*q[8]*z + q[9];
+			}
+			double q[10];
+			double weight;
+		};
+
+		/// Collapse of vertex from onto vertex to (valid while both keep their version)
+		struct Collapse {
+			double cost;
+			double distance;
+			unsigned int from,to;
+			unsigned int version_from,version_to;
+			bool operator<(const Collapse& o) const {return cost > o.cost;}
+		};
+
+		inline void cross(const double* a,const double* b,double* r) {
+			r[0] = a[1]*b[2]-a[2]*b[1];
+			r[1] = a[2]*b[0]-a[0]*b[2];
+			r[2] = a[0]*b[1]-a[1]*b[0];
+		}
+
+		/// Working state of one simplification
+		struct Simplifier {
+			Simplifier(const float* positions,unsigned int nb_vertices,const unsigned int* idx,unsigned int nb_tri)
+				:pos(positions),nbVertices(nb_vertices),triangles(idx,idx+3*size_t(nb_tri)),removed(nb_tri,false),
+				 nbTriangles(nb_tri),vertexTriangles(nb_vertices),quadrics(nb_vertices),version(nb_vertices,0),
+				 locked(nb_vertices,false),border(nb_vertices,false) {
+				for(unsigned int t=0;t<nb_tri;t++) {
+					for(int c=0;c<3;c++) vertexTriangles[idx[3*size_t(t)+c]].push_back(t);
+				}
+				findSeams();
+				buildQuadrics();
+			}
+
+			/// Vertices sharing their position with another one are attribute seams : locked
+			void findSeams() {
+				std::vector<unsigned int> order(nbVertices);
+				for(unsigned int v=0;v<nbVertices;v++) order[v] = v;
+				std::sort(order.begin(),order.end(),[this](unsigned int a,unsigned int b) {
+					return std::lexicographical_compare(pos+3*size_t(a),pos+3*size_t(a)+3,pos+3*size_t(b),pos+3*size_t(b)+3);
+				});
+				for(size_t i=0;i+1<order.size();i++) {
+					if (memcmp(pos+3*size_t(order[i]),pos+3*size_t(order[i+1]),3*sizeof(float)) == 0) {
+						locked[order[i]] = locked[order[i+1]] = true;
+					}
+				}
+			}
+
+			/// Number of live triangles using edge [a,b]
+			unsigned int edgeUse(unsigned int a,unsigned int b) const {
+				unsigned int n = 0;
+				for(size_t k=0;k<vertexTriangles[a].size();k++) {
+					unsigned int t = vertexTriangles[a][k];
+					if (removed[t]) continue;
+					for(int c=0;c<3;c++) n += (triangles[3*size_t(t)+c] == b);
+				}
+				return n;
+			}
+
+			void buildQuadrics() {
+				for(unsigned int t=0;t<nbTriangles;t++) {
+					const unsigned int* tri = &triangles[3*size_t(t)];
+					double e1[3],e2[3],n[3];
+					for(int c=0;c<3;c++) {
+						e1[c] = pos[3*size_t(tri[1])+c]-pos[3*size_t(tri[0])+c];
+						e2[c] = pos[3*size_t(tri[2])+c]-pos[3*size_t(tri[0])+c];
+					}
+					cross(e1,e2,n);
+					double area = std::sqrt(n[0]*n[0]+n[1]*n[1]+n[2]*n[2]);
+					if (area <= 0.0) continue;
+					for(int c=0;c<3;c++) n[c] /= area;
+					const float* p0 = pos+3*size_t(tri[0]);
+					Quadric plane(n[0],n[1],n[2],-(n[0]*p0[0]+n[1]*p0[1]+n[2]*p0[2]),area);
+					for(int c=0;c<3;c++) quadrics[tri[c]].add(plane);
+
+					// Border edges : plane through the edge, perpendicular to the triangle, with a large weight
+					for(int c=0;c<3;c++) {
+						unsigned int a = tri[c],b = tri[(c+1)%3];
+						if (edgeUse(a,b) != 1) continue;
+						border[a] = border[b] = true;
+						double e[3],m[3];
+						for(int k=0;k<3;k++) e[k] = pos[3*size_t(b)+k]-pos[3*size_t(a)+k];
+						cross(e,n,m);
+						double len = std::sqrt(m[0]*m[0]+m[1]*m[1]+m[2]*m[2]);
+						if (len <= 0.0) continue;
+						for(int k=0;k<3;k++) m[k] /= len;
+						const float* pa = pos+3*size_t(a);
+						Quadric side(m[0],m[1],m[2],-(m[0]*pa[0]+m[1]*pa[1]+m[2]*pa[2]),10.0*area);
+						quadrics[a].add(side);
+						quadrics[b].add(side);
+					}
+				}
+			}
+
+			/// True if moving \param from onto \param to keeps the mesh manifold and no triangle flips
+			bool valid(unsigned int from,unsigned int to) const {
+				if (locked[from]) return false;
+				// Border vertices only slide along their border
+				unsigned int uses = edgeUse(from,to);
+				if (uses == 0) return false;
+				if (border[from] && (uses != 1)) return false;
+				if (!border[from] && border[to] && (uses != 2)) return false;
+				// Link condition : the edge and its (1 or 2) triangles are the only shared neighbourhood
+				std::vector<unsigned int> ring_from,ring_to;
+				neighbours(from,ring_from);
+				neighbours(to,ring_to);
+				unsigned int shared = 0;
+				for(size_t i=0;i<ring_from.size();i++) {
+					shared += (std::find(ring_to.begin(),ring_to.end(),ring_from[i]) != ring_to.end());
+				}
+				if (shared != uses) return false;
+				// Triangles moving with from must keep their orientation
+				const float* pt = pos+3*size_t(to);
+				for(size_t k=0;k<vertexTriangles[from].size();k++) {
+					unsigned int t = vertexTriangles[from][k];
+					if (removed[t]) continue;
+					const unsigned int* tri = &triangles[3*size_t(t)];
+					if ((tri[0] == to) || (tri[1] == to) || (tri[2] == to)) continue;
+					double before[3],after[3],e1[3],e2[3];
+					const float* p[3];
+					for(int c=0;c<3;c++) p[c] = pos+3*size_t(tri[c]);
+					for(int c=0;c<3;c++) {e1[c] = p[1][c]-p[0][c]; e2[c] = p[2][c]-p[0][c];}
+					cross(e1,e2,before);
+					for(int c=0;c<3;c++) if (tri[c] == from) p[c] = pt;
+					for(int c=0;c<3;c++) {e1[c] = p[1][c]-p[0][c]; e2[c] = p[2][c]-p[0][c];}
+					cross(e1,e2,after);
+					double dot = before[0]*after[0]+before[1]*after[1]+before[2]*after[2];
+					double len = std::sqrt(after[0]*after[0]+after[1]*after[1]+after[2]*after[2]);
+					if ((dot <= 0.0) || (len <= 0.0)) return false;
+				}
+				return true;
+			}
+
+			void neighbours(unsigned int v,std::vector<unsigned int>& ring) const {
+				for(size_t k=0;k<vertexTriangles[v].size();k++) {
+					unsigned int t = vertexTriangles[v][k];
+					if (removed[t]) continue;
+					for(int c=0;c<3;c++) {
+						unsigned int w = triangles[3*size_t(t)+c];
+						if ((w != v) && (std::find(ring.begin(),ring.end(),w) == ring.end())) ring.push_back(w);
+					}
+				}
+			}
+
+			void pushCollapses(unsigned int v,std::priority_queue<Collapse>& heap) {
+				std::vector<unsigned int> ring;
+				neighbours(v,ring);
+				for(size_t i=0;i<ring.size();i++) {
+					unsigned int w = ring[i];
+					Quadric q = quadrics[v];
+					q.add(quadrics[w]);
+					const float* pv = pos+3*size_t(v);
+					const float* pw = pos+3*size_t(w);
+					Collapse a = {q.error(pw),q.distance(pw),v,w,version[v],version[w]};
+					Collapse b = {q.error(pv),q.distance(pv),w,v,version[w],version[v]};
+					if (!locked[v]) heap.push(a);
+					if (!locked[w]) heap.push(b);
+				}
+			}
+
+			void collapse(unsigned int from,unsigned int to) {
+				for(size_t k=0;k<vertexTriangles[from].size();k++) {
+					unsigned int t = vertexTriangles[from][k];
+					if (removed[t]) continue;
+					unsigned int* tri = &triangles[3*size_t(t)];
+					if ((tri[0] == to) || (tri[1] == to) || (tri[2] == to)) {
+						removed[t] = true;
+						nbTriangles--;
+						continue;
+					}
+					for(int c=0;c<3;c++) if (tri[c] == from) tri[c] = to;
+					vertexTriangles[to].push_back(t);
+				}
+				vertexTriangles[from].clear();
+				quadrics[to].add(quadrics[from]);
+				version[from]++;
+				version[to]++;
+				if (border[from]) border[to] = true;
+			}
+
+			const float* pos;
+			unsigned int nbVertices;
+			std::vector<unsigned int> triangles;
+			std::vector<bool> removed;
+			unsigned int nbTriangles;
+			std::vector<std::vector<unsigned int> > vertexTriangles;
+			std::vector<Quadric> quadrics;
+			std::vector<unsigned int> version;
+			std::vector<bool> locked;
+			std::vector<bool> border;
+		};
+
+	}
+
+	inline IndexedMesh* simplifyMesh(const IndexedMesh& mesh,unsigned int target_triangles,float max_error,float* result_error) {
+		const float* pos = NULL;
+		for(size_t b=0;b<mesh.buffers.size();b++) {
+			if ((mesh.attr_id[b] == 0) && (mesh.size_one_elt[b] == 3)) pos = mesh.buffers[b];
+		}
+		bool ok = (mesh.gl_type_mesh == GL_TRIANGLES) && mesh.index_buffer && pos;
+		for(size_t b=0;b<mesh.buffers.size();b++) ok = ok && mesh.buffers[b];
+		if (!ok) {
+			STP3D::setError("simplifyMesh : indexed triangles with CPU buffers and 3D coordinates (attribute 0) needed");
+			return NULL;
+		}
+
+		simplify_detail::Simplifier s(pos,mesh.nb_elts,mesh.index_buffer,mesh.nb_primitive);
+		std::priority_queue<simplify_detail::Collapse> heap;
+		for(unsigned int v=0;v<mesh.nb_elts;v++) s.pushCollapses(v,heap);
+		double error = 0.0;
+		while ((s.nbTriangles > target_triangles) && !heap.empty()) {
+			simplify_detail::Collapse c = heap.top();
+			heap.pop();
+			// Stale entry : one of the vertices changed since
+			if ((c.version_from != s.version[c.from]) || (c.version_to != s.version[c.to])) continue;
+			if ((c.distance > max_error) || !s.valid(c.from,c.to)) continue;
+			s.collapse(c.from,c.to);
+			error = std::max(error,c.distance);
+			s.pushCollapses(c.to,heap);
+		}
+		if (result_error) *result_error = float(error);
+
+		// Copy of the vertices still used
+		std::vector<unsigned int> remap(mesh.nb_elts,~0u);
+		unsigned int nb_used = 0;
+		std::vector<unsigned int> idx;
+		idx.reserve(3*size_t(s.nbTriangles));
+		for(unsigned int t=0;t<mesh.nb_primitive;t++) {
+			if (s.removed[t]) continue;
+			for(int c=0;c<3;c++) {
+				unsigned int v = s.triangles[3*size_t(t)+c];
+				if (remap[v] == ~0u) remap[v] = nb_used++;
+				idx.push_back(remap[v]);
+			}
+		}
+		IndexedMesh* result = new IndexedMesh(s.nbTriangles,nb_used,GL_TRIANGLES);
+		for(size_t b=0;b<mesh.buffers.size();b++) {
+			unsigned int size = mesh.size_one_elt[b];
+			float* data = new float[size_t(size)*nb_used];
+			for(unsigned int v=0;v<mesh.nb_elts;v++) {
+				if (remap[v] != ~0u) memcpy(data+size_t(size)*remap[v],mesh.buffers[b]+size_t(size)*v,size*sizeof(float));
+			}
+			result->addOneBuffer(mesh.attr_id[b],size,data,mesh.attr_semantic[b],false);
+		}
+		if (!idx.empty()) memcpy(result->index_buffer,idx.data(),idx.size()*sizeof(unsigned int));
+		return result;
+	}
+
+};
+
+#endif
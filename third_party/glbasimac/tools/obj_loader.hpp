@@ -0,0 +1,311 @@
+#ifndef _STP3D_OBJ_LOADER_HPP_
+#define _STP3D_OBJ_LOADER_HPP_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "globals.hpp"
+#include "indexed_mesh.hpp"
+
+/** \addtogroup Macros */
+/*@{*/
+/** Minimum number of bytes of an OBJ file given to each parsing thread.
+  * Smaller files are parsed by the calling thread only.
+  */
+#define STP3D_OBJ_BYTES_PER_THREAD (1<<20)
+/*@}*/
+
+namespace STP3D {
+
+	/**
+	  * Wavefront OBJ loading into an IndexedMesh : positions (attribute 0), normals (attribute 1)
+	  * and texture coordinates (attribute 2) when the file has them.
+	  * The file is read at once and cut at line boundaries into chunks parsed by \a nb_threads threads
+	  * (0 : one per core, as long as each thread gets STP3D_OBJ_BYTES_PER_THREAD bytes). Each distinct
+	  * position/uv/normal triplet of the faces becomes one vertex; polygons are split in triangle fans.
+	  * Only geometry is read : groups, objects, smoothing groups and materials are ignored.
+	  * Return NULL (see STP3D::getError) if the file can not be read or an index is out of range.
+	  */
+	IndexedMesh* loadOBJ(const std::string& filename,unsigned int nb_threads = 0);
+
+	namespace obj_detail {
+
+		/// Face indices relative to the end of the list (negative in the file) are stored with this offset
+		static const long long RELATIVE = 1LL<<40;
+		static const long long ABSENT = -1;
+
+		/// Content of one chunk of the file
+		struct Chunk {
+			const char* begin;
+			const char* end;
+			std::vector<float> positions,uvs,normals;
+			/// Position, uv and normal of every triangle corner (file numbering, see resolve)
+			std::vector<long long> corners;
+			bool valid;
+		};
+
+		inline bool isBlank(char c) {return (c == ' ') || (c == '\t') || (c == '\r');}
+
+		/// Parse a decimal float (no locale, no allocation). \param s is moved after it
+		inline float parseFloat(const char*& s,const char* end) {
+			static const double pow10[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+			                               1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+			while ((s < end) && isBlank(*s)) s++;
+			bool negative = false;
+			if ((s < end) && ((*s == '-') || (*s == '+'))) negative = (*s++ == '-');
+			unsigned long long mantissa = 0;
+			int exponent = 0,nb_digits = 0;
+			for(;(s < end) && (*s >= '0') && (*s <= '9');s++) {
+				if (nb_digits < 19) {mantissa = 10*mantissa+(*s-'0'); nb_digits += (mantissa != 0);}
+				else exponent++;
+			}
+			if ((s < end) && (*s == '.')) {
+				for(s++;(s < end) && (*s >= '0') && (*s <= '9');s++) {
+					if (nb_digits < 19) {mantissa = 10*mantissa+(*s-'0'); nb_digits += (mantissa != 0); exponent--;}
+				}
+			}
+			if ((s < end) && ((*s == 'e') || (*s == 'E'))) {
+				s++;
+				bool neg_exp = false;
+				if ((s < end) && ((*s == '-') || (*s == '+'))) neg_exp = (*s++ == '-');
+				int e = 0;
+				for(;(s < end) && (*s >= '0') && (*s <= '9');s++) e = std::min(10*e+(*s-'0'),10000);
+				exponent += neg_exp ? -e : e;
+			}
+			double value = double(mantissa);
+			if (exponent != 0) {
+				int abs_exp = std::abs(exponent);
+				double scale = (abs_exp <= 22) ? pow10[abs_exp] : std::pow(10.0,abs_exp);
+				value = (exponent < 0) ? value/scale : value*scale;
+			}
+			return float(negative ? -value : value);
+		}
+
+		/// Parse an index of a face corner (0 if there is none)
+		inline long long parseIndex(const char*& s,const char* end) {
+			bool negative = false;
+			if ((s < end) && (*s == '-')) {negative = true; s++;}
+			long long value = 0;
+			for(;(s < end) && (*s >= '0') && (*s <= '9');s++) value = 10*value+(*s-'0');
+			return negative ? -value : value;
+		}
+
+		/// Store index \param idx of a list which has \param count elements so far in the chunk
+		inline long long encode(long long idx,size_t count) {
+			if (idx > 0) return idx-1;
+			if (idx < 0) return RELATIVE+(long long)count+idx;
+			return ABSENT;
+		}
+
+		/// Index in the whole file of an encoded index of a chunk whose lists start at \param offset
+		inline long long resolve(long long idx,size_t offset) {
+			if (idx >= RELATIVE/2) return idx-RELATIVE+(long long)offset;
+			return idx;
+		}
+
+		inline void parseChunk(Chunk& chunk) {
+			const char* s = chunk.begin;
+			const char* end = chunk.end;
+			std::vector<long long> polygon;
+			chunk.valid = true;
+			while (s < end) {
+				while ((s < end) && isBlank(*s)) s++;
+				if ((s+1 < end) && (s[0] == 'v') && isBlank(s[1])) {
+					s += 1;
+					for(int c=0;c<3;c++) chunk.positions.push_back(parseFloat(s,end));
+				}
+				else if ((s+2 < end) && (s[0] == 'v') && (s[1] == 't') && isBlank(s[2])) {
+					s += 2;
+					for(int c=0;c<2;c++) chunk.uvs.push_back(parseFloat(s,end));
+				}
+				else if ((s+2 < end) && (s[0] == 'v') && (s[1] == 'n') && isBlank(s[2])) {
+					s += 2;
+					for(int c=0;c<3;c++) chunk.normals.push_back(parseFloat(s,end));
+				}
+				else if ((s+1 < end) && (s[0] == 'f') && isBlank(s[1])) {
+					s += 1;
+					polygon.clear();
+					while (true) {
+						while ((s < end) && isBlank(*s)) s++;
+						if ((s >= end) || (*s == '\n') || (*s == '#')) break;
+						long long v = parseIndex(s,end),t = 0,n = 0;
+						if ((s < end) && (*s == '/')) {
+							s++;
+							if ((s < end) && (*s != '/')) t = parseIndex(s,end);
+							if ((s < end) && (*s == '/')) {s++; n = parseIndex(s,end);}
+						}
+						if (v == 0) {chunk.valid = false; break;}
+						polygon.push_back(encode(v,chunk.positions.size()/3));
+						polygon.push_back(encode(t,chunk.uvs.size()/2));
+						polygon.push_back(encode(n,chunk.normals.size()/3));
+						// Skip what can not be read (keeps the loop progressing)
+						while ((s < end) && !isBlank(*s) && (*s != '\n')) s++;
+					}
+					// Triangle fan
+					for(size_t k=2;3*k<polygon.size();k++) {
+						chunk.corners.insert(chunk.corners.end(),polygon.begin(),polygon.begin()+3);
+						chunk.corners.insert(chunk.corners.end(),polygon.begin()+3*(k-1),polygon.begin()+3*(k+1));
+					}
+				}
+				// Next line
+				const char* eol = (const char*)memchr(s,'\n',end-s);
+				s = eol ? eol+1 : end;
+			}
+		}
+
+		/// Open addressing table of the distinct (position,uv,normal) triplets
+		struct VertexTable {
+			VertexTable(size_t nb_corners) {
+				size_t size = 16;
+				while (size < 2*nb_corners) size *= 2;
+				keys.assign(3*size,0);
+				values.assign(size,~0u);
+				mask = size-1;
+			}
+			/// Vertex of triplet \param key, or \param next if it is new
+			unsigned int find(const unsigned int* key,unsigned int next) {
+				size_t h = (key[0]*73856093u) ^ (key[1]*19349663u) ^ (key[2]*83492791u);
+				for(size_t i=h & mask;;i=(i+1) & mask) {
+					if (values[i] == ~0u) {
+						memcpy(&keys[3*i],key,3*sizeof(unsigned int));
+						values[i] = next;
+						return next;
+					}
+					if (memcmp(&keys[3*i],key,3*sizeof(unsigned int)) == 0) return values[i];
+				}
+			}
+			std::vector<unsigned int> keys;
+			std::vector<unsigned int> values;
+			size_t mask;
+		};
+
+		inline void copyAttribute(float* dst,const std::vector<Chunk>& chunks,std::vector<float> Chunk::*list) {
+			for(size_t c=0;c<chunks.size();c++) {
+				const std::vector<float>& src = chunks[c].*list;
+				if (!src.empty()) memcpy(dst,src.data(),src.size()*sizeof(float));
+				dst += src.size();
+			}
+		}
+
+	}
+
+	inline IndexedMesh* loadOBJ(const std::string& filename,unsigned int nb_threads) {
+		FILE* file = fopen(filename.c_str(),"rb");
+		if (!file) {
+			STP3D::setError("loadOBJ : unable to open "+filename);
+			return NULL;
+		}
+		fseek(file,0,SEEK_END);
+		long size = ftell(file);
+		fseek(file,0,SEEK_SET);
+		std::vector<char> data(size > 0 ? size_t(size) : 0);
+		size_t nb_read = data.empty() ? 0 : fread(data.data(),1,data.size(),file);
+		fclose(file);
+		if (nb_read != data.size()) {
+			STP3D::setError("loadOBJ : unable to read "+filename);
+			return NULL;
+		}
+
+		// Chunks cut at line boundaries
+		if (nb_threads == 0) nb_threads = std::max(1u,std::thread::hardware_concurrency());
+		size_t nb_chunks = std::max<size_t>(1,std::min<size_t>(nb_threads,data.size()/STP3D_OBJ_BYTES_PER_THREAD));
+		std::vector<obj_detail::Chunk> chunks(nb_chunks);
+		const char* begin = data.data();
+		const char* end = begin+data.size();
+		for(size_t c=0;c<nb_chunks;c++) {
+			chunks[c].begin = begin;
+			const char* cut = data.data()+data.size()*(c+1)/nb_chunks;
+			if (c+1 == nb_chunks) cut = end;
+			const char* eol = (cut < end) ? (const char*)memchr(cut,'\n',end-cut) : NULL;
+			chunks[c].end = std::max(begin,eol ? eol+1 : end);
+			begin = chunks[c].end;
+		}
+		if (nb_chunks == 1) obj_detail::parseChunk(chunks[0]);
+		else {
+			std::vector<std::thread> workers;
+			for(size_t c=1;c<nb_chunks;c++) workers.push_back(std::thread(obj_detail::parseChunk,std::ref(chunks[c])));
+			obj_detail::parseChunk(chunks[0]);
+			for(size_t t=0;t<workers.size();t++) workers[t].join();
+		}
+
+		// Chunk lists are concatenated : global indices of relative ones
+		size_t nb_pos = 0,nb_uv = 0,nb_nml = 0,nb_corners = 0;
+		std::vector<size_t> offsets(3*nb_chunks);
+		for(size_t c=0;c<nb_chunks;c++) {
+			if (!chunks[c].valid) {
+				STP3D::setError("loadOBJ : wrong face in "+filename);
+				return NULL;
+			}
+			offsets[3*c] = nb_pos; offsets[3*c+1] = nb_uv; offsets[3*c+2] = nb_nml;
+			nb_pos += chunks[c].positions.size()/3;
+			nb_uv += chunks[c].uvs.size()/2;
+			nb_nml += chunks[c].normals.size()/3;
+			nb_corners += chunks[c].corners.size()/3;
+		}
+		std::vector<float> positions(3*nb_pos),uvs(2*nb_uv),normals(3*nb_nml);
+		obj_detail::copyAttribute(positions.data(),chunks,&obj_detail::Chunk::positions);
+		obj_detail::copyAttribute(uvs.data(),chunks,&obj_detail::Chunk::uvs);
+		obj_detail::copyAttribute(normals.data(),chunks,&obj_detail::Chunk::normals);
+
+		// One vertex per distinct triplet (~0u : no uv or no normal)
+		const size_t counts[3] = {nb_pos,nb_uv,nb_nml};
+		obj_detail::VertexTable table(nb_corners);
+		std::vector<unsigned int> vertices;
+		unsigned int* indexes = new unsigned int[nb_corners];
+		size_t corner = 0;
+		bool has_uv = false,has_nml = false;
+		for(size_t c=0;c<nb_chunks;c++) {
+			const std::vector<long long>& src = chunks[c].corners;
+			for(size_t k=0;k<src.size();k+=3,corner++) {
+				unsigned int key[3];
+				for(int a=0;a<3;a++) {
+					if (src[k+a] == obj_detail::ABSENT) {key[a] = ~0u; continue;}
+					long long idx = obj_detail::resolve(src[k+a],offsets[3*c+a]);
+					if ((idx < 0) || (idx >= (long long)counts[a])) {
+						delete[](indexes);
+						STP3D::setError("loadOBJ : index out of range in "+filename);
+						return NULL;
+					}
+					key[a] = (unsigned int)idx;
+				}
+				has_uv = has_uv || (key[1] != ~0u);
+				has_nml = has_nml || (key[2] != ~0u);
+				unsigned int next = (unsigned int)(vertices.size()/3);
+				unsigned int v = table.find(key,next);
+				if (v == next) vertices.insert(vertices.end(),key,key+3);
+				indexes[corner] = v;
+			}
+		}
+		chunks.clear();
+
+		unsigned int nb_vertices = (unsigned int)(vertices.size()/3);
+		IndexedMesh* mesh = new IndexedMesh((unsigned int)(nb_corners/3),nb_vertices,GL_TRIANGLES);
+		float* coord = new float[3*size_t(nb_vertices)];
+		float* nml = has_nml ? new float[3*size_t(nb_vertices)] : NULL;
+		float* uv = has_uv ? new float[2*size_t(nb_vertices)] : NULL;
+		for(size_t v=0;v<nb_vertices;v++) {
+			const unsigned int* key = &vertices[3*v];
+			memcpy(coord+3*v,&positions[3*size_t(key[0])],3*sizeof(float));
+			if (uv) {
+				if (key[1] != ~0u) memcpy(uv+2*v,&uvs[2*size_t(key[1])],2*sizeof(float));
+				else uv[2*v] = uv[2*v+1] = 0.0f;
+			}
+			if (nml) {
+				if (key[2] != ~0u) memcpy(nml+3*v,&normals[3*size_t(key[2])],3*sizeof(float));
+				else nml[3*v] = nml[3*v+1] = nml[3*v+2] = 0.0f;
+			}
+		}
+		mesh->addOneBuffer(0,3,coord,"coordinates",false);
+		if (nml) mesh->addOneBuffer(1,3,nml,"normals",false);
+		if (uv) mesh->addOneBuffer(2,2,uv,"uvs",false);
+		mesh->addIndexBuffer(indexes,false);
+		return mesh;
+	}
+
+};
+
+#endif
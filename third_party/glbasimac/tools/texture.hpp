@@ -87,9 +87,10 @@ namespace STP3D {
 		  * - GL_TEXTURE_WRAP_R sets to GL_REPEAT
 		  * - GL_TEXTURE_WRAP_S sets to GL_REPEAT
 		  * - GL_TEXTURE_MAG_FILTER sets to GL_LINEAR
-		  * - GL_TEXTURE_MIN_FILTER sets to GL_LINEAR
+		  * - GL_TEXTURE_MIN_FILTER sets to GL_LINEAR_MIPMAP_LINEAR (GL_LINEAR without mipmaps)
+		  * \param mipmaps Generate the mipmap chain (true by default). Without mipmaps, minified textures alias
 		  */
-		void initTexture();
+		void initTexture(bool mipmaps = true);
 		/** Set texture filtering parameters.
 		  * This function sets the two wrapping parameters of GL_TEXTURE_MAG_FILTER and GL_TEXTURE_MIN_FILTER
 		  * to value this be choose in 
@@ -225,26 +226,30 @@ namespace STP3D {
 	 * ********** FONCTIONS D'INTERACTION AVEC OPENGL
 	 * ************************************************************************************* */
 
-	inline void Texture2D::initTexture() {
+	inline void Texture2D::initTexture(bool mipmaps) {
 		glGenTextures(1,&gl_id_tex);
 		glBindTexture(GL_TEXTURE_2D,gl_id_tex);
 		glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		// Rows of RVB and LUM images are not padded to 4 bytes
+		glPixelStorei(GL_UNPACK_ALIGNMENT,1);
 
 		if (typetext==TEX_TYPE_RVB) {
-			glTexImage2D(GL_TEXTURE_2D,0,GL_RGB,tex_w,tex_h,0,GL_RGB,GL_UNSIGNED_BYTE,getTab());
+			glTexImage2D(GL_TEXTURE_2D,0,GL_RGB8,tex_w,tex_h,0,GL_RGB,GL_UNSIGNED_BYTE,getTab());
 		}
 		else if (typetext==TEX_TYPE_RVBA) {
-			glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,tex_w,tex_h,0,GL_RGBA,GL_UNSIGNED_BYTE,getTab());
+			glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA8,tex_w,tex_h,0,GL_RGBA,GL_UNSIGNED_BYTE,getTab());
 		}
 		else if (typetext==TEX_TYPE_LUM){
-			glTexImage2D(GL_TEXTURE_2D,0,GL_RED,tex_w,tex_h, 0,GL_RED,GL_UNSIGNED_BYTE,getTab());
+			glTexImage2D(GL_TEXTURE_2D,0,GL_R8,tex_w,tex_h, 0,GL_RED,GL_UNSIGNED_BYTE,getTab());
 		}
 		else {
 			STP3D::setError("[Texture : initTexture] NULL initialization of texture is impossible");
 		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT,4);
+		if (mipmaps) glGenerateMipmap(GL_TEXTURE_2D);
 		glBindTexture(GL_TEXTURE_2D,0);
 		//cout<<"Fin initialisation Texture : "<<*this<<std::endl;
 	}
@@ -265,13 +270,13 @@ namespace STP3D {
 
 	inline void Texture2D::loadTexture(GLuint target_tex) {
 		last_tex_unit = target_tex;
-		glActiveTextureARB(target_tex);
+		glActiveTexture(target_tex);
 		glBindTexture(GL_TEXTURE_2D,gl_id_tex);
 	}
 
 	inline void Texture2D::unloadTexture(GLuint target_tex) {
 		last_tex_unit = target_tex;
-		glActiveTextureARB(last_tex_unit);
+		glActiveTexture(last_tex_unit);
 		glBindTexture(GL_TEXTURE_2D,0);
 	}
 
@@ -0,0 +1,203 @@
+#ifndef _STP3D_VERTEX_LAYOUT_HPP_
+#define _STP3D_VERTEX_LAYOUT_HPP_
+
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include "globals.hpp"
+#include "gl_tools.hpp"
+
+/** \addtogroup Macros */
+/*@{*/
+/** \defgroup vertex_packing Compact formats for interleaved vertex buffers */
+/*@{*/
+/** No packing : every attribute stays in GL_FLOAT. */
+#define STP3D_PACK_NONE             0x0
+/** Texture coordinates (attribute 2) stored as half floats. */
+#define STP3D_PACK_HALF_UVS         0x1
+/** Normals (attribute 1, 3 components) stored as GL_INT_2_10_10_10_REV. */
+#define STP3D_PACK_NORMALS_2101010  0x2
+/** Colors (attribute 3) stored as 4 normalized unsigned bytes. */
+#define STP3D_PACK_UBYTE_COLORS     0x4
+/** All the above. */
+#define STP3D_PACK_ALL              0x7
+/*@}*/
+/*@}*/
+
+namespace STP3D {
+
+	/**
+	  * \brief Format of one attribute inside an interleaved vertex buffer.
+	  * Attribute index follow the basic mesh convention (0 coordinates, 1 normals, 2 uvs, 3 colors).
+	  */
+	struct VertexAttribFormat {
+		unsigned int id_attribute;  ///< Attribute id in shaders
+		unsigned int src_comp;      ///< Number of float components in the source buffer
+		int gl_size;                ///< Number of components declared to GL
+		GLenum gl_type;             ///< GL type of one component
+		GLboolean normalized;       ///< Integer values are normalized
+		unsigned int offset;        ///< Offset (in bytes) in one vertex
+		unsigned int byte_size;     ///< Size (in bytes) of the attribute in one vertex
+	};
+
+	/// Conversion of a float to a IEEE half float (round to nearest)
+	inline unsigned short floatToHalf(float value) {
+		unsigned int f;
+		memcpy(&f,&value,sizeof(float));
+		unsigned int sign = (f >> 16) & 0x8000;
+		unsigned int mantissa = f & 0x7fffff;
+		int exponent = (int)((f >> 23) & 0xff) - 127 + 15;
+		// Infinity and NaN
+		if (((f >> 23) & 0xff) == 0xff) return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+		// Overflow
+		if (exponent >= 31) return sign | 0x7c00;
+		// Denormalized half (or zero)
+		if (exponent <= 0) {
+			if (exponent < -10) return sign;
+			mantissa |= 0x800000;
+			unsigned int shift = 14 - exponent;
+			unsigned int half_m = mantissa >> shift;
+			if ((mantissa >> (shift-1)) & 1) half_m++;
+			return sign | half_m;
+		}
+		unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+		// Rounding may carry into the exponent, which is the expected result
+		if (mantissa & 0x1000) half++;
+		return half;
+	}
+
+	/// Pack a normal (x,y,z) in a GL_INT_2_10_10_10_REV word (w is set to 0)
+	inline unsigned int packNormal2101010(float x,float y,float z) {
+		int ix = (int)floor(STP3D::clamp(x,-1.0f,1.0f)*511.0f+0.5f);
+		int iy = (int)floor(STP3D::clamp(y,-1.0f,1.0f)*511.0f+0.5f);
+		int iz = (int)floor(STP3D::clamp(z,-1.0f,1.0f)*511.0f+0.5f);
+		return ((unsigned int)(iz & 0x3ff) << 20) | ((unsigned int)(iy & 0x3ff) << 10) | (unsigned int)(ix & 0x3ff);
+	}
+
+	/// Conversion of a float in [0,1] to a normalized unsigned byte
+	inline unsigned char floatToUnorm8(float v) {
+		return (unsigned char)(STP3D::clamp(v,0.0f,1.0f)*255.0f+0.5f);
+	}
+
+	/** Compute the interleaved layout of a set of float buffers.
+	  * \param attr_id attribute id of each buffer
+	  * \param size_one_elt number of float components of each buffer
+	  * \param packing combination of STP3D_PACK_* flags
+	  * \param formats resulting format of each attribute
+	  * \return the stride (size in bytes of one vertex)
+	  */
+	inline unsigned int computeInterleavedLayout(const std::vector<unsigned int>& attr_id,
+	                                             const std::vector<unsigned int>& size_one_elt,
+	                                             unsigned int packing,
+	                                             std::vector<VertexAttribFormat>& formats) {
+		formats.clear();
+		unsigned int offset = 0;
+		for(unsigned int i=0;i<attr_id.size();i++) {
+			VertexAttribFormat fmt;
+			fmt.id_attribute = attr_id[i];
+			fmt.src_comp = size_one_elt[i];
+			fmt.gl_size = size_one_elt[i];
+			fmt.gl_type = GL_FLOAT;
+			fmt.normalized = GL_FALSE;
+			fmt.byte_size = size_one_elt[i]*sizeof(GLfloat);
+			if ((attr_id[i] == 1) && (size_one_elt[i] == 3) && (packing & STP3D_PACK_NORMALS_2101010)) {
+				fmt.gl_size = 4;
+				fmt.gl_type = GL_INT_2_10_10_10_REV;
+				fmt.normalized = GL_TRUE;
+				fmt.byte_size = 4;
+			}
+			else if ((attr_id[i] == 2) && (packing & STP3D_PACK_HALF_UVS)) {
+				fmt.gl_type = GL_HALF_FLOAT;
+				fmt.byte_size = size_one_elt[i]*sizeof(unsigned short);
+			}
+			else if ((attr_id[i] == 3) && (size_one_elt[i] <= 4) && (packing & STP3D_PACK_UBYTE_COLORS)) {
+				fmt.gl_size = 4;
+				fmt.gl_type = GL_UNSIGNED_BYTE;
+				fmt.normalized = GL_TRUE;
+				fmt.byte_size = 4;
+			}
+			// Every attribute is aligned on 4 bytes
+			fmt.byte_size = (fmt.byte_size+3) & ~3u;
+			fmt.offset = offset;
+			offset += fmt.byte_size;
+			formats.push_back(fmt);
+		}
+		return offset;
+	}
+
+	/** Fill \a dest (stride*nb_elts bytes) with the interleaved and packed content of \a buffers.
+	  */
+	inline void interleaveBuffers(const std::vector<float*>& buffers,unsigned int nb_elts,
+	                              const std::vector<VertexAttribFormat>& formats,unsigned int stride,
+	                              unsigned char* dest) {
+		memset(dest,0,stride*nb_elts);
+		for(unsigned int a=0;a<formats.size();a++) {
+			const VertexAttribFormat& fmt = formats[a];
+			const float* src = buffers[a];
+			for(unsigned int v=0;v<nb_elts;v++,src+=fmt.src_comp) {
+				unsigned char* dst = dest+v*stride+fmt.offset;
+				if (fmt.gl_type == GL_FLOAT) {
+					memcpy(dst,src,fmt.src_comp*sizeof(GLfloat));
+				}
+				else if (fmt.gl_type == GL_HALF_FLOAT) {
+					for(unsigned int c=0;c<fmt.src_comp;c++) {
+						unsigned short h = floatToHalf(src[c]);
+						memcpy(dst+c*sizeof(unsigned short),&h,sizeof(unsigned short));
+					}
+				}
+				else if (fmt.gl_type == GL_INT_2_10_10_10_REV) {
+					unsigned int n = packNormal2101010(src[0],src[1],src[2]);
+					memcpy(dst,&n,sizeof(unsigned int));
+				}
+				else if (fmt.gl_type == GL_UNSIGNED_BYTE) {
+					for(unsigned int c=0;c<4;c++) {
+						dst[c] = (c < fmt.src_comp) ? floatToUnorm8(src[c]) : 255;
+					}
+				}
+			}
+		}
+	}
+
+	/** Create one interleaved VBO from a set of float buffers and set the attribute pointers.
+	  * The VAO must be bound by the caller.
+	  * \return the stride (size in bytes of one vertex), 0 if an error occured
+	  */
+	inline unsigned int createInterleavedVBO(const std::vector<float*>& buffers,unsigned int nb_elts,
+	                                         const std::vector<unsigned int>& attr_id,
+	                                         const std::vector<unsigned int>& size_one_elt,
+	                                         unsigned int packing,unsigned int& id_vbo) {
+		std::vector<VertexAttribFormat> formats;
+		unsigned int stride = computeInterleavedLayout(attr_id,size_one_elt,packing,formats);
+		for(unsigned int i=0;i<buffers.size();i++) {
+			if (buffers[i] == NULL) {
+				STP3D::setError("Impossible to interleave a buffer whose CPU memory has been released");
+				return 0;
+			}
+		}
+		std::vector<unsigned char> data(stride*nb_elts);
+		interleaveBuffers(buffers,nb_elts,formats,stride,data.data());
+
+		glGenBuffers(1,&id_vbo);
+		if (id_vbo == 0) {
+			STP3D::setError("Unable to find an empty VBO for interleaved buffer");
+			return 0;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER,id_vbo);
+		glBufferData(GL_ARRAY_BUFFER,data.size(),data.data(),GL_STATIC_DRAW);
+		STP3D_COUNT(buffer_bytes,data.size());
+		for(unsigned int i=0;i<formats.size();i++) {
+			glEnableVertexAttribArray(formats[i].id_attribute);
+			glVertexAttribPointer(formats[i].id_attribute,formats[i].gl_size,formats[i].gl_type,
+			                      formats[i].normalized,stride,(const void*)(size_t)formats[i].offset);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER,0);
+		return stride;
+	}
+
+};
+
+#endif
+
+